@@ -0,0 +1,172 @@
+#include <algorithm>
+using std::fill;
+using std::max;
+using std::min;
+
+#include <mutex>
+using std::unique_lock;
+
+#include <vector>
+using std::vector;
+
+#include "batch_prefetcher.hxx"
+
+BatchPrefetcher::BatchPrefetcher(
+    const ImagesInterface& _images, const vector<long>& _order, int32_t _batch_size, int32_t _channels,
+    bool _use_thread, int32_t _max_shift, bool _flip, uint32_t seed
+)
+    : images(_images), order(_order), generator(seed) {
+    batch_size = _batch_size;
+    channels = _channels;
+    image_height = images.get_image_height();
+    image_width = images.get_image_width();
+
+    max_shift = _max_shift;
+    flip = _flip;
+
+    use_thread = _use_thread;
+    ready[0] = false;
+    ready[1] = false;
+    holding = false;
+    finished = false;
+    stopping = false;
+    current_slot = 0;
+    next_start = 0;
+
+    if (use_thread) {
+        worker = thread(&BatchPrefetcher::run, this);
+    }
+}
+
+BatchPrefetcher::~BatchPrefetcher() {
+    if (use_thread) {
+        {
+            unique_lock<mutex> lock(slot_mutex);
+            stopping = true;
+        }
+        slot_condition.notify_all();
+        worker.join();
+    }
+}
+
+void BatchPrefetcher::prepare(int32_t slot, int32_t batch_start) {
+    vector<int>& batch = batches[slot];
+    batch.clear();
+    for (int32_t k = 0; k < batch_size && (batch_start + k) < (int32_t) order.size(); k++) {
+        batch.push_back(order[batch_start + k]);
+    }
+
+    int32_t channel_size = batch.size() * image_height * image_width;
+    values[slot].resize(channels * channel_size);
+
+    for (int32_t channel = 0; channel < channels; channel++) {
+        images.get_batch(batch, channel, values[slot].data() + (channel * channel_size));
+    }
+
+    if (max_shift > 0 || flip) {
+        augment(slot);
+    }
+}
+
+void BatchPrefetcher::augment(int32_t slot) {
+    int32_t image_size = image_height * image_width;
+    int32_t number_images = batches[slot].size();
+    staging.resize(image_size);
+
+    for (int32_t i = 0; i < number_images; i++) {
+        int32_t shift_y = 0;
+        int32_t shift_x = 0;
+        if (max_shift > 0) {
+            shift_y = (int32_t) (generator() % (2 * max_shift + 1)) - max_shift;
+            shift_x = (int32_t) (generator() % (2 * max_shift + 1)) - max_shift;
+        }
+        bool flip_image = flip && (generator() % 2 == 1);
+
+        if (shift_y == 0 && shift_x == 0 && !flip_image) {
+            continue;
+        }
+
+        for (int32_t channel = 0; channel < channels; channel++) {
+            float* image = values[slot].data() + (((channel * number_images) + i) * image_size);
+            staging.assign(image, image + image_size);
+            fill(image, image + image_size, 0.0f);
+
+            // output pixel (y, x) comes from (y - shift_y, x - shift_x) of the (possibly flipped) image
+            int32_t y_start = max(0, shift_y);
+            int32_t y_end = min(image_height, image_height + shift_y);
+            int32_t x_start = max(0, shift_x);
+            int32_t x_end = min(image_width, image_width + shift_x);
+
+            for (int32_t y = y_start; y < y_end; y++) {
+                const float* source_row = staging.data() + ((y - shift_y) * image_width);
+                float* row = image + (y * image_width);
+
+                for (int32_t x = x_start; x < x_end; x++) {
+                    int32_t source_x = x - shift_x;
+                    row[x] = source_row[flip_image ? image_width - 1 - source_x : source_x];
+                }
+            }
+        }
+    }
+}
+
+void BatchPrefetcher::run() {
+    int32_t slot = 0;
+    for (int32_t batch_start = 0; batch_start < (int32_t) order.size(); batch_start += batch_size) {
+        {
+            unique_lock<mutex> lock(slot_mutex);
+            slot_condition.wait(lock, [&] { return !ready[slot] || stopping; });
+            if (stopping) {
+                return;
+            }
+        }
+
+        // the slot is not being trained on, so it can be filled without holding the lock
+        prepare(slot, batch_start);
+
+        {
+            unique_lock<mutex> lock(slot_mutex);
+            ready[slot] = true;
+        }
+        slot_condition.notify_all();
+        slot = 1 - slot;
+    }
+
+    {
+        unique_lock<mutex> lock(slot_mutex);
+        finished = true;
+    }
+    slot_condition.notify_all();
+}
+
+bool BatchPrefetcher::next_batch(vector<int>& batch, const float*& batch_values) {
+    if (!use_thread) {
+        if (next_start >= (int32_t) order.size()) {
+            return false;
+        }
+        prepare(0, next_start);
+        next_start += batch_size;
+
+        batch = batches[0];
+        batch_values = values[0].data();
+        return true;
+    }
+
+    unique_lock<mutex> lock(slot_mutex);
+    if (holding) {
+        ready[current_slot] = false;
+        current_slot = 1 - current_slot;
+        holding = false;
+        slot_condition.notify_all();
+    }
+
+    slot_condition.wait(lock, [&] { return ready[current_slot] || finished; });
+    if (!ready[current_slot]) {
+        return false;
+    }
+
+    holding = true;
+    batch = batches[current_slot];
+    batch_values = values[current_slot].data();
+    return true;
+}
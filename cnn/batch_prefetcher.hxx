@@ -0,0 +1,80 @@
+#ifndef CNN_BATCH_PREFETCHER_HXX
+#define CNN_BATCH_PREFETCHER_HXX
+
+#include <condition_variable>
+using std::condition_variable;
+
+#include <mutex>
+using std::mutex;
+
+#include <random>
+using std::minstd_rand0;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "image_tools/image_set_interface.hxx"
+#include "stdint.h"
+
+/**
+ * Prepares the input values of the batches of an epoch: gathering, normalizing and padding each image (and
+ * optionally shifting and flipping it) into a buffer laid out channel by channel, so each input node can copy its
+ * channel of the batch in one go. With a helper thread the two buffers are double buffered, so the next batch is
+ * prepared while the current one trains; without one each batch is prepared when it is asked for.
+ *
+ * Augmentation shifts each image by up to max_shift pixels in y and x (filling with 0, the normalized mean, as the
+ * padding is) and flips it horizontally half the time. The same shift and flip is used for every channel of an
+ * image, and is drawn from the prefetcher's own generator so it does not change the genome's random numbers.
+ */
+class BatchPrefetcher {
+   private:
+    const ImagesInterface& images;
+    const vector<long>& order;
+
+    int32_t batch_size;
+    int32_t channels;
+    int32_t image_height;
+    int32_t image_width;
+
+    int32_t max_shift;
+    bool flip;
+    minstd_rand0 generator;
+    vector<float> staging;
+
+    vector<int> batches[2];
+    vector<float> values[2];
+
+    bool use_thread;
+    thread worker;
+    mutex slot_mutex;
+    condition_variable slot_condition;
+
+    bool ready[2];
+    bool holding;
+    bool finished;
+    bool stopping;
+    int32_t current_slot;
+    int32_t next_start;
+
+    void prepare(int32_t slot, int32_t batch_start);
+    void augment(int32_t slot);
+    void run();
+
+   public:
+    BatchPrefetcher(
+        const ImagesInterface& _images, const vector<long>& _order, int32_t _batch_size, int32_t _channels,
+        bool _use_thread, int32_t _max_shift, bool _flip, uint32_t seed
+    );
+    ~BatchPrefetcher();
+
+    /**
+     * Hands out the next batch of the order, returning false once there are none left. The values stay valid until
+     * the next call, which gives the buffer back to be refilled.
+     */
+    bool next_batch(vector<int>& batch, const float*& batch_values);
+};
+
+#endif
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <cmath>
 using std::isinf;
 using std::isnan;
@@ -26,9 +28,11 @@ using std::minstd_rand0;
 using std::normal_distribution;
 
 #include <sstream>
-#include <thread>
 using std::ostringstream;
 
+#include <thread>
+using std::thread;
+
 #include <stdexcept>
 using std::runtime_error;
 
@@ -42,6 +46,7 @@ using std::vector;
 #include "cnn_node.hxx"
 #include "common/random.hxx"
 #include "comparison.hxx"
+#include "convolution_backend.hxx"
 #include "image_tools/image_set.hxx"
 #include "pooling.hxx"
 #include "propagation.hxx"
@@ -557,6 +562,7 @@ void CNN_Edge::resize() {
 
     initialize_pools(y_pools, y_pool_offset, input_node->get_size_y(), output_node->get_size_y());
     initialize_pools(x_pools, x_pool_offset, input_node->get_size_x(), output_node->get_size_x());
+    pool_buffers.clear_repeats();
 
     needs_initialization = true;
 }
@@ -590,6 +596,27 @@ void CNN_Edge::set_weights_to_best() {
     previous_velocity_scale = best_velocity_scale;
 }
 
+void CNN_Edge::get_best_weights(vector<float>& _best_weights, float& _best_scale) const {
+    _best_weights.assign(best_weights, best_weights + filter_size);
+    _best_scale = best_scale;
+}
+
+void CNN_Edge::set_weights(const vector<float>& _weights, float _scale) {
+    for (int32_t i = 0; i < filter_size; i++) {
+        weights[i] = _weights[i];
+        best_weights[i] = _weights[i];
+        previous_velocity[i] = 0.0;
+        best_velocity[i] = 0.0;
+    }
+
+    scale = _scale;
+    best_scale = _scale;
+    previous_velocity_scale = 0.0;
+    best_velocity_scale = 0.0;
+
+    needs_initialization = false;
+}
+
 CNN_Edge* CNN_Edge::copy() const {
     CNN_Edge* copy = new CNN_Edge();
 
@@ -725,6 +752,7 @@ bool CNN_Edge::set_nodes(const vector<CNN_Node*> nodes) {
 void CNN_Edge::set_pools() {
     initialize_pools(y_pools, y_pool_offset, input_node->get_size_y(), output_node->get_size_y());
     initialize_pools(x_pools, x_pool_offset, input_node->get_size_x(), output_node->get_size_x());
+    pool_buffers.clear_repeats();
 }
 
 bool CNN_Edge::is_filter_correct() const {
@@ -977,9 +1005,162 @@ void CNN_Edge::check_output_update(
     }
 }
 
+void CNN_Edge::convolve_forward(const float* input, float* output, int32_t batch_start, int32_t number_images) {
+    int output_size_x = output_node->get_size_x();
+    int output_size_y = output_node->get_size_y();
+    int input_size_x = input_node->get_size_x();
+    int input_size_y = input_node->get_size_y();
+
+    input += batch_start * input_size_y * input_size_x;
+    output += batch_start * output_size_y * output_size_x;
+
+    ConvolutionShape shape;
+    shape.batch_size = number_images;
+    shape.input_size_y = input_size_y;
+    shape.input_size_x = input_size_x;
+    shape.filter_y = filter_y;
+    shape.filter_x = filter_x;
+    shape.output_size_y = output_size_y;
+    shape.output_size_x = output_size_x;
+    shape.reverse_y = reverse_filter_y;
+    shape.reverse_x = reverse_filter_x;
+
+    ConvolutionAutotuner::forward(shape, input, weights, output);
+}
+
+void CNN_Edge::convolve_tile(
+    const float* input, float* output, int32_t input_size_y, int32_t input_size_x, int32_t output_size_y,
+    int32_t output_size_x
+) const {
+    ConvolutionShape shape;
+    shape.batch_size = 1;
+    shape.input_size_y = input_size_y;
+    shape.input_size_x = input_size_x;
+    shape.filter_y = filter_y;
+    shape.filter_x = filter_x;
+    shape.output_size_y = output_size_y;
+    shape.output_size_x = output_size_x;
+    shape.reverse_y = false;
+    shape.reverse_x = false;
+
+    ConvolutionAutotuner::forward(shape, input, weights, output);
+}
+
+void CNN_Edge::pool_inference(
+    const float* input, float* pool_gradients, float* output, int32_t number_images, PoolBuffers& buffers,
+    minstd_rand0& generator
+) const {
+    bool fractional_y = is_fractional(y_pools);
+    bool fractional_x = is_fractional(x_pools);
+
+    if (!(fractional_y || fractional_x)) {
+        pool_images(
+            input, pool_gradients, output, y_pools, x_pools, y_pool_offset, x_pool_offset, number_images, buffers
+        );
+        return;
+    }
+
+    // the same averaging over shuffled pools as propagate_forward, but with the caller's repeats
+    if (buffers.repeat_y_pools.size() == 0) {
+        initialize_repeats(buffers, y_pools, x_pools, fractional_y, fractional_x, generator);
+    }
+
+    int32_t output_size = number_images * output_node->get_size_y() * output_node->get_size_x();
+    buffers.repeat_output.assign(output_size, 0.0f);
+
+    for (int32_t i = 0; i < POOL_REPEATS; i++) {
+        pool_images(
+            input, pool_gradients, buffers.repeat_output.data(), buffers.repeat_y_pools[i], buffers.repeat_x_pools[i],
+            buffers.repeat_y_pool_offset[i], buffers.repeat_x_pool_offset[i], number_images, buffers
+        );
+    }
+
+    for (int32_t i = 0; i < output_size; i++) {
+        output[i] += buffers.repeat_output[i] / POOL_REPEATS;
+    }
+}
+
+void CNN_Edge::convolve_backward(
+    float* output_errors, float* input, float* input_errors, float* updates, int32_t batch_start,
+    int32_t number_images
+) {
+    int output_size_x = output_node->get_size_x();
+    int output_size_y = output_node->get_size_y();
+    int input_size_x = input_node->get_size_x();
+    int input_size_y = input_node->get_size_y();
+
+    output_errors += batch_start * output_size_y * output_size_x;
+    input += batch_start * input_size_y * input_size_x;
+    input_errors += batch_start * input_size_y * input_size_x;
+
+    // the prop_backward functions average over the images they are given, so calculate the updates
+    // for this part of the batch separately and rescale them to the full batch size
+    vector<float> partial_updates(filter_size, 0.0);
+
+    if (reverse_filter_x && reverse_filter_y) {
+        prop_backward_ry_rx(
+            output_errors, input, input_errors, partial_updates.data(), weights, number_images, input_size_y,
+            input_size_x, filter_y, filter_x, output_size_y, output_size_x
+        );
+    } else if (reverse_filter_y) {
+        prop_backward_ry(
+            output_errors, input, input_errors, partial_updates.data(), weights, number_images, input_size_y,
+            input_size_x, filter_y, filter_x, output_size_y, output_size_x
+        );
+    } else if (reverse_filter_x) {
+        prop_backward_rx(
+            output_errors, input, input_errors, partial_updates.data(), weights, number_images, input_size_y,
+            input_size_x, filter_y, filter_x, output_size_y, output_size_x
+        );
+    } else {
+        prop_backward(
+            output_errors, input, input_errors, partial_updates.data(), weights, number_images, input_size_y,
+            input_size_x, filter_y, filter_x, output_size_y, output_size_x
+        );
+    }
+
+    float batch_fraction = (float) number_images / batch_size;
+    for (int32_t current = 0; current < filter_size; current++) {
+        updates[current] += partial_updates[current] * batch_fraction;
+    }
+}
+
+void CNN_Edge::pool_images(
+    const float* input, float* pool_gradients, float* output, const vector<int>& current_y_pools,
+    const vector<int>& current_x_pools, const vector<int>& current_y_pool_offset,
+    const vector<int>& current_x_pool_offset, int32_t number_images, PoolBuffers& buffers
+) const {
+    int output_size_x = output_node->get_size_x();
+    int output_size_y = output_node->get_size_y();
+    int input_size_x = input_node->get_size_x();
+    int input_size_y = input_node->get_size_y();
+
+    if (reverse_filter_y && reverse_filter_x) {
+        pool_forward_ry_rx(
+            input, scale, pool_gradients, output, number_images, input_size_y, input_size_x, output_size_y,
+            output_size_x, current_y_pools, current_x_pools, current_y_pool_offset, current_x_pool_offset, buffers
+        );
+    } else if (reverse_filter_y) {
+        pool_forward_ry(
+            input, scale, pool_gradients, output, number_images, input_size_y, input_size_x, output_size_y,
+            output_size_x, current_y_pools, current_x_pools, current_y_pool_offset, current_x_pool_offset, buffers
+        );
+    } else if (reverse_filter_x) {
+        pool_forward_rx(
+            input, scale, pool_gradients, output, number_images, input_size_y, input_size_x, output_size_y,
+            output_size_x, current_y_pools, current_x_pools, current_y_pool_offset, current_x_pool_offset, buffers
+        );
+    } else {
+        pool_forward(
+            input, scale, pool_gradients, output, number_images, input_size_y, input_size_x, output_size_y,
+            output_size_x, current_y_pools, current_x_pools, current_y_pool_offset, current_x_pool_offset, buffers
+        );
+    }
+}
+
 void CNN_Edge::propagate_forward(
     bool training, bool accumulate_test_statistics, float epsilon, float alpha, bool perform_dropout,
-    float hidden_dropout_probability, minstd_rand0& generator
+    float hidden_dropout_probability, minstd_rand0& generator, int32_t batch_threads
 ) {
     if (!is_reachable()) {
         return;
@@ -1005,34 +1186,32 @@ void CNN_Edge::propagate_forward(
 
     int output_size_x = output_node->get_size_x();
     int output_size_y = output_node->get_size_y();
-    int input_size_x = input_node->get_size_x();
-    int input_size_y = input_node->get_size_y();
 
     if (type == CONVOLUTIONAL) {
-        if (reverse_filter_y && reverse_filter_x) {
-            prop_forward_ry_rx(
-                input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
-                output_size_x
-            );
-        } else if (reverse_filter_y) {
-            prop_forward_ry(
-                input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
-                output_size_x
-            );
-        } else if (reverse_filter_x) {
-            prop_forward_rx(
-                input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
-                output_size_x
-            );
+        if (batch_threads <= 1 || batch_size < 2) {
+            convolve_forward(input, output, 0, batch_size);
         } else {
-            prop_forward(
-                input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
-                output_size_x
-            );
+            // each image of the batch is independent so the threads can write their part of the output directly
+            int32_t number_threads = std::min(batch_threads, batch_size);
+            vector<thread> threads;
+            for (int32_t i = 0; i < number_threads; i++) {
+                int32_t batch_start = (batch_size * i) / number_threads;
+                int32_t batch_end = (batch_size * (i + 1)) / number_threads;
+                threads.push_back(
+                    thread(&CNN_Edge::convolve_forward, this, input, output, batch_start, batch_end - batch_start)
+                );
+            }
+
+            for (int32_t i = 0; i < (int32_t) threads.size(); i++) {
+                threads[i].join();
+            }
         }
 
     } else if (type == POOLING) {
 #ifdef NAN_CHECKS
+        int input_size_x = input_node->get_size_x();
+        int input_size_y = input_node->get_size_y();
+
         if (y_pools.size() != output_size_y) {
             cerr << "ERROR: POOLING y_pools.size: " << y_pools.size() << " != output_size_y: " << output_size_y
                  << ", input_size_y: " << input_size_y << endl;
@@ -1056,78 +1235,46 @@ void CNN_Edge::propagate_forward(
         cout << endl;
         */
 
-        bool max_pooling = true;
-        if (reverse_filter_y && reverse_filter_x) {
-            if (input_size_y % output_size_y == 0) {
-                fisher_yates_shuffle(generator, y_pools);
-                update_offset(y_pools, y_pool_offset);
-                max_pooling = false;
-            }
+        // fractional pools (where the input does not divide evenly into the output) are shuffled every training
+        // batch, and inference averages over a fixed set of shuffles drawn the first time they are needed. even pools
+        // are the same in any order, so they take a single deterministic pass
+        bool fractional_y = is_fractional(y_pools);
+        bool fractional_x = is_fractional(x_pools);
 
-            if (input_size_x % output_size_x == 0) {
-                fisher_yates_shuffle(generator, x_pools);
-                update_offset(x_pools, x_pool_offset);
-                max_pooling = false;
-            }
-
-            pool_forward_ry_rx(
-                input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, max_pooling
-            );
-
-        } else if (reverse_filter_y) {
-            if (output_size_y % input_size_y == 0) {
+        if (training || !(fractional_y || fractional_x)) {
+            if (fractional_y) {
                 fisher_yates_shuffle(generator, y_pools);
                 update_offset(y_pools, y_pool_offset);
-                max_pooling = false;
             }
 
-            if (input_size_x % output_size_x == 0) {
+            if (fractional_x) {
                 fisher_yates_shuffle(generator, x_pools);
                 update_offset(x_pools, x_pool_offset);
-                max_pooling = false;
             }
 
-            pool_forward_ry(
-                input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, max_pooling
+            pool_images(
+                input, pool_gradients, output, y_pools, x_pools, y_pool_offset, x_pool_offset, batch_size, pool_buffers
             );
 
-        } else if (reverse_filter_x) {
-            if (input_size_y % output_size_y == 0) {
-                fisher_yates_shuffle(generator, y_pools);
-                update_offset(y_pools, y_pool_offset);
-                max_pooling = false;
-            }
-
-            if (output_size_x % input_size_x == 0) {
-                fisher_yates_shuffle(generator, x_pools);
-                update_offset(x_pools, x_pool_offset);
-                max_pooling = false;
+        } else {
+            if (pool_buffers.repeat_y_pools.size() == 0) {
+                initialize_repeats(pool_buffers, y_pools, x_pools, fractional_y, fractional_x, generator);
             }
 
-            pool_forward_rx(
-                input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, max_pooling
-            );
+            int32_t output_batch_size = batch_size * output_size_y * output_size_x;
+            pool_buffers.repeat_output.assign(output_batch_size, 0.0f);
 
-        } else {
-            if (output_size_y % input_size_y == 0) {
-                fisher_yates_shuffle(generator, y_pools);
-                update_offset(y_pools, y_pool_offset);
-                max_pooling = false;
+            for (int32_t i = 0; i < POOL_REPEATS; i++) {
+                pool_images(
+                    input, pool_gradients, pool_buffers.repeat_output.data(), pool_buffers.repeat_y_pools[i],
+                    pool_buffers.repeat_x_pools[i], pool_buffers.repeat_y_pool_offset[i],
+                    pool_buffers.repeat_x_pool_offset[i], batch_size, pool_buffers
+                );
             }
 
-            if (output_size_x % input_size_x == 0) {
-                fisher_yates_shuffle(generator, x_pools);
-                update_offset(x_pools, x_pool_offset);
-                max_pooling = false;
+            for (int32_t i = 0; i < output_batch_size; i++) {
+                output[i] += pool_buffers.repeat_output[i] / POOL_REPEATS;
             }
-
-            pool_forward(
-                input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, max_pooling
-            );
         }
 
     } else {
@@ -1243,7 +1390,7 @@ void CNN_Edge::update_weights(float mu, float learning_rate, float weight_decay)
     weight_update_time += time_span.count() / 1000.0;
 }
 
-void CNN_Edge::propagate_backward(bool training, float mu, float learning_rate, float epsilon) {
+void CNN_Edge::propagate_backward(bool training, float mu, float learning_rate, float epsilon, int32_t batch_threads) {
     if (!is_reachable()) {
         return;
     }
@@ -1266,26 +1413,52 @@ void CNN_Edge::propagate_backward(bool training, float mu, float learning_rate,
     }
 
     if (type == CONVOLUTIONAL) {
-        if (reverse_filter_x && reverse_filter_y) {
-            prop_backward_ry_rx(
-                output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x,
-                filter_y, filter_x, output_size_y, output_size_x
-            );
-        } else if (reverse_filter_y) {
-            prop_backward_ry(
-                output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x,
-                filter_y, filter_x, output_size_y, output_size_x
-            );
-        } else if (reverse_filter_x) {
-            prop_backward_rx(
-                output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x,
-                filter_y, filter_x, output_size_y, output_size_x
-            );
+        if (batch_threads <= 1 || batch_size < 2) {
+            if (reverse_filter_x && reverse_filter_y) {
+                prop_backward_ry_rx(
+                    output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y,
+                    input_size_x, filter_y, filter_x, output_size_y, output_size_x
+                );
+            } else if (reverse_filter_y) {
+                prop_backward_ry(
+                    output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y,
+                    input_size_x, filter_y, filter_x, output_size_y, output_size_x
+                );
+            } else if (reverse_filter_x) {
+                prop_backward_rx(
+                    output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y,
+                    input_size_x, filter_y, filter_x, output_size_y, output_size_x
+                );
+            } else {
+                prop_backward(
+                    output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y,
+                    input_size_x, filter_y, filter_x, output_size_y, output_size_x
+                );
+            }
         } else {
-            prop_backward(
-                output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x,
-                filter_y, filter_x, output_size_y, output_size_x
-            );
+            // the input errors of each image are independent, but every image adds to the weight updates,
+            // so each thread gets its own accumulator which are summed in thread order afterwards
+            int32_t number_threads = std::min(batch_threads, batch_size);
+            vector<vector<float>> thread_updates(number_threads, vector<float>(filter_size, 0.0));
+            vector<thread> threads;
+            for (int32_t i = 0; i < number_threads; i++) {
+                int32_t batch_start = (batch_size * i) / number_threads;
+                int32_t batch_end = (batch_size * (i + 1)) / number_threads;
+                threads.push_back(thread(
+                    &CNN_Edge::convolve_backward, this, output_errors, input, input_errors, thread_updates[i].data(),
+                    batch_start, batch_end - batch_start
+                ));
+            }
+
+            for (int32_t i = 0; i < (int32_t) threads.size(); i++) {
+                threads[i].join();
+            }
+
+            for (int32_t i = 0; i < number_threads; i++) {
+                for (int32_t current = 0; current < filter_size; current++) {
+                    weight_updates[current] += thread_updates[i][current];
+                }
+            }
         }
 
     } else if (type == POOLING) {
@@ -1562,6 +1735,7 @@ istream& operator>>(istream& is, CNN_Edge* edge) {
 
     update_offset(edge->y_pools, edge->y_pool_offset);
     update_offset(edge->x_pools, edge->x_pool_offset);
+    edge->pool_buffers.clear_repeats();
 
     /*
        cerr << "edge " << edge->innovation_number << ", y_pools: ";
@@ -25,6 +25,7 @@ using std::vector;
 #include "cnn_node.hxx"
 #include "common/random.hxx"
 #include "image_tools/image_set.hxx"
+#include "pooling.hxx"
 
 #define CONVOLUTIONAL 0
 #define POOLING       1
@@ -63,6 +64,7 @@ class CNN_Edge {
     vector<int> y_pool_offset;
     vector<int> x_pools;
     vector<int> x_pool_offset;
+    PoolBuffers pool_buffers;
 
     bool fixed;
     bool disabled;
@@ -122,6 +124,9 @@ class CNN_Edge {
     void save_best_weights();
     void set_weights_to_best();
 
+    void get_best_weights(vector<float>& _best_weights, float& _best_scale) const;
+    void set_weights(const vector<float>& _weights, float _scale);
+
     bool set_nodes(const vector<CNN_Node*> nodes);
     void set_pools();
 
@@ -174,12 +179,55 @@ class CNN_Edge {
         int in_y, int in_x
     );
 
+    /**
+     * Runs the convolution over the images [batch_start, batch_start + number_images) of the batch, the backward
+     * version adds the weight updates for those images (scaled by the full batch size) into updates.
+     */
+    void convolve_forward(const float* input, float* output, int32_t batch_start, int32_t number_images);
+    void convolve_backward(
+        float* output_errors, float* input, float* input_errors, float* updates, int32_t batch_start,
+        int32_t number_images
+    );
+
+    /**
+     * Convolves an input of any size with this edge's filter, for inference over tiles which are larger than the
+     * nodes the edge connects. Only for convolutional edges without reversed filters, where the output is the
+     * input size - filter size + 1.
+     */
+    void convolve_tile(
+        const float* input, float* output, int32_t input_size_y, int32_t input_size_x, int32_t output_size_y,
+        int32_t output_size_x
+    ) const;
+
+    /**
+     * Runs the pooling kernel for the edge's reversed filters over number_images images with the given pools.
+     */
+    void pool_images(
+        const float* input, float* pool_gradients, float* output, const vector<int>& current_y_pools,
+        const vector<int>& current_x_pools, const vector<int>& current_y_pool_offset,
+        const vector<int>& current_x_pool_offset, int32_t number_images, PoolBuffers& buffers
+    ) const;
+
+    /**
+     * Pools number_images images the way propagate_forward does when not training, but with the caller's buffers
+     * (so it can be used outside of the genome, e.g., by a CompiledGenome). Fractional pools are averaged over
+     * repeats which are drawn into the buffers the first time they are used.
+     */
+    void pool_inference(
+        const float* input, float* pool_gradients, float* output, int32_t number_images, PoolBuffers& buffers,
+        minstd_rand0& generator
+    ) const;
+
+    /**
+     * The batch_threads argument splits a convolutional edge's batch over that many threads, the backward pass
+     * gives each thread its own weight update accumulator and sums them afterwards.
+     */
     void propagate_forward(
         bool training, bool accumulate_test_statistics, float epsilon, float alpha, bool perform_dropout,
-        float hidden_dropout_probability, minstd_rand0& generator
+        float hidden_dropout_probability, minstd_rand0& generator, int32_t batch_threads = 1
     );
 
-    void propagate_backward(bool training, float mu, float learning_rate, float epsilon);
+    void propagate_backward(bool training, float mu, float learning_rate, float epsilon, int32_t batch_threads = 1);
     void update_weights(float mu, float learning_rate, float weight_decay);
 
     void print_statistics();
@@ -45,6 +45,9 @@ using std::ostringstream;
 using std::string;
 using std::to_string;
 
+#include <thread>
+using std::thread;
+
 #include <vector>
 using std::vector;
 
@@ -52,6 +55,7 @@ using std::vector;
 #include "common/db_conn.hxx"
 #endif
 
+#include "batch_prefetcher.hxx"
 #include "cnn_edge.hxx"
 #include "cnn_genome.hxx"
 #include "cnn_node.hxx"
@@ -63,6 +67,7 @@ using std::vector;
 #include "image_tools/image_set.hxx"
 #include "image_tools/large_image_set.hxx"
 #include "stdint.h"
+#include "tiled_inference.hxx"
 
 void write_map(ostream& out, map<string, int>& m) {
     out << m.size();
@@ -91,6 +96,11 @@ void read_map(istream& in, map<string, int>& m) {
 CNN_Genome::CNN_Genome(string filename, bool is_checkpoint) {
     exact_id = -1;
     genome_id = -1;
+    number_threads = 1;
+    prefetch_batches = true;
+    augment_shift = 0;
+    augment_flip = false;
+    tile_size = 0;
     started_from_checkpoint = is_checkpoint;
 
     string file_contents;
@@ -109,6 +119,11 @@ CNN_Genome::CNN_Genome(string filename, bool is_checkpoint) {
 CNN_Genome::CNN_Genome(istream& in, bool is_checkpoint) {
     exact_id = -1;
     genome_id = -1;
+    number_threads = 1;
+    prefetch_batches = true;
+    augment_shift = 0;
+    augment_flip = false;
+    tile_size = 0;
     started_from_checkpoint = is_checkpoint;
     read(in);
 }
@@ -117,6 +132,57 @@ void CNN_Genome::set_progress_function(int (*_progress_function)(float)) {
     progress_function = _progress_function;
 }
 
+void CNN_Genome::set_number_threads(int _number_threads) {
+    if (_number_threads < 1) {
+        cerr << "ERROR: number of threads for a genome must be >= 1, was " << _number_threads << endl;
+        exit(1);
+    }
+    number_threads = _number_threads;
+}
+
+int CNN_Genome::get_number_threads() const {
+    return number_threads;
+}
+
+void CNN_Genome::set_prefetch_batches(bool _prefetch_batches) {
+    prefetch_batches = _prefetch_batches;
+}
+
+void CNN_Genome::set_augmentation(int _augment_shift, bool _augment_flip) {
+    if (_augment_shift < 0) {
+        cerr << "ERROR: augmentation shift for a genome must be >= 0, was " << _augment_shift << endl;
+        exit(1);
+    }
+    augment_shift = _augment_shift;
+    augment_flip = _augment_flip;
+}
+
+void CNN_Genome::set_tile_size(int _tile_size) {
+    if (_tile_size < 0) {
+        cerr << "ERROR: tile size for a genome must be >= 0, was " << _tile_size << endl;
+        exit(1);
+    }
+    tile_size = _tile_size;
+}
+
+int CNN_Genome::get_tile_size() const {
+    return tile_size;
+}
+
+bool CNN_Genome::is_fully_convolutional() const {
+    for (uint32_t i = 0; i < edges.size(); i++) {
+        if (!edges[i]->is_reachable()) {
+            continue;
+        }
+
+        if (edges[i]->get_type() != CONVOLUTIONAL || edges[i]->is_reverse_filter_y()
+            || edges[i]->is_reverse_filter_x()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int CNN_Genome::get_genome_id() const {
     return genome_id;
 }
@@ -165,6 +231,10 @@ float CNN_Genome::get_alpha() const {
     return alpha;
 }
 
+float CNN_Genome::get_epsilon() const {
+    return epsilon;
+}
+
 int CNN_Genome::get_velocity_reset() const {
     return velocity_reset;
 }
@@ -201,6 +271,11 @@ void parse_array(vector<T>& output, istringstream& iss) {
 #ifdef _MYSQL_
 CNN_Genome::CNN_Genome(int _genome_id) {
     progress_function = NULL;
+    number_threads = 1;
+    prefetch_batches = true;
+    augment_shift = 0;
+    augment_flip = false;
+    tile_size = 0;
     version_str = EXACT_VERSION_STR;
 
     ostringstream query;
@@ -495,6 +570,11 @@ CNN_Genome::CNN_Genome(
 ) {
     exact_id = -1;
     genome_id = -1;
+    number_threads = 1;
+    prefetch_batches = true;
+    augment_shift = 0;
+    augment_flip = false;
+    tile_size = 0;
     started_from_checkpoint = false;
     generator = minstd_rand0(seed);
 
@@ -847,6 +927,14 @@ const vector<CNN_Edge*> CNN_Genome::get_edges() const {
     return edges;
 }
 
+const vector<CNN_Node*> CNN_Genome::get_input_nodes() const {
+    return input_nodes;
+}
+
+const vector<CNN_Node*> CNN_Genome::get_softmax_nodes() const {
+    return softmax_nodes;
+}
+
 void CNN_Genome::get_node_copies(vector<CNN_Node*>& node_copies) const {
     node_copies.clear();
 
@@ -1301,6 +1389,226 @@ bool CNN_Genome::visit_nodes() {
     return true;
 }
 
+/**
+ * Groups the edges of one level so that edges which write to the same node end up in the same group. Edges are
+ * joined with a small union find over the nodes they write to, and each group keeps the edges in their original
+ * order.
+ */
+void group_level_edges(const vector<CNN_Edge*>& level_edges, bool forward, vector<vector<CNN_Edge*> >& groups) {
+    vector<int32_t> parent(level_edges.size());
+    for (int32_t i = 0; i < (int32_t) level_edges.size(); i++) {
+        parent[i] = i;
+    }
+
+    auto find_root = [&parent](int32_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    map<CNN_Node*, int32_t> node_edges;
+    for (int32_t i = 0; i < (int32_t) level_edges.size(); i++) {
+        CNN_Edge* edge = level_edges[i];
+
+        vector<CNN_Node*> written_nodes;
+        if (forward) {
+            written_nodes.push_back(edge->get_output_node());
+            // pooling edges also write the pool gradients of their input node
+            if (edge->get_type() == POOLING) {
+                written_nodes.push_back(edge->get_input_node());
+            }
+        } else {
+            written_nodes.push_back(edge->get_input_node());
+        }
+
+        for (CNN_Node* node : written_nodes) {
+            auto it = node_edges.find(node);
+            if (it == node_edges.end()) {
+                node_edges[node] = i;
+            } else {
+                parent[find_root(i)] = find_root(it->second);
+            }
+        }
+    }
+
+    groups.clear();
+    map<int32_t, int32_t> root_groups;
+    for (int32_t i = 0; i < (int32_t) level_edges.size(); i++) {
+        int32_t root = find_root(i);
+        auto it = root_groups.find(root);
+        if (it == root_groups.end()) {
+            root_groups[root] = groups.size();
+            groups.push_back(vector<CNN_Edge*>());
+            groups.back().push_back(level_edges[i]);
+        } else {
+            groups[it->second].push_back(level_edges[i]);
+        }
+    }
+}
+
+void CNN_Genome::get_forward_levels(vector<vector<vector<CNN_Edge*> > >& levels) {
+    levels.clear();
+
+    // edges are sorted by the depth of their input node, and a node is only complete once every edge
+    // from a shallower depth has fired, so each depth is a level
+    vector<CNN_Edge*> level_edges;
+    float current_depth = -1.0;
+    for (uint32_t i = 0; i < edges.size(); i++) {
+        if (!edges[i]->is_reachable()) {
+            continue;
+        }
+
+        float depth = edges[i]->get_input_node()->get_depth();
+        if (depth != current_depth && level_edges.size() > 0) {
+            levels.push_back(vector<vector<CNN_Edge*> >());
+            group_level_edges(level_edges, true, levels.back());
+            level_edges.clear();
+        }
+        current_depth = depth;
+        level_edges.push_back(edges[i]);
+    }
+
+    if (level_edges.size() > 0) {
+        levels.push_back(vector<vector<CNN_Edge*> >());
+        group_level_edges(level_edges, true, levels.back());
+    }
+}
+
+void CNN_Genome::get_backward_levels(vector<vector<vector<CNN_Edge*> > >& levels) {
+    levels.clear();
+
+    vector<CNN_Edge*> level_edges;
+    float current_depth = -1.0;
+    for (int32_t i = edges.size() - 1; i >= 0; i--) {
+        if (!edges[i]->is_reachable()) {
+            continue;
+        }
+
+        float depth = edges[i]->get_input_node()->get_depth();
+        if (depth != current_depth && level_edges.size() > 0) {
+            levels.push_back(vector<vector<CNN_Edge*> >());
+            group_level_edges(level_edges, false, levels.back());
+            level_edges.clear();
+        }
+        current_depth = depth;
+        level_edges.push_back(edges[i]);
+    }
+
+    if (level_edges.size() > 0) {
+        levels.push_back(vector<vector<CNN_Edge*> >());
+        group_level_edges(level_edges, false, levels.back());
+    }
+}
+
+void propagate_forward_thread(
+    const vector<vector<CNN_Edge*> >& groups, int32_t thread_id, int32_t number_threads, bool training,
+    bool accumulate_test_statistics, float epsilon, float alpha, float hidden_dropout_probability,
+    int32_t batch_threads, int32_t seed
+) {
+    // dropout and pooling draw random numbers, so each thread needs its own generator
+    minstd_rand0 generator(seed);
+
+    for (int32_t i = thread_id; i < (int32_t) groups.size(); i += number_threads) {
+        for (CNN_Edge* edge : groups[i]) {
+            edge->propagate_forward(
+                training, accumulate_test_statistics, epsilon, alpha, training, hidden_dropout_probability, generator,
+                batch_threads
+            );
+        }
+    }
+}
+
+void propagate_backward_thread(
+    const vector<vector<CNN_Edge*> >& groups, int32_t thread_id, int32_t number_threads, bool training, float mu,
+    float learning_rate, float epsilon, int32_t batch_threads
+) {
+    for (int32_t i = thread_id; i < (int32_t) groups.size(); i += number_threads) {
+        for (CNN_Edge* edge : groups[i]) {
+            edge->propagate_backward(training, mu, learning_rate, epsilon, batch_threads);
+        }
+    }
+}
+
+void CNN_Genome::propagate_forward(bool training, bool accumulate_test_statistics) {
+    if (number_threads <= 1) {
+        for (uint32_t i = 0; i < edges.size(); i++) {
+            edges[i]->propagate_forward(
+                training, accumulate_test_statistics, epsilon, alpha, training, hidden_dropout_probability, generator
+            );
+        }
+        return;
+    }
+
+    vector<vector<vector<CNN_Edge*> > > levels;
+    get_forward_levels(levels);
+
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        const vector<vector<CNN_Edge*> >& groups = levels[level];
+
+        // threads not needed for the groups of this level split the batches of its edges
+        int32_t level_threads = std::min(number_threads, (int) groups.size());
+        int32_t batch_threads = std::max(1, number_threads / level_threads);
+
+        if (level_threads == 1) {
+            for (CNN_Edge* edge : groups[0]) {
+                edge->propagate_forward(
+                    training, accumulate_test_statistics, epsilon, alpha, training, hidden_dropout_probability,
+                    generator, batch_threads
+                );
+            }
+            continue;
+        }
+
+        vector<thread> threads;
+        for (int32_t i = 0; i < level_threads; i++) {
+            threads.push_back(thread(
+                propagate_forward_thread, std::cref(groups), i, level_threads, training, accumulate_test_statistics,
+                epsilon, alpha, hidden_dropout_probability, batch_threads, (int32_t) generator()
+            ));
+        }
+
+        for (int32_t i = 0; i < (int32_t) threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+}
+
+void CNN_Genome::propagate_backward(bool training) {
+    if (number_threads <= 1) {
+        for (int32_t i = edges.size() - 1; i >= 0; i--) {
+            edges[i]->propagate_backward(training, mu, learning_rate, epsilon);
+        }
+    } else {
+        vector<vector<vector<CNN_Edge*> > > levels;
+        get_backward_levels(levels);
+
+        for (uint32_t level = 0; level < levels.size(); level++) {
+            const vector<vector<CNN_Edge*> >& groups = levels[level];
+
+            int32_t level_threads = std::min(number_threads, (int) groups.size());
+            int32_t batch_threads = std::max(1, number_threads / level_threads);
+
+            vector<thread> threads;
+            for (int32_t i = 0; i < level_threads; i++) {
+                threads.push_back(thread(
+                    propagate_backward_thread, std::cref(groups), i, level_threads, training, mu, learning_rate,
+                    epsilon, batch_threads
+                ));
+            }
+
+            for (int32_t i = 0; i < (int32_t) threads.size(); i++) {
+                threads[i].join();
+            }
+        }
+    }
+
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        edges[i]->update_weights(mu, learning_rate, weight_decay);
+    }
+}
+
 void CNN_Genome::evaluate_images(
     const ImagesInterface& images, const vector<int>& batch, vector<vector<float> >& predictions, int offset
 ) {
@@ -1317,11 +1625,7 @@ void CNN_Genome::evaluate_images(
         );
     }
 
-    for (uint32_t i = 0; i < edges.size(); i++) {
-        edges[i]->propagate_forward(
-            training, accumulate_test_statistics, epsilon, alpha, training, hidden_dropout_probability, generator
-        );
-    }
+    propagate_forward(training, accumulate_test_statistics);
 
     // may be less images than in a batch if the total number of images is not divisible by the batch size
     for (int32_t batch_number = 0; batch_number < batch.size(); batch_number++) {
@@ -1629,23 +1933,27 @@ void CNN_Genome::check_gradients(const ImagesInterface& images) {
 
 void CNN_Genome::evaluate_images(
     const ImagesInterface& images, const vector<int>& batch, bool training, float& total_error,
-    int& correct_predictions, bool accumulate_test_statistics
+    int& correct_predictions, bool accumulate_test_statistics, const float* batch_values
 ) {
     for (uint32_t i = 0; i < nodes.size(); i++) {
         nodes[i]->reset();
     }
 
+    int channel_size = batch.size() * images.get_image_height() * images.get_image_width();
     for (uint32_t channel = 0; channel < input_nodes.size(); channel++) {
-        input_nodes[channel]->set_values(
-            images, batch, channel, training, accumulate_test_statistics, input_dropout_probability, generator
-        );
+        if (batch_values != NULL) {
+            input_nodes[channel]->set_values(
+                images, batch_values + (channel * channel_size), batch.size(), training, accumulate_test_statistics,
+                input_dropout_probability, generator
+            );
+        } else {
+            input_nodes[channel]->set_values(
+                images, batch, channel, training, accumulate_test_statistics, input_dropout_probability, generator
+            );
+        }
     }
 
-    for (uint32_t i = 0; i < edges.size(); i++) {
-        edges[i]->propagate_forward(
-            training, accumulate_test_statistics, epsilon, alpha, training, hidden_dropout_probability, generator
-        );
-    }
+    propagate_forward(training, accumulate_test_statistics);
 
     vector<float> values_in(softmax_nodes.size());
     vector<float> values_out(softmax_nodes.size());
@@ -1715,13 +2023,7 @@ void CNN_Genome::evaluate_images(
     }
 
     if (training) {
-        for (int32_t i = edges.size() - 1; i >= 0; i--) {
-            edges[i]->propagate_backward(training, mu, learning_rate, epsilon);
-        }
-
-        for (int32_t i = 0; i < edges.size(); i++) {
-            edges[i]->update_weights(mu, learning_rate, weight_decay);
-        }
+        propagate_backward(training);
     }
 }
 
@@ -1854,11 +2156,29 @@ void CNN_Genome::print_progress(
         << weight_decay << endl;
 }
 
+bool CNN_Genome::use_tiled_inference() const {
+    if (tile_size == 0) {
+        return false;
+    }
+
+    if (!is_fully_convolutional()) {
+        cout << "genome has pooling or reversed filters, so it cannot be tiled, evaluating each subimage separately."
+             << endl;
+        return false;
+    }
+    return true;
+}
+
 void CNN_Genome::evaluate_large_images(const LargeImages& images, string output_directory) {
     int current_subimage = 0;
 
     vector<vector<int> > bins(images.get_number_classes(), vector<int>(10, 0));
 
+    TiledInference* tiled_inference = NULL;
+    if (use_tiled_inference()) {
+        tiled_inference = new TiledInference(this, tile_size, number_threads);
+    }
+
     // cout << "number classes: " << images.get_number_classes() << endl;
 
     for (int image_number = 0; image_number < images.get_number_large_images(); image_number++) {
@@ -1870,7 +2190,24 @@ void CNN_Genome::evaluate_large_images(const LargeImages& images, string output_
         vector<vector<float> > predictions(number_subimages, vector<float>(images.get_number_classes(), 0.0));
         // cout << "created vector!" << endl;
 
-        for (uint32_t j = 0; j < number_subimages; j += batch_size) {
+        int32_t map_width = images.get_large_image_width(image_number) - images.get_image_width()
+                            + (2 * images.get_padding()) + 1;
+        vector<float> band;
+
+        // the subimages are in the same row by row order as the windows of the tiled prediction map
+        for (int32_t band_y = 0; tiled_inference != NULL && band_y * map_width < number_subimages;
+             band_y += tile_size) {
+            int32_t band_height = std::min(tile_size, (number_subimages / map_width) - band_y);
+            tiled_inference->evaluate_band(images, image_number, band_y, band_height, band);
+
+            for (int32_t j = 0; j < band_height * map_width; j++) {
+                for (int32_t k = 0; k < images.get_number_classes(); k++) {
+                    predictions[(band_y * map_width) + j][k] = band[(j * tiled_inference->get_number_classes()) + k];
+                }
+            }
+        }
+
+        for (uint32_t j = 0; tiled_inference == NULL && j < number_subimages; j += batch_size) {
             // cout << "image " << image_number << ", number subimages: " << number_subimages << ", batch is: ";
             vector<int> batch;
             for (uint32_t k = 0; k < batch_size && (j + k) < number_subimages; k++) {
@@ -1921,6 +2258,8 @@ void CNN_Genome::evaluate_large_images(const LargeImages& images, string output_
         }
     }
 
+    delete tiled_inference;
+
     for (uint32_t i = 0; i < images.get_number_classes(); i++) {
         cout << "bins for class " << i << endl;
 
@@ -1935,6 +2274,12 @@ void CNN_Genome::evaluate_large_images(const LargeImages& images, string output_
 void CNN_Genome::get_prediction_matrix(
     const MultiImagesInterface& images, int image_number, int stride, vector<vector<vector<float> > >& prediction_matrix
 ) {
+    if (use_tiled_inference()) {
+        TiledInference tiled_inference(this, tile_size, number_threads);
+        tiled_inference.get_prediction_matrix(images, image_number, prediction_matrix);
+        return;
+    }
+
     int number_subimages = images.get_number_subimages(image_number);
 
     // TODO: fix, number classes should be equal to number of softmax nodes of genome
@@ -2098,16 +2443,23 @@ void CNN_Genome::evaluate(
         edges[i]->reset_times();
     }
 
-    for (uint32_t j = 0; j < order.size(); j += batch_size) {
-        vector<int> batch;
-        for (uint32_t k = 0; k < batch_size && (j + k) < order.size(); k++) {
-            batch.push_back(order[j + k]);
-        }
+    // only training batches are augmented, and the augmentation seed is only drawn when there is augmentation so
+    // the genome's random numbers are the same as without the prefetcher otherwise
+    bool augment = perform_backprop && (augment_shift > 0 || augment_flip);
+    uint32_t augment_seed = augment ? generator() : 0;
+    BatchPrefetcher prefetcher(
+        images, order, batch_size, input_nodes.size(), prefetch_batches, augment ? augment_shift : 0,
+        augment && augment_flip, augment_seed
+    );
 
+    vector<int> batch;
+    const float* batch_values;
+    while (prefetcher.next_batch(batch, batch_values)) {
         float batch_total_error = 0.0;
         int batch_correct_predictions = 0;
         evaluate_images(
-            images, batch, training, batch_total_error, batch_correct_predictions, accumulate_test_statistics
+            images, batch, training, batch_total_error, batch_correct_predictions, accumulate_test_statistics,
+            batch_values
         );
 
         /*
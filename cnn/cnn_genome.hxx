@@ -89,6 +89,32 @@ class CNN_Genome {
 
     int (*progress_function)(float);
 
+    // how many threads propagate the edges of this genome, this is a runtime setting and is not written out
+    int number_threads;
+
+    // how the training batches are staged, these are also runtime settings which are not written out
+    bool prefetch_batches;
+    int augment_shift;
+    bool augment_flip;
+
+    // when > 0, large images are evaluated a tile of tile_size x tile_size windows at a time if the genome is fully
+    // convolutional (see TiledInference), also a runtime setting
+    int tile_size;
+
+    /**
+     * Groups the reachable edges into levels which have to be run in order. The groups within a level can run in
+     * parallel: for the forward pass edges which share an output node (or a pooling edge's input node) are in the
+     * same group, and for the backward pass edges which share an input node are. Each group keeps the edges in the
+     * same order as the serial passes, so a node's values and errors are accumulated in the same order.
+     */
+    void get_forward_levels(vector<vector<vector<CNN_Edge*> > >& levels);
+    void get_backward_levels(vector<vector<vector<CNN_Edge*> > >& levels);
+
+    bool use_tiled_inference() const;
+
+    void propagate_forward(bool training, bool accumulate_test_statistics);
+    void propagate_backward(bool training);
+
    public:
     /**
      *  Initialize a genome from a file
@@ -140,6 +166,29 @@ class CNN_Genome {
 
     void set_progress_function(int (*_progress_function)(float));
 
+    /**
+     * Sets how many threads are used to train and evaluate this genome. Independent edges at the same depth are
+     * run on separate threads, and any leftover threads split the batch of each convolutional edge.
+     */
+    void set_number_threads(int _number_threads);
+    int get_number_threads() const;
+
+    /**
+     * With prefetching (the default) the next batch is gathered and normalized on a helper thread while the current
+     * one trains. Training batches can also be augmented by shifting each image up to augment_shift pixels in y and
+     * x and flipping it horizontally half the time, see BatchPrefetcher.
+     */
+    void set_prefetch_batches(bool _prefetch_batches);
+    void set_augmentation(int _augment_shift, bool _augment_flip);
+    void set_tile_size(int _tile_size);
+    int get_tile_size() const;
+
+    /**
+     * Whether every reachable edge is a convolution without reversed filters, so the genome can be applied to tiles
+     * larger than its input nodes.
+     */
+    bool is_fully_convolutional() const;
+
     int get_generation_id() const;
 
     float get_best_validation_error() const;
@@ -167,6 +216,8 @@ class CNN_Genome {
 
     const vector<CNN_Node*> get_nodes() const;
     const vector<CNN_Edge*> get_edges() const;
+    const vector<CNN_Node*> get_input_nodes() const;
+    const vector<CNN_Node*> get_softmax_nodes() const;
 
     CNN_Node* get_node(int node_position);
     CNN_Edge* get_edge(int edge_position);
@@ -183,6 +234,7 @@ class CNN_Genome {
     int get_batch_size() const;
 
     float get_alpha() const;
+    float get_epsilon() const;
     int get_velocity_reset() const;
 
     float get_input_dropout_probability() const;
@@ -215,7 +267,7 @@ class CNN_Genome {
     );
     void evaluate_images(
         const ImagesInterface& images, const vector<int>& batch, bool training, float& total_error,
-        int& correct_predictions, bool accumulate_test_statistics
+        int& correct_predictions, bool accumulate_test_statistics, const float* batch_values = NULL
     );
 
     void set_to_best();
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 // using std::isnan;
 // using std::isinf;
@@ -1093,15 +1094,12 @@ void CNN_Node::backpropagate_batch_normalization(bool training, float mu, float
     // ", gamma now: " << gamma << ", beta now: " << beta << endl;
 }
 
-void CNN_Node::set_values(
-    const ImagesInterface& images, const vector<int>& batch, int channel, bool perform_dropout,
-    bool accumulate_test_statistics, float input_dropout_probability, minstd_rand0& generator
-) {
+void CNN_Node::check_input_size(const ImagesInterface& images, int number_images) const {
     // images.size() may be less than batch size, in the case when the total number of images is not divisible by the
     // batch_size
-    if (batch.size() > batch_size) {
+    if (number_images > batch_size) {
         ostringstream error_message;
-        error_message << "ERROR: number of batch images: " << batch.size()
+        error_message << "ERROR: number of batch images: " << number_images
                       << " > batch_size of input node: " << batch_size << endl;
         throw runtime_error(error_message.str());
     }
@@ -1119,18 +1117,33 @@ void CNN_Node::set_values(
                       << " != size_x of input node: " << size_x << endl;
         throw runtime_error(error_message.str());
     }
+}
+
+void CNN_Node::set_values(
+    const ImagesInterface& images, const vector<int>& batch, int channel, bool perform_dropout,
+    bool accumulate_test_statistics, float input_dropout_probability, minstd_rand0& generator
+) {
+    check_input_size(images, batch.size());
 
     // images.size() may be less than batch size, in the case when the total number of images is not divisible by the
     // batch_size
-    int current = 0;
-    for (int32_t batch_number = 0; batch_number < batch.size(); batch_number++) {
-        for (int32_t y = 0; y < size_y; y++) {
-            for (int32_t x = 0; x < size_x; x++) {
-                values_out[current] = images.get_pixel(batch[batch_number], channel, y, x);
-                current++;
-            }
-        }
+    images.get_batch(batch, channel, values_out);
+
+    if (input_dropout_probability > 0) {
+        apply_dropout(
+            values_out, relu_gradients, perform_dropout, accumulate_test_statistics, input_dropout_probability,
+            generator
+        );
     }
+}
+
+void CNN_Node::set_values(
+    const ImagesInterface& images, const float* channel_values, int number_images, bool perform_dropout,
+    bool accumulate_test_statistics, float input_dropout_probability, minstd_rand0& generator
+) {
+    check_input_size(images, number_images);
+
+    std::copy(channel_values, channel_values + (number_images * size_y * size_x), values_out);
 
     if (input_dropout_probability > 0) {
         apply_dropout(
@@ -1140,6 +1153,67 @@ void CNN_Node::set_values(
     }
 }
 
+void CNN_Node::apply_inference(
+    float* values, int32_t number_values, float epsilon, float input_dropout_probability,
+    float hidden_dropout_probability
+) const {
+    // the same operations (in the same order) as set_values and input_fired when not training, so the values match
+    if (type == INPUT_NODE) {
+        if (input_dropout_probability > 0) {
+            float dropout_scale = 1.0 - input_dropout_probability;
+            for (int32_t current = 0; current < number_values; current++) {
+                values[current] *= dropout_scale;
+            }
+        }
+        return;
+    }
+
+    if (type == SOFTMAX_NODE) {
+        return;
+    }
+
+    float dropout_scale = 1.0 - hidden_dropout_probability;
+    float term1 = gamma / exact_sqrt(running_variance + epsilon);
+    float term2 = beta - ((gamma * running_mean) / exact_sqrt(running_variance + epsilon));
+
+    for (int32_t current = 0; current < number_values; current++) {
+        float value = values[current];
+
+        if (value <= RELU_MIN) {
+            value = value * RELU_MIN_LEAK;
+        } else if (value > RELU_MAX) {
+            value = RELU_MAX;
+        }
+
+        if (hidden_dropout_probability > 0) {
+            value *= dropout_scale;
+        }
+
+        values[current] = (term1 * value) + term2;
+    }
+}
+
+void CNN_Node::get_inference_affine(
+    float epsilon, float input_dropout_probability, float hidden_dropout_probability, float& multiplier,
+    float& offset
+) const {
+    multiplier = 1.0;
+    offset = 0.0;
+
+    if (type == INPUT_NODE) {
+        if (input_dropout_probability > 0) {
+            multiplier = 1.0 - input_dropout_probability;
+        }
+    } else if (type != SOFTMAX_NODE) {
+        multiplier = gamma / exact_sqrt(running_variance + epsilon);
+        offset = beta - ((gamma * running_mean) / exact_sqrt(running_variance + epsilon));
+
+        if (hidden_dropout_probability > 0) {
+            multiplier *= 1.0 - hidden_dropout_probability;
+        }
+    }
+}
+
 void CNN_Node::input_fired(
     bool training, bool accumulate_test_statistics, float epsilon, float alpha, bool perform_dropout,
     float hidden_dropout_probability, minstd_rand0& generator
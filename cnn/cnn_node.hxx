@@ -150,11 +150,42 @@ class CNN_Node {
 
     bool has_nan() const;
 
+    void check_input_size(const ImagesInterface& images, int number_images) const;
+
     void set_values(
         const ImagesInterface& images, const vector<int>& batch, int channel, bool perform_dropout,
         bool accumulate_test_statistics, float input_dropout_probability, minstd_rand0& generator
     );
 
+    /**
+     * Sets the values to a batch of this node's channel which has already been gathered, normalized and padded
+     * (e.g., by a BatchPrefetcher), number_images x size_y x size_x values.
+     */
+    void set_values(
+        const ImagesInterface& images, const float* channel_values, int number_images, bool perform_dropout,
+        bool accumulate_test_statistics, float input_dropout_probability, minstd_rand0& generator
+    );
+
+    /**
+     * Applies what this node does to its values during inference (the input dropout scaling for input nodes, or the
+     * activation, dropout scaling and batch normalization for hidden nodes) to number_values values which were
+     * calculated outside of the node, e.g., for a tile of a larger image.
+     */
+    void apply_inference(
+        float* values, int32_t number_values, float epsilon, float input_dropout_probability,
+        float hidden_dropout_probability
+    ) const;
+
+    /**
+     * The inference of a hidden node folded into multiplier * activation(value) + offset, with the dropout scaling
+     * folded into the batch normalization. Input nodes only have the input dropout scaling and softmax nodes are
+     * the identity.
+     */
+    void get_inference_affine(
+        float epsilon, float input_dropout_probability, float hidden_dropout_probability, float& multiplier,
+        float& offset
+    ) const;
+
     float get_value_in(int batch_number, int y, int x);
     void set_value_in(int batch_number, int y, int x, float value);
     float* get_values_in();
@@ -0,0 +1,401 @@
+#include <algorithm>
+using std::fill_n;
+using std::find;
+using std::max;
+using std::min;
+
+#include <cmath>
+#include <fstream>
+using std::ifstream;
+using std::ofstream;
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_edge.hxx"
+#include "cnn_genome.hxx"
+#include "cnn_node.hxx"
+#include "common/exp.hxx"
+#include "compiled_genome.hxx"
+#include "propagation.hxx"
+
+static int8_t quantize(float value, float inverse_scale) {
+    return (int8_t) max(-127.0f, min(127.0f, nearbyintf(value * inverse_scale)));
+}
+
+CompiledGenome::CompiledGenome(CNN_Genome* genome, int32_t _precision, int32_t _batch_size) {
+    if (_precision != COMPILED_FLOAT && _precision != COMPILED_INT8) {
+        cerr << "ERROR: unknown precision for a compiled genome: " << _precision << endl;
+        exit(1);
+    }
+
+    precision = _precision;
+    batch_size = max(1, _batch_size);
+    calibrated = false;
+    generator = minstd_rand0(genome->get_generation_id() + 1);
+
+    float epsilon = genome->get_epsilon();
+    float input_dropout_probability = genome->get_input_dropout_probability();
+    float hidden_dropout_probability = genome->get_hidden_dropout_probability();
+
+    const vector<CNN_Node*> genome_nodes = genome->get_nodes();
+    const vector<CNN_Edge*> genome_edges = genome->get_edges();
+
+    vector<CNN_Node*> nodes;
+    for (int32_t i = 0; i < (int32_t) genome_nodes.size(); i++) {
+        CNN_Node* node = genome_nodes[i];
+        if (!node->is_reachable() && !node->is_input() && !node->is_softmax()) {
+            continue;
+        }
+
+        float multiplier, offset;
+        node->get_inference_affine(
+            epsilon, input_dropout_probability, hidden_dropout_probability, multiplier, offset
+        );
+
+        nodes.push_back(node);
+        node_innovation_numbers.push_back(node->get_innovation_number());
+        node_sizes.push_back(node->get_size_y() * node->get_size_x());
+        node_types.push_back(node->is_input() ? INPUT_NODE : (node->is_softmax() ? SOFTMAX_NODE : HIDDEN_NODE));
+        node_multipliers.push_back(multiplier);
+        node_offsets.push_back(offset);
+    }
+    node_inputs.assign(nodes.size(), 0);
+    activation_scales.assign(nodes.size(), 1.0);
+    activation_max.assign(nodes.size(), 0.0);
+
+    int32_t largest_node = 0;
+    for (int32_t i = 0; i < (int32_t) genome_edges.size(); i++) {
+        CNN_Edge* edge = genome_edges[i];
+        if (!edge->is_reachable()) {
+            continue;
+        }
+
+        int32_t input_position = find(nodes.begin(), nodes.end(), edge->get_input_node()) - nodes.begin();
+        int32_t output_position = find(nodes.begin(), nodes.end(), edge->get_output_node()) - nodes.begin();
+
+        edges.push_back(edge);
+        edge_inputs.push_back(input_position);
+        edge_outputs.push_back(output_position);
+        node_inputs[output_position]++;
+        pool_buffers.push_back(PoolBuffers());
+
+        vector<float> weights;
+        vector<int8_t> quantized_weights;
+        float weight_scale = 1.0;
+
+        if (edge->get_type() == CONVOLUTIONAL) {
+            float max_weight = 0.0;
+            for (int32_t j = 0; j < edge->get_filter_size(); j++) {
+                weights.push_back(edge->get_weight(j));
+                max_weight = max(max_weight, (float) fabs(weights[j]));
+            }
+
+            // symmetric quantization, so 0 stays exactly 0
+            if (max_weight > 0) {
+                weight_scale = max_weight / 127.0;
+            }
+            for (int32_t j = 0; j < (int32_t) weights.size(); j++) {
+                quantized_weights.push_back(quantize(weights[j], 1.0 / weight_scale));
+            }
+        } else {
+            largest_node = max(largest_node, node_sizes[input_position]);
+        }
+
+        float_weights.push_back(weights);
+        int8_weights.push_back(quantized_weights);
+        weight_scales.push_back(weight_scale);
+    }
+
+    const vector<CNN_Node*> input_nodes = genome->get_input_nodes();
+    for (int32_t i = 0; i < (int32_t) input_nodes.size(); i++) {
+        input_positions.push_back(find(nodes.begin(), nodes.end(), input_nodes[i]) - nodes.begin());
+    }
+
+    const vector<CNN_Node*> softmax_nodes = genome->get_softmax_nodes();
+    for (int32_t i = 0; i < (int32_t) softmax_nodes.size(); i++) {
+        softmax_positions.push_back(find(nodes.begin(), nodes.end(), softmax_nodes[i]) - nodes.begin());
+    }
+
+    values.resize(nodes.size());
+    quantized_values.resize(nodes.size());
+    for (int32_t i = 0; i < (int32_t) nodes.size(); i++) {
+        values[i].assign(batch_size * node_sizes[i], 0.0f);
+
+        // softmax nodes stay float, and the float path only needs the float values
+        if (precision == COMPILED_INT8 && node_types[i] != SOFTMAX_NODE) {
+            quantized_values[i].assign(batch_size * node_sizes[i], 0);
+        }
+    }
+
+    // the float inputs of a pooling edge, dequantized in the int8 path
+    pool_input.assign(precision == COMPILED_INT8 ? batch_size * largest_node : 0, 0.0f);
+    pool_gradients.assign(batch_size * largest_node, 0.0f);
+}
+
+int32_t CompiledGenome::get_precision() const {
+    return precision;
+}
+
+int32_t CompiledGenome::get_number_classes() const {
+    return softmax_positions.size();
+}
+
+int64_t CompiledGenome::get_weight_bytes() const {
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        if (precision == COMPILED_INT8) {
+            bytes += int8_weights[i].size() * sizeof(int8_t) + sizeof(float);
+        } else {
+            bytes += float_weights[i].size() * sizeof(float);
+        }
+    }
+    return bytes;
+}
+
+int64_t CompiledGenome::get_activation_bytes() const {
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < (int32_t) values.size(); i++) {
+        if (precision == COMPILED_INT8 && node_types[i] != SOFTMAX_NODE) {
+            bytes += quantized_values[i].size() * sizeof(int8_t);
+        } else {
+            bytes += values[i].size() * sizeof(float);
+        }
+    }
+    return bytes;
+}
+
+void CompiledGenome::finish_node(int32_t position, int32_t number_images, bool use_int8, bool calibrating) {
+    if (node_types[position] == SOFTMAX_NODE) {
+        return;
+    }
+
+    float* __restrict__ node_values = values[position].data();
+    int32_t number_values = number_images * node_sizes[position];
+    float multiplier = node_multipliers[position];
+    float offset = node_offsets[position];
+
+    // the activation and the folded batch normalization in one pass (input nodes only have the dropout scaling)
+    if (node_types[position] == INPUT_NODE) {
+        for (int32_t i = 0; i < number_values; i++) {
+            node_values[i] *= multiplier;
+        }
+    } else {
+        for (int32_t i = 0; i < number_values; i++) {
+            float value = node_values[i];
+            if (value <= RELU_MIN) {
+                value = value * RELU_MIN_LEAK;
+            } else if (value > RELU_MAX) {
+                value = RELU_MAX;
+            }
+            node_values[i] = (multiplier * value) + offset;
+        }
+    }
+
+    if (calibrating) {
+        float largest = activation_max[position];
+        for (int32_t i = 0; i < number_values; i++) {
+            largest = max(largest, (float) fabs(node_values[i]));
+        }
+        activation_max[position] = largest;
+    }
+
+    if (use_int8) {
+        int8_t* __restrict__ quantized = quantized_values[position].data();
+        float inverse_scale = 1.0 / activation_scales[position];
+        for (int32_t i = 0; i < number_values; i++) {
+            quantized[i] = quantize(node_values[i], inverse_scale);
+        }
+    }
+}
+
+void CompiledGenome::evaluate_batch(
+    const ImagesInterface& images, const vector<int>& batch, vector<vector<float> >& predictions, bool calibrating
+) {
+    int32_t number_images = batch.size();
+    bool use_int8 = precision == COMPILED_INT8 && !calibrating;
+
+    for (int32_t i = 0; i < (int32_t) values.size(); i++) {
+        fill_n(values[i].begin(), number_images * node_sizes[i], 0.0f);
+    }
+
+    for (int32_t channel = 0; channel < (int32_t) input_positions.size(); channel++) {
+        int32_t position = input_positions[channel];
+        images.get_batch(batch, channel, values[position].data());
+        finish_node(position, number_images, use_int8, calibrating);
+    }
+
+    // the edges are in the genome's order, so a node has had all of its inputs added before its output edges
+    vector<int32_t> inputs_fired(values.size(), 0);
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        CNN_Edge* edge = edges[i];
+        int32_t input = edge_inputs[i];
+        int32_t output = edge_outputs[i];
+
+        CNN_Node* input_node = edge->get_input_node();
+        CNN_Node* output_node = edge->get_output_node();
+        int32_t input_size_y = input_node->get_size_y(), input_size_x = input_node->get_size_x();
+        int32_t output_size_y = output_node->get_size_y(), output_size_x = output_node->get_size_x();
+        bool reverse_y = edge->is_reverse_filter_y(), reverse_x = edge->is_reverse_filter_x();
+
+        if (edge->get_type() == CONVOLUTIONAL) {
+            if (use_int8) {
+                prop_forward_int8(
+                    quantized_values[input].data(), int8_weights[i].data(),
+                    activation_scales[input] * weight_scales[i], values[output].data(), number_images, input_size_y,
+                    input_size_x, edge->get_filter_y(), edge->get_filter_x(), output_size_y, output_size_x, reverse_y,
+                    reverse_x
+                );
+            } else {
+                void (*forward)(
+                    const float*, const float*, float*, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t
+                ) = prop_forward;
+                if (reverse_y && reverse_x) {
+                    forward = prop_forward_ry_rx;
+                } else if (reverse_y) {
+                    forward = prop_forward_ry;
+                } else if (reverse_x) {
+                    forward = prop_forward_rx;
+                }
+
+                forward(
+                    values[input].data(), float_weights[i].data(), values[output].data(), number_images, input_size_y,
+                    input_size_x, edge->get_filter_y(), edge->get_filter_x(), output_size_y, output_size_x
+                );
+            }
+        } else {
+            const float* pool_values = values[input].data();
+            if (use_int8) {
+                int32_t number_values = number_images * node_sizes[input];
+                const int8_t* quantized = quantized_values[input].data();
+                float scale = activation_scales[input];
+                for (int32_t j = 0; j < number_values; j++) {
+                    pool_input[j] = quantized[j] * scale;
+                }
+                pool_values = pool_input.data();
+            }
+
+            edge->pool_inference(
+                pool_values, pool_gradients.data(), values[output].data(), number_images, pool_buffers[i], generator
+            );
+        }
+
+        inputs_fired[output]++;
+        if (inputs_fired[output] == node_inputs[output]) {
+            finish_node(output, number_images, use_int8, calibrating);
+        }
+    }
+
+    // the softmax of each image, calculated the same way as CNN_Genome::evaluate_images
+    int32_t number_classes = softmax_positions.size();
+    for (int32_t i = 0; i < number_images; i++) {
+        vector<float>& prediction = predictions[batch[i]];
+
+        float softmax_max = values[softmax_positions[0]][i];
+        for (int32_t j = 1; j < number_classes; j++) {
+            softmax_max = max(softmax_max, values[softmax_positions[j]][i]);
+        }
+
+        float softmax_sum = 0.0;
+        for (int32_t j = 0; j < number_classes; j++) {
+            prediction[j] = exact_exp(values[softmax_positions[j]][i] - softmax_max);
+            softmax_sum += prediction[j];
+        }
+
+        if (softmax_sum == 0 || std::isnan(softmax_sum)) {
+            cerr << "ERROR! softmax sum was " << softmax_sum << " for image " << batch[i] << endl;
+            exit(1);
+        }
+
+        for (int32_t j = 0; j < number_classes; j++) {
+            prediction[j] /= softmax_sum;
+        }
+    }
+}
+
+void CompiledGenome::calibrate(const ImagesInterface& images, int32_t number_images) {
+    number_images = min(number_images, images.get_number_images());
+
+    activation_max.assign(values.size(), 0.0);
+
+    vector<vector<float> > predictions(number_images, vector<float>(get_number_classes(), 0.0));
+    for (int32_t j = 0; j < number_images; j += batch_size) {
+        vector<int> batch;
+        for (int32_t k = j; k < min(j + batch_size, number_images); k++) {
+            batch.push_back(k);
+        }
+        evaluate_batch(images, batch, predictions, true);
+    }
+
+    for (int32_t i = 0; i < (int32_t) values.size(); i++) {
+        activation_scales[i] = activation_max[i] > 0 ? activation_max[i] / 127.0 : 1.0;
+    }
+    calibrated = true;
+}
+
+void CompiledGenome::write_calibration(string filename) const {
+    ofstream outfile(filename);
+    if (!outfile.is_open()) {
+        cerr << "ERROR: could not open calibration file '" << filename << "' for writing." << endl;
+        exit(1);
+    }
+
+    outfile << activation_scales.size() << endl;
+    for (int32_t i = 0; i < (int32_t) activation_scales.size(); i++) {
+        outfile << node_innovation_numbers[i] << " ";
+        write_hexfloat(outfile, activation_scales[i]);
+        outfile << endl;
+    }
+}
+
+void CompiledGenome::read_calibration(string filename) {
+    ifstream infile(filename);
+    if (!infile.is_open()) {
+        cerr << "ERROR: could not open calibration file '" << filename << "' for reading." << endl;
+        exit(1);
+    }
+
+    int32_t number_nodes = 0;
+    infile >> number_nodes;
+    if (number_nodes != (int32_t) activation_scales.size()) {
+        cerr << "ERROR: calibration file '" << filename << "' has " << number_nodes << " nodes, but the genome has "
+             << activation_scales.size() << endl;
+        exit(1);
+    }
+
+    for (int32_t i = 0; i < number_nodes; i++) {
+        int32_t innovation_number;
+        infile >> innovation_number;
+        if (!infile || innovation_number != node_innovation_numbers[i]) {
+            cerr << "ERROR: calibration file '" << filename << "' does not match the genome at node " << i << endl;
+            exit(1);
+        }
+        activation_scales[i] = read_hexfloat(infile);
+    }
+    calibrated = true;
+}
+
+void CompiledGenome::evaluate(const ImagesInterface& images, vector<vector<float> >& predictions) {
+    if (precision == COMPILED_INT8 && !calibrated) {
+        cerr << "ERROR: an int8 compiled genome needs to be calibrated (or read a calibration) before evaluating."
+             << endl;
+        exit(1);
+    }
+
+    predictions.assign(images.get_number_images(), vector<float>(get_number_classes(), 0.0));
+
+    for (int32_t j = 0; j < images.get_number_images(); j += batch_size) {
+        vector<int> batch;
+        for (int32_t k = j; k < min(j + batch_size, images.get_number_images()); k++) {
+            batch.push_back(k);
+        }
+        evaluate_batch(images, batch, predictions, false);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef CNN_COMPILED_GENOME_HXX
+#define CNN_COMPILED_GENOME_HXX
+
+#include <random>
+using std::minstd_rand0;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_edge.hxx"
+#include "cnn_genome.hxx"
+#include "image_tools/image_set_interface.hxx"
+#include "pooling.hxx"
+#include "stdint.h"
+
+#define COMPILED_FLOAT 0
+#define COMPILED_INT8  1
+
+/**
+ * An inference only copy of a trained genome. Each node's batch normalization (with its running statistics) and
+ * dropout scaling are folded into a single multiply and add which is fused with the activation, and only the buffers
+ * needed for the forward pass are kept (no errors, gradients, dropout, statistics or timing), sized for batch_size
+ * images so partial batches only do the work for the images they have.
+ *
+ * With COMPILED_INT8 the convolution weights are quantized to int8 with a scale per edge, and each node's outputs are
+ * stored as int8 with a scale per node, so the activations take a quarter of the memory bandwidth. The node scales
+ * come from the largest output of each node over a set of calibration images (run through the float path), and can
+ * be written out and read back so the calibration only needs to be done once. Convolutions sum the int8 products
+ * exactly in int32; pooling edges and softmax nodes work on float values.
+ */
+class CompiledGenome {
+   private:
+    int32_t precision;
+    int32_t batch_size;
+
+    vector<int32_t> node_innovation_numbers;
+    vector<int32_t> node_sizes;
+    vector<int32_t> node_types;
+    vector<float> node_multipliers;
+    vector<float> node_offsets;
+    vector<int32_t> node_inputs;
+
+    // the scale of each node's int8 outputs, and the largest output seen while calibrating
+    vector<float> activation_scales;
+    vector<float> activation_max;
+    bool calibrated;
+
+    vector<CNN_Edge*> edges;
+    vector<int32_t> edge_inputs;
+    vector<int32_t> edge_outputs;
+    vector<vector<float> > float_weights;
+    vector<vector<int8_t> > int8_weights;
+    vector<float> weight_scales;
+    vector<PoolBuffers> pool_buffers;
+
+    vector<int32_t> input_positions;
+    vector<int32_t> softmax_positions;
+
+    // the inputs of every node (and the outputs in the float path), and the int8 outputs for the int8 path
+    vector<vector<float> > values;
+    vector<vector<int8_t> > quantized_values;
+    vector<float> pool_input;
+    vector<float> pool_gradients;
+
+    // draws the shuffled pools for fractional pooling edges
+    minstd_rand0 generator;
+
+    void finish_node(int32_t position, int32_t number_images, bool use_int8, bool calibrating);
+    void evaluate_batch(
+        const ImagesInterface& images, const vector<int>& batch, vector<vector<float> >& predictions, bool calibrating
+    );
+
+   public:
+    /**
+     * The genome's current weights are compiled, so it should be set_to_best first.
+     */
+    CompiledGenome(CNN_Genome* genome, int32_t _precision, int32_t _batch_size);
+
+    int32_t get_precision() const;
+    int32_t get_number_classes() const;
+
+    /**
+     * The bytes used for the weights, and for the node outputs of a full batch.
+     */
+    int64_t get_weight_bytes() const;
+    int64_t get_activation_bytes() const;
+
+    /**
+     * Sets the int8 scale of each node from its largest output over the first number_images images.
+     */
+    void calibrate(const ImagesInterface& images, int32_t number_images);
+
+    void write_calibration(string filename) const;
+    void read_calibration(string filename);
+
+    /**
+     * The same as CNN_Genome::evaluate, a vector of softmax outputs for each image.
+     */
+    void evaluate(const ImagesInterface& images, vector<vector<float> >& predictions);
+};
+
+#endif
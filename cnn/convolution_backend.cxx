@@ -0,0 +1,573 @@
+#include <algorithm>
+using std::fill;
+using std::max;
+
+#include <chrono>
+
+#include <cmath>
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+using std::ostream;
+
+#include <map>
+using std::map;
+
+#include <mutex>
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+#include <random>
+using std::minstd_rand0;
+using std::uniform_real_distribution;
+
+#include <shared_mutex>
+using std::shared_lock;
+using std::shared_mutex;
+
+#include <sstream>
+using std::ostringstream;
+
+#include <string>
+using std::string;
+
+#include <tuple>
+using std::tie;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "convolution_backend.hxx"
+#include "propagation.hxx"
+
+bool ConvolutionShape::operator<(const ConvolutionShape& other) const {
+    return tie(batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y, output_size_x, reverse_y,
+               reverse_x)
+           < tie(other.batch_size, other.input_size_y, other.input_size_x, other.filter_y, other.filter_x,
+                 other.output_size_y, other.output_size_x, other.reverse_y, other.reverse_x);
+}
+
+string ConvolutionShape::to_string() const {
+    ostringstream out;
+    out << batch_size << "x" << input_size_y << "x" << input_size_x << " * " << filter_y << "x" << filter_x
+        << (reverse_y ? " ry" : "") << (reverse_x ? " rx" : "") << " -> " << output_size_y << "x" << output_size_x;
+    return out.str();
+}
+
+ConvolutionBackend::~ConvolutionBackend() {
+}
+
+bool ConvolutionBackend::supports(const ConvolutionShape& shape) const {
+    return true;
+}
+
+string ReferenceConvolution::get_name() const {
+    return "reference";
+}
+
+void ReferenceConvolution::forward(
+    const ConvolutionShape& shape, const float* input, const float* weights, float* output
+) {
+    void (*reference)(
+        const float*, const float*, float*, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t
+    ) = prop_forward_reference;
+    if (shape.reverse_y && shape.reverse_x) {
+        reference = prop_forward_ry_rx_reference;
+    } else if (shape.reverse_y) {
+        reference = prop_forward_ry_reference;
+    } else if (shape.reverse_x) {
+        reference = prop_forward_rx_reference;
+    }
+
+    reference(
+        input, weights, output, shape.batch_size, shape.input_size_y, shape.input_size_x, shape.filter_y,
+        shape.filter_x, shape.output_size_y, shape.output_size_x
+    );
+}
+
+string BlockedConvolution::get_name() const {
+    return "blocked";
+}
+
+void BlockedConvolution::forward(
+    const ConvolutionShape& shape, const float* input, const float* weights, float* output
+) {
+    void (*blocked)(
+        const float*, const float*, float*, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t
+    ) = prop_forward;
+    if (shape.reverse_y && shape.reverse_x) {
+        blocked = prop_forward_ry_rx;
+    } else if (shape.reverse_y) {
+        blocked = prop_forward_ry;
+    } else if (shape.reverse_x) {
+        blocked = prop_forward_rx;
+    }
+
+    blocked(
+        input, weights, output, shape.batch_size, shape.input_size_y, shape.input_size_x, shape.filter_y,
+        shape.filter_x, shape.output_size_y, shape.output_size_x
+    );
+}
+
+#ifdef __OPENCL__
+
+/**
+ * Each work item sums the filter over its output pixel, skipping the filter positions which fall outside of the
+ * input (which only happens for reversed filters), and adds the sum to the output.
+ */
+static const char* CONVOLUTION_KERNEL_SOURCE = R"(
+__kernel void convolve_forward(const __global float* input, __constant float* weights, __global float* output) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+    const int image = get_global_id(2);
+
+    const __global float* image_input = input + (image * INPUT_Y * INPUT_X);
+
+    float sum = 0.0f;
+    for (int fy = 0; fy < FILTER_Y; fy++) {
+        const int in_y = REVERSE_Y ? y - fy : y + fy;
+        if (in_y < 0 || in_y >= INPUT_Y) continue;
+
+        for (int fx = 0; fx < FILTER_X; fx++) {
+            const int in_x = REVERSE_X ? x - fx : x + fx;
+            if (in_x < 0 || in_x >= INPUT_X) continue;
+
+            sum += weights[(fy * FILTER_X) + fx] * image_input[(in_y * INPUT_X) + in_x];
+        }
+    }
+
+    output[(((image * OUTPUT_Y) + y) * OUTPUT_X) + x] += sum;
+}
+)";
+
+static void check_opencl(cl_int error, string message) {
+    if (error != CL_SUCCESS) {
+        cerr << "ERROR: OpenCL " << message << " failed with error code " << error << endl;
+        exit(1);
+    }
+}
+
+OpenCLConvolution* OpenCLConvolution::create() {
+    cl_uint number_platforms = 0;
+    if (clGetPlatformIDs(0, NULL, &number_platforms) != CL_SUCCESS || number_platforms == 0) {
+        return NULL;
+    }
+
+    vector<cl_platform_id> platforms(number_platforms);
+    clGetPlatformIDs(number_platforms, platforms.data(), NULL);
+
+    // prefer a GPU on any platform, but fall back to a CPU runtime
+    cl_device_type device_types[2] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_CPU};
+    for (int32_t i = 0; i < 2; i++) {
+        for (int32_t j = 0; j < (int32_t) platforms.size(); j++) {
+            cl_device_id device;
+            if (clGetDeviceIDs(platforms[j], device_types[i], 1, &device, NULL) == CL_SUCCESS) {
+                return new OpenCLConvolution(device);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+OpenCLConvolution::OpenCLConvolution(cl_device_id _device) {
+    device = _device;
+
+    cl_int error;
+    context = clCreateContext(NULL, 1, &device, NULL, NULL, &error);
+    check_opencl(error, "clCreateContext");
+
+    queue = clCreateCommandQueue(context, device, 0, &error);
+    check_opencl(error, "clCreateCommandQueue");
+
+    input_buffer = NULL;
+    weights_buffer = NULL;
+    output_buffer = NULL;
+    input_capacity = 0;
+    weights_capacity = 0;
+    output_capacity = 0;
+
+    char device_name[1024];
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(device_name), device_name, NULL);
+    cerr << "OpenCL convolution backend using device: " << device_name << endl;
+}
+
+OpenCLConvolution::~OpenCLConvolution() {
+    for (auto kernel = kernels.begin(); kernel != kernels.end(); kernel++) {
+        clReleaseKernel(kernel->second);
+    }
+    for (int32_t i = 0; i < (int32_t) programs.size(); i++) {
+        clReleaseProgram(programs[i]);
+    }
+
+    if (input_buffer != NULL) {
+        clReleaseMemObject(input_buffer);
+    }
+    if (weights_buffer != NULL) {
+        clReleaseMemObject(weights_buffer);
+    }
+    if (output_buffer != NULL) {
+        clReleaseMemObject(output_buffer);
+    }
+
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+}
+
+string OpenCLConvolution::get_name() const {
+    return "opencl";
+}
+
+cl_kernel OpenCLConvolution::get_kernel(const ConvolutionShape& shape) {
+    ConvolutionShape key = shape;
+    key.batch_size = 0;
+
+    auto cached = kernels.find(key);
+    if (cached != kernels.end()) {
+        return cached->second;
+    }
+
+    ostringstream options;
+    options << "-D INPUT_Y=" << shape.input_size_y << " -D INPUT_X=" << shape.input_size_x
+            << " -D FILTER_Y=" << shape.filter_y << " -D FILTER_X=" << shape.filter_x
+            << " -D OUTPUT_Y=" << shape.output_size_y << " -D OUTPUT_X=" << shape.output_size_x
+            << " -D REVERSE_Y=" << (shape.reverse_y ? 1 : 0) << " -D REVERSE_X=" << (shape.reverse_x ? 1 : 0);
+
+    cl_int error;
+    cl_program program = clCreateProgramWithSource(context, 1, &CONVOLUTION_KERNEL_SOURCE, NULL, &error);
+    check_opencl(error, "clCreateProgramWithSource");
+
+    error = clBuildProgram(program, 1, &device, options.str().c_str(), NULL, NULL);
+    if (error != CL_SUCCESS) {
+        size_t log_size;
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
+        string build_log(log_size, '\0');
+        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, &build_log[0], NULL);
+        cerr << "ERROR: could not build the OpenCL convolution for " << shape.to_string() << ":" << endl;
+        cerr << build_log << endl;
+        exit(1);
+    }
+
+    cl_kernel kernel = clCreateKernel(program, "convolve_forward", &error);
+    check_opencl(error, "clCreateKernel");
+
+    programs.push_back(program);
+    kernels[key] = kernel;
+    return kernel;
+}
+
+void OpenCLConvolution::reserve(cl_mem& buffer, size_t& capacity, size_t bytes, cl_mem_flags flags) {
+    if (bytes <= capacity) {
+        return;
+    }
+
+    if (buffer != NULL) {
+        clReleaseMemObject(buffer);
+    }
+
+    cl_int error;
+    buffer = clCreateBuffer(context, flags, bytes, NULL, &error);
+    check_opencl(error, "clCreateBuffer");
+    capacity = bytes;
+}
+
+void OpenCLConvolution::forward(
+    const ConvolutionShape& shape, const float* input, const float* weights, float* output
+) {
+    lock_guard<mutex> lock(opencl_mutex);
+
+    size_t input_bytes = sizeof(float) * shape.batch_size * shape.input_size_y * shape.input_size_x;
+    size_t weights_bytes = sizeof(float) * shape.filter_y * shape.filter_x;
+    size_t output_bytes = sizeof(float) * shape.batch_size * shape.output_size_y * shape.output_size_x;
+
+    cl_kernel kernel = get_kernel(shape);
+    reserve(input_buffer, input_capacity, input_bytes, CL_MEM_READ_ONLY);
+    reserve(weights_buffer, weights_capacity, weights_bytes, CL_MEM_READ_ONLY);
+    reserve(output_buffer, output_capacity, output_bytes, CL_MEM_READ_WRITE);
+
+    // the kernel adds to the output, so it needs the current output values as well as the inputs
+    check_opencl(
+        clEnqueueWriteBuffer(queue, input_buffer, CL_FALSE, 0, input_bytes, input, 0, NULL, NULL), "write input"
+    );
+    check_opencl(
+        clEnqueueWriteBuffer(queue, weights_buffer, CL_FALSE, 0, weights_bytes, weights, 0, NULL, NULL),
+        "write weights"
+    );
+    check_opencl(
+        clEnqueueWriteBuffer(queue, output_buffer, CL_FALSE, 0, output_bytes, output, 0, NULL, NULL), "write output"
+    );
+
+    check_opencl(clSetKernelArg(kernel, 0, sizeof(cl_mem), &input_buffer), "clSetKernelArg");
+    check_opencl(clSetKernelArg(kernel, 1, sizeof(cl_mem), &weights_buffer), "clSetKernelArg");
+    check_opencl(clSetKernelArg(kernel, 2, sizeof(cl_mem), &output_buffer), "clSetKernelArg");
+
+    size_t global_size[3] = {(size_t) shape.output_size_x, (size_t) shape.output_size_y, (size_t) shape.batch_size};
+    check_opencl(
+        clEnqueueNDRangeKernel(queue, kernel, 3, NULL, global_size, NULL, 0, NULL, NULL), "clEnqueueNDRangeKernel"
+    );
+
+    check_opencl(
+        clEnqueueReadBuffer(queue, output_buffer, CL_TRUE, 0, output_bytes, output, 0, NULL, NULL), "read output"
+    );
+}
+
+#endif
+
+static ReferenceConvolution reference_convolution;
+static BlockedConvolution blocked_convolution;
+
+// the reference backend is first, the other backends are checked against it when autotuning
+vector<ConvolutionBackend*> ConvolutionAutotuner::backends = {&reference_convolution, &blocked_convolution};
+ConvolutionBackend* ConvolutionAutotuner::fixed_backend = &blocked_convolution;
+bool ConvolutionAutotuner::autotune = false;
+int32_t ConvolutionAutotuner::benchmark_repeats = 5;
+
+map<ConvolutionShape, ConvolutionBackend*> ConvolutionAutotuner::best_backends;
+shared_mutex ConvolutionAutotuner::best_backends_mutex;
+
+void ConvolutionAutotuner::add_opencl_backend() {
+#ifdef __OPENCL__
+    for (int32_t i = 0; i < (int32_t) backends.size(); i++) {
+        if (backends[i]->get_name() == "opencl") {
+            return;
+        }
+    }
+
+    OpenCLConvolution* opencl_convolution = OpenCLConvolution::create();
+    if (opencl_convolution == NULL) {
+        cerr << "no OpenCL device was found, the OpenCL convolution backend will not be used." << endl;
+    } else {
+        backends.push_back(opencl_convolution);
+    }
+#endif
+}
+
+void ConvolutionAutotuner::initialize(const vector<string>& arguments) {
+    string backend_name = "blocked";
+    get_argument(arguments, "--convolution_backend", false, backend_name);
+    get_argument(arguments, "--convolution_benchmark_repeats", false, benchmark_repeats);
+
+    set_backend(backend_name);
+}
+
+void ConvolutionAutotuner::set_backend(string name) {
+    unique_lock<shared_mutex> lock(best_backends_mutex);
+    best_backends.clear();
+
+    if (name == "auto" || name == "opencl") {
+        add_opencl_backend();
+    }
+
+    if (name == "auto") {
+        autotune = true;
+        return;
+    }
+
+    for (int32_t i = 0; i < (int32_t) backends.size(); i++) {
+        if (backends[i]->get_name() == name) {
+            fixed_backend = backends[i];
+            autotune = false;
+            return;
+        }
+    }
+
+    cerr << "ERROR: unknown or unavailable convolution backend '" << name << "', the available backends are:";
+    for (int32_t i = 0; i < (int32_t) backends.size(); i++) {
+        cerr << " " << backends[i]->get_name();
+    }
+    cerr << " and auto" << endl;
+    exit(1);
+}
+
+const vector<ConvolutionBackend*>& ConvolutionAutotuner::get_backends() {
+    return backends;
+}
+
+ConvolutionBackend* ConvolutionAutotuner::tune(const ConvolutionShape& shape) {
+    int32_t input_size = shape.batch_size * shape.input_size_y * shape.input_size_x;
+    int32_t output_size = shape.batch_size * shape.output_size_y * shape.output_size_x;
+
+    minstd_rand0 generator(shape.input_size_y * 7919 + shape.filter_y * 31 + shape.filter_x);
+    uniform_real_distribution<float> rng(-1.0, 1.0);
+
+    vector<float> input(input_size);
+    vector<float> weights(shape.filter_y * shape.filter_x);
+    for (int32_t i = 0; i < (int32_t) input.size(); i++) {
+        input[i] = rng(generator);
+    }
+    for (int32_t i = 0; i < (int32_t) weights.size(); i++) {
+        weights[i] = rng(generator);
+    }
+
+    vector<float> expected(output_size, 0.0f);
+    backends[0]->forward(shape, input.data(), weights.data(), expected.data());
+
+    using namespace std::chrono;
+
+    ConvolutionBackend* best_backend = backends[0];
+    double best_time = -1.0;
+    vector<float> output(output_size);
+    for (int32_t i = 0; i < (int32_t) backends.size(); i++) {
+        if (!backends[i]->supports(shape)) {
+            continue;
+        }
+
+        // the first run checks the results (and warms up the backend, e.g., building an OpenCL program)
+        fill(output.begin(), output.end(), 0.0f);
+        backends[i]->forward(shape, input.data(), weights.data(), output.data());
+
+        bool matches = true;
+        for (int32_t j = 0; j < output_size; j++) {
+            if (fabs(expected[j] - output[j]) > 1e-4 * max(1.0f, (float) fabs(expected[j]))) {
+                matches = false;
+                break;
+            }
+        }
+
+        if (!matches) {
+            cerr << "WARNING: the " << backends[i]->get_name() << " convolution backend does not match the reference "
+                 << "for " << shape.to_string() << ", not using it." << endl;
+            continue;
+        }
+
+        double time = -1.0;
+        for (int32_t j = 0; j < benchmark_repeats; j++) {
+            high_resolution_clock::time_point start = high_resolution_clock::now();
+            backends[i]->forward(shape, input.data(), weights.data(), output.data());
+            double elapsed = duration<double>(high_resolution_clock::now() - start).count();
+
+            if (time < 0 || elapsed < time) {
+                time = elapsed;
+            }
+        }
+
+        if (best_time < 0 || time < best_time) {
+            best_time = time;
+            best_backend = backends[i];
+        }
+    }
+
+    return best_backend;
+}
+
+ConvolutionBackend* ConvolutionAutotuner::get_backend(const ConvolutionShape& shape) {
+    if (!autotune) {
+        return fixed_backend;
+    }
+
+    {
+        shared_lock<shared_mutex> lock(best_backends_mutex);
+        auto best = best_backends.find(shape);
+        if (best != best_backends.end()) {
+            return best->second;
+        }
+    }
+
+    // another thread may have tuned this shape while waiting for the lock
+    unique_lock<shared_mutex> lock(best_backends_mutex);
+    auto best = best_backends.find(shape);
+    if (best != best_backends.end()) {
+        return best->second;
+    }
+
+    ConvolutionBackend* backend = tune(shape);
+    best_backends[shape] = backend;
+    return backend;
+}
+
+void ConvolutionAutotuner::forward(
+    const ConvolutionShape& shape, const float* input, const float* weights, float* output
+) {
+    get_backend(shape)->forward(shape, input, weights, output);
+}
+
+void ConvolutionAutotuner::print_choices(ostream& out) {
+    shared_lock<shared_mutex> lock(best_backends_mutex);
+    for (auto best = best_backends.begin(); best != best_backends.end(); best++) {
+        out << "convolution " << best->first.to_string() << ": " << best->second->get_name() << endl;
+    }
+}
+
+#ifdef CONVOLUTION_BACKEND_TEST
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    string backend_name = "auto";
+    get_argument(arguments, "--convolution_backend", false, backend_name);
+    ConvolutionAutotuner::set_backend(backend_name);
+
+    // {batch, input y, input x, filter y, filter x, reverse y, reverse x}
+    int32_t shapes[][7] = {{25, 28, 28, 5, 5, 0, 0},   {25, 28, 28, 15, 15, 0, 0}, {1, 32, 32, 3, 3, 0, 0},
+                           {25, 14, 14, 5, 5, 1, 1},   {25, 14, 20, 5, 3, 1, 0},   {25, 20, 14, 3, 5, 0, 1},
+                           {7, 13, 9, 13, 1, 0, 0},    {50, 8, 8, 1, 1, 0, 0}};
+    int32_t number_shapes = sizeof(shapes) / sizeof(shapes[0]);
+
+    minstd_rand0 generator(1337);
+    uniform_real_distribution<float> rng(-1.0, 1.0);
+
+    bool passed = true;
+    for (int32_t i = 0; i < number_shapes; i++) {
+        ConvolutionShape shape;
+        shape.batch_size = shapes[i][0];
+        shape.input_size_y = shapes[i][1];
+        shape.input_size_x = shapes[i][2];
+        shape.filter_y = shapes[i][3];
+        shape.filter_x = shapes[i][4];
+        shape.reverse_y = shapes[i][5];
+        shape.reverse_x = shapes[i][6];
+        shape.output_size_y = shape.reverse_y ? shape.input_size_y + shape.filter_y - 1
+                                              : shape.input_size_y - shape.filter_y + 1;
+        shape.output_size_x = shape.reverse_x ? shape.input_size_x + shape.filter_x - 1
+                                              : shape.input_size_x - shape.filter_x + 1;
+
+        vector<float> input(shape.batch_size * shape.input_size_y * shape.input_size_x);
+        vector<float> weights(shape.filter_y * shape.filter_x);
+        vector<float> initial_output(shape.batch_size * shape.output_size_y * shape.output_size_x);
+        for (int32_t j = 0; j < (int32_t) input.size(); j++) {
+            input[j] = rng(generator);
+        }
+        for (int32_t j = 0; j < (int32_t) weights.size(); j++) {
+            weights[j] = rng(generator);
+        }
+        for (int32_t j = 0; j < (int32_t) initial_output.size(); j++) {
+            initial_output[j] = rng(generator);
+        }
+
+        const vector<ConvolutionBackend*>& backends = ConvolutionAutotuner::get_backends();
+        vector<float> expected = initial_output;
+        backends[0]->forward(shape, input.data(), weights.data(), expected.data());
+
+        for (int32_t j = 1; j < (int32_t) backends.size(); j++) {
+            // the backends add to the output, so start from a non zero output
+            vector<float> output = initial_output;
+            backends[j]->forward(shape, input.data(), weights.data(), output.data());
+
+            for (int32_t k = 0; k < (int32_t) output.size(); k++) {
+                if (fabs(expected[k] - output[k]) > 1e-5 * max(1.0f, (float) fabs(expected[k]))) {
+                    cerr << "FAILED " << backends[j]->get_name() << " " << shape.to_string() << " at " << k
+                         << ", expected: " << expected[k] << ", actual: " << output[k] << endl;
+                    passed = false;
+                    break;
+                }
+            }
+        }
+
+        vector<float> output = initial_output;
+        ConvolutionAutotuner::forward(shape, input.data(), weights.data(), output.data());
+    }
+
+    ConvolutionAutotuner::print_choices(cerr);
+
+    if (passed) {
+        cerr << "ALL PASSED!" << endl;
+        return 0;
+    } else {
+        return 1;
+    }
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef CNN_CONVOLUTION_BACKEND_HXX
+#define CNN_CONVOLUTION_BACKEND_HXX
+
+#include <iostream>
+using std::ostream;
+
+#include <map>
+using std::map;
+
+#include <mutex>
+using std::mutex;
+
+#include <shared_mutex>
+using std::shared_mutex;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "stdint.h"
+
+/**
+ * Everything about a forward convolution which changes which implementation is fastest: the number of images, the
+ * input, filter and output sizes, and if the filter is reversed (the output is larger than the input) in y or x.
+ */
+struct ConvolutionShape {
+    int32_t batch_size;
+    int32_t input_size_y;
+    int32_t input_size_x;
+    int32_t filter_y;
+    int32_t filter_x;
+    int32_t output_size_y;
+    int32_t output_size_x;
+    bool reverse_y;
+    bool reverse_x;
+
+    bool operator<(const ConvolutionShape& other) const;
+    string to_string() const;
+};
+
+/**
+ * An implementation of the forward convolution of a batch of images. Like prop_forward, forward adds the convolution
+ * of each image (stored one after another) with the weights to the output.
+ */
+class ConvolutionBackend {
+   public:
+    virtual ~ConvolutionBackend();
+
+    virtual string get_name() const = 0;
+    virtual bool supports(const ConvolutionShape& shape) const;
+    virtual void forward(const ConvolutionShape& shape, const float* input, const float* weights, float* output) = 0;
+};
+
+/**
+ * The original scalar loops (prop_forward_reference and its reversed versions).
+ */
+class ReferenceConvolution : public ConvolutionBackend {
+   public:
+    string get_name() const;
+    void forward(const ConvolutionShape& shape, const float* input, const float* weights, float* output);
+};
+
+/**
+ * The cache blocked kernels compiled for multiple instruction sets (prop_forward and its reversed versions).
+ */
+class BlockedConvolution : public ConvolutionBackend {
+   public:
+    string get_name() const;
+    void forward(const ConvolutionShape& shape, const float* input, const float* weights, float* output);
+};
+
+#ifdef __OPENCL__
+
+#ifdef __APPLE__
+#include <OpenCL/cl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+/**
+ * A portable OpenCL kernel with one work item for each output pixel of each image. The sizes are compiled into the
+ * kernel as constants, so a program is built (and cached) for each shape. It uses the first GPU found, otherwise
+ * the first CPU device (e.g., the POCL CPU runtime), so it can also be tested on machines without a GPU.
+ */
+class OpenCLConvolution : public ConvolutionBackend {
+   private:
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue queue;
+
+    // kernels for each shape (without the batch size, which is a kernel argument)
+    map<ConvolutionShape, cl_kernel> kernels;
+    vector<cl_program> programs;
+
+    cl_mem input_buffer;
+    cl_mem weights_buffer;
+    cl_mem output_buffer;
+    size_t input_capacity;
+    size_t weights_capacity;
+    size_t output_capacity;
+
+    // the command queue and buffers are shared, so one convolution runs at a time
+    mutex opencl_mutex;
+
+    cl_kernel get_kernel(const ConvolutionShape& shape);
+    void reserve(cl_mem& buffer, size_t& capacity, size_t bytes, cl_mem_flags flags);
+
+   public:
+    OpenCLConvolution(cl_device_id _device);
+    ~OpenCLConvolution();
+
+    OpenCLConvolution(const OpenCLConvolution& other) = delete;
+    OpenCLConvolution& operator=(const OpenCLConvolution& other) = delete;
+
+    /**
+     * Returns NULL if there is no OpenCL platform with a GPU or CPU device.
+     */
+    static OpenCLConvolution* create();
+
+    string get_name() const;
+    void forward(const ConvolutionShape& shape, const float* input, const float* weights, float* output);
+};
+
+#endif
+
+/**
+ * Selects the backend used by CNN_Edge::convolve_forward for each convolution shape. By default every shape uses
+ * the blocked backend. With "auto" the first convolution of each shape benchmarks every backend which supports it
+ * (after checking its results against the reference backend) and the fastest one is cached for the rest of the run.
+ * Any other backend name uses that backend for every shape.
+ */
+class ConvolutionAutotuner {
+   private:
+    static vector<ConvolutionBackend*> backends;
+    static ConvolutionBackend* fixed_backend;
+    static bool autotune;
+    static int32_t benchmark_repeats;
+
+    static map<ConvolutionShape, ConvolutionBackend*> best_backends;
+    static shared_mutex best_backends_mutex;
+
+    static void add_opencl_backend();
+    static ConvolutionBackend* tune(const ConvolutionShape& shape);
+
+   public:
+    /**
+     * Reads the --convolution_backend (reference, blocked, opencl or auto) and --convolution_benchmark_repeats
+     * arguments, this should be called before any genomes are trained.
+     */
+    static void initialize(const vector<string>& arguments);
+
+    /**
+     * Uses the named backend for every shape, or autotunes each shape with "auto".
+     */
+    static void set_backend(string name);
+
+    static const vector<ConvolutionBackend*>& get_backends();
+    static ConvolutionBackend* get_backend(const ConvolutionShape& shape);
+
+    static void forward(const ConvolutionShape& shape, const float* input, const float* weights, float* output);
+
+    /**
+     * Writes out which backend was chosen for each shape which has been autotuned.
+     */
+    static void print_choices(ostream& out);
+};
+
+#endif
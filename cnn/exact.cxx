@@ -74,6 +74,8 @@ bool EXACT::exists_in_database(int exact_id) {
 }
 
 EXACT::EXACT(int exact_id) {
+    genome_store = NULL;
+
     ostringstream query;
 
     query << "SELECT * FROM exact_search WHERE id = " << exact_id;
@@ -529,6 +531,8 @@ EXACT::EXACT(
     best_predictions_genome_id = -1;
     best_predictions_genome = NULL;
 
+    genome_store = NULL;
+
     inserted_genomes = 0;
 
     population_size = _population_size;
@@ -911,6 +915,10 @@ int EXACT::get_max_genomes() const {
     return max_genomes;
 }
 
+void EXACT::set_genome_store(GenomeStore* _genome_store) {
+    genome_store = _genome_store;
+}
+
 string EXACT::get_search_name() const {
     return search_name;
 }
@@ -1284,6 +1292,14 @@ CNN_Genome* EXACT::generate_individual() {
         }
     }
 
+    // edges which would be randomly initialized start from the trained weights of earlier genomes instead
+    if (genome_store != NULL && !reset_weights) {
+        int32_t warm_started = genome_store->warm_start(genome);
+        if (warm_started > 0) {
+            cout << "warm started " << warm_started << " edges from the genome store" << endl;
+        }
+    }
+
     genome->initialize();
 
     if (!genome->sanity_check(SANITY_CHECK_AFTER_GENERATION)) {
@@ -1354,6 +1370,10 @@ bool EXACT::insert_genome(CNN_Genome* genome) {
     if (genome->get_best_validation_error() != EXACT_MAX_FLOAT) {
         write_individual_hyperparameters(genome);
 
+        if (genome_store != NULL) {
+            genome_store->store(genome);
+        }
+
         int genome_test_predictions = genome->get_test_predictions();
         int best_genome_test_predictions = 0;
         if (best_predictions_genome != NULL) {
@@ -26,6 +26,7 @@ using std::vector;
 #include "cnn_edge.hxx"
 #include "cnn_genome.hxx"
 #include "cnn_node.hxx"
+#include "genome_store.hxx"
 #include "image_tools/image_set.hxx"
 
 class EXACT {
@@ -154,6 +155,9 @@ class EXACT {
     map<string, int> inserted_from_map;
     map<string, int> generated_from_map;
 
+    // not owned by the search
+    GenomeStore* genome_store;
+
    public:
 #ifdef _MYSQL_
     static bool exists_in_database(int exact_id);
@@ -198,6 +202,11 @@ class EXACT {
     int get_inserted_genomes() const;
     int get_max_genomes() const;
 
+    /**
+     * Trained genomes are stored in (and new genomes warm started from) the genome store, if one is set.
+     */
+    void set_genome_store(GenomeStore* _genome_store);
+
     void write_individual_hyperparameters(CNN_Genome* individual);
     void write_statistics(int new_generation_id, float new_fitness);
     void write_statistics_header();
@@ -0,0 +1,295 @@
+#include <filesystem>
+
+#include <fstream>
+using std::ifstream;
+using std::ios;
+using std::ofstream;
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+using std::istream;
+
+#include <mutex>
+using std::lock_guard;
+using std::unique_lock;
+
+#include <sstream>
+using std::ostringstream;
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_edge.hxx"
+#include "cnn_genome.hxx"
+#include "genome_store.hxx"
+#include "stdint.h"
+
+template <class T>
+static void write_binary(ostringstream& out, T value) {
+    out.write((const char*) &value, sizeof(T));
+}
+
+template <class T>
+static bool read_binary(istream& in, T& value) {
+    return (bool) in.read((char*) &value, sizeof(T));
+}
+
+GenomeStore::GenomeStore(string _filename, int32_t _batch_records) {
+    filename = _filename;
+    // the writer waits for a full batch, so a batch of less than one record would never let it wait
+    batch_records = _batch_records < 1 ? 1 : _batch_records;
+
+    number_stored = 0;
+    records_queued = 0;
+    records_written = 0;
+    flush_requested = false;
+    finished = false;
+
+    // index the weights from a previous run so they can be used to warm start this one
+    ifstream infile(filename, ios::in | ios::binary);
+    if (infile.is_open()) {
+        int64_t file_size = std::filesystem::file_size(filename);
+        int64_t records_end = 0;
+        while (read_record(infile, file_size)) {
+            number_stored++;
+            records_end = infile.tellg();
+        }
+        infile.close();
+
+        // a run which was killed while writing leaves a partial record at the end of the file, which has to be cut
+        // off or the records appended by this run would be read as part of it
+        if (records_end < file_size) {
+            cerr << "genome store '" << filename << "' has " << (file_size - records_end)
+                 << " bytes after the last complete record, truncating it to " << records_end << " bytes." << endl;
+            std::filesystem::resize_file(filename, records_end);
+        }
+
+        cerr << "read " << number_stored << " genomes from genome store '" << filename << "', with weights for "
+             << best_edges.size() << " edge innovation numbers" << endl;
+    }
+
+    outfile.open(filename, ios::out | ios::binary | ios::app);
+    if (!outfile.is_open()) {
+        cerr << "ERROR: could not open genome store '" << filename << "' for writing." << endl;
+        exit(1);
+    }
+
+    writer = thread(&GenomeStore::write_records, this);
+}
+
+GenomeStore::~GenomeStore() {
+    {
+        lock_guard<mutex> lock(store_mutex);
+        finished = true;
+    }
+    writer_condition.notify_all();
+    writer.join();
+
+    outfile.close();
+}
+
+bool GenomeStore::read_record(istream& infile, int64_t file_size) {
+    int32_t generation_id;
+    float fitness;
+    int32_t number_edges;
+    if (!read_binary(infile, generation_id) || !read_binary(infile, fitness) || !read_binary(infile, number_edges)) {
+        return false;
+    }
+
+    // each edge takes at least its header, so a count or filter size which could not fit in the rest of the file
+    // means the record is corrupt or truncated, and is not used to size the weights
+    const int64_t edge_header_size = 5 * sizeof(int32_t) + sizeof(float);
+    int64_t remaining = file_size - (int64_t) infile.tellg();
+    if (number_edges < 0 || (int64_t) number_edges * edge_header_size > remaining) {
+        cerr << "genome store '" << filename << "' has an invalid edge count (" << number_edges
+             << ") in the record for genome " << generation_id
+             << ", which is corrupt or truncated, ignoring the rest of the file." << endl;
+        return false;
+    }
+
+    // the edges are only indexed once the whole record has been read
+    vector<StoredEdge> edges(number_edges);
+    for (int32_t i = 0; i < number_edges; i++) {
+        StoredEdge& edge = edges[i];
+        edge.fitness = fitness;
+
+        if (!read_binary(infile, edge.innovation_number) || !read_binary(infile, edge.filter_y)
+            || !read_binary(infile, edge.filter_x) || !read_binary(infile, edge.reverse_filter_y)
+            || !read_binary(infile, edge.reverse_filter_x) || !read_binary(infile, edge.scale)) {
+            cerr << "genome store '" << filename << "' is truncated in the record for genome " << generation_id
+                 << ", ignoring the rest of the file." << endl;
+            return false;
+        }
+
+        remaining = file_size - (int64_t) infile.tellg();
+        if (edge.filter_y < 1 || edge.filter_x < 1
+            || (int64_t) edge.filter_y * edge.filter_x * (int64_t) sizeof(float) > remaining) {
+            cerr << "genome store '" << filename << "' has an invalid filter size (" << edge.filter_y << "x"
+                 << edge.filter_x << ") in the record for genome " << generation_id
+                 << ", which is corrupt or truncated, ignoring the rest of the file." << endl;
+            return false;
+        }
+
+        edge.weights.resize(edge.filter_y * edge.filter_x);
+        if (!infile.read((char*) edge.weights.data(), edge.weights.size() * sizeof(float))) {
+            cerr << "genome store '" << filename << "' is truncated in the record for genome " << generation_id
+                 << ", ignoring the rest of the file." << endl;
+            return false;
+        }
+    }
+
+    for (int32_t i = 0; i < number_edges; i++) {
+        index_edge(edges[i]);
+    }
+
+    return true;
+}
+
+void GenomeStore::index_edge(const StoredEdge& edge) {
+    vector<StoredEdge>& shapes = best_edges[edge.innovation_number];
+
+    for (int32_t i = 0; i < (int32_t) shapes.size(); i++) {
+        if (shapes[i].filter_y == edge.filter_y && shapes[i].filter_x == edge.filter_x
+            && shapes[i].reverse_filter_y == edge.reverse_filter_y
+            && shapes[i].reverse_filter_x == edge.reverse_filter_x) {
+            if (edge.fitness < shapes[i].fitness) {
+                shapes[i] = edge;
+            }
+            return;
+        }
+    }
+
+    shapes.push_back(edge);
+}
+
+void GenomeStore::store(CNN_Genome* genome) {
+    float fitness = genome->get_best_validation_error();
+
+    vector<StoredEdge> edges;
+    for (int32_t i = 0; i < genome->get_number_edges(); i++) {
+        CNN_Edge* edge = genome->get_edge(i);
+        if (edge->get_type() != CONVOLUTIONAL || !edge->is_reachable()) {
+            continue;
+        }
+
+        StoredEdge stored;
+        stored.fitness = fitness;
+        stored.innovation_number = edge->get_innovation_number();
+        stored.filter_y = edge->get_filter_y();
+        stored.filter_x = edge->get_filter_x();
+        stored.reverse_filter_y = edge->is_reverse_filter_y();
+        stored.reverse_filter_x = edge->is_reverse_filter_x();
+        edge->get_best_weights(stored.weights, stored.scale);
+        edges.push_back(stored);
+    }
+
+    ostringstream record;
+    write_binary(record, (int32_t) genome->get_generation_id());
+    write_binary(record, fitness);
+    write_binary(record, (int32_t) edges.size());
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        write_binary(record, edges[i].innovation_number);
+        write_binary(record, edges[i].filter_y);
+        write_binary(record, edges[i].filter_x);
+        write_binary(record, edges[i].reverse_filter_y);
+        write_binary(record, edges[i].reverse_filter_x);
+        write_binary(record, edges[i].scale);
+        record.write((const char*) edges[i].weights.data(), edges[i].weights.size() * sizeof(float));
+    }
+
+    lock_guard<mutex> lock(store_mutex);
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        index_edge(edges[i]);
+    }
+
+    number_stored++;
+    pending_records.push_back(record.str());
+    records_queued++;
+
+    if ((int32_t) pending_records.size() >= batch_records) {
+        writer_condition.notify_all();
+    }
+}
+
+int32_t GenomeStore::warm_start(CNN_Genome* genome) const {
+    lock_guard<mutex> lock(store_mutex);
+
+    int32_t warm_started = 0;
+    for (int32_t i = 0; i < genome->get_number_edges(); i++) {
+        CNN_Edge* edge = genome->get_edge(i);
+        if (edge->get_type() != CONVOLUTIONAL || !edge->needs_init()) {
+            continue;
+        }
+
+        auto shapes = best_edges.find(edge->get_innovation_number());
+        if (shapes == best_edges.end()) {
+            continue;
+        }
+
+        for (int32_t j = 0; j < (int32_t) shapes->second.size(); j++) {
+            const StoredEdge& stored = shapes->second[j];
+            if (stored.filter_y == edge->get_filter_y() && stored.filter_x == edge->get_filter_x()
+                && stored.reverse_filter_y == edge->is_reverse_filter_y()
+                && stored.reverse_filter_x == edge->is_reverse_filter_x()) {
+                edge->set_weights(stored.weights, stored.scale);
+                warm_started++;
+                break;
+            }
+        }
+    }
+
+    return warm_started;
+}
+
+void GenomeStore::write_records() {
+    vector<string> records;
+
+    unique_lock<mutex> lock(store_mutex);
+    while (true) {
+        writer_condition.wait(lock, [this] {
+            return finished || flush_requested || (int32_t) pending_records.size() >= batch_records;
+        });
+
+        records.swap(pending_records);
+        flush_requested = false;
+        bool was_finished = finished;
+
+        // the disk writes happen without the lock, so storing more genomes does not wait on them
+        lock.unlock();
+        for (int32_t i = 0; i < (int32_t) records.size(); i++) {
+            outfile.write(records[i].data(), records[i].size());
+        }
+        outfile.flush();
+        lock.lock();
+
+        records_written += records.size();
+        records.clear();
+        writer_condition.notify_all();
+
+        if (was_finished && pending_records.empty()) {
+            return;
+        }
+    }
+}
+
+void GenomeStore::flush() {
+    unique_lock<mutex> lock(store_mutex);
+
+    int64_t target = records_queued;
+    flush_requested = true;
+    writer_condition.notify_all();
+
+    writer_condition.wait(lock, [this, target] { return records_written >= target; });
+}
+
+int32_t GenomeStore::get_number_stored() const {
+    lock_guard<mutex> lock(store_mutex);
+    return number_stored;
+}
@@ -0,0 +1,113 @@
+#ifndef CNN_GENOME_STORE_HXX
+#define CNN_GENOME_STORE_HXX
+
+#include <condition_variable>
+using std::condition_variable;
+
+#include <fstream>
+using std::ofstream;
+
+#include <iostream>
+using std::istream;
+
+#include <map>
+using std::map;
+
+#include <mutex>
+using std::mutex;
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_genome.hxx"
+#include "stdint.h"
+
+/**
+ * The best weights of one convolutional edge of a stored genome, and the best validation error of that genome.
+ */
+struct StoredEdge {
+    float fitness;
+    int32_t innovation_number;
+    int32_t filter_y;
+    int32_t filter_x;
+    int32_t reverse_filter_y;
+    int32_t reverse_filter_x;
+    float scale;
+    vector<float> weights;
+};
+
+/**
+ * A binary store of the trained weights of the genomes inserted into an EXACT search, which replaces the per row
+ * database inserts for offline runs. Each stored genome is appended to the file as a record of its generation id,
+ * best validation error and number of edges, followed by each convolutional edge's innovation number, filter size,
+ * reverse flags, scale and best weights. Records are written in batches by a background thread, so storing a genome
+ * only copies its weights and the search does not wait on the disk.
+ *
+ * For each edge innovation number and filter shape the store keeps the weights from the fittest genome in memory,
+ * and warm_start copies them into the edges of a new genome which would otherwise be randomly initialized (new,
+ * re-enabled and resized edges), so children start from trained weights (Lamarckian inheritance). An existing store
+ * file is read back when it is opened, so a new or restarted search can be warm started from a previous one, and
+ * a partial record left at its end by a run which was killed while writing is truncated away.
+ */
+class GenomeStore {
+   private:
+    string filename;
+    int32_t batch_records;
+
+    ofstream outfile;
+
+    // the fittest stored weights for each edge innovation number, one for each filter shape
+    map<int32_t, vector<StoredEdge> > best_edges;
+
+    int32_t number_stored;
+
+    // records which have been stored but not yet written by the background thread
+    vector<string> pending_records;
+    int64_t records_queued;
+    int64_t records_written;
+
+    mutable mutex store_mutex;
+    condition_variable writer_condition;
+    bool flush_requested;
+    bool finished;
+
+    thread writer;
+
+    void index_edge(const StoredEdge& edge);
+    bool read_record(istream& infile, int64_t file_size);
+    void write_records();
+
+   public:
+    GenomeStore(string _filename, int32_t _batch_records);
+    ~GenomeStore();
+
+    GenomeStore(const GenomeStore& other) = delete;
+    GenomeStore& operator=(const GenomeStore& other) = delete;
+
+    /**
+     * Copies the best weights of a genome which has been trained into the store, the record is written to the file
+     * by the background thread.
+     */
+    void store(CNN_Genome* genome);
+
+    /**
+     * Sets the edges of the genome which need initialization to the stored weights with the same innovation number
+     * and filter shape, returning how many edges were warm started.
+     */
+    int32_t warm_start(CNN_Genome* genome) const;
+
+    /**
+     * Writes out any pending records before returning.
+     */
+    void flush();
+
+    int32_t get_number_stored() const;
+};
+
+#endif
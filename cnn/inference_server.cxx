@@ -0,0 +1,324 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+using std::chrono::microseconds;
+
+#include <cstring>
+using std::memcpy;
+using std::memset;
+using std::strncpy;
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <utility>
+using std::pair;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_genome.hxx"
+#include "cnn_node.hxx"
+#include "image_tools/image_set.hxx"
+#include "inference_server.hxx"
+#include "stdint.h"
+
+// an upper bound on the images in one request, so a bad header cannot make the server allocate everything
+#define MAX_REQUEST_IMAGES 65536
+
+atomic<bool> InferenceServer::stop_requested(false);
+
+static bool read_fully(int socket, void* buffer, size_t size) {
+    char* bytes = (char*) buffer;
+    while (size > 0) {
+        ssize_t count = read(socket, bytes, size);
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool write_fully(int socket, const void* buffer, size_t size) {
+    const char* bytes = (const char*) buffer;
+    while (size > 0) {
+        ssize_t count = send(socket, bytes, size, MSG_NOSIGNAL);
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+InferenceServer::InferenceServer(
+    string genome_filename, string _socket_filename, int32_t number_replicas, int32_t _max_wait_us,
+    const vector<float>& _channel_avg, const vector<float>& _channel_std_dev
+) {
+    socket_filename = _socket_filename;
+    max_wait_us = _max_wait_us;
+    channel_avg = _channel_avg;
+    channel_std_dev = _channel_std_dev;
+
+    queued_images = 0;
+    active_connections = 0;
+    stopping = false;
+
+    // each worker needs its own genome, as evaluating a batch overwrites the node values
+    for (int32_t i = 0; i < number_replicas; i++) {
+        bool is_checkpoint = false;
+        CNN_Genome* replica = new CNN_Genome(genome_filename, is_checkpoint);
+        replica->set_to_best();
+        replicas.push_back(replica);
+    }
+
+    CNN_Genome* genome = replicas[0];
+    const vector<CNN_Node*> input_nodes = genome->get_input_nodes();
+
+    number_classes = genome->get_number_softmax_nodes();
+    channels = input_nodes.size();
+    padding = genome->get_padding();
+    height = input_nodes[0]->get_size_y() - (2 * padding);
+    width = input_nodes[0]->get_size_x() - (2 * padding);
+    batch_size = genome->get_batch_size();
+
+    if ((int32_t) channel_avg.size() != channels || (int32_t) channel_std_dev.size() != channels) {
+        cerr << "ERROR: genome '" << genome_filename << "' has " << channels << " input channels, but there are "
+             << channel_avg.size() << " channel averages and " << channel_std_dev.size()
+             << " channel standard deviations." << endl;
+        exit(1);
+    }
+
+    cerr << "loaded " << number_replicas << " replicas of '" << genome_filename << "', images are " << channels
+         << " x " << height << " x " << width << " with " << number_classes << " classes, batch size " << batch_size
+         << endl;
+}
+
+InferenceServer::~InferenceServer() {
+    for (int32_t i = 0; i < (int32_t) replicas.size(); i++) {
+        delete replicas[i];
+    }
+}
+
+void InferenceServer::stop() {
+    stop_requested = true;
+}
+
+void InferenceServer::worker(int32_t replica) {
+    CNN_Genome* genome = replicas[replica];
+    ImageBatch batch_images(number_classes, channels, height, width, padding, channel_avg, channel_std_dev);
+
+    vector<pair<InferenceRequest*, int32_t> > taken;
+    vector<vector<float> > predictions;
+
+    std::unique_lock<mutex> lock(queue_mutex);
+    while (true) {
+        queue_condition.wait(lock, [this] { return stopping || queued_images > 0; });
+        if (queued_images == 0) {
+            return;
+        }
+
+        // give other clients a chance to fill the rest of the batch
+        if (queued_images < batch_size && max_wait_us > 0 && !stopping) {
+            queue_condition.wait_for(lock, microseconds(max_wait_us), [this] {
+                return stopping || queued_images >= batch_size;
+            });
+        }
+
+        taken.clear();
+        while ((int32_t) taken.size() < batch_size && !queue.empty()) {
+            InferenceRequest* request = queue.front();
+            taken.push_back(pair<InferenceRequest*, int32_t>(request, request->next_image));
+
+            request->next_image++;
+            queued_images--;
+            if (request->next_image == request->number_images) {
+                queue.pop_front();
+            }
+        }
+
+        // another worker may have emptied the queue while this one was waiting
+        if (taken.empty()) {
+            continue;
+        }
+
+        // the requests' pixels stay valid until all of their images are done
+        lock.unlock();
+
+        int32_t image_size = channels * height * width;
+        batch_images.clear();
+        for (int32_t i = 0; i < (int32_t) taken.size(); i++) {
+            batch_images.add_image(taken[i].first->pixels + ((size_t) taken[i].second * image_size));
+        }
+
+        genome->evaluate(batch_images, predictions);
+
+        lock.lock();
+        for (int32_t i = 0; i < (int32_t) taken.size(); i++) {
+            InferenceRequest* request = taken[i].first;
+            memcpy(
+                request->predictions + ((size_t) taken[i].second * number_classes), predictions[i].data(),
+                number_classes * sizeof(float)
+            );
+            request->images_done++;
+        }
+        done_condition.notify_all();
+    }
+}
+
+void InferenceServer::handle_connection(int client_socket) {
+    int32_t image_size = channels * height * width;
+
+    vector<uint8_t> pixels;
+    vector<float> predictions;
+
+    struct pollfd client_poll;
+    client_poll.fd = client_socket;
+    client_poll.events = POLLIN;
+
+    while (true) {
+        // wait for the next request with a timeout, so idle connections are closed when the server is stopped
+        int ready = 0;
+        while (!stop_requested && (ready = poll(&client_poll, 1, 200)) == 0) {
+        }
+        if (ready <= 0) {
+            break;
+        }
+
+        int32_t header[4];
+        if (!read_fully(client_socket, header, sizeof(header)) || header[0] == 0) {
+            break;
+        }
+
+        if (header[0] < 0 || header[0] > MAX_REQUEST_IMAGES || header[1] != channels || header[2] != height
+            || header[3] != width) {
+            cerr << "rejecting request for " << header[0] << " images of size " << header[1] << " x " << header[2]
+                 << " x " << header[3] << ", expected at most " << MAX_REQUEST_IMAGES << " images of size " << channels
+                 << " x " << height << " x " << width << endl;
+
+            int32_t error_header[2] = {-1, 0};
+            write_fully(client_socket, error_header, sizeof(error_header));
+            break;
+        }
+
+        int32_t number_images = header[0];
+        pixels.resize((size_t) number_images * image_size);
+        if (!read_fully(client_socket, pixels.data(), pixels.size())) {
+            break;
+        }
+        predictions.resize((size_t) number_images * number_classes);
+
+        InferenceRequest request;
+        request.pixels = pixels.data();
+        request.number_images = number_images;
+        request.next_image = 0;
+        request.images_done = 0;
+        request.predictions = predictions.data();
+
+        {
+            std::unique_lock<mutex> lock(queue_mutex);
+            queue.push_back(&request);
+            queued_images += number_images;
+            queue_condition.notify_all();
+
+            done_condition.wait(lock, [&request] { return request.images_done == request.number_images; });
+        }
+
+        int32_t response_header[2] = {number_images, number_classes};
+        if (!write_fully(client_socket, response_header, sizeof(response_header))
+            || !write_fully(client_socket, predictions.data(), predictions.size() * sizeof(float))) {
+            break;
+        }
+    }
+
+    close(client_socket);
+
+    std::lock_guard<mutex> lock(queue_mutex);
+    active_connections--;
+    done_condition.notify_all();
+}
+
+void InferenceServer::run() {
+    int listen_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_socket < 0) {
+        cerr << "ERROR: could not create a socket." << endl;
+        exit(1);
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_filename.size() >= sizeof(address.sun_path)) {
+        cerr << "ERROR: socket path '" << socket_filename << "' is longer than " << sizeof(address.sun_path) - 1
+             << " characters." << endl;
+        exit(1);
+    }
+    strncpy(address.sun_path, socket_filename.c_str(), sizeof(address.sun_path) - 1);
+
+    // a socket file left by a server which did not shut down cleanly would make bind fail
+    unlink(socket_filename.c_str());
+    if (bind(listen_socket, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(listen_socket, 64) != 0) {
+        cerr << "ERROR: could not listen on socket '" << socket_filename << "'." << endl;
+        exit(1);
+    }
+
+    vector<thread> workers;
+    for (int32_t i = 0; i < (int32_t) replicas.size(); i++) {
+        workers.push_back(thread(&InferenceServer::worker, this, i));
+    }
+
+    cerr << "listening on '" << socket_filename << "'" << endl;
+
+    // poll with a timeout so a stop request is noticed even if no clients connect
+    struct pollfd listen_poll;
+    listen_poll.fd = listen_socket;
+    listen_poll.events = POLLIN;
+
+    while (!stop_requested) {
+        if (poll(&listen_poll, 1, 200) <= 0) {
+            continue;
+        }
+
+        int client_socket = accept(listen_socket, NULL, NULL);
+        if (client_socket < 0) {
+            continue;
+        }
+
+        {
+            std::lock_guard<mutex> lock(queue_mutex);
+            active_connections++;
+        }
+
+        // connections can be long lived, so they are not joined; the count of active connections is waited on instead
+        thread(&InferenceServer::handle_connection, this, client_socket).detach();
+    }
+
+    close(listen_socket);
+    unlink(socket_filename.c_str());
+
+    cerr << "stopping, waiting for the requests in progress to finish" << endl;
+
+    {
+        std::unique_lock<mutex> lock(queue_mutex);
+        done_condition.wait(lock, [this] { return active_connections == 0; });
+        stopping = true;
+        queue_condition.notify_all();
+    }
+
+    for (int32_t i = 0; i < (int32_t) workers.size(); i++) {
+        workers[i].join();
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef CNN_INFERENCE_SERVER_HXX
+#define CNN_INFERENCE_SERVER_HXX
+
+#include <atomic>
+using std::atomic;
+
+#include <condition_variable>
+using std::condition_variable;
+
+#include <deque>
+using std::deque;
+
+#include <mutex>
+using std::mutex;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_genome.hxx"
+#include "stdint.h"
+
+/**
+ * A long running service which keeps a trained genome loaded and evaluates images sent to it over a Unix domain
+ * socket, so the genome file does not need to be parsed (and the node and edge buffers allocated) for every set of
+ * images.
+ *
+ * Each connection sends requests of 4 int32s (number of images, channels, height and width, which must match the
+ * genome's input without its padding) followed by the uint8 pixels of the images in channel, row, column order (the
+ * same as the binary image files). The response is 2 int32s (number of images and number of classes) followed by the
+ * float32 softmax outputs of each image. A request with 0 images closes the connection, and a malformed request gets
+ * a response of -1 images and 0 classes before the connection is closed.
+ *
+ * The images of all the connections go into one queue. There is a replica of the genome for each worker thread, and a
+ * worker takes up to a batch size of images from the front of the queue (waiting up to max_wait_us for more to arrive
+ * if it cannot fill a batch), so small requests from concurrent clients are coalesced into full batches and large
+ * requests are split over the workers.
+ */
+class InferenceServer {
+   private:
+    struct InferenceRequest {
+        const uint8_t* pixels;
+        int32_t number_images;
+        int32_t next_image;
+        int32_t images_done;
+        float* predictions;
+    };
+
+    string socket_filename;
+    int32_t max_wait_us;
+
+    vector<CNN_Genome*> replicas;
+
+    int32_t number_classes;
+    int32_t channels;
+    int32_t height;
+    int32_t width;
+    int32_t padding;
+    int32_t batch_size;
+
+    vector<float> channel_avg;
+    vector<float> channel_std_dev;
+
+    mutex queue_mutex;
+    condition_variable queue_condition;
+    condition_variable done_condition;
+    deque<InferenceRequest*> queue;
+    int64_t queued_images;
+    int32_t active_connections;
+    bool stopping;
+
+    static atomic<bool> stop_requested;
+
+    void worker(int32_t replica);
+    void handle_connection(int client_socket);
+
+   public:
+    InferenceServer(
+        string genome_filename, string _socket_filename, int32_t number_replicas, int32_t _max_wait_us,
+        const vector<float>& _channel_avg, const vector<float>& _channel_std_dev
+    );
+    ~InferenceServer();
+
+    InferenceServer(const InferenceServer& other) = delete;
+    InferenceServer& operator=(const InferenceServer& other) = delete;
+
+    /**
+     * Accepts connections until stop is called, then finishes the requests in progress and closes the connections.
+     */
+    void run();
+
+    /**
+     * Only sets a flag, so it can be called from a signal handler.
+     */
+    static void stop();
+};
+
+#endif
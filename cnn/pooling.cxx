@@ -1,4 +1,7 @@
-#include <chrono>
+#include <algorithm>
+using std::max;
+using std::min;
+
 #include <cmath>
 #include <limits>
 
@@ -7,14 +10,8 @@ using std::numeric_limits;
 
 #include <iostream>
 using std::cerr;
-using std::cout;
 using std::endl;
 
-#include <iomanip>
-using std::fixed;
-using std::setprecision;
-using std::setw;
-
 #include <random>
 #include <string>
 using std::string;
@@ -23,45 +20,7 @@ using std::string;
 using std::vector;
 
 #include "common/random.hxx"
-
-#define REPEATS 16
-
-#ifdef POOL_TEST
-template <class T>
-void print_array(string name, T* array, int32_t batch_size, int32_t size_y, int32_t size_x) {
-    int32_t x_counter = 0;
-    int32_t batch_counter = 0;
-
-    cout << name << ":" << endl;
-    for (int32_t i = 0; i < batch_size * size_y * size_x; i++) {
-        cout << fixed << setw(10) << setprecision(3) << array[i];
-
-        x_counter++;
-        batch_counter++;
-
-        if (x_counter == size_x) {
-            cout << endl;
-            x_counter = 0;
-        }
-
-        if (batch_counter == (size_x * size_y)) {
-            cout << endl;
-            batch_counter = 0;
-        }
-    }
-    cout << endl << endl;
-}
-
-template <class T>
-void print_vector(string name, vector<T> v) {
-    cout << name << ":";
-
-    for (int32_t i = 0; i < v.size(); i++) {
-        cout << " " << v[i];
-    }
-    cout << endl;
-}
-#endif
+#include "pooling.hxx"
 
 /********************************************
  * POOL INITIALIZATION
@@ -98,16 +57,255 @@ void initialize_pools(vector<int>& pools, vector<int>& offset, int input_size, i
     update_offset(pools, offset);
 }
 
+bool is_fractional(const vector<int>& pools) {
+    for (int32_t i = 1; i < (int32_t) pools.size(); i++) {
+        if (pools[i] != pools[0]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PoolBuffers::clear_repeats() {
+    repeat_y_pools.clear();
+    repeat_y_pool_offset.clear();
+    repeat_x_pools.clear();
+    repeat_x_pool_offset.clear();
+}
+
+void initialize_repeats(
+    PoolBuffers& buffers, const vector<int>& y_pools, const vector<int>& x_pools, bool shuffle_y, bool shuffle_x,
+    minstd_rand0& generator
+) {
+    buffers.clear_repeats();
+
+    vector<int> current_y_pools = y_pools;
+    vector<int> current_x_pools = x_pools;
+    vector<int> offset;
+
+    for (int32_t i = 0; i < POOL_REPEATS; i++) {
+        if (shuffle_y) {
+            fisher_yates_shuffle(generator, current_y_pools);
+        }
+        if (shuffle_x) {
+            fisher_yates_shuffle(generator, current_x_pools);
+        }
+
+        buffers.repeat_y_pools.push_back(current_y_pools);
+        update_offset(current_y_pools, offset);
+        buffers.repeat_y_pool_offset.push_back(offset);
+
+        buffers.repeat_x_pools.push_back(current_x_pools);
+        update_offset(current_x_pools, offset);
+        buffers.repeat_x_pool_offset.push_back(offset);
+    }
+}
+
 /********************************************
  * FORWARD PROPAGATION
  ********************************************/
 
+/**
+ * Each image is pooled a row of pools at a time. For every pool in the row, the max and its position are found by
+ * stepping through the pool's rows and (clamped) columns together, which the compiler turns into vector compares,
+ * blends and gathers (or strided loads for the common even 2 and 3 wide pools). The pool gradients of the image
+ * are cleared up front, so writing them only touches the max of each pool instead of every value a second time.
+ *
+ * Pools are scanned in the same order as the reference implementations and only a strictly greater value replaces
+ * the current max, so ties resolve to the same position. The POOL_TEST build checks all four against the
+ * references.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define POOLING_TARGETS __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define POOLING_TARGETS
+#endif
+
+#define POOLING_INLINE inline __attribute__((always_inline))
+
+template <int32_t WIDTH>
+static POOLING_INLINE void pool_max(
+    const float* __restrict__ rows, int32_t row_count, int32_t row_length, const int* __restrict__ columns,
+    int32_t pool_width, int32_t number_pools, float* __restrict__ best_values, int* __restrict__ best_positions
+) {
+    // even pools WIDTH wide start every WIDTH columns, so the compiler can use strided loads instead of gathers
+    int32_t width = WIDTH > 0 ? WIDTH : pool_width;
+
+    for (int32_t i = 0; i < number_pools; i++) {
+        int32_t column = WIDTH > 0 ? i * WIDTH : columns[i];
+        best_values[i] = rows[column];
+        best_positions[i] = column;
+    }
+
+    for (int32_t pool_y = 0; pool_y < row_count; pool_y++) {
+        const float* row = rows + (pool_y * row_length);
+        int32_t row_offset = pool_y * row_length;
+
+        for (int32_t pool_x = (pool_y == 0) ? 1 : 0; pool_x < width; pool_x++) {
+            const int* pool_columns = columns + (pool_x * number_pools);
+
+            for (int32_t i = 0; i < number_pools; i++) {
+                int32_t column = WIDTH > 0 ? (i * WIDTH) + pool_x : pool_columns[i];
+                float value = row[column];
+                bool greater = value > best_values[i];
+                best_values[i] = greater ? value : best_values[i];
+                best_positions[i] = greater ? row_offset + column : best_positions[i];
+            }
+        }
+    }
+}
+
+/**
+ * A normal pool reads y_pools[y] input rows starting at y_pool_offset[y] and writes output row y, a reversed pool
+ * (where the output is larger than the input) reads input row y and copies its max to y_pools[y] output rows
+ * starting at y_pool_offset[y]. Similarly for x.
+ */
+template <bool REVERSE_Y, bool REVERSE_X>
+static POOLING_INLINE void blocked_pool_forward(
+    const float* __restrict__ input, float scale, float* __restrict__ pool_gradients, float* __restrict__ output,
+    int32_t batch_size, int32_t input_size_y, int32_t input_size_x, int32_t output_size_y, int32_t output_size_x,
+    const vector<int>& y_pools, const vector<int>& x_pools, const vector<int>& y_pool_offset,
+    const vector<int>& x_pool_offset, PoolBuffers& buffers
+) {
+    int32_t input_image_size = input_size_y * input_size_x;
+    int32_t output_image_size = output_size_y * output_size_x;
+
+    int32_t number_y = REVERSE_Y ? input_size_y : (int32_t) y_pools.size();
+    int32_t number_x = REVERSE_X ? input_size_x : (int32_t) x_pools.size();
+
+    int32_t pool_width = 1;
+    if (!REVERSE_X) {
+        for (int32_t x = 0; x < number_x; x++) {
+            pool_width = max(pool_width, x_pools[x]);
+        }
+    }
+
+    bool even_x = !REVERSE_X && !is_fractional(x_pools);
+
+    buffers.columns.resize(pool_width * number_x);
+    buffers.best_values.resize(number_x);
+    buffers.best_positions.resize(number_x);
+
+    int* columns = buffers.columns.data();
+    float* best_values = buffers.best_values.data();
+    int* best_positions = buffers.best_positions.data();
+
+    for (int32_t pool_x = 0; pool_x < pool_width; pool_x++) {
+        for (int32_t x = 0; x < number_x; x++) {
+            columns[(pool_x * number_x) + x] = REVERSE_X ? x : x_pool_offset[x] + min(pool_x, x_pools[x] - 1);
+        }
+    }
+
+    for (int32_t batch_number = 0; batch_number < batch_size; batch_number++) {
+        const float* batch_input = input + (batch_number * input_image_size);
+        float* batch_gradients = pool_gradients + (batch_number * input_image_size);
+        float* batch_output = output + (batch_number * output_image_size);
+
+        std::fill_n(batch_gradients, input_image_size, 0.0f);
+
+        for (int32_t y = 0; y < number_y; y++) {
+            int32_t in_y = REVERSE_Y ? y : y_pool_offset[y];
+            int32_t row_count = REVERSE_Y ? 1 : y_pools[y];
+
+            const float* rows = batch_input + (in_y * input_size_x);
+            if (even_x && pool_width == 2) {
+                pool_max<2>(rows, row_count, input_size_x, columns, pool_width, number_x, best_values, best_positions);
+            } else if (even_x && pool_width == 3) {
+                pool_max<3>(rows, row_count, input_size_x, columns, pool_width, number_x, best_values, best_positions);
+            } else {
+                pool_max<0>(rows, row_count, input_size_x, columns, pool_width, number_x, best_values, best_positions);
+            }
+
+            float* gradients = batch_gradients + (in_y * input_size_x);
+            for (int32_t x = 0; x < number_x; x++) {
+                gradients[best_positions[x]] = scale;
+                best_values[x] *= scale;
+            }
+
+            int32_t out_y = REVERSE_Y ? y_pool_offset[y] : y;
+            int32_t output_rows = REVERSE_Y ? y_pools[y] : 1;
+
+            for (int32_t row = out_y; row < out_y + output_rows; row++) {
+                float* output_row = batch_output + (row * output_size_x);
+
+                if (REVERSE_X) {
+                    for (int32_t x = 0; x < number_x; x++) {
+                        for (int32_t pool_x = 0; pool_x < x_pools[x]; pool_x++) {
+                            output_row[x_pool_offset[x] + pool_x] += best_values[x];
+                        }
+                    }
+                } else {
+                    for (int32_t x = 0; x < number_x; x++) {
+                        output_row[x] += best_values[x];
+                    }
+                }
+            }
+        }
+    }
+}
+
+POOLING_TARGETS
+void pool_forward(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
+) {
+    blocked_pool_forward<false, false>(
+        input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
+        y_pools, x_pools, y_pool_offset, x_pool_offset, buffers
+    );
+}
+
+POOLING_TARGETS
+void pool_forward_ry(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
+) {
+    blocked_pool_forward<true, false>(
+        input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
+        y_pools, x_pools, y_pool_offset, x_pool_offset, buffers
+    );
+}
+
+POOLING_TARGETS
+void pool_forward_rx(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
+) {
+    blocked_pool_forward<false, true>(
+        input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
+        y_pools, x_pools, y_pool_offset, x_pool_offset, buffers
+    );
+}
+
+POOLING_TARGETS
+void pool_forward_ry_rx(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
+) {
+    blocked_pool_forward<true, true>(
+        input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
+        y_pools, x_pools, y_pool_offset, x_pool_offset, buffers
+    );
+}
+
+/********************************************
+ * REFERENCE FORWARD PROPAGATION
+ ********************************************/
+
 // pool forward when the y dimension of the output is less than the y dimension of the input and
 // the x dimension of the output is less than the the x dimension of the input
-void pool_forward(
+void pool_forward_reference(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
 ) {
     int32_t input_batch_offset = 0;
     int32_t output_batch_offset = 0;
@@ -159,47 +357,12 @@ void pool_forward(
     }
 }
 
-void pool_forward(
-    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
-) {
-    if (training || max_pooling) {
-        pool_forward(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
-    } else {
-        int output_image_size = output_size_y * output_size_x;
-        float* temp_output = new float[batch_size * output_image_size];
-        std::fill_n(temp_output, batch_size * output_image_size, 0);
-
-        for (int32_t i = 0; i < REPEATS; i++) {
-            fisher_yates_shuffle(generator, y_pools);
-            fisher_yates_shuffle(generator, x_pools);
-            update_offset(y_pools, y_pool_offset);
-            update_offset(x_pools, x_pool_offset);
-
-            pool_forward(
-                input, scale, pool_gradients, temp_output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-            );
-        }
-
-        for (int32_t i = 0; i < batch_size * output_image_size; i++) {
-            output[i] += temp_output[i] / REPEATS;
-        }
-
-        delete[] temp_output;
-    }
-}
-
 // pool forward when the y dimension of the output is greater than the y dimension of the input and
 // the x dimension of the output is less than the the x dimension of the input
-void pool_forward_ry(
+void pool_forward_ry_reference(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
 ) {
     int32_t input_batch_offset = 0;
     int32_t output_batch_offset = 0;
@@ -250,47 +413,12 @@ void pool_forward_ry(
     }
 }
 
-void pool_forward_ry(
-    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
-) {
-    if (training || max_pooling) {
-        pool_forward_ry(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
-    } else {
-        int output_image_size = output_size_y * output_size_x;
-        float* temp_output = new float[batch_size * output_image_size];
-        std::fill_n(temp_output, batch_size * output_image_size, 0);
-
-        for (int32_t i = 0; i < REPEATS; i++) {
-            fisher_yates_shuffle(generator, y_pools);
-            fisher_yates_shuffle(generator, x_pools);
-            update_offset(y_pools, y_pool_offset);
-            update_offset(x_pools, x_pool_offset);
-
-            pool_forward_ry(
-                input, scale, pool_gradients, temp_output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-            );
-        }
-
-        for (int32_t i = 0; i < batch_size * output_image_size; i++) {
-            output[i] += temp_output[i] / REPEATS;
-        }
-
-        delete[] temp_output;
-    }
-}
-
 // pool forward when the y dimension of the output is less than the y dimension of the input and
 // the x dimension of the output is greater than the the x dimension of the input
-void pool_forward_rx(
+void pool_forward_rx_reference(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
 ) {
     int32_t input_batch_offset = 0;
     int32_t output_batch_offset = 0;
@@ -340,47 +468,12 @@ void pool_forward_rx(
     }
 }
 
-void pool_forward_rx(
-    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
-) {
-    if (training || max_pooling) {
-        pool_forward_rx(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
-    } else {
-        int output_image_size = output_size_y * output_size_x;
-        float* temp_output = new float[batch_size * output_image_size];
-        std::fill_n(temp_output, batch_size * output_image_size, 0);
-
-        for (int32_t i = 0; i < REPEATS; i++) {
-            fisher_yates_shuffle(generator, y_pools);
-            fisher_yates_shuffle(generator, x_pools);
-            update_offset(y_pools, y_pool_offset);
-            update_offset(x_pools, x_pool_offset);
-
-            pool_forward_rx(
-                input, scale, pool_gradients, temp_output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-            );
-        }
-
-        for (int32_t i = 0; i < batch_size * output_image_size; i++) {
-            output[i] += temp_output[i] / REPEATS;
-        }
-
-        delete[] temp_output;
-    }
-}
-
 // pool forward when the y dimension of the output is greater than the y dimension of the input and
 // the x dimension of the output is greater than the the x dimension of the input
-void pool_forward_ry_rx(
+void pool_forward_ry_rx_reference(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
 ) {
     int32_t input_batch_offset = 0;
     int32_t output_batch_offset = 0;
@@ -414,42 +507,6 @@ void pool_forward_ry_rx(
         output_batch_offset += output_image_size;
     }
 }
-
-void pool_forward_ry_rx(
-    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
-) {
-    if (training || max_pooling) {
-        pool_forward_ry_rx(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
-    } else {
-        int output_image_size = output_size_y * output_size_x;
-        float* temp_output = new float[batch_size * output_image_size];
-        std::fill_n(temp_output, batch_size * output_image_size, 0);
-
-        for (int32_t i = 0; i < REPEATS; i++) {
-            fisher_yates_shuffle(generator, y_pools);
-            fisher_yates_shuffle(generator, x_pools);
-            update_offset(y_pools, y_pool_offset);
-            update_offset(x_pools, x_pool_offset);
-
-            pool_forward_ry_rx(
-                input, scale, pool_gradients, temp_output, batch_size, input_size_y, input_size_x, output_size_y,
-                output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-            );
-        }
-
-        for (int32_t i = 0; i < batch_size * output_image_size; i++) {
-            output[i] += temp_output[i] / REPEATS;
-        }
-
-        delete[] temp_output;
-    }
-}
-
 /********************************************
  * BACK PROPAGATION
  ********************************************/
@@ -621,33 +678,37 @@ void pool_backward_ry_rx(
 }
 
 #ifdef POOL_TEST
-
-void test_pooling(
-    int input_size_y, int input_size_x, int output_size_y, int output_size_x, int batch_size, minstd_rand0& generator,
-    bool training
-) {
-    float* input = new float[batch_size * input_size_y * input_size_x];
-    float* input_errors = new float[batch_size * input_size_y * input_size_x];
-    float* pool_gradients = new float[batch_size * input_size_y * input_size_x];
-    for (int32_t i = 0; i < batch_size * input_size_y * input_size_x; i++) {
-        input[i] = ceil(100 * drand48());
-        input_errors[i] = 0;
-        pool_gradients[i] = 0;
+using std::uniform_real_distribution;
+
+typedef void (*pool_function)(const float*, float, float*, float*, int32_t, int32_t, int32_t, int32_t, int32_t,
+                              const vector<int>&, const vector<int>&, const vector<int>&, const vector<int>&,
+                              PoolBuffers&);
+typedef void (*pool_reference_function)(const float*, float, float*, float*, int32_t, int32_t, int32_t, int32_t,
+                                        int32_t, const vector<int>&, const vector<int>&, const vector<int>&,
+                                        const vector<int>&);
+
+bool check_values(string name, const vector<float>& expected, const vector<float>& actual) {
+    for (int32_t i = 0; i < (int32_t) expected.size(); i++) {
+        if (expected[i] != actual[i]) {
+            cerr << "FAILED " << name << " at " << i << ", expected: " << expected[i] << ", actual: " << actual[i]
+                 << endl;
+            return false;
+        }
     }
+    return true;
+}
 
-    float* output = new float[batch_size * output_size_y * output_size_x];
-    float* output_errors = new float[batch_size * output_size_y * output_size_x];
-    for (int32_t i = 0; i < batch_size * output_size_y * output_size_x; i++) {
-        output[i] = 0.0;
-        output_errors[i] = ceil(100 * drand48());
+bool test_pooling(
+    string name, pool_function forward, pool_reference_function forward_reference, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, int32_t batch_size, bool shuffle,
+    minstd_rand0& generator
+) {
+    // integer valued inputs so that pools have ties
+    vector<float> input(batch_size * input_size_y * input_size_x);
+    for (int32_t i = 0; i < (int32_t) input.size(); i++) {
+        input[i] = generator() % 10;
     }
 
-    print_array("input", input, batch_size, input_size_y, input_size_x);
-    print_array("output", output, batch_size, output_size_y, output_size_x);
-    print_array("pool_gradients", pool_gradients, batch_size, input_size_y, input_size_x);
-    print_array("input_errors", input_errors, batch_size, input_size_y, input_size_x);
-    print_array("output_errors", output_errors, batch_size, output_size_y, output_size_x);
-
     vector<int> y_pools;
     vector<int> y_pool_offset;
     initialize_pools(y_pools, y_pool_offset, input_size_y, output_size_y);
@@ -656,124 +717,74 @@ void test_pooling(
     vector<int> x_pool_offset;
     initialize_pools(x_pools, x_pool_offset, input_size_x, output_size_x);
 
-    print_vector("y_pools (before shuffle)", y_pools);
-    print_vector("x_pools (before shuffle)", x_pools);
-
-    print_vector("y_pool_offset (before shuffle)", y_pool_offset);
-    print_vector("x_pool_offset (before shuffle)", x_pool_offset);
-
-    fisher_yates_shuffle(generator, y_pools);
-    fisher_yates_shuffle(generator, x_pools);
-    update_offset(y_pools, y_pool_offset);
-    update_offset(x_pools, x_pool_offset);
-
-    print_vector("y_pools (after shuffle)", y_pools);
-    print_vector("x_pools (after shuffle)", x_pools);
-
-    print_vector("y_pool_offset (after shuffle)", y_pool_offset);
-    print_vector("x_pool_offset (after shuffle)", x_pool_offset);
-
-    float scale = (10.0 * drand48()) - 5.0;
-    float scale_update;
-
-    if (input_size_y >= output_size_y && input_size_x >= output_size_x) {
-        pool_forward(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, false
-        );
-        pool_backward(
-            input_errors, scale_update, input, pool_gradients, output_errors, batch_size, input_size_y, input_size_x,
-            output_size_y, output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
-
-    } else if (input_size_x >= output_size_x) {
-        pool_forward_ry(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, false
-        );
-        pool_backward_ry(
-            input_errors, scale_update, input, pool_gradients, output_errors, batch_size, input_size_y, input_size_x,
-            output_size_y, output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
-
-    } else if (input_size_y >= output_size_y) {
-        pool_forward_rx(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, false
-        );
-        pool_backward_rx(
-            input_errors, scale_update, input, pool_gradients, output_errors, batch_size, input_size_y, input_size_x,
-            output_size_y, output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
-
-    } else {
-        pool_forward_ry_rx(
-            input, scale, pool_gradients, output, batch_size, input_size_y, input_size_x, output_size_y, output_size_x,
-            y_pools, x_pools, y_pool_offset, x_pool_offset, generator, training, false
-        );
-        pool_backward_ry_rx(
-            input_errors, scale_update, input, pool_gradients, output_errors, batch_size, input_size_y, input_size_x,
-            output_size_y, output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
-        );
+    if (shuffle) {
+        fisher_yates_shuffle(generator, y_pools);
+        fisher_yates_shuffle(generator, x_pools);
+        update_offset(y_pools, y_pool_offset);
+        update_offset(x_pools, x_pool_offset);
     }
-    cout << "scale_update: " << scale_update << endl;
-
-    print_array("output", output, batch_size, output_size_y, output_size_x);
 
-    print_array("pool_gradients", pool_gradients, batch_size, input_size_y, input_size_x);
-    print_array("input_errors", input_errors, batch_size, input_size_y, input_size_x);
-    print_array("output_errors", output_errors, batch_size, output_size_y, output_size_x);
-
-    delete[] input;
-    delete[] output;
-    delete[] pool_gradients;
-    delete[] input_errors;
-    delete[] output_errors;
+    uniform_real_distribution<float> rng(-5.0, 5.0);
+    float scale = rng(generator);
+
+    vector<float> output(batch_size * output_size_y * output_size_x, 1.0f);
+    vector<float> expected_output(output.size(), 1.0f);
+    vector<float> pool_gradients(input.size(), -1.0f);
+    vector<float> expected_pool_gradients(input.size(), -1.0f);
+
+    PoolBuffers buffers;
+    forward(
+        input.data(), scale, pool_gradients.data(), output.data(), batch_size, input_size_y, input_size_x,
+        output_size_y, output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset, buffers
+    );
+    forward_reference(
+        input.data(), scale, expected_pool_gradients.data(), expected_output.data(), batch_size, input_size_y,
+        input_size_x, output_size_y, output_size_x, y_pools, x_pools, y_pool_offset, x_pool_offset
+    );
+
+    bool passed = check_values(name + " output", expected_output, output);
+    passed &= check_values(name + " pool_gradients", expected_pool_gradients, pool_gradients);
+    return passed;
 }
 
 int main(int argc, char** argv) {
-    int batch_size = 3;
-
-    cout << "TESTING REGULAR POOLING:" << endl;
-
-    bool training = false;
-
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    minstd_rand0 generator(seed);
-
-    // regular
-    int input_size_y = 13;
-    int input_size_x = 15;
-    int output_size_y = 6;
-    int output_size_x = 4;
-    test_pooling(input_size_y, input_size_x, output_size_y, output_size_x, batch_size, generator, training);
-
-    cout << endl << endl << endl;
-    cout << "TESTING POOLING WITH REVERSE FILTER Y:" << endl;
-    // reverse filter y
-    input_size_y = 6;
-    input_size_x = 15;
-    output_size_y = 13;
-    output_size_x = 4;
-    test_pooling(input_size_y, input_size_x, output_size_y, output_size_x, batch_size, generator, training);
-
-    cout << endl << endl << endl;
-    cout << "TESTING POOLING WITH REVERSE FILTER X:" << endl;
-    // reverse filter x
-    input_size_y = 13;
-    input_size_x = 4;
-    output_size_y = 6;
-    output_size_x = 15;
-    test_pooling(input_size_y, input_size_x, output_size_y, output_size_x, batch_size, generator, training);
-
-    cout << endl << endl << endl;
-    cout << "TESTING POOLING WITH REVERSE FILTER Y and X:" << endl;
-    // reverse filter x and reverse filter y
-    input_size_y = 6;
-    input_size_x = 4;
-    output_size_y = 13;
-    output_size_x = 15;
-    test_pooling(input_size_y, input_size_x, output_size_y, output_size_x, batch_size, generator, training);
+    minstd_rand0 generator(1337);
+
+    // input y, input x, output y, output x -- the first is larger than the second in each dimension, so the
+    // reversed tests swap them. even pools, fractional pools, single value pools and a pool over the whole image
+    int32_t sizes[][4] = {{28, 28, 14, 14}, {13, 15, 6, 4}, {24, 37, 7, 11}, {9, 7, 9, 7}, {16, 16, 1, 1}};
+
+    bool passed = true;
+    for (auto size : sizes) {
+        int32_t large_y = size[0], large_x = size[1], small_y = size[2], small_x = size[3];
+        cerr << "testing " << large_y << "x" << large_x << " to " << small_y << "x" << small_x << endl;
+
+        for (int32_t shuffle = 0; shuffle < 2; shuffle++) {
+            passed &= test_pooling(
+                "pool", pool_forward, pool_forward_reference, large_y, large_x, small_y, small_x, 3, shuffle,
+                generator
+            );
+            passed &= test_pooling(
+                "pool_ry", pool_forward_ry, pool_forward_ry_reference, small_y, large_x, large_y, small_x, 3, shuffle,
+                generator
+            );
+            passed &= test_pooling(
+                "pool_rx", pool_forward_rx, pool_forward_rx_reference, large_y, small_x, small_y, large_x, 3, shuffle,
+                generator
+            );
+            passed &= test_pooling(
+                "pool_ry_rx", pool_forward_ry_rx, pool_forward_ry_rx_reference, small_y, small_x, large_y, large_x, 3,
+                shuffle, generator
+            );
+        }
+    }
+
+    if (passed) {
+        cerr << "ALL PASSED!" << endl;
+    } else {
+        cerr << "SOME FAILED!" << endl;
+    }
+    return passed ? 0 : 1;
 }
 
 #endif
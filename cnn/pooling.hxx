@@ -1,34 +1,107 @@
 #ifndef EXACT_POOLING_HXX
 #define EXACT_POOLING_HXX
 
+#include <random>
+using std::minstd_rand0;
+
 #include <vector>
 using std::vector;
 
+#include "stdint.h"
+
+// the number of shuffled pool arrangements averaged over for inference when the pools are fractional
+#define POOL_REPEATS 16
+
+/**
+ * Scratch space for the pooling kernels. Each pooling edge owns one, so once the buffers have grown to the size of
+ * the edge propagating a batch does not allocate anything.
+ */
+struct PoolBuffers {
+    // the input column of every (pool_x, pool) pair, clamped to the last column of the pool so pools of different
+    // widths can all be scanned with the same number of steps
+    vector<int> columns;
+    vector<float> best_values;
+    vector<int> best_positions;
+
+    // the shuffled pools averaged over during inference, drawn once and then reused by every batch
+    vector<vector<int> > repeat_y_pools;
+    vector<vector<int> > repeat_y_pool_offset;
+    vector<vector<int> > repeat_x_pools;
+    vector<vector<int> > repeat_x_pool_offset;
+    vector<float> repeat_output;
+
+    void clear_repeats();
+};
+
 void update_offset(vector<int>& pools, vector<int>& offset);
 void initialize_pools(vector<int>& pools, vector<int>& offset, int input_size, int output_size);
 
+bool is_fractional(const vector<int>& pools);
+void initialize_repeats(
+    PoolBuffers& buffers, const vector<int>& y_pools, const vector<int>& x_pools, bool shuffle_y, bool shuffle_x,
+    minstd_rand0& generator
+);
+
+/**
+ * Max pooling in a single pass over the input, compiled for multiple instruction sets with the best one selected at
+ * load time. The pool_gradients are set to scale at the max of each pool and 0 everywhere else. The _ry and _rx
+ * versions are for reversed filters, where the output is larger than the input.
+ */
+
 void pool_forward(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
 );
 
 void pool_forward_ry(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
 );
 
 void pool_forward_rx(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
 );
 
 void pool_forward_ry_rx(
     const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
-    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, vector<int>& y_pools, vector<int>& x_pools,
-    vector<int>& y_pool_offset, vector<int>& x_pool_offset, minstd_rand0& generator, bool training, bool max_pooling
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset,
+    PoolBuffers& buffers
+);
+
+/**
+ * The original scalar pooling, used to validate the single pass versions.
+ */
+
+void pool_forward_reference(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
+);
+
+void pool_forward_ry_reference(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
+);
+
+void pool_forward_rx_reference(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
+);
+
+void pool_forward_ry_rx_reference(
+    const float* input, float scale, float* pool_gradients, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t output_size_y, int32_t output_size_x, const vector<int>& y_pools,
+    const vector<int>& x_pools, const vector<int>& y_pool_offset, const vector<int>& x_pool_offset
 );
 
 void pool_backward(
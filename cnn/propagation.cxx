@@ -1,3 +1,7 @@
+#include <algorithm>
+using std::max;
+using std::min;
+
 #include <cmath>
 #include <iostream>
 
@@ -10,9 +14,345 @@ using std::vector;
 
 #include "propagation.hxx"
 
+/**
+ * The convolutions are done a row at a time: for each filter position a row of the output gets weight * a row of
+ * the input added to it (or for the backward pass, a row of the input errors gets weight * a row of the output
+ * errors, and the weight update gets the dot product of the two rows). The rows are contiguous, so the compiler can
+ * vectorize them, and the passes walk one destination row at a time and apply every filter position that touches
+ * it while that row is still in cache.
+ *
+ * Each destination value still receives its terms in the same (filter_y, filter_x) order as the reference
+ * implementations, so the forward pass and the input errors match them exactly unless the compiler contracts the
+ * multiply and add into an FMA. The weight updates are summed with multiple accumulators, so they match to within
+ * floating point tolerance. The PROPAGATE_TEST build checks all eight against the references.
+ *
+ * The public functions are compiled for AVX-512, AVX2, and the baseline instruction set, and the best one for the
+ * CPU is picked when the program is loaded.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define PROPAGATION_TARGETS __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define PROPAGATION_TARGETS
+#endif
+
+#define PROPAGATION_INLINE inline __attribute__((always_inline))
+
+#define PROPAGATION_LANES 16
+
+static PROPAGATION_INLINE void row_axpy(
+    float* __restrict__ destination, const float* __restrict__ source, float weight, int32_t length
+) {
+    for (int32_t x = 0; x < length; x++) {
+        destination[x] += weight * source[x];
+    }
+}
+
+static PROPAGATION_INLINE float row_dot(const float* __restrict__ a, const float* __restrict__ b, int32_t length) {
+    float partial[PROPAGATION_LANES] = {0.0f};
+
+    int32_t x = 0;
+    for (; x + PROPAGATION_LANES <= length; x += PROPAGATION_LANES) {
+        for (int32_t lane = 0; lane < PROPAGATION_LANES; lane++) {
+            partial[lane] += a[x + lane] * b[x + lane];
+        }
+    }
+
+    float sum = 0.0f;
+    for (int32_t lane = 0; lane < PROPAGATION_LANES; lane++) {
+        sum += partial[lane];
+    }
+
+    for (; x < length; x++) {
+        sum += a[x] * b[x];
+    }
+    return sum;
+}
+
+/**
+ * A normal filter reads input row output_y + fy, a reversed filter (where the output is larger than the input)
+ * writes output row input_y + fy. Similarly for x, a normal filter reads the input at an offset of fx and writes a
+ * row of output_size_x values, a reversed filter writes the output at an offset of fx and reads a row of
+ * input_size_x values.
+ */
+template <bool REVERSE_Y, bool REVERSE_X>
+static PROPAGATION_INLINE void blocked_forward(
+    const float* __restrict__ input, const float* __restrict__ weights, float* __restrict__ output,
+    int32_t batch_size, int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x,
+    int32_t output_size_y, int32_t output_size_x
+) {
+    int32_t output_image_size = output_size_y * output_size_x;
+    int32_t input_image_size = input_size_y * input_size_x;
+    int32_t length = REVERSE_X ? input_size_x : output_size_x;
+
+    for (int32_t batch_number = 0; batch_number < batch_size; batch_number++) {
+        const float* batch_input = input + (batch_number * input_image_size);
+        float* batch_output = output + (batch_number * output_image_size);
+
+        for (int32_t y = 0; y < output_size_y; y++) {
+            float* output_row = batch_output + (y * output_size_x);
+
+            // only the filter rows which map to a valid input row contribute to a reversed filter's output
+            int32_t fy_start = REVERSE_Y ? max(0, y - input_size_y + 1) : 0;
+            int32_t fy_end = REVERSE_Y ? min(filter_y, y + 1) : filter_y;
+
+            for (int32_t fy = fy_start; fy < fy_end; fy++) {
+                const float* input_row = batch_input + ((REVERSE_Y ? y - fy : y + fy) * input_size_x);
+                const float* filter_row = weights + (fy * filter_x);
+
+                for (int32_t fx = 0; fx < filter_x; fx++) {
+                    if (REVERSE_X) {
+                        row_axpy(output_row + fx, input_row, filter_row[fx], length);
+                    } else {
+                        row_axpy(output_row, input_row + fx, filter_row[fx], length);
+                    }
+                }
+            }
+        }
+
+#ifdef NAN_CHECKS
+        for (int32_t i = 0; i < output_image_size; i++) {
+            if (std::isnan(batch_output[i]) || std::isinf(batch_output[i])) {
+                cerr << "ERROR! NAN or INF in propagate forward, batch: " << batch_number << ", output: " << i
+                     << endl;
+                exit(1);
+            }
+        }
+#endif
+    }
+}
+
+/**
+ * The backward pass walks the input rows, so the input errors are accumulated in the same order as the forward
+ * pass accumulates the outputs.
+ */
+template <bool REVERSE_Y, bool REVERSE_X>
+static PROPAGATION_INLINE void blocked_backward(
+    const float* __restrict__ output_errors, const float* __restrict__ input, float* __restrict__ input_errors,
+    float* __restrict__ weight_updates, const float* __restrict__ weights, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+) {
+    int32_t output_image_size = output_size_y * output_size_x;
+    int32_t input_image_size = input_size_y * input_size_x;
+    int32_t length = REVERSE_X ? input_size_x : output_size_x;
+
+    vector<float> batch_updates(filter_y * filter_x);
+
+    for (int32_t batch_number = 0; batch_number < batch_size; batch_number++) {
+        const float* batch_errors = output_errors + (batch_number * output_image_size);
+        const float* batch_input = input + (batch_number * input_image_size);
+        float* batch_input_errors = input_errors + (batch_number * input_image_size);
+
+        std::fill(batch_updates.begin(), batch_updates.end(), 0.0f);
+
+        for (int32_t y = 0; y < input_size_y; y++) {
+            const float* input_row = batch_input + (y * input_size_x);
+            float* input_error_row = batch_input_errors + (y * input_size_x);
+
+            // only the filter rows which map to a valid output row contribute to a normal filter's input errors
+            int32_t fy_start = REVERSE_Y ? 0 : max(0, y - output_size_y + 1);
+            int32_t fy_end = REVERSE_Y ? filter_y : min(filter_y, y + 1);
+
+            for (int32_t fy = fy_start; fy < fy_end; fy++) {
+                const float* error_row = batch_errors + ((REVERSE_Y ? y + fy : y - fy) * output_size_x);
+
+                for (int32_t fx = 0; fx < filter_x; fx++) {
+                    int32_t current_weight = (fy * filter_x) + fx;
+
+                    if (REVERSE_X) {
+                        batch_updates[current_weight] += row_dot(input_row, error_row + fx, length);
+                        row_axpy(input_error_row, error_row + fx, weights[current_weight], length);
+                    } else {
+                        batch_updates[current_weight] += row_dot(input_row + fx, error_row, length);
+                        row_axpy(input_error_row + fx, error_row, weights[current_weight], length);
+                    }
+                }
+            }
+        }
+
+        for (int32_t i = 0; i < filter_y * filter_x; i++) {
+            weight_updates[i] += batch_updates[i] / batch_size;
+        }
+    }
+}
+
+PROPAGATION_TARGETS
 void prop_forward(
     const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
     int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+) {
+    blocked_forward<false, false>(
+        input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
+        output_size_x
+    );
+}
+
+PROPAGATION_TARGETS
+void prop_forward_ry(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+) {
+    blocked_forward<true, false>(
+        input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
+        output_size_x
+    );
+}
+
+PROPAGATION_TARGETS
+void prop_forward_rx(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+) {
+    blocked_forward<false, true>(
+        input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
+        output_size_x
+    );
+}
+
+PROPAGATION_TARGETS
+void prop_forward_ry_rx(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+) {
+    blocked_forward<true, true>(
+        input, weights, output, batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y,
+        output_size_x
+    );
+}
+
+PROPAGATION_TARGETS
+void prop_backward(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+) {
+    blocked_backward<false, false>(
+        output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x, filter_y,
+        filter_x, output_size_y, output_size_x
+    );
+}
+
+PROPAGATION_TARGETS
+void prop_backward_ry(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+) {
+    blocked_backward<true, false>(
+        output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x, filter_y,
+        filter_x, output_size_y, output_size_x
+    );
+}
+
+PROPAGATION_TARGETS
+void prop_backward_rx(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+) {
+    blocked_backward<false, true>(
+        output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x, filter_y,
+        filter_x, output_size_y, output_size_x
+    );
+}
+
+PROPAGATION_TARGETS
+void prop_backward_ry_rx(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+) {
+    blocked_backward<true, true>(
+        output_errors, input, input_errors, weight_updates, weights, batch_size, input_size_y, input_size_x, filter_y,
+        filter_x, output_size_y, output_size_x
+    );
+}
+
+/**
+ * The same row order as blocked_forward, but with int8 inputs and weights accumulated exactly in an int32 row which
+ * is scaled and added to the float output once all of its filter positions are done.
+ */
+template <bool REVERSE_Y, bool REVERSE_X>
+static PROPAGATION_INLINE void blocked_forward_int8(
+    const int8_t* __restrict__ input, const int8_t* __restrict__ weights, float output_scale,
+    float* __restrict__ output, int32_t batch_size, int32_t input_size_y, int32_t input_size_x, int32_t filter_y,
+    int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+) {
+    int32_t output_image_size = output_size_y * output_size_x;
+    int32_t input_image_size = input_size_y * input_size_x;
+    int32_t length = REVERSE_X ? input_size_x : output_size_x;
+
+    vector<int32_t> row_sums(output_size_x);
+    int32_t* __restrict__ sums = row_sums.data();
+
+    for (int32_t batch_number = 0; batch_number < batch_size; batch_number++) {
+        const int8_t* batch_input = input + (batch_number * input_image_size);
+        float* batch_output = output + (batch_number * output_image_size);
+
+        for (int32_t y = 0; y < output_size_y; y++) {
+            std::fill(row_sums.begin(), row_sums.end(), 0);
+
+            int32_t fy_start = REVERSE_Y ? max(0, y - input_size_y + 1) : 0;
+            int32_t fy_end = REVERSE_Y ? min(filter_y, y + 1) : filter_y;
+
+            for (int32_t fy = fy_start; fy < fy_end; fy++) {
+                const int8_t* input_row = batch_input + ((REVERSE_Y ? y - fy : y + fy) * input_size_x);
+                const int8_t* filter_row = weights + (fy * filter_x);
+
+                for (int32_t fx = 0; fx < filter_x; fx++) {
+                    int32_t weight = filter_row[fx];
+                    int32_t* destination = REVERSE_X ? sums + fx : sums;
+                    const int8_t* source = REVERSE_X ? input_row : input_row + fx;
+
+                    for (int32_t x = 0; x < length; x++) {
+                        destination[x] += weight * source[x];
+                    }
+                }
+            }
+
+            float* output_row = batch_output + (y * output_size_x);
+            for (int32_t x = 0; x < output_size_x; x++) {
+                output_row[x] += output_scale * sums[x];
+            }
+        }
+    }
+}
+
+PROPAGATION_TARGETS
+void prop_forward_int8(
+    const int8_t* input, const int8_t* weights, float output_scale, float* output, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x, bool reverse_y, bool reverse_x
+) {
+    if (reverse_y && reverse_x) {
+        blocked_forward_int8<true, true>(
+            input, weights, output_scale, output, batch_size, input_size_y, input_size_x, filter_y, filter_x,
+            output_size_y, output_size_x
+        );
+    } else if (reverse_y) {
+        blocked_forward_int8<true, false>(
+            input, weights, output_scale, output, batch_size, input_size_y, input_size_x, filter_y, filter_x,
+            output_size_y, output_size_x
+        );
+    } else if (reverse_x) {
+        blocked_forward_int8<false, true>(
+            input, weights, output_scale, output, batch_size, input_size_y, input_size_x, filter_y, filter_x,
+            output_size_y, output_size_x
+        );
+    } else {
+        blocked_forward_int8<false, false>(
+            input, weights, output_scale, output, batch_size, input_size_y, input_size_x, filter_y, filter_x,
+            output_size_y, output_size_x
+        );
+    }
+}
+
+/**
+ * The original scalar implementations, these are kept to check the blocked versions against.
+ */
+
+void prop_forward_reference(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
 ) {
     int current_weight, current_output, current_input;
 
@@ -43,7 +383,7 @@ void prop_forward(
                         output[current_output++] += weight * input[current_input++];
 
 #ifdef NAN_CHECKS
-                        if (isnan(output[current_output - 1]) || isinf(output[current_output - 1])) {
+                        if (std::isnan(output[current_output - 1]) || std::isinf(output[current_output - 1])) {
                             cerr << "ERROR! NAN or INF in propagate forward" << endl;
                             cerr << "previous_output: " << previous_output << ", output: " << output[current_output - 1]
                                  << endl;
@@ -59,7 +399,7 @@ void prop_forward(
     }
 }
 
-void prop_forward_ry(
+void prop_forward_ry_reference(
     const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
     int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
 ) {
@@ -89,7 +429,7 @@ void prop_forward_ry(
     }
 }
 
-void prop_forward_rx(
+void prop_forward_rx_reference(
     const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
     int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
 ) {
@@ -120,7 +460,7 @@ void prop_forward_rx(
     }
 }
 
-void prop_forward_ry_rx(
+void prop_forward_ry_rx_reference(
     const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
     int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
 ) {
@@ -150,7 +490,7 @@ void prop_forward_ry_rx(
     }
 }
 
-void prop_backward(
+void prop_backward_reference(
     float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
     int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
     int32_t output_size_x
@@ -191,7 +531,7 @@ void prop_backward(
     }
 }
 
-void prop_backward_ry(
+void prop_backward_ry_reference(
     float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
     int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
     int32_t output_size_x
@@ -228,7 +568,7 @@ void prop_backward_ry(
     }
 }
 
-void prop_backward_rx(
+void prop_backward_rx_reference(
     float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
     int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
     int32_t output_size_x
@@ -265,7 +605,7 @@ void prop_backward_rx(
     }
 }
 
-void prop_backward_ry_rx(
+void prop_backward_ry_rx_reference(
     float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
     int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
     int32_t output_size_x
@@ -303,7 +643,163 @@ void prop_backward_ry_rx(
 }
 
 #ifdef PROPAGATE_TEST
+#include <random>
+using std::minstd_rand0;
+using std::uniform_real_distribution;
+
+#include <string>
+using std::string;
+
+typedef void (*forward_function)(const float*, const float*, float*, int32_t, int32_t, int32_t, int32_t, int32_t,
+                                 int32_t, int32_t);
+typedef void (*backward_function)(float*, float*, float*, float*, float*, int32_t, int32_t, int32_t, int32_t,
+                                  int32_t, int32_t, int32_t);
+
+void fill_random(vector<float>& values, minstd_rand0& generator) {
+    uniform_real_distribution<float> rng(-1.0, 1.0);
+    for (int32_t i = 0; i < (int32_t) values.size(); i++) {
+        values[i] = rng(generator);
+    }
+}
+
+bool check_values(string name, const vector<float>& expected, const vector<float>& actual, float tolerance) {
+    for (int32_t i = 0; i < (int32_t) expected.size(); i++) {
+        float scale = std::fmax(1.0f, std::fabs(expected[i]));
+        if (std::fabs(expected[i] - actual[i]) / scale > tolerance) {
+            cerr << "FAILED " << name << " at " << i << ", expected: " << expected[i] << ", actual: " << actual[i]
+                 << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_convolution(
+    string name, forward_function forward, forward_function forward_reference, backward_function backward,
+    backward_function backward_reference, bool reverse_y, bool reverse_x, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, minstd_rand0& generator
+) {
+    int32_t output_size_y = reverse_y ? input_size_y + filter_y - 1 : input_size_y - filter_y + 1;
+    int32_t output_size_x = reverse_x ? input_size_x + filter_x - 1 : input_size_x - filter_x + 1;
+
+    vector<float> input(batch_size * input_size_y * input_size_x);
+    vector<float> weights(filter_y * filter_x);
+    vector<float> output_errors(batch_size * output_size_y * output_size_x);
+    fill_random(input, generator);
+    fill_random(weights, generator);
+    fill_random(output_errors, generator);
+
+    vector<float> output(batch_size * output_size_y * output_size_x, 0.0f);
+    vector<float> expected_output(output.size(), 0.0f);
+    forward(
+        input.data(), weights.data(), output.data(), batch_size, input_size_y, input_size_x, filter_y, filter_x,
+        output_size_y, output_size_x
+    );
+    forward_reference(
+        input.data(), weights.data(), expected_output.data(), batch_size, input_size_y, input_size_x, filter_y,
+        filter_x, output_size_y, output_size_x
+    );
+
+    vector<float> input_errors(input.size(), 0.0f);
+    vector<float> expected_input_errors(input.size(), 0.0f);
+    vector<float> weight_updates(weights.size(), 0.0f);
+    vector<float> expected_weight_updates(weights.size(), 0.0f);
+    backward(
+        output_errors.data(), input.data(), input_errors.data(), weight_updates.data(), weights.data(), batch_size,
+        input_size_y, input_size_x, filter_y, filter_x, output_size_y, output_size_x
+    );
+    backward_reference(
+        output_errors.data(), input.data(), expected_input_errors.data(), expected_weight_updates.data(),
+        weights.data(), batch_size, input_size_y, input_size_x, filter_y, filter_x, output_size_y, output_size_x
+    );
+
+    bool passed = check_values(name + " output", expected_output, output, 1e-5);
+    passed &= check_values(name + " input_errors", expected_input_errors, input_errors, 1e-5);
+    passed &= check_values(name + " weight_updates", expected_weight_updates, weight_updates, 1e-4);
+    return passed;
+}
+
 int main(int argc, char** argv) {
-    // make tests for the 8 convolve operations
+    minstd_rand0 generator(1337);
+
+    // sizes cover filters smaller than a vector, larger than a vector and the whole image
+    int32_t sizes[][4] = {{28, 28, 5, 5}, {32, 32, 3, 3}, {28, 28, 28, 28}, {37, 41, 20, 17}, {7, 9, 1, 1}};
+
+    bool passed = true;
+    for (auto size : sizes) {
+        int32_t input_size_y = size[0], input_size_x = size[1], filter_y = size[2], filter_x = size[3];
+        cerr << "testing input " << input_size_y << "x" << input_size_x << ", filter " << filter_y << "x" << filter_x
+             << endl;
+
+        passed &= test_convolution(
+            "prop", prop_forward, prop_forward_reference, prop_backward, prop_backward_reference, false, false, 4,
+            input_size_y, input_size_x, filter_y, filter_x, generator
+        );
+        passed &= test_convolution(
+            "prop_ry", prop_forward_ry, prop_forward_ry_reference, prop_backward_ry, prop_backward_ry_reference, true,
+            false, 4, input_size_y, input_size_x, filter_y, filter_x, generator
+        );
+        passed &= test_convolution(
+            "prop_rx", prop_forward_rx, prop_forward_rx_reference, prop_backward_rx, prop_backward_rx_reference, false,
+            true, 4, input_size_y, input_size_x, filter_y, filter_x, generator
+        );
+        passed &= test_convolution(
+            "prop_ry_rx", prop_forward_ry_rx, prop_forward_ry_rx_reference, prop_backward_ry_rx,
+            prop_backward_ry_rx_reference, true, true, 4, input_size_y, input_size_x, filter_y, filter_x, generator
+        );
+    }
+
+    // the int8 convolutions are exact, so they should match the float references run on the same integers
+    for (auto size : sizes) {
+        int32_t input_size_y = size[0], input_size_x = size[1], filter_y = size[2], filter_x = size[3];
+
+        for (int32_t reverse = 0; reverse < 4; reverse++) {
+            bool reverse_y = reverse & 1, reverse_x = reverse & 2;
+            int32_t output_size_y = reverse_y ? input_size_y + filter_y - 1 : input_size_y - filter_y + 1;
+            int32_t output_size_x = reverse_x ? input_size_x + filter_x - 1 : input_size_x - filter_x + 1;
+
+            vector<int8_t> input(4 * input_size_y * input_size_x);
+            vector<int8_t> weights(filter_y * filter_x);
+            for (int32_t i = 0; i < (int32_t) input.size(); i++) {
+                input[i] = (int32_t) (generator() % 255) - 127;
+            }
+            for (int32_t i = 0; i < (int32_t) weights.size(); i++) {
+                weights[i] = (int32_t) (generator() % 255) - 127;
+            }
+
+            vector<float> float_input(input.begin(), input.end());
+            vector<float> float_weights(weights.begin(), weights.end());
+
+            forward_function forward_reference = prop_forward_reference;
+            if (reverse_y && reverse_x) {
+                forward_reference = prop_forward_ry_rx_reference;
+            } else if (reverse_y) {
+                forward_reference = prop_forward_ry_reference;
+            } else if (reverse_x) {
+                forward_reference = prop_forward_rx_reference;
+            }
+
+            vector<float> expected_output(4 * output_size_y * output_size_x, 0.0f);
+            forward_reference(
+                float_input.data(), float_weights.data(), expected_output.data(), 4, input_size_y, input_size_x,
+                filter_y, filter_x, output_size_y, output_size_x
+            );
+
+            vector<float> output(expected_output.size(), 0.0f);
+            prop_forward_int8(
+                input.data(), weights.data(), 1.0f, output.data(), 4, input_size_y, input_size_x, filter_y, filter_x,
+                output_size_y, output_size_x, reverse_y, reverse_x
+            );
+
+            passed &= check_values("prop_int8_" + std::to_string(reverse), expected_output, output, 1e-5);
+        }
+    }
+
+    if (passed) {
+        cerr << "ALL PASSED!" << endl;
+    } else {
+        cerr << "SOME FAILED!" << endl;
+    }
+    return passed ? 0 : 1;
 }
 #endif
@@ -6,6 +6,11 @@
 #include "stdint.h"
 using std::vector;
 
+/**
+ * Cache blocked convolutions, compiled for multiple instruction sets with the best one selected at load time.
+ * The _ry and _rx versions are for reversed filters, where the output is larger than the input.
+ */
+
 void prop_forward(
     const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
     int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
@@ -50,4 +55,62 @@ void prop_backward_ry_rx(
     int32_t output_size_x
 );
 
+/**
+ * A forward convolution with int8 inputs and weights, for quantized inference. The products are summed exactly in
+ * int32 and then output_scale (the input scale * the weight scale) times the sum is added to the float output.
+ */
+void prop_forward_int8(
+    const int8_t* input, const int8_t* weights, float output_scale, float* output, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x, bool reverse_y, bool reverse_x
+);
+
+/**
+ * The original scalar convolutions, used to validate the blocked versions.
+ */
+
+void prop_forward_reference(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+);
+
+void prop_forward_ry_reference(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+);
+
+void prop_forward_rx_reference(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+);
+
+void prop_forward_ry_rx_reference(
+    const float* input, const float* weights, float* output, int32_t batch_size, int32_t input_size_y,
+    int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y, int32_t output_size_x
+);
+
+void prop_backward_reference(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+);
+
+void prop_backward_ry_reference(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+);
+
+void prop_backward_rx_reference(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+);
+
+void prop_backward_ry_rx_reference(
+    float* output_errors, float* input, float* input_errors, float* weight_updates, float* weights, int32_t batch_size,
+    int32_t input_size_y, int32_t input_size_x, int32_t filter_y, int32_t filter_x, int32_t output_size_y,
+    int32_t output_size_x
+);
+
 #endif
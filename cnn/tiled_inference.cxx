@@ -0,0 +1,386 @@
+#include <algorithm>
+using std::fill;
+using std::find;
+using std::max;
+using std::min;
+
+#include <cmath>
+#include <fstream>
+using std::ios;
+using std::ofstream;
+
+#include <functional>
+using std::cref;
+
+#include <iostream>
+using std::cerr;
+using std::cout;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_edge.hxx"
+#include "cnn_genome.hxx"
+#include "cnn_node.hxx"
+#include "common/exp.hxx"
+#include "tiled_inference.hxx"
+
+TiledInference::TiledInference(CNN_Genome* genome, int32_t _tile_size, int32_t _number_threads) {
+    if (_tile_size < 1) {
+        cerr << "ERROR: tile size for tiled inference must be >= 1, was " << _tile_size << endl;
+        exit(1);
+    }
+
+    if (!genome->is_fully_convolutional()) {
+        cerr << "ERROR: tiled inference needs a genome where every reachable edge is a convolution without reversed "
+                "filters."
+             << endl;
+        exit(1);
+    }
+
+    tile_size = _tile_size;
+    number_threads = max(1, _number_threads);
+
+    epsilon = genome->get_epsilon();
+    input_dropout_probability = genome->get_input_dropout_probability();
+    hidden_dropout_probability = genome->get_hidden_dropout_probability();
+
+    padding = genome->get_padding();
+
+    const vector<CNN_Node*> genome_nodes = genome->get_nodes();
+    const vector<CNN_Edge*> genome_edges = genome->get_edges();
+
+    vector<int32_t> positions(genome_nodes.size(), -1);
+    for (int32_t i = 0; i < (int32_t) genome_nodes.size(); i++) {
+        if (genome_nodes[i]->is_reachable() || genome_nodes[i]->is_input() || genome_nodes[i]->is_softmax()) {
+            positions[i] = nodes.size();
+            nodes.push_back(genome_nodes[i]);
+        }
+    }
+    node_inputs.assign(nodes.size(), 0);
+
+    for (int32_t i = 0; i < (int32_t) genome_edges.size(); i++) {
+        CNN_Edge* edge = genome_edges[i];
+        if (!edge->is_reachable()) {
+            continue;
+        }
+
+        int32_t input_position = -1, output_position = -1;
+        for (int32_t j = 0; j < (int32_t) genome_nodes.size(); j++) {
+            if (genome_nodes[j] == edge->get_input_node()) {
+                input_position = positions[j];
+            }
+            if (genome_nodes[j] == edge->get_output_node()) {
+                output_position = positions[j];
+            }
+        }
+
+        edges.push_back(edge);
+        edge_inputs.push_back(input_position);
+        edge_outputs.push_back(output_position);
+        node_inputs[output_position]++;
+    }
+
+    const vector<CNN_Node*> input_nodes = genome->get_input_nodes();
+    for (int32_t i = 0; i < (int32_t) input_nodes.size(); i++) {
+        input_positions.push_back(find(nodes.begin(), nodes.end(), input_nodes[i]) - nodes.begin());
+    }
+
+    const vector<CNN_Node*> softmax_nodes = genome->get_softmax_nodes();
+    for (int32_t i = 0; i < (int32_t) softmax_nodes.size(); i++) {
+        softmax_positions.push_back(find(nodes.begin(), nodes.end(), softmax_nodes[i]) - nodes.begin());
+    }
+
+    window_height = input_nodes[0]->get_size_y() - (2 * padding);
+    window_width = input_nodes[0]->get_size_x() - (2 * padding);
+
+    thread_values.assign(number_threads, vector<vector<float> >(nodes.size()));
+}
+
+int32_t TiledInference::get_number_classes() const {
+    return softmax_positions.size();
+}
+
+int32_t TiledInference::get_map_height(const LargeImageTilesInterface& images, int32_t image_number) const {
+    return images.get_large_image_height(image_number) - window_height + 1;
+}
+
+int32_t TiledInference::get_map_width(const LargeImageTilesInterface& images, int32_t image_number) const {
+    return images.get_large_image_width(image_number) - window_width + 1;
+}
+
+void TiledInference::check_map_size(const LargeImageTilesInterface& images, int32_t image_number) const {
+    if (get_map_height(images, image_number) < 1 || get_map_width(images, image_number) < 1) {
+        cerr << "ERROR: large image " << image_number << " (" << images.get_large_image_height(image_number) << "x"
+             << images.get_large_image_width(image_number) << ") is smaller than the genome's " << window_height
+             << "x" << window_width << " window." << endl;
+        exit(1);
+    }
+}
+
+void TiledInference::evaluate_tile(
+    const LargeImageTilesInterface& images, int32_t image_number, int32_t tile_y, int32_t tile_x, int32_t tile_height,
+    int32_t tile_width, int32_t map_width, vector<vector<float> >& values, float* band
+) {
+    // every node grows by the tile size - 1, so the input - output + 1 filter sizes stay the same
+    int32_t grow_y = tile_height - 1;
+    int32_t grow_x = tile_width - 1;
+
+    for (int32_t i = 0; i < (int32_t) nodes.size(); i++) {
+        values[i].assign((nodes[i]->get_size_y() + grow_y) * (nodes[i]->get_size_x() + grow_x), 0.0f);
+    }
+
+    for (int32_t channel = 0; channel < (int32_t) input_positions.size(); channel++) {
+        int32_t position = input_positions[channel];
+        CNN_Node* node = nodes[position];
+
+        images.get_tile(
+            image_number, channel, tile_y - padding, tile_x - padding, node->get_size_y() + grow_y,
+            node->get_size_x() + grow_x, values[position].data()
+        );
+        node->apply_inference(
+            values[position].data(), values[position].size(), epsilon, input_dropout_probability,
+            hidden_dropout_probability
+        );
+    }
+
+    // the edges are in the genome's order, so (as in CNN_Genome::propagate_forward) a node has had all of its inputs
+    // added before any of its output edges are reached
+    vector<int32_t> inputs_fired(nodes.size(), 0);
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        CNN_Node* input_node = nodes[edge_inputs[i]];
+        CNN_Node* output_node = nodes[edge_outputs[i]];
+
+        edges[i]->convolve_tile(
+            values[edge_inputs[i]].data(), values[edge_outputs[i]].data(), input_node->get_size_y() + grow_y,
+            input_node->get_size_x() + grow_x, output_node->get_size_y() + grow_y, output_node->get_size_x() + grow_x
+        );
+
+        inputs_fired[edge_outputs[i]]++;
+        if (inputs_fired[edge_outputs[i]] == node_inputs[edge_outputs[i]]) {
+            output_node->apply_inference(
+                values[edge_outputs[i]].data(), values[edge_outputs[i]].size(), epsilon, input_dropout_probability,
+                hidden_dropout_probability
+            );
+        }
+    }
+
+    // the softmax of each window, calculated the same way as CNN_Genome::evaluate_images
+    int32_t number_classes = softmax_positions.size();
+    for (int32_t y = 0; y < tile_height; y++) {
+        for (int32_t x = 0; x < tile_width; x++) {
+            int32_t current = (y * tile_width) + x;
+            float* prediction = band + (((y * map_width) + tile_x + x) * number_classes);
+
+            float softmax_max = values[softmax_positions[0]][current];
+            for (int32_t i = 1; i < number_classes; i++) {
+                if (values[softmax_positions[i]][current] > softmax_max) {
+                    softmax_max = values[softmax_positions[i]][current];
+                }
+            }
+
+            float softmax_sum = 0.0;
+            for (int32_t i = 0; i < number_classes; i++) {
+                prediction[i] = exact_exp(values[softmax_positions[i]][current] - softmax_max);
+                softmax_sum += prediction[i];
+            }
+
+            if (softmax_sum == 0 || std::isnan(softmax_sum)) {
+                cerr << "ERROR! softmax sum was " << softmax_sum << " for the window at y: " << tile_y + y
+                     << ", x: " << tile_x + x << " of large image " << image_number << endl;
+                exit(1);
+            }
+
+            for (int32_t i = 0; i < number_classes; i++) {
+                prediction[i] = prediction[i] / softmax_sum;
+            }
+        }
+    }
+}
+
+void TiledInference::evaluate_tiles(
+    const LargeImageTilesInterface& images, int32_t image_number, int32_t band_y, int32_t band_height,
+    int32_t thread_id, float* band
+) {
+    int32_t map_width = get_map_width(images, image_number);
+
+    int32_t tile_number = 0;
+    for (int32_t tile_x = 0; tile_x < map_width; tile_x += tile_size) {
+        if (tile_number % number_threads == thread_id) {
+            int32_t tile_width = min(tile_size, map_width - tile_x);
+            evaluate_tile(
+                images, image_number, band_y, tile_x, band_height, tile_width, map_width, thread_values[thread_id],
+                band
+            );
+        }
+        tile_number++;
+    }
+}
+
+void TiledInference::evaluate_band(
+    const LargeImageTilesInterface& images, int32_t image_number, int32_t band_y, int32_t band_height,
+    vector<float>& band
+) {
+    int32_t map_width = get_map_width(images, image_number);
+    band.resize((size_t) band_height * map_width * get_number_classes());
+
+    int32_t number_tiles = (map_width + tile_size - 1) / tile_size;
+    int32_t band_threads = min(number_threads, number_tiles);
+
+    if (band_threads <= 1) {
+        evaluate_tiles(images, image_number, band_y, band_height, 0, band.data());
+        return;
+    }
+
+    // each thread has its own node values and writes a separate set of columns of the band
+    vector<thread> threads;
+    for (int32_t i = 0; i < band_threads; i++) {
+        threads.push_back(thread(
+            &TiledInference::evaluate_tiles, this, cref(images), image_number, band_y, band_height, i,
+            band.data()
+        ));
+    }
+
+    for (int32_t i = 0; i < (int32_t) threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void TiledInference::get_prediction_matrix(
+    const LargeImageTilesInterface& images, int32_t image_number, vector<vector<vector<float> > >& prediction_matrix
+) {
+    int32_t map_height = get_map_height(images, image_number);
+    int32_t map_width = get_map_width(images, image_number);
+    int32_t number_classes = get_number_classes();
+    check_map_size(images, image_number);
+
+    prediction_matrix.assign(map_height, vector<vector<float> >(map_width, vector<float>(number_classes, 0)));
+
+    vector<float> band;
+    for (int32_t band_y = 0; band_y < map_height; band_y += tile_size) {
+        int32_t band_height = min(tile_size, map_height - band_y);
+        evaluate_band(images, image_number, band_y, band_height, band);
+
+        int32_t current = 0;
+        for (int32_t y = 0; y < band_height; y++) {
+            for (int32_t x = 0; x < map_width; x++) {
+                for (int32_t c = 0; c < number_classes; c++) {
+                    prediction_matrix[band_y + y][x][c] = band[current];
+                    current++;
+                }
+            }
+        }
+    }
+}
+
+void TiledInference::write_class_maps(
+    const LargeImageTilesInterface& images, int32_t image_number, string window_filename, string pixel_filename
+) {
+    int32_t image_height = images.get_large_image_height(image_number);
+    int32_t image_width = images.get_large_image_width(image_number);
+    int32_t map_height = get_map_height(images, image_number);
+    int32_t map_width = get_map_width(images, image_number);
+    int32_t number_classes = get_number_classes();
+    check_map_size(images, image_number);
+
+    ofstream window_file(window_filename.c_str(), ios::out | ios::binary);
+    if (!window_file.is_open()) {
+        cerr << "ERROR: could not open '" << window_filename << "' for writing." << endl;
+        exit(1);
+    }
+    int32_t window_header[3] = {map_height, map_width, number_classes};
+    window_file.write((char*) window_header, sizeof(window_header));
+
+    bool write_pixels = pixel_filename.size() > 0;
+    ofstream pixel_file;
+    if (write_pixels) {
+        pixel_file.open(pixel_filename.c_str(), ios::out | ios::binary);
+        if (!pixel_file.is_open()) {
+            cerr << "ERROR: could not open '" << pixel_filename << "' for writing." << endl;
+            exit(1);
+        }
+        int32_t pixel_header[3] = {image_height, image_width, number_classes};
+        pixel_file.write((char*) pixel_header, sizeof(pixel_header));
+    }
+
+    // a pixel row is the sum of the window rows covering it, so the last window_height rows of horizontal window sums
+    // are kept in a ring and a running sum of them is added to and subtracted from as the window rows come in
+    int32_t row_size = image_width * number_classes;
+    vector<vector<double> > row_sums(window_height, vector<double>(row_size, 0.0));
+    vector<double> column_sums(row_size, 0.0);
+    vector<float> pixel_row(row_size, 0.0f);
+
+    float max_count = fmin(window_height, image_height - window_height + 1)
+                      * fmin(window_width, image_width - window_width + 1);
+
+    int32_t pixel_y = 0;
+    vector<float> band;
+    for (int32_t band_y = 0; band_y < map_height || (write_pixels && pixel_y < image_height); band_y += tile_size) {
+        int32_t band_height = 0;
+        if (band_y < map_height) {
+            band_height = min(tile_size, map_height - band_y);
+            evaluate_band(images, image_number, band_y, band_height, band);
+            window_file.write((char*) band.data(), sizeof(float) * band_height * map_width * number_classes);
+        }
+
+        if (!write_pixels) {
+            continue;
+        }
+
+        // after the last band the remaining pixel rows only have window rows leaving the sums
+        int32_t band_end = (band_y + tile_size < map_height) ? band_y + band_height : image_height;
+        for (; pixel_y < band_end; pixel_y++) {
+            vector<double>& entering = row_sums[pixel_y % window_height];
+
+            if (pixel_y >= window_height) {
+                for (int32_t i = 0; i < row_size; i++) {
+                    column_sums[i] -= entering[i];
+                }
+            }
+
+            if (pixel_y < map_height) {
+                const float* window_row = band.data() + ((size_t) (pixel_y - band_y) * map_width * number_classes);
+
+                // entering[x] is the sum of the windows in this row starting in (x - window_width, x]
+                fill(entering.begin(), entering.end(), 0.0);
+                for (int32_t c = 0; c < number_classes; c++) {
+                    double sum = 0.0;
+                    for (int32_t x = 0; x < image_width; x++) {
+                        if (x < map_width) {
+                            sum += window_row[(x * number_classes) + c];
+                        }
+                        if (x - window_width >= 0) {
+                            sum -= window_row[((x - window_width) * number_classes) + c];
+                        }
+                        entering[(x * number_classes) + c] = sum;
+                    }
+                }
+
+                for (int32_t i = 0; i < row_size; i++) {
+                    column_sums[i] += entering[i];
+                }
+            } else {
+                fill(entering.begin(), entering.end(), 0.0);
+            }
+
+            for (int32_t i = 0; i < row_size; i++) {
+                pixel_row[i] = column_sums[i] / max_count;
+            }
+            pixel_file.write((char*) pixel_row.data(), sizeof(float) * row_size);
+        }
+    }
+
+    cout << "wrote " << map_height << "x" << map_width << " window map of large image " << image_number << " to '"
+         << window_filename << "'";
+    if (write_pixels) {
+        cout << " and its " << image_height << "x" << image_width << " pixel map to '" << pixel_filename << "'";
+    }
+    cout << endl;
+}
@@ -0,0 +1,108 @@
+#ifndef CNN_TILED_INFERENCE_HXX
+#define CNN_TILED_INFERENCE_HXX
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "cnn_edge.hxx"
+#include "cnn_node.hxx"
+#include "image_tools/image_set_interface.hxx"
+#include "stdint.h"
+
+class CNN_Genome;
+
+/**
+ * Sliding window inference over large images for genomes which are fully convolutional (every reachable edge is a
+ * convolution without reversed filters). Instead of evaluating every window of the image as a separate batch entry,
+ * the genome is run once over a tile of tile_size x tile_size windows: every node is grown by tile_size - 1 in y and
+ * x (which leaves the filter sizes unchanged), so the activations shared by overlapping windows are only calculated
+ * once and the softmax nodes come out as a tile_size x tile_size map of predictions.
+ *
+ * The window at (y, x) covers rows [y - padding, y + window_height + padding) and the same columns of the large
+ * image, with anything outside of the image 0. For genomes without padding this gives the same predictions as the
+ * subimage evaluation (exactly, unless the compiler contracts multiplies and adds into FMAs); with padding the windows
+ * see the neighbouring pixels of the image where a subimage would see the zero padding.
+ *
+ * The windows are evaluated a band of tile_size rows at a time, with the tiles of a band split over the threads, so
+ * class maps can be written out as they are calculated instead of being held in memory.
+ */
+class TiledInference {
+   private:
+    int32_t tile_size;
+    int32_t number_threads;
+
+    int32_t padding;
+    int32_t window_height;
+    int32_t window_width;
+
+    float epsilon;
+    float input_dropout_probability;
+    float hidden_dropout_probability;
+
+    // the reachable nodes and edges of the genome, with the edges in the order the genome propagates them
+    vector<CNN_Node*> nodes;
+    vector<CNN_Edge*> edges;
+    vector<int32_t> edge_inputs;
+    vector<int32_t> edge_outputs;
+    vector<int32_t> node_inputs;
+
+    // the positions (in nodes) of the input node of each channel and the softmax node of each class
+    vector<int32_t> input_positions;
+    vector<int32_t> softmax_positions;
+
+    // the values of every node for each thread's tile, reused from tile to tile
+    vector<vector<vector<float> > > thread_values;
+
+    void check_map_size(const LargeImageTilesInterface& images, int32_t image_number) const;
+
+    void evaluate_tiles(
+        const LargeImageTilesInterface& images, int32_t image_number, int32_t band_y, int32_t band_height,
+        int32_t thread_id, float* band
+    );
+
+    void evaluate_tile(
+        const LargeImageTilesInterface& images, int32_t image_number, int32_t tile_y, int32_t tile_x,
+        int32_t tile_height, int32_t tile_width, int32_t map_width, vector<vector<float> >& values, float* band
+    );
+
+   public:
+    TiledInference(CNN_Genome* genome, int32_t _tile_size, int32_t _number_threads);
+
+    int32_t get_number_classes() const;
+    int32_t get_map_height(const LargeImageTilesInterface& images, int32_t image_number) const;
+    int32_t get_map_width(const LargeImageTilesInterface& images, int32_t image_number) const;
+
+    /**
+     * Calculates the class predictions of the windows in rows [band_y, band_y + band_height) of the prediction map
+     * (which has a row for each window position in y and a column for each in x), band_height x map width x number
+     * classes values with the classes of each window together.
+     */
+    void evaluate_band(
+        const LargeImageTilesInterface& images, int32_t image_number, int32_t band_y, int32_t band_height,
+        vector<float>& band
+    );
+
+    /**
+     * Gets the whole prediction map of an image, in the same layout as CNN_Genome::get_prediction_matrix.
+     */
+    void get_prediction_matrix(
+        const LargeImageTilesInterface& images, int32_t image_number,
+        vector<vector<vector<float> > >& prediction_matrix
+    );
+
+    /**
+     * Streams the class maps of an image to binary files as the bands are calculated: the window map has a value
+     * for each window position, and the pixel map (if pixel_filename is not empty) has a value for each pixel, the
+     * sum of the predictions of the windows covering it scaled the same way as
+     * CNN_Genome::get_expanded_prediction_matrix. Each file is a header of 3 int32s (height, width and number of
+     * classes) followed by the float32 values, row by row with the classes of each position together.
+     */
+    void write_class_maps(
+        const LargeImageTilesInterface& images, int32_t image_number, string window_filename, string pixel_filename
+    );
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include <iostream>
+using std::cerr;
+using std::cout;
+using std::endl;
+
+#include <sstream>
+using std::ostringstream;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "cnn/cnn_genome.hxx"
+#include "cnn/tiled_inference.hxx"
+#include "common/arguments.hxx"
+#include "image_tools/mapped_large_image_set.hxx"
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    string genome_filename;
+    get_argument(arguments, "--genome_file", true, genome_filename);
+
+    string large_image_filename;
+    get_argument(arguments, "--large_image_file", true, large_image_filename);
+
+    string output_directory;
+    get_argument(arguments, "--output_directory", true, output_directory);
+
+    int tile_size = 128;
+    get_argument(arguments, "--tile_size", false, tile_size);
+
+    int number_threads = 1;
+    get_argument(arguments, "--number_threads", false, number_threads);
+
+    bool pixel_maps = argument_exists(arguments, "--pixel_maps");
+
+    bool is_checkpoint = false;
+    CNN_Genome* genome = new CNN_Genome(genome_filename, is_checkpoint);
+    genome->set_to_best();
+
+    if (!genome->is_fully_convolutional()) {
+        cerr << "ERROR: genome '" << genome_filename << "' has pooling or reversed filters, so it cannot be applied a "
+             << "tile at a time, use apply_cnn_to_mosaic or evaluate_large_image_cnn instead." << endl;
+        exit(1);
+    }
+
+    // the images are normalized with the training set's statistics if they are given, otherwise with their own
+    MappedLargeImages* images = NULL;
+    if (argument_exists(arguments, "--channel_avg")) {
+        vector<float> channel_avg;
+        get_argument_vector(arguments, "--channel_avg", true, channel_avg);
+
+        vector<float> channel_std_dev;
+        get_argument_vector(arguments, "--channel_std_dev", true, channel_std_dev);
+
+        images = new MappedLargeImages(large_image_filename, channel_avg, channel_std_dev);
+    } else {
+        images = new MappedLargeImages(large_image_filename);
+    }
+
+    if (!images->loaded_correctly()) {
+        cerr << "ERROR: could not read the large images from '" << large_image_filename << "'" << endl;
+        exit(1);
+    }
+
+    TiledInference tiled_inference(genome, tile_size, number_threads);
+
+    for (int32_t i = 0; i < images->get_number_large_images(); i++) {
+        ostringstream window_filename;
+        window_filename << output_directory << "/large_image_" << i << "_windows.bin";
+
+        ostringstream pixel_filename;
+        if (pixel_maps) {
+            pixel_filename << output_directory << "/large_image_" << i << "_pixels.bin";
+        }
+
+        tiled_inference.write_class_maps(*images, i, window_filename.str(), pixel_filename.str());
+    }
+
+    delete images;
+    delete genome;
+}
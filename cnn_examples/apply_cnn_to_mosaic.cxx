@@ -37,6 +37,15 @@ int main(int argc, char** argv) {
     bool is_checkpoint = false;
     CNN_Genome* genome = new CNN_Genome(genome_filename, is_checkpoint);
 
+    // evaluate fully convolutional genomes a tile of windows at a time instead of window by window
+    int tile_size = 0;
+    get_argument(arguments, "--tile_size", false, tile_size);
+    genome->set_tile_size(tile_size);
+
+    int number_threads = 1;
+    get_argument(arguments, "--number_threads", false, number_threads);
+    genome->set_number_threads(number_threads);
+
     string label_name;
     get_argument(arguments, "--label_name", true, label_name);
 
@@ -0,0 +1,137 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+using std::min;
+
+#include <chrono>
+
+#include <cstring>
+using std::memset;
+using std::strncpy;
+
+#include <iostream>
+using std::cerr;
+using std::cout;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "image_tools/image_set.hxx"
+
+bool read_fully(int socket, void* buffer, size_t size) {
+    char* bytes = (char*) buffer;
+    while (size > 0) {
+        ssize_t count = read(socket, bytes, size);
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool write_fully(int socket, const void* buffer, size_t size) {
+    const char* bytes = (const char*) buffer;
+    while (size > 0) {
+        ssize_t count = write(socket, bytes, size);
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+/**
+ * Sends the images of a binary image file to a cnn_inference_server, --request_size images at a time, and reports
+ * how many were classified correctly and how long it took.
+ */
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    string socket_filename;
+    get_argument(arguments, "--socket", true, socket_filename);
+
+    string images_filename;
+    get_argument(arguments, "--images_file", true, images_filename);
+
+    int request_size = 1;
+    get_argument(arguments, "--request_size", false, request_size);
+
+    Images images(images_filename, 0);
+
+    int client_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_filename.c_str(), sizeof(address.sun_path) - 1);
+
+    if (client_socket < 0 || connect(client_socket, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        cerr << "ERROR: could not connect to '" << socket_filename << "'." << endl;
+        exit(1);
+    }
+
+    int32_t channels = images.get_image_channels();
+    int32_t height = images.get_image_height();
+    int32_t width = images.get_image_width();
+    int32_t image_size = channels * height * width;
+
+    using namespace std::chrono;
+    high_resolution_clock::time_point start_time = high_resolution_clock::now();
+
+    int32_t correct_predictions = 0;
+    vector<float> predictions;
+
+    for (int32_t i = 0; i < images.get_number_images(); i += request_size) {
+        int32_t number_images = min(request_size, images.get_number_images() - i);
+
+        int32_t header[4] = {number_images, channels, height, width};
+        write_fully(client_socket, header, sizeof(header));
+        for (int32_t j = 0; j < number_images; j++) {
+            write_fully(client_socket, images.get_image_pixels(i + j), image_size);
+        }
+
+        int32_t response_header[2];
+        if (!read_fully(client_socket, response_header, sizeof(response_header)) || response_header[0] < 0) {
+            cerr << "ERROR: the server rejected the request for images " << i << " to " << (i + number_images)
+                 << "." << endl;
+            exit(1);
+        }
+
+        int32_t number_classes = response_header[1];
+        predictions.resize((size_t) number_images * number_classes);
+        read_fully(client_socket, predictions.data(), predictions.size() * sizeof(float));
+
+        for (int32_t j = 0; j < number_images; j++) {
+            int32_t predicted_class = 0;
+            for (int32_t k = 1; k < number_classes; k++) {
+                if (predictions[(j * number_classes) + k] > predictions[(j * number_classes) + predicted_class]) {
+                    predicted_class = k;
+                }
+            }
+
+            if (predicted_class == images.get_classification(i + j)) {
+                correct_predictions++;
+            }
+        }
+    }
+
+    int32_t close_header[4] = {0, 0, 0, 0};
+    write_fully(client_socket, close_header, sizeof(close_header));
+    close(client_socket);
+
+    double seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start_time).count();
+
+    cout << "correct predictions: " << correct_predictions << " of " << images.get_number_images() << endl;
+    cout << "time: " << seconds << "s (" << (images.get_number_images() / seconds) << " images/s)" << endl;
+}
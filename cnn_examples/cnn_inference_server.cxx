@@ -0,0 +1,69 @@
+#include <csignal>
+using std::signal;
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "cnn/inference_server.hxx"
+#include "common/arguments.hxx"
+#include "image_tools/image_set.hxx"
+
+void handle_stop_signal(int signal_number) {
+    InferenceServer::stop();
+}
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    string genome_filename;
+    get_argument(arguments, "--genome_file", true, genome_filename);
+
+    string socket_filename;
+    get_argument(arguments, "--socket", true, socket_filename);
+
+    // one replica of the genome per core by default
+    int number_threads = thread::hardware_concurrency();
+    get_argument(arguments, "--number_threads", false, number_threads);
+    if (number_threads < 1) {
+        number_threads = 1;
+    }
+
+    int max_wait_us = 2000;
+    get_argument(arguments, "--max_wait_us", false, max_wait_us);
+
+    // the images need to be normalized with the statistics of the set the genome was trained on
+    vector<float> channel_avg;
+    vector<float> channel_std_dev;
+    if (argument_exists(arguments, "--training_file")) {
+        string training_filename;
+        get_argument(arguments, "--training_file", true, training_filename);
+
+        Images training_images(training_filename, 0);
+        channel_avg = training_images.get_average();
+        channel_std_dev = training_images.get_std_dev();
+    } else if (argument_exists(arguments, "--channel_avg")) {
+        get_argument_vector(arguments, "--channel_avg", true, channel_avg);
+        get_argument_vector(arguments, "--channel_std_dev", true, channel_std_dev);
+    } else {
+        cerr << "ERROR: need either --training_file or --channel_avg and --channel_std_dev to normalize the images."
+             << endl;
+        exit(1);
+    }
+
+    InferenceServer server(genome_filename, socket_filename, number_threads, max_wait_us, channel_avg, channel_std_dev);
+
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+
+    server.run();
+}
@@ -0,0 +1,141 @@
+#include <chrono>
+
+#include <cmath>
+
+#include <iomanip>
+using std::setw;
+
+#include <iostream>
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::fixed;
+using std::setprecision;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "cnn/cnn_genome.hxx"
+#include "cnn/compiled_genome.hxx"
+#include "common/arguments.hxx"
+#include "image_tools/image_set.hxx"
+
+static int32_t count_correct(const ImagesInterface& images, const vector<vector<float> >& predictions) {
+    int32_t correct = 0;
+    for (int32_t i = 0; i < images.get_number_images(); i++) {
+        int32_t best = 0;
+        for (int32_t j = 1; j < (int32_t) predictions[i].size(); j++) {
+            if (predictions[i][j] > predictions[i][best]) {
+                best = j;
+            }
+        }
+
+        if (best == images.get_classification(i)) {
+            correct++;
+        }
+    }
+    return correct;
+}
+
+static void report(
+    string name, const ImagesInterface& images, const vector<vector<float> >& predictions,
+    const vector<vector<float> >& reference, double seconds
+) {
+    int32_t agree = 0;
+    float max_difference = 0.0;
+    for (int32_t i = 0; i < images.get_number_images(); i++) {
+        int32_t best = 0, reference_best = 0;
+        for (int32_t j = 0; j < (int32_t) predictions[i].size(); j++) {
+            if (predictions[i][j] > predictions[i][best]) {
+                best = j;
+            }
+            if (reference[i][j] > reference[i][reference_best]) {
+                reference_best = j;
+            }
+            max_difference = fmax(max_difference, fabs(predictions[i][j] - reference[i][j]));
+        }
+
+        if (best == reference_best) {
+            agree++;
+        }
+    }
+
+    cout << setw(10) << name << ": correct " << setw(8) << count_correct(images, predictions) << " / "
+         << images.get_number_images() << ", agrees with genome " << setw(8) << agree << ", max prediction difference "
+         << setw(12) << max_difference << ", " << setw(10) << seconds << " seconds" << endl;
+}
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    string genome_filename;
+    get_argument(arguments, "--genome_file", true, genome_filename);
+
+    string training_filename;
+    get_argument(arguments, "--training_file", true, training_filename);
+
+    string testing_filename;
+    get_argument(arguments, "--testing_file", true, testing_filename);
+
+    int32_t calibration_images = 1000;
+    get_argument(arguments, "--calibration_images", false, calibration_images);
+
+    string calibration_filename;
+    get_argument(arguments, "--calibration_file", false, calibration_filename);
+
+    bool is_checkpoint = false;
+    CNN_Genome* genome = new CNN_Genome(genome_filename, is_checkpoint);
+
+    int32_t batch_size = genome->get_batch_size();
+    get_argument(arguments, "--batch_size", false, batch_size);
+
+    Images training_images(training_filename, genome->get_padding());
+    Images testing_images(
+        testing_filename, genome->get_padding(), training_images.get_average(), training_images.get_std_dev()
+    );
+
+    genome->initialize();
+    genome->set_to_best();
+
+    vector<vector<float> > reference, float_predictions, int8_predictions;
+
+    using namespace std::chrono;
+    high_resolution_clock::time_point start = high_resolution_clock::now();
+    genome->evaluate(testing_images, reference);
+    double genome_seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+    CompiledGenome float_genome(genome, COMPILED_FLOAT, batch_size);
+    start = high_resolution_clock::now();
+    float_genome.evaluate(testing_images, float_predictions);
+    double float_seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+    CompiledGenome int8_genome(genome, COMPILED_INT8, batch_size);
+    if (calibration_filename.compare("") != 0 && argument_exists(arguments, "--read_calibration")) {
+        int8_genome.read_calibration(calibration_filename);
+    } else {
+        // calibrate on the training images, so the test images are not used to set the scales
+        int8_genome.calibrate(training_images, calibration_images);
+        if (calibration_filename.compare("") != 0) {
+            int8_genome.write_calibration(calibration_filename);
+        }
+    }
+
+    start = high_resolution_clock::now();
+    int8_genome.evaluate(testing_images, int8_predictions);
+    double int8_seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+    cout << fixed << setprecision(6);
+    report("genome", testing_images, reference, reference, genome_seconds);
+    report("float", testing_images, float_predictions, reference, float_seconds);
+    report("int8", testing_images, int8_predictions, reference, int8_seconds);
+
+    cout << "weight bytes: float " << float_genome.get_weight_bytes() << ", int8 " << int8_genome.get_weight_bytes()
+         << endl;
+    cout << "activation bytes: float " << float_genome.get_activation_bytes() << ", int8 "
+         << int8_genome.get_activation_bytes() << endl;
+
+    delete genome;
+}
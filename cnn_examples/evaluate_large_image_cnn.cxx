@@ -65,6 +65,15 @@ int main(int argc, char** argv) {
         testing_data, genome->get_padding(), 64, 64, training_images.get_average(), training_images.get_std_dev()
     );
 
+    // evaluate fully convolutional genomes a tile of windows at a time instead of window by window
+    int tile_size = 0;
+    get_argument(arguments, "--tile_size", false, tile_size);
+    genome->set_tile_size(tile_size);
+
+    int number_threads = 1;
+    get_argument(arguments, "--number_threads", false, number_threads);
+    genome->set_number_threads(number_threads);
+
     // genome->initialize();
     genome->set_to_best();
 
@@ -73,6 +73,15 @@ int main(int argc, char** argv) {
     double hidden_dropout_probability;
     get_argument(arguments, "--hidden_dropout_probability", true, hidden_dropout_probability);
 
+    int number_threads = 1;
+    get_argument(arguments, "--number_threads", false, number_threads);
+
+    bool no_prefetch = argument_exists(arguments, "--no_prefetch");
+
+    int augment_shift = 0;
+    get_argument(arguments, "--augment_shift", false, augment_shift);
+    bool augment_flip = argument_exists(arguments, "--augment_flip");
+
     double epsilon = 1.0e-7;
 
     LargeImages training_images(training_filename, padding, 64, 64);
@@ -302,6 +311,9 @@ int main(int argc, char** argv) {
     genome->print_graphviz(outfile);
     outfile.close();
 
+    genome->set_number_threads(number_threads);
+    genome->set_prefetch_batches(!no_prefetch);
+    genome->set_augmentation(augment_shift, augment_flip);
     genome->stochastic_backpropagation(training_images, validation_images);
 
     cout << "writing genome to file!" << endl;
@@ -18,6 +18,7 @@ using std::vector;
 #include "cnn/cnn_edge.hxx"
 #include "cnn/cnn_genome.hxx"
 #include "cnn/cnn_node.hxx"
+#include "cnn/convolution_backend.hxx"
 #include "cnn/exact.hxx"
 #include "common/arguments.hxx"
 #include "image_tools/image_set.hxx"
@@ -25,6 +26,8 @@ using std::vector;
 int main(int argc, char** argv) {
     vector<string> arguments = vector<string>(argv, argv + argc);
 
+    ConvolutionAutotuner::initialize(arguments);
+
     string training_filename;
     get_argument(arguments, "--training_file", true, training_filename);
 
@@ -73,6 +76,15 @@ int main(int argc, char** argv) {
     double hidden_dropout_probability;
     get_argument(arguments, "--hidden_dropout_probability", true, hidden_dropout_probability);
 
+    int number_threads = 1;
+    get_argument(arguments, "--number_threads", false, number_threads);
+
+    bool no_prefetch = argument_exists(arguments, "--no_prefetch");
+
+    int augment_shift = 0;
+    get_argument(arguments, "--augment_shift", false, augment_shift);
+    bool augment_flip = argument_exists(arguments, "--augment_flip");
+
     double epsilon = 1.0e-7;
 
     Images training_images(training_filename, padding);
@@ -285,9 +297,13 @@ int main(int argc, char** argv) {
 
     // genome->check_gradients(training_images);
 
+    genome->set_number_threads(number_threads);
+    genome->set_prefetch_batches(!no_prefetch);
+    genome->set_augmentation(augment_shift, augment_flip);
     genome->stochastic_backpropagation(training_images, validation_images);
     genome->evaluate_test(testing_images);
     genome->print_results(cerr);
+    ConvolutionAutotuner::print_choices(cerr);
 
     genome->write_to_file("lenet_trained.txt");
 }
@@ -142,6 +142,17 @@ void Log::release_id(string human_readable_id) {
     log_ids_mutex.unlock();
 }
 
+string Log::get_id() {
+    thread::id id = std::this_thread::get_id();
+
+    log_ids_mutex.lock_shared();
+    auto log_id = log_ids.find(id);
+    string human_readable_id = log_id == log_ids.end() ? "" : log_id->second;
+    log_ids_mutex.unlock_shared();
+
+    return human_readable_id;
+}
+
 void Log::write_message(
     bool print_header, int8_t message_level, const char* message_type, const char* format, va_list arguments
 ) {
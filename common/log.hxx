@@ -194,6 +194,14 @@ class Log {
      */
     static void release_id(string human_readable_id);
 
+    /**
+     * Gets the human readable id set for the calling thread, so threads it starts can be given
+     * ids derived from it.
+     *
+     * \return the human readable id of the calling thread, or an empty string if it has not been set
+     */
+    static string get_id();
+
     /**
      * Determines if either output level (the file or standard output) level
      * is above the level passed as a parameter.
@@ -48,6 +48,7 @@ EXAMM* generate_examm_from_arguments(
         }
         Log::info_no_header("\n");
     }
+    get_argument(arguments, "--dnas_pruning_threshold", false, dnas_pruning_threshold);
 
     GenomeProperty* genome_property = new GenomeProperty();
     genome_property->generate_genome_property_from_arguments(arguments);
@@ -145,11 +146,17 @@ NeatSpeciationStrategy* generate_neat_speciation_strategy_from_arguments(
     get_argument(arguments, "--neat_c2", false, neat_c2);
     double neat_c3 = 1;
     get_argument(arguments, "--neat_c3", false, neat_c3);
+    int32_t speciation_threads = 1;
+    get_argument(arguments, "--speciation_threads", false, speciation_threads);
+    if (speciation_threads < 1) {
+        Log::fatal("ERROR: --speciation_threads must be >= 1, was %d\n", speciation_threads);
+        exit(1);
+    }
     double mutation_rate = 0.70, intra_island_co_rate = 0.20, inter_island_co_rate = 0.10;
 
     NeatSpeciationStrategy* neat_strategy = new NeatSpeciationStrategy(
         mutation_rate, intra_island_co_rate, inter_island_co_rate, seed_genome, species_threshold, fitness_threshold,
-        neat_c1, neat_c2, neat_c3
+        neat_c1, neat_c2, neat_c3, speciation_threads
     );
     return neat_strategy;
 }
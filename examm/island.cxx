@@ -447,7 +447,7 @@ void Island::fill_with_mutated_genomes(
     Log::info("Island %d: Filling island with mutated seed genomes\n", id);
     for (int32_t i = 0; i < max_size; i++) {
         RNN_Genome* new_genome = seed_genome->copy();
-        mutate(num_mutations, seed_genome);
+        mutate(num_mutations, new_genome);
         new_genome->set_generation_id(0);
         if (tl_epigenetic_weights) {
             new_genome->initialize_randomly();
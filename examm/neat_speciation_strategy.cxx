@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <functional>
 using std::function;
 
@@ -12,6 +14,13 @@ using std::uniform_real_distribution;
 
 #include <string>
 using std::string;
+using std::to_string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
 
 #include <stdlib.h>
 
@@ -26,7 +35,7 @@ using std::string;
 NeatSpeciationStrategy::NeatSpeciationStrategy(
     double _mutation_rate, double _intra_island_crossover_rate, double _inter_island_crossover_rate,
     RNN_Genome* _seed_genome, double _species_threshold, double _fitness_threshold, double _neat_c1, double _neat_c2,
-    double _neat_c3
+    double _neat_c3, int32_t _speciation_threads
 )
     : generation_species(0),
       species_count(0),
@@ -36,6 +45,7 @@ NeatSpeciationStrategy::NeatSpeciationStrategy(
       neat_c1(_neat_c1),
       neat_c2(_neat_c2),
       neat_c3(_neat_c3),
+      speciation_threads(_speciation_threads),
       mutation_rate(_mutation_rate),
       intra_island_crossover_rate(_intra_island_crossover_rate),
       inter_island_crossover_rate(_inter_island_crossover_rate),
@@ -163,6 +173,22 @@ int32_t NeatSpeciationStrategy::insert_genome(RNN_Genome* genome) {
 
     if (!inserted) {
         vector<int32_t> species_list = get_random_species_list();
+
+        vector<RNN_Genome*> representatives(species_list.size(), NULL);
+        for (int32_t i = 0; i < (int32_t) species_list.size(); i++) {
+            Species* random_species = Neat_Species[species_list[i]];
+            if (random_species != NULL && random_species->size() > 0) {
+                representatives[i] = random_species->get_latested_genome();
+            }
+        }
+
+        // with multiple threads the distances to every species are calculated up front, otherwise they are
+        // calculated one at a time until a species close enough is found
+        vector<double> distances;
+        if (speciation_threads > 1) {
+            get_distances(genome, representatives, distances);
+        }
+
         for (int32_t i = 0; i < (int32_t) species_list.size(); i++) {
             Species* random_species = Neat_Species[species_list[i]];
             if (random_species == NULL || random_species->size() == 0) {
@@ -170,7 +196,7 @@ int32_t NeatSpeciationStrategy::insert_genome(RNN_Genome* genome) {
                 continue;
             }
 
-            RNN_Genome* genome_representation = random_species->get_latested_genome();
+            RNN_Genome* genome_representation = representatives[i];
             if (genome_representation == NULL) {
                 Log::error("genome representation is null!\n");
                 break;
@@ -179,7 +205,8 @@ int32_t NeatSpeciationStrategy::insert_genome(RNN_Genome* genome) {
             if (genome_representation == NULL) {
                 Log::fatal("the latest genome is null, this should never happen!\n");
             }
-            double distance = get_distance(genome_representation, genome);
+            double distance =
+                distances.size() > 0 ? distances[i] : get_distance(genome_representation, genome);
 
             // Log::error("distance is %f \n", distance);
 
@@ -436,8 +463,8 @@ double NeatSpeciationStrategy::get_distance(RNN_Genome* g1, RNN_Genome* g2) {
     int32_t D;
     int32_t N;
     // d = c1*E/N + c2*D/N + c3*w
-    vector<int32_t> innovation1 = g1->get_innovation_list();
-    vector<int32_t> innovation2 = g2->get_innovation_list();
+    const vector<int32_t>& innovation1 = g1->get_innovation_list();
+    const vector<int32_t>& innovation2 = g2->get_innovation_list();
     double weight1 = g1->get_avg_edge_weight();
     double weight2 = g2->get_avg_edge_weight();
     double w = abs(weight1 - weight2);
@@ -457,34 +484,77 @@ double NeatSpeciationStrategy::get_distance(RNN_Genome* g1, RNN_Genome* g2) {
         E = get_exceed_number(innovation2, innovation1);
     }
 
-    std::vector<int32_t> setunion;
-    std::vector<int32_t> intersec;
-    std::set_union(
-        innovation1.begin(), innovation1.end(), innovation2.begin(), innovation2.end(),
-        std::inserter(setunion, setunion.begin())
-    );
-    std::set_intersection(
-        innovation1.begin(), innovation1.end(), innovation2.begin(), innovation2.end(),
-        std::inserter(intersec, intersec.begin())
-    );
-
-    D = setunion.size() - intersec.size() - E;
+    // the union minus the intersection is everything not in common, the disjoint genes are what is
+    // left after removing the excess genes
+    int32_t common = get_common_number(innovation1, innovation2);
+    D = innovation1.size() + innovation2.size() - (2 * common) - E;
     distance = neat_c1 * E / N + neat_c2 * D / N + neat_c3 * w;
     Log::debug("distance is %f \n", distance);
     return distance;
 }
-// v1.max > v2.max
-int32_t NeatSpeciationStrategy::get_exceed_number(vector<int32_t> v1, vector<int32_t> v2) {
-    int32_t exceed = 0;
 
-    for (auto it = v1.rbegin(); it != v1.rend(); ++it) {
-        if (*it > v2.back()) {
-            exceed++;
-        } else {
-            break;
+void species_distance_thread(
+    NeatSpeciationStrategy* strategy, RNN_Genome* genome, const vector<RNN_Genome*>& representatives,
+    vector<double>& distances, int32_t thread_id, int32_t number_threads
+) {
+    // get_distance logs, so each thread needs its own log id
+    string log_id = "species_distance_" + to_string(thread_id);
+    Log::set_id(log_id);
+
+    for (int32_t i = thread_id; i < (int32_t) representatives.size(); i += number_threads) {
+        if (representatives[i] != NULL) {
+            distances[i] = strategy->get_distance(representatives[i], genome);
         }
     }
-    return exceed;
+
+    Log::release_id(log_id);
+}
+
+void NeatSpeciationStrategy::get_distances(
+    RNN_Genome* genome, const vector<RNN_Genome*>& representatives, vector<double>& distances
+) {
+    distances.assign(representatives.size(), EXAMM_MAX_DOUBLE);
+
+    // build the cached innovation lists before the threads start, as the inserted genome is shared by all of them
+    // and each representative is only used by one thread
+    genome->get_innovation_list();
+
+    int32_t number_threads = std::min(speciation_threads, (int32_t) representatives.size());
+    vector<thread> threads;
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads.push_back(thread(
+            species_distance_thread, this, genome, std::cref(representatives), std::ref(distances), i, number_threads
+        ));
+    }
+
+    for (int32_t i = 0; i < (int32_t) threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+// v1.max > v2.max
+int32_t NeatSpeciationStrategy::get_exceed_number(const vector<int32_t>& v1, const vector<int32_t>& v2) {
+    // v1 is sorted so everything after the first innovation number larger than v2's max is in excess
+    return v1.end() - std::upper_bound(v1.begin(), v1.end(), v2.back());
+}
+
+int32_t NeatSpeciationStrategy::get_common_number(const vector<int32_t>& v1, const vector<int32_t>& v2) {
+    int32_t common = 0;
+    int32_t i = 0, j = 0;
+    int32_t size1 = v1.size(), size2 = v2.size();
+    const int32_t* a = v1.data();
+    const int32_t* b = v2.data();
+
+    // branch free merge, the comparisons become conditional moves so mispredicted branches
+    // don't dominate the walk over the two lists
+    while (i < size1 && j < size2) {
+        int32_t x = a[i];
+        int32_t y = b[j];
+        common += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return common;
 }
 
 void NeatSpeciationStrategy::rank_species() {
@@ -25,6 +25,7 @@ class NeatSpeciationStrategy : public SpeciationStrategy {
     double neat_c1;
     double neat_c2;
     double neat_c3;
+    int32_t speciation_threads; /**< How many threads calculate the distances of a new genome to the species. */
     double mutation_rate; /**< How frequently to do mutations. Note that mutation_rate + intra_island_crossover_rate +
                              inter_island_crossover_rate should equal 1, if not they will be scaled down such that they
                              do. */
@@ -48,7 +49,7 @@ class NeatSpeciationStrategy : public SpeciationStrategy {
     NeatSpeciationStrategy(
         double _mutation_rate, double _intra_island_crossover_rate, double _inter_island_crossover_rate,
         RNN_Genome* _seed_genome, double _species_threshold, double _fitness_threshold, double _neat_c1,
-        double _neat_c2, double _neat_c3
+        double _neat_c2, double _neat_c3, int32_t _speciation_threads = 1
     );
     /**
      * \return the number of generated genomes.
@@ -138,7 +139,22 @@ class NeatSpeciationStrategy : public SpeciationStrategy {
 
     double get_distance(RNN_Genome* g1, RNN_Genome* g2);
 
-    int32_t get_exceed_number(vector<int32_t> v1, vector<int32_t> v2);
+    /**
+     * Calculates the distance from a genome to the representative of each species in a species list, splitting
+     * the species over speciation_threads threads.
+     *
+     * \param genome is the genome being inserted
+     * \param representatives are the species representatives, NULL entries are skipped
+     * \param distances will be filled in with the distance to each representative
+     */
+    void get_distances(RNN_Genome* genome, const vector<RNN_Genome*>& representatives, vector<double>& distances);
+
+    int32_t get_exceed_number(const vector<int32_t>& v1, const vector<int32_t>& v2);
+
+    /**
+     * \return how many innovation numbers two sorted innovation lists have in common
+     */
+    int32_t get_common_number(const vector<int32_t>& v1, const vector<int32_t>& v2);
 
     void rank_species();
 
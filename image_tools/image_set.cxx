@@ -1,4 +1,15 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+using std::fill_n;
+
 #include <cmath>
+#include <cstring>
+using std::memcpy;
+
 #include <fstream>
 using std::ifstream;
 
@@ -18,112 +29,49 @@ using std::string;
 #include <vector>
 using std::vector;
 
+#include "common/log.hxx"
 #include "image_set.hxx"
 #include "stdint.h"
 
-Image::Image(
-    ifstream& infile, int _channels, int _width, int _height, int _padding, int _classification, const Images* _images
-) {
-    channels = _channels;
-    width = _width;
-    height = _height;
-    padding = _padding;
-    classification = _classification;
-    images = _images;
-
-    pixels = vector<vector<vector<uint8_t> > >(channels, vector<vector<uint8_t> >(height, vector<uint8_t>(width, 0)));
-
-    char* c_pixels = new char[channels * width * height];
-
-    infile.read(c_pixels, sizeof(char) * channels * width * height);
-
-    int current = 0;
-    for (int32_t z = 0; z < channels; z++) {
-        for (int32_t y = 0; y < height; y++) {
-            for (int32_t x = 0; x < width; x++) {
-                pixels[z][y][x] = (uint8_t) c_pixels[current];
-                current++;
-            }
-        }
-    }
-
-    delete[] c_pixels;
-}
-
-float Image::get_pixel(int z, int y, int x) const {
-    if (y < padding || x < padding) {
-        return 0;
-    } else if (y >= width + padding || x >= height + padding) {
-        return 0;
-    } else {
-        return ((pixels[z][y - padding][x - padding] / 255.0) - images->get_channel_avg(z))
-               / images->get_channel_std_dev(z);
-    }
-}
-
-int Image::get_classification() const {
-    return classification;
-}
-
-void Image::get_pixel_avg(vector<float>& channel_avgs) const {
-    channel_avgs.clear();
-    channel_avgs.assign(channels, 0.0);
-
-    for (int32_t z = 0; z < channels; z++) {
-        for (int32_t y = 0; y < height; y++) {
-            for (int32_t x = 0; x < width; x++) {
-                channel_avgs[z] += pixels[z][y][x] / 255.0;
-            }
-        }
-        channel_avgs[z] /= (height * width);
-    }
-}
-
-void Image::get_pixel_variance(const vector<float>& channel_avgs, vector<float>& channel_variances) const {
-    channel_variances.clear();
-    channel_variances.assign(channels, 0.0);
-
-    float tmp;
-    for (int32_t z = 0; z < channels; z++) {
-        for (int32_t y = 0; y < height; y++) {
-            for (int32_t x = 0; x < width; x++) {
-                tmp = channel_avgs[z] - (pixels[z][y][x] / 255.0);
-                channel_variances[z] += tmp * tmp;
-            }
-        }
-
-        channel_variances[z] /= (height * width);
-    }
-}
-
-void Image::print(ostream& out) {
-    out << "Image Class: " << classification << endl;
-    for (int32_t z = 0; z < channels; z++) {
-        for (int32_t y = 0; y < height; y++) {
-            for (int32_t x = 0; x < width; x++) {
-                out << setw(7) << pixels[z][y][x];
-            }
-            out << endl;
-        }
-    }
-}
-
 string Images::get_filename() const {
     return filename;
 }
 
 int Images::read_images(string _filename) {
     filename = _filename;
+    mapped_file = NULL;
+    mapped_size = 0;
+    pixels = NULL;
 
-    ifstream infile(filename.c_str(), ios::in | ios::binary);
-
-    if (!infile.is_open()) {
+    int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
         cerr << "Could not open '" << filename << "' for reading." << endl;
         return 1;
     }
 
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size < (off_t) (4 * sizeof(int))) {
+        cerr << "Could not read the header of '" << filename << "'." << endl;
+        close(file_descriptor);
+        return 1;
+    }
+    mapped_size = file_stat.st_size;
+
+    // the mapping stays valid after the file is closed
+    mapped_file = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+
+    if (mapped_file == MAP_FAILED) {
+        cerr << "Could not memory map '" << filename << "'." << endl;
+        mapped_file = NULL;
+        mapped_size = 0;
+        return 1;
+    }
+
+    const char* file_bytes = (const char*) mapped_file;
+
     int initial_vals[4];
-    infile.read((char*) &initial_vals, sizeof(initial_vals));
+    memcpy(initial_vals, file_bytes, sizeof(initial_vals));
 
     number_classes = initial_vals[0];
     channels = initial_vals[1];
@@ -135,35 +83,38 @@ int Images::read_images(string _filename) {
     cerr << "width: " << width << endl;
     cerr << "height: " << height << endl;
 
+    size_t header_size = sizeof(initial_vals) + (sizeof(int) * number_classes);
+    if (number_classes < 0 || mapped_size < header_size) {
+        cerr << "Could not read the class sizes of '" << filename << "'." << endl;
+        return 1;
+    }
+
     class_sizes = vector<int>(number_classes, 0);
-    infile.read((char*) &class_sizes[0], sizeof(int) * number_classes);
+    memcpy(&class_sizes[0], file_bytes + sizeof(initial_vals), sizeof(int) * number_classes);
 
     int image_size = channels * width * height;
 
+    classifications.clear();
     for (int i = 0; i < number_classes; i++) {
         cerr << "reading image set with " << class_sizes[i] << " images." << endl;
-
-        for (int32_t j = 0; j < class_sizes[i]; j++) {
-            images.push_back(Image(infile, channels, width, height, padding, i, this));
-        }
+        classifications.insert(classifications.end(), class_sizes[i], i);
     }
-    number_images = images.size();
+    number_images = classifications.size();
 
-    infile.close();
+    if (mapped_size < header_size + ((size_t) number_images * image_size)) {
+        cerr << "'" << filename << "' is truncated, expected " << number_images << " images of " << image_size
+             << " bytes after the header but the file is only " << mapped_size << " bytes." << endl;
+        return 1;
+    }
+    pixels = (const uint8_t*) (file_bytes + header_size);
 
     cerr << "image_size: " << channels << "x" << width << "x" << height << " = " << image_size << endl;
 
-    cerr << "read " << images.size() << " images." << endl;
+    cerr << "read " << number_images << " images." << endl;
     for (int i = 0; i < (int32_t) class_sizes.size(); i++) {
         cerr << "    class " << setw(4) << i << ": " << class_sizes[i] << endl;
     }
 
-    /*
-   for (int i = 0; i < images.size(); i++) {
-       images[i].print(cerr);
-   }
-   */
-
     return 0;
 }
 
@@ -175,8 +126,19 @@ Images::Images(
     filename = _filename;
     had_error = read_images(filename);
 
-    channel_avg = _channel_avg;
-    channel_std_dev = _channel_std_dev;
+    if (!had_error) {
+        if ((int) _channel_avg.size() != channels || (int) _channel_std_dev.size() != channels) {
+            Log::fatal(
+                "ERROR: '%s' has %d channels but was given %d channel averages and %d channel standard deviations\n",
+                filename.c_str(), channels, _channel_avg.size(), _channel_std_dev.size()
+            );
+            exit(1);
+        }
+
+        channel_avg = _channel_avg;
+        channel_std_dev = _channel_std_dev;
+        set_normalization();
+    }
 }
 
 Images::Images(string _filename, int _padding) {
@@ -185,7 +147,15 @@ Images::Images(string _filename, int _padding) {
     filename = _filename;
     had_error = read_images(filename);
 
-    calculate_avg_std_dev();
+    if (!had_error) {
+        calculate_avg_std_dev();
+    }
+}
+
+Images::~Images() {
+    if (mapped_file != NULL) {
+        munmap(mapped_file, mapped_size);
+    }
 }
 
 bool Images::loaded_correctly() const {
@@ -217,11 +187,54 @@ int Images::get_image_width() const {
 }
 
 int Images::get_classification(int image) const {
-    return images[image].get_classification();
+    return classifications[image];
+}
+
+const uint8_t* Images::get_image_pixels(int image) const {
+    return pixels + ((size_t) image * channels * height * width);
 }
 
 float Images::get_pixel(int image, int z, int y, int x) const {
-    return images[image].get_pixel(z, y, x);
+    if (y < padding || x < padding) {
+        return 0;
+    } else if (y >= height + padding || x >= width + padding) {
+        return 0;
+    } else {
+        uint8_t pixel = get_image_pixels(image)[(z * height * width) + ((y - padding) * width) + (x - padding)];
+        return (pixel * channel_scale[z]) + channel_offset[z];
+    }
+}
+
+void normalize_plane(
+    const uint8_t* plane, int height, int width, int padding, float scale, float offset, float* output
+) {
+    int32_t padded_width = width + (2 * padding);
+
+    // the padding is all zero, so only the interior rows need to be converted
+    fill_n(output, padding * padded_width, 0.0f);
+    fill_n(output + ((height + padding) * padded_width), padding * padded_width, 0.0f);
+
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* __restrict__ row = plane + (y * width);
+        float* __restrict__ output_row = output + ((y + padding) * padded_width);
+
+        fill_n(output_row, padding, 0.0f);
+        for (int32_t x = 0; x < width; x++) {
+            output_row[padding + x] = (row[x] * scale) + offset;
+        }
+        fill_n(output_row + padding + width, padding, 0.0f);
+    }
+}
+
+void Images::get_batch(const vector<int>& batch, int channel, float* output) const {
+    int32_t padded_image_size = (height + (2 * padding)) * (width + (2 * padding));
+
+    for (int32_t i = 0; i < (int32_t) batch.size(); i++) {
+        normalize_plane(
+            get_image_pixels(batch[i]) + (channel * height * width), height, width, padding, channel_scale[channel],
+            channel_offset[channel], output + (i * padded_image_size)
+        );
+    }
 }
 
 const vector<float>& Images::get_average() const {
@@ -240,41 +253,160 @@ float Images::get_channel_std_dev(int channel) const {
     return channel_std_dev[channel];
 }
 
+void Images::set_normalization() {
+    channel_scale.assign(channels, 0.0);
+    channel_offset.assign(channels, 0.0);
+
+    for (int32_t j = 0; j < channels; j++) {
+        channel_scale[j] = 1.0 / (255.0 * channel_std_dev[j]);
+        channel_offset[j] = -channel_avg[j] / channel_std_dev[j];
+    }
+}
+
 void Images::calculate_avg_std_dev() {
     cerr << "calculating averages and standard deviations for images" << endl;
-    channel_avg.clear();
-    channel_avg.assign(channels, 0.0);
 
-    vector<float> image_avg;
+    // the sums of the (uint8) pixels and their squares are exact, so the channel statistics do not depend on the
+    // order the images are in
+    vector<uint64_t> channel_sum(channels, 0);
+    vector<uint64_t> channel_sum_squared(channels, 0);
+
+    int32_t plane_size = height * width;
     for (int32_t i = 0; i < number_images; i++) {
-        images[i].get_pixel_avg(image_avg);
+        const uint8_t* image = get_image_pixels(i);
 
         for (int32_t j = 0; j < channels; j++) {
-            channel_avg[j] += image_avg[j];
+            const uint8_t* plane = image + (j * plane_size);
+
+            uint64_t sum = 0;
+            uint64_t sum_squared = 0;
+            for (int32_t k = 0; k < plane_size; k++) {
+                sum += plane[k];
+                sum_squared += plane[k] * plane[k];
+            }
+            channel_sum[j] += sum;
+            channel_sum_squared[j] += sum_squared;
         }
     }
 
+    double number_pixels = (double) number_images * plane_size;
+
+    channel_avg.clear();
+    channel_avg.assign(channels, 0.0);
     for (int32_t j = 0; j < channels; j++) {
-        channel_avg[j] /= number_images;
+        channel_avg[j] = (channel_sum[j] / 255.0) / number_pixels;
         cerr << "average pixel value for channel " << j << ": " << channel_avg[j] << endl;
     }
 
     channel_std_dev.clear();
     channel_std_dev.assign(channels, 0.0);
-
-    vector<float> image_variance;
-    for (int i = 0; i < number_images; i++) {
-        images[i].get_pixel_variance(channel_avg, image_variance);
-
-        for (int32_t j = 0; j < channels; j++) {
-            channel_std_dev[j] += image_variance[j];
-        }
-    }
-
     for (int32_t j = 0; j < channels; j++) {
-        channel_std_dev[j] /= number_images;
+        double avg = (channel_sum[j] / 255.0) / number_pixels;
+        double variance = ((channel_sum_squared[j] / (255.0 * 255.0)) / number_pixels) - (avg * avg);
+        channel_std_dev[j] = fmax(0.0, variance);
         cerr << "pixel variance for channel " << j << ": " << channel_std_dev[j] << endl;
         channel_std_dev[j] = sqrt(channel_std_dev[j]);
         cerr << "pixel standard deviation for channel " << j << ": " << channel_std_dev[j] << endl;
     }
+
+    set_normalization();
+}
+
+ImageBatch::ImageBatch(
+    int _number_classes, int _channels, int _height, int _width, int _padding, const vector<float>& _channel_avg,
+    const vector<float>& _channel_std_dev
+) {
+    number_classes = _number_classes;
+    channels = _channels;
+    height = _height;
+    width = _width;
+    padding = _padding;
+
+    channel_avg = _channel_avg;
+    channel_std_dev = _channel_std_dev;
+
+    channel_scale.assign(channels, 0.0);
+    channel_offset.assign(channels, 0.0);
+    for (int32_t j = 0; j < channels; j++) {
+        channel_scale[j] = 1.0 / (255.0 * channel_std_dev[j]);
+        channel_offset[j] = -channel_avg[j] / channel_std_dev[j];
+    }
+}
+
+void ImageBatch::clear() {
+    images.clear();
+}
+
+void ImageBatch::add_image(const uint8_t* pixels) {
+    images.push_back(pixels);
+}
+
+string ImageBatch::get_filename() const {
+    return "";
+}
+
+int ImageBatch::get_class_size(int i) const {
+    return 0;
+}
+
+int ImageBatch::get_number_classes() const {
+    return number_classes;
+}
+
+int ImageBatch::get_number_images() const {
+    return images.size();
+}
+
+int ImageBatch::get_image_channels() const {
+    return channels;
+}
+
+int ImageBatch::get_image_width() const {
+    return width + (2 * padding);
+}
+
+int ImageBatch::get_image_height() const {
+    return height + (2 * padding);
+}
+
+int ImageBatch::get_classification(int image) const {
+    return 0;
+}
+
+float ImageBatch::get_pixel(int image, int z, int y, int x) const {
+    if (y < padding || x < padding) {
+        return 0;
+    } else if (y >= height + padding || x >= width + padding) {
+        return 0;
+    } else {
+        uint8_t pixel = images[image][(z * height * width) + ((y - padding) * width) + (x - padding)];
+        return (pixel * channel_scale[z]) + channel_offset[z];
+    }
+}
+
+void ImageBatch::get_batch(const vector<int>& batch, int channel, float* output) const {
+    int32_t padded_image_size = (height + (2 * padding)) * (width + (2 * padding));
+
+    for (int32_t i = 0; i < (int32_t) batch.size(); i++) {
+        normalize_plane(
+            images[batch[i]] + (channel * height * width), height, width, padding, channel_scale[channel],
+            channel_offset[channel], output + (i * padded_image_size)
+        );
+    }
+}
+
+float ImageBatch::get_channel_avg(int channel) const {
+    return channel_avg[channel];
+}
+
+float ImageBatch::get_channel_std_dev(int channel) const {
+    return channel_std_dev[channel];
+}
+
+const vector<float>& ImageBatch::get_average() const {
+    return channel_avg;
+}
+
+const vector<float>& ImageBatch::get_std_dev() const {
+    return channel_std_dev;
 }
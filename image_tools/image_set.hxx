@@ -14,42 +14,14 @@ using std::string;
 using std::vector;
 
 #include "image_set_interface.hxx"
-
-typedef class Images Images;
-
-class Image : public ImageInterface {
-    friend class Images;
-
-   private:
-    int padding;
-    int channels;
-    int height;
-    int width;
-    int classification;
-    vector<vector<vector<uint8_t> > > pixels;
-
-    // reference to images to get channel avgs and std_Devs
-    const Images* images;
-
-   public:
-    Image(
-        ifstream& infile, int _channels, int _width, int _height, int _padding, int _classification,
-        const Images* _images
-    );
-
-    int get_classification() const;
-
-    void scale_0_1();
-
-    float get_pixel(int z, int y, int x) const;
-
-    void get_pixel_avg(vector<float>& channel_avgs) const;
-    void get_pixel_variance(const vector<float>& channel_avgs, vector<float>& channel_variances) const;
-    // void normalize(const vector<float> &channel_avgs, const vector<float> &channel_std_dev);
-
-    void print(ostream& out);
-};
-
+#include "stdint.h"
+
+/**
+ * The binary image files are a header of number_classes, channels, width and height, the number of images in each
+ * class, and then the uint8 pixels of every image (grouped by class) in channel, row, column order. Images memory
+ * maps the file read only instead of copying the pixels, so each image is a contiguous block of channel planes and
+ * processes on the same machine (e.g., MPI ranks) share a single copy of the dataset through the page cache.
+ */
 class Images : public ImagesInterface {
    private:
     string filename;
@@ -58,17 +30,26 @@ class Images : public ImagesInterface {
     int number_images;
 
     vector<int> class_sizes;
+    vector<int> classifications;
 
     int padding;
     int channels, width, height;
 
-    vector<Image> images;
+    void* mapped_file;
+    size_t mapped_size;
+    const uint8_t* pixels;
 
     vector<float> channel_avg;
     vector<float> channel_std_dev;
 
+    // pixel * channel_scale + channel_offset == ((pixel / 255) - channel_avg) / channel_std_dev
+    vector<float> channel_scale;
+    vector<float> channel_offset;
+
     bool had_error;
 
+    void set_normalization();
+
    public:
     int read_images(string binary_filename);
 
@@ -77,6 +58,11 @@ class Images : public ImagesInterface {
         string binary_filename, int _padding, const vector<float>& _channeL_avg, const vector<float>& channel_std_dev
     );
 
+    ~Images();
+
+    Images(const Images& other) = delete;
+    Images& operator=(const Images& other) = delete;
+
     string get_filename() const;
 
     int get_class_size(int i) const;
@@ -91,6 +77,9 @@ class Images : public ImagesInterface {
 
     int get_classification(int image) const;
     float get_pixel(int image, int z, int y, int x) const;
+    void get_batch(const vector<int>& batch, int channel, float* output) const;
+
+    const uint8_t* get_image_pixels(int image) const;
 
     void calculate_avg_std_dev();
 
@@ -102,8 +91,63 @@ class Images : public ImagesInterface {
 
     const vector<float>& get_average() const;
     const vector<float>& get_std_dev() const;
+};
+
+/**
+ * Images which are already in memory (e.g., received by the inference server) in the same channel, row, column uint8
+ * layout as the binary image files, normalized with a training set's channel averages and standard deviations. The
+ * pixels are not copied, so they need to stay valid while the batch is used.
+ */
+class ImageBatch : public ImagesInterface {
+   private:
+    int number_classes;
+    int channels, width, height;
+    int padding;
+
+    vector<const uint8_t*> images;
 
-    // void normalize();
+    vector<float> channel_avg;
+    vector<float> channel_std_dev;
+    vector<float> channel_scale;
+    vector<float> channel_offset;
+
+   public:
+    ImageBatch(
+        int _number_classes, int _channels, int _height, int _width, int _padding, const vector<float>& _channel_avg,
+        const vector<float>& _channel_std_dev
+    );
+
+    void clear();
+    void add_image(const uint8_t* pixels);
+
+    string get_filename() const;
+
+    int get_class_size(int i) const;
+
+    int get_number_classes() const;
+
+    int get_number_images() const;
+
+    int get_image_channels() const;
+    int get_image_width() const;
+    int get_image_height() const;
+
+    int get_classification(int image) const;
+    float get_pixel(int image, int z, int y, int x) const;
+    void get_batch(const vector<int>& batch, int channel, float* output) const;
+
+    float get_channel_avg(int channel) const;
+    float get_channel_std_dev(int channel) const;
+
+    const vector<float>& get_average() const;
+    const vector<float>& get_std_dev() const;
 };
 
+/**
+ * Writes a (height + 2 * padding) x (width + 2 * padding) plane of pixel * scale + offset, with the padding 0.
+ */
+void normalize_plane(
+    const uint8_t* plane, int height, int width, int padding, float scale, float offset, float* output
+);
+
 #endif
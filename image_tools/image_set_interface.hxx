@@ -13,8 +13,6 @@ using std::string;
 #include <vector>
 using std::vector;
 
-typedef class Image Image;
-
 class ImageInterface {
    public:
     virtual int get_classification() const = 0;
@@ -41,6 +39,12 @@ class ImagesInterface {
     virtual int get_classification(int image) const = 0;
     virtual float get_pixel(int image, int z, int y, int x) const = 0;
 
+    /**
+     * Copies the normalized and padded channel of every image in the batch into output, one after the other, each
+     * get_image_height() x get_image_width() values.
+     */
+    virtual void get_batch(const vector<int>& batch, int channel, float* output) const = 0;
+
     virtual float get_channel_avg(int channel) const = 0;
     virtual float get_channel_std_dev(int channel) const = 0;
 
@@ -48,17 +52,34 @@ class ImagesInterface {
     virtual const vector<float>& get_std_dev() const = 0;
 };
 
-class MultiImagesInterface : public ImagesInterface {
+/**
+ * Large images which can be read a tile at a time, for sliding window inference over the whole image instead of over
+ * each of its subimages.
+ */
+class LargeImageTilesInterface {
    public:
     virtual int get_number_large_images() const = 0;
-    virtual int get_number_subimages(int i) const = 0;
-
-    virtual int get_padding() const = 0;
 
     virtual int get_large_image_channels(int image) const = 0;
     virtual int get_large_image_width(int image) const = 0;
     virtual int get_large_image_height(int image) const = 0;
 
+    /**
+     * Copies the normalized pixels of rows [y, y + tile_height) and columns [x, x + tile_width) of a channel of the
+     * large image into output, row by row. The tile may hang off the image (y and x may be negative), any pixels
+     * outside of it are 0, as the padding is.
+     */
+    virtual void get_tile(
+        int image, int channel, int y, int x, int tile_height, int tile_width, float* output
+    ) const = 0;
+};
+
+class MultiImagesInterface : public ImagesInterface, public LargeImageTilesInterface {
+   public:
+    virtual int get_number_subimages(int i) const = 0;
+
+    virtual int get_padding() const = 0;
+
     virtual int get_number_classes() const = 0;
 
     virtual int get_image_classification(int image) const = 0;
@@ -882,6 +882,69 @@ float LargeImages::get_pixel(int subimage, int z, int y, int x) const {
     return 0;
 }
 
+void LargeImages::get_batch(const vector<int>& batch, int channel, float* output) const {
+    int32_t current = 0;
+    for (int32_t i = 0; i < (int32_t) batch.size(); i++) {
+        // find the large image the subimage is in once for the whole subimage, instead of for every pixel
+        int32_t subimage = batch[i];
+        int32_t image_number = 0;
+        while (image_number < (int32_t) images.size() && subimage >= images[image_number].get_number_subimages()) {
+            subimage -= images[image_number].get_number_subimages();
+            image_number++;
+        }
+
+        if (image_number == (int32_t) images.size()) {
+            cerr << "Error getting batch, subimage was: " << batch[i] << " and there are not that many subimages!"
+                 << endl;
+            exit(1);
+        }
+
+        const LargeImage& image = images[image_number];
+        int subimages_along_width = image.get_width() - subimage_width + 1;
+
+        int subimage_y_offset = subimage / subimages_along_width;
+        int subimage_x_offset = subimage % subimages_along_width;
+
+        for (int32_t y = 0; y < subimage_height + (2 * padding); y++) {
+            for (int32_t x = 0; x < subimage_width + (2 * padding); x++) {
+                if (y < padding || x < padding || y >= subimage_height + padding || x >= subimage_width + padding) {
+                    output[current] = 0;
+                } else {
+                    output[current] =
+                        ((image.get_pixel(channel, subimage_y_offset + y, subimage_x_offset + x) / 255.0)
+                         - channel_avg[channel])
+                        / channel_std_dev[channel];
+                }
+                current++;
+            }
+        }
+    }
+}
+
+void LargeImages::get_tile(
+    int image_number, int channel, int y, int x, int tile_height, int tile_width, float* output
+) const {
+    const LargeImage& image = images[image_number];
+
+    int32_t current = 0;
+    for (int32_t tile_y = 0; tile_y < tile_height; tile_y++) {
+        int32_t image_y = y + tile_y;
+
+        for (int32_t tile_x = 0; tile_x < tile_width; tile_x++) {
+            int32_t image_x = x + tile_x;
+
+            if (image_y < 0 || image_x < 0 || image_y >= image.get_height() || image_x >= image.get_width()) {
+                output[current] = 0;
+            } else {
+                output[current] =
+                    ((image.get_pixel(channel, image_y + padding, image_x + padding) / 255.0) - channel_avg[channel])
+                    / channel_std_dev[channel];
+            }
+            current++;
+        }
+    }
+}
+
 const vector<float>& LargeImages::get_average() const {
     return channel_avg;
 }
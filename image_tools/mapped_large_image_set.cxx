@@ -0,0 +1,263 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+using std::fill_n;
+using std::max;
+using std::min;
+
+#include <cmath>
+#include <cstring>
+using std::memcpy;
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "mapped_large_image_set.hxx"
+#include "stdint.h"
+
+int MappedLargeImages::read_images(string _filename) {
+    filename = _filename;
+    mapped_file = NULL;
+    mapped_size = 0;
+
+    int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        cerr << "Could not open '" << filename << "' for reading." << endl;
+        return 1;
+    }
+
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size < (off_t) (2 * sizeof(int))) {
+        cerr << "Could not read the header of '" << filename << "'." << endl;
+        close(file_descriptor);
+        return 1;
+    }
+    mapped_size = file_stat.st_size;
+
+    // the mapping stays valid after the file is closed
+    mapped_file = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor);
+
+    if (mapped_file == MAP_FAILED) {
+        cerr << "Could not memory map '" << filename << "'." << endl;
+        mapped_file = NULL;
+        mapped_size = 0;
+        return 1;
+    }
+
+    const char* file_bytes = (const char*) mapped_file;
+
+    int initial_vals[2];
+    memcpy(initial_vals, file_bytes, sizeof(initial_vals));
+
+    number_classes = initial_vals[0];
+    int number_images = initial_vals[1];
+
+    cerr << "number_classes: " << number_classes << endl;
+    cerr << "number_images: " << number_images << endl;
+
+    size_t position = sizeof(initial_vals);
+    for (int i = 0; i < number_images; i++) {
+        int image_vals[4];
+        if (mapped_size < position + sizeof(image_vals)) {
+            cerr << "'" << filename << "' is truncated, could not read the header of image " << i << "." << endl;
+            return 1;
+        }
+        memcpy(image_vals, file_bytes + position, sizeof(image_vals));
+        position += sizeof(image_vals);
+
+        size_t image_size = (size_t) image_vals[1] * image_vals[2] * image_vals[3];
+        if (mapped_size < position + image_size) {
+            cerr << "'" << filename << "' is truncated, expected " << image_size << " bytes for image " << i
+                 << " but there are only " << (mapped_size - position) << " left." << endl;
+            return 1;
+        }
+
+        classifications.push_back(image_vals[0]);
+        channels.push_back(image_vals[1]);
+        heights.push_back(image_vals[2]);
+        widths.push_back(image_vals[3]);
+        pixels.push_back((const uint8_t*) (file_bytes + position));
+        position += image_size;
+
+        cerr << "image[" << i << "] class: " << image_vals[0] << ", channels: " << image_vals[1]
+             << ", height: " << image_vals[2] << ", width: " << image_vals[3] << endl;
+    }
+
+    return 0;
+}
+
+MappedLargeImages::MappedLargeImages(string _filename) {
+    had_error = read_images(_filename);
+
+    if (!had_error) {
+        calculate_avg_std_dev();
+    }
+}
+
+MappedLargeImages::MappedLargeImages(
+    string _filename, const vector<float>& _channel_avg, const vector<float>& _channel_std_dev
+) {
+    had_error = read_images(_filename);
+
+    channel_avg = _channel_avg;
+    channel_std_dev = _channel_std_dev;
+    set_normalization();
+}
+
+MappedLargeImages::~MappedLargeImages() {
+    if (mapped_file != NULL) {
+        munmap(mapped_file, mapped_size);
+    }
+}
+
+string MappedLargeImages::get_filename() const {
+    return filename;
+}
+
+bool MappedLargeImages::loaded_correctly() const {
+    return !had_error;
+}
+
+int MappedLargeImages::get_number_classes() const {
+    return number_classes;
+}
+
+int MappedLargeImages::get_number_large_images() const {
+    return pixels.size();
+}
+
+int MappedLargeImages::get_large_image_classification(int image) const {
+    return classifications[image];
+}
+
+int MappedLargeImages::get_large_image_channels(int image) const {
+    return channels[image];
+}
+
+int MappedLargeImages::get_large_image_width(int image) const {
+    return widths[image];
+}
+
+int MappedLargeImages::get_large_image_height(int image) const {
+    return heights[image];
+}
+
+void MappedLargeImages::get_tile(
+    int image, int channel, int y, int x, int tile_height, int tile_width, float* output
+) const {
+    int32_t height = heights[image];
+    int32_t width = widths[image];
+    const uint8_t* plane = pixels[image] + ((size_t) channel * height * width);
+    const float* lookup = channel_lookup[channel].data();
+
+    // the columns of the tile which are inside the image
+    int32_t x_start = min(tile_width, max(0, -x));
+    int32_t x_end = max(x_start, min(tile_width, width - x));
+
+    for (int32_t tile_y = 0; tile_y < tile_height; tile_y++) {
+        float* output_row = output + ((size_t) tile_y * tile_width);
+        int32_t image_y = y + tile_y;
+
+        if (image_y < 0 || image_y >= height) {
+            fill_n(output_row, tile_width, 0.0f);
+            continue;
+        }
+
+        const uint8_t* row = plane + ((size_t) image_y * width);
+
+        fill_n(output_row, x_start, 0.0f);
+        for (int32_t tile_x = x_start; tile_x < x_end; tile_x++) {
+            output_row[tile_x] = lookup[row[x + tile_x]];
+        }
+        fill_n(output_row + x_end, tile_width - x_end, 0.0f);
+    }
+}
+
+void MappedLargeImages::set_normalization() {
+    channel_lookup.assign(channel_avg.size(), vector<float>(256, 0.0));
+
+    // the same expression as LargeImages::get_pixel, so the normalized pixels are identical
+    for (int32_t j = 0; j < (int32_t) channel_avg.size(); j++) {
+        for (int32_t pixel = 0; pixel < 256; pixel++) {
+            channel_lookup[j][pixel] = ((pixel / 255.0) - channel_avg[j]) / channel_std_dev[j];
+        }
+    }
+}
+
+void MappedLargeImages::calculate_avg_std_dev() {
+    int32_t number_images = pixels.size();
+    int32_t number_channels = number_images > 0 ? channels[0] : 0;
+
+    // exact per image sums of the pixels and their squares, so the image only needs to be read once
+    vector<vector<uint64_t> > image_sum(number_images, vector<uint64_t>(number_channels, 0));
+    vector<vector<uint64_t> > image_sum_squared(number_images, vector<uint64_t>(number_channels, 0));
+
+    for (int32_t i = 0; i < number_images; i++) {
+        size_t plane_size = (size_t) heights[i] * widths[i];
+
+        for (int32_t j = 0; j < number_channels; j++) {
+            const uint8_t* plane = pixels[i] + (j * plane_size);
+
+            uint64_t sum = 0;
+            uint64_t sum_squared = 0;
+            for (size_t k = 0; k < plane_size; k++) {
+                sum += plane[k];
+                sum_squared += plane[k] * plane[k];
+            }
+            image_sum[i][j] = sum;
+            image_sum_squared[i][j] = sum_squared;
+        }
+    }
+
+    channel_avg.assign(number_channels, 0.0);
+    for (int32_t i = 0; i < number_images; i++) {
+        double plane_size = (double) heights[i] * widths[i];
+        for (int32_t j = 0; j < number_channels; j++) {
+            channel_avg[j] += (image_sum[i][j] / 255.0) / plane_size;
+        }
+    }
+
+    for (int32_t j = 0; j < number_channels; j++) {
+        channel_avg[j] /= number_images;
+        cerr << "average pixel value for channel " << j << ": " << channel_avg[j] << endl;
+    }
+
+    // each image's variance is around the average over all the images
+    channel_std_dev.assign(number_channels, 0.0);
+    for (int32_t i = 0; i < number_images; i++) {
+        double plane_size = (double) heights[i] * widths[i];
+        for (int32_t j = 0; j < number_channels; j++) {
+            double avg = (image_sum[i][j] / 255.0) / plane_size;
+            double squared = (image_sum_squared[i][j] / (255.0 * 255.0)) / plane_size;
+            channel_std_dev[j] += squared - (2.0 * channel_avg[j] * avg) + (channel_avg[j] * channel_avg[j]);
+        }
+    }
+
+    for (int32_t j = 0; j < number_channels; j++) {
+        channel_std_dev[j] = fmax(0.0, channel_std_dev[j] / number_images);
+        cerr << "pixel variance for channel " << j << ": " << channel_std_dev[j] << endl;
+        channel_std_dev[j] = sqrt(channel_std_dev[j]);
+        cerr << "pixel standard deviation for channel " << j << ": " << channel_std_dev[j] << endl;
+    }
+
+    set_normalization();
+}
+
+const vector<float>& MappedLargeImages::get_average() const {
+    return channel_avg;
+}
+
+const vector<float>& MappedLargeImages::get_std_dev() const {
+    return channel_std_dev;
+}
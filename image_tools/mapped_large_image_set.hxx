@@ -0,0 +1,76 @@
+#ifndef MAPPED_LARGE_IMAGE_SET_HXX
+#define MAPPED_LARGE_IMAGE_SET_HXX
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "image_set_interface.hxx"
+#include "stdint.h"
+
+/**
+ * Reads the same binary large image files as LargeImages (a header of number_classes and number_images, then for
+ * each image its class, channels, height and width followed by its uint8 pixels in channel, row, column order), but
+ * memory maps the file instead of loading it. Tiles are read straight out of the mapping, so only the rows being
+ * evaluated need to be paged in and images larger than memory can be processed.
+ */
+class MappedLargeImages : public LargeImageTilesInterface {
+   private:
+    string filename;
+
+    void* mapped_file;
+    size_t mapped_size;
+
+    int number_classes;
+
+    vector<int> classifications;
+    vector<int> channels;
+    vector<int> heights;
+    vector<int> widths;
+    vector<const uint8_t*> pixels;
+
+    vector<float> channel_avg;
+    vector<float> channel_std_dev;
+
+    // the normalized value of each of the 256 pixel values of each channel
+    vector<vector<float> > channel_lookup;
+
+    bool had_error;
+
+    int read_images(string binary_filename);
+    void set_normalization();
+
+   public:
+    MappedLargeImages(string binary_filename);
+    MappedLargeImages(string binary_filename, const vector<float>& _channel_avg, const vector<float>& _channel_std_dev);
+
+    ~MappedLargeImages();
+
+    MappedLargeImages(const MappedLargeImages& other) = delete;
+    MappedLargeImages& operator=(const MappedLargeImages& other) = delete;
+
+    string get_filename() const;
+    bool loaded_correctly() const;
+
+    int get_number_classes() const;
+    int get_number_large_images() const;
+
+    int get_large_image_classification(int image) const;
+    int get_large_image_channels(int image) const;
+    int get_large_image_width(int image) const;
+    int get_large_image_height(int image) const;
+
+    void get_tile(int image, int channel, int y, int x, int tile_height, int tile_width, float* output) const;
+
+    /**
+     * Averages the per image channel averages and variances, the same way LargeImages does.
+     */
+    void calculate_avg_std_dev();
+
+    const vector<float>& get_average() const;
+    const vector<float>& get_std_dev() const;
+};
+
+#endif
@@ -120,6 +120,8 @@ class MosaicImages : public MultiImagesInterface {
     int get_classification(int subimage) const;
     float get_pixel(int subimage, int z, int y, int x) const;
     float get_raw_pixel(int subimage, int z, int y, int x) const;
+    void get_batch(const vector<int>& batch, int channel, float* output) const;
+    void get_tile(int image, int channel, int y, int x, int tile_height, int tile_width, float* output) const;
 
     void calculate_avg_std_dev();
 
@@ -21,7 +21,9 @@ using std::thread;
 #include <vector>
 using std::vector;
 
+#include "cnn/convolution_backend.hxx"
 #include "cnn/exact.hxx"
+#include "cnn/genome_store.hxx"
 #include "common/arguments.hxx"
 #include "image_tools/image_set.hxx"
 #include "mpi.h"
@@ -222,6 +224,8 @@ int main(int argc, char** argv) {
 
     arguments = vector<string>(argv, argv + argc);
 
+    ConvolutionAutotuner::initialize(arguments);
+
     string training_filename;
     get_argument(arguments, "--training_file", true, training_filename);
 
@@ -272,7 +276,28 @@ int main(int argc, char** argv) {
             use_node_operations, max_genomes, output_directory, search_name, reset_edges
         );
 
+        GenomeStore* genome_store = NULL;
+        if (argument_exists(arguments, "--genome_store")) {
+            string genome_store_filename;
+            get_argument(arguments, "--genome_store", true, genome_store_filename);
+
+            int genome_store_batch = 16;
+            get_argument(arguments, "--genome_store_batch", false, genome_store_batch);
+            if (genome_store_batch < 1) {
+                cerr << "ERROR: --genome_store_batch must be at least 1, was " << genome_store_batch << endl;
+                exit(1);
+            }
+
+            genome_store = new GenomeStore(genome_store_filename, genome_store_batch);
+            exact->set_genome_store(genome_store);
+        }
+
         master(training_images, validation_images, testing_images, max_rank);
+
+        if (genome_store != NULL) {
+            genome_store->flush();
+            delete genome_store;
+        }
     } else {
         worker(training_images, validation_images, testing_images, rank);
     }
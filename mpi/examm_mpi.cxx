@@ -21,6 +21,7 @@ using std::vector;
 #include "examm/examm.hxx"
 #include "mpi.h"
 #include "rnn/generate_nn.hxx"
+#include "rnn/genome_property.hxx"
 #include "time_series/time_series.hxx"
 #include "weights/weight_rules.hxx"
 #include "weights/weight_update.hxx"
@@ -36,6 +37,9 @@ vector<string> arguments;
 
 EXAMM* examm;
 WeightUpdate* weight_update_method;
+// the batch size, training threads and other runtime training settings, which the genomes sent to the workers do
+// not carry
+GenomeProperty* genome_property;
 
 bool finished = false;
 
@@ -206,6 +210,8 @@ void worker(int32_t rank) {
 
             // have each worker write the backproagation to a separate log file
             string log_id = "genome_" + to_string(genome->get_generation_id()) + "_worker_" + to_string(rank);
+            genome_property->set_training_settings(genome);
+
             Log::set_id(log_id);
             genome->backpropagate_stochastic(
                 training_inputs, training_outputs, validation_inputs, validation_outputs, weight_update_method
@@ -257,6 +263,12 @@ int main(int argc, char** argv) {
     WeightRules* weight_rules = new WeightRules();
     weight_rules->initialize_from_args(arguments);
 
+    // the workers train the DNAS nodes, so they need the pruning threshold as well as the master
+    get_argument(arguments, "--dnas_pruning_threshold", false, dnas_pruning_threshold);
+
+    genome_property = new GenomeProperty();
+    genome_property->generate_genome_property_from_arguments(arguments);
+
     RNN_Genome* seed_genome = get_seed_genome(arguments, time_series_sets, weight_rules);
 
     Log::clear_rank_restriction();
@@ -1,18 +1,22 @@
+#include <algorithm>
+using std::find;
+
 #include <chrono>
+
+#include <fstream>
+using std::ofstream;
+
 #include <iomanip>
 using std::fixed;
 using std::setprecision;
 using std::setw;
 
-#include <mutex>
-using std::mutex;
+#include <map>
+using std::map;
 
 #include <string>
 using std::string;
 
-#include <thread>
-using std::thread;
-
 #include <vector>
 using std::vector;
 
@@ -23,6 +27,7 @@ using std::vector;
 #include "examm/examm.hxx"
 #include "mpi.h"
 #include "rnn/generate_nn.hxx"
+#include "rnn/genome_property.hxx"
 #include "time_series/time_series.hxx"
 #include "weights/weight_update.hxx"
 
@@ -31,21 +36,48 @@ using std::vector;
 #define GENOME_TAG        3
 #define TERMINATE_TAG     4
 
-mutex examm_mutex;
-
 vector<string> arguments;
 
-EXAMM* examm;
+int32_t fold_size = 2;
+int32_t repeats;
+string output_directory = "";
+
+TimeSeriesSets* time_series_sets = NULL;
+RNN_Genome* seed_genome = NULL;
 
 WeightUpdate* weight_update_method;
+// the batch size, training threads and other runtime training settings, which the genomes sent to the workers do
+// not carry
+GenomeProperty* genome_property;
+
+/**
+ * Each slice (the test fold starting at a series index) and repeat is an independent EXAMM search, numbered
+ * slice_number * repeats + repeat. Genome messages carry the number of the search they belong to.
+ */
+int32_t get_search_slice(int32_t search) {
+    return (search / repeats) * fold_size;
+}
 
-vector<vector<vector<double> > > training_inputs;
-vector<vector<vector<double> > > training_outputs;
-vector<vector<vector<double> > > validation_inputs;
-vector<vector<vector<double> > > validation_outputs;
+int32_t get_search_repeat(int32_t search) {
+    return search % repeats;
+}
+
+void get_fold_indexes(int32_t slice, vector<int32_t>& training_indexes, vector<int32_t>& test_indexes) {
+    training_indexes.clear();
+    test_indexes.clear();
 
-int32_t global_slice;
-int32_t global_repeat;
+    for (int32_t j = 0; j < time_series_sets->get_number_series(); j += fold_size) {
+        if (j == slice) {
+            for (int32_t k = 0; k < fold_size; k++) {
+                test_indexes.push_back(j + k);
+            }
+        } else {
+            for (int32_t k = 0; k < fold_size; k++) {
+                training_indexes.push_back(j + k);
+            }
+        }
+    }
+}
 
 void send_work_request(int32_t target) {
     int32_t work_request_message[1];
@@ -59,14 +91,15 @@ void receive_work_request(int32_t source) {
     MPI_Recv(work_request_message, 1, MPI_INT, source, WORK_REQUEST_TAG, MPI_COMM_WORLD, &status);
 }
 
-RNN_Genome* receive_genome_from(int32_t source) {
+RNN_Genome* receive_genome_from(int32_t source, int32_t& search) {
     MPI_Status status;
-    int32_t length_message[1];
-    MPI_Recv(length_message, 1, MPI_INT, source, GENOME_LENGTH_TAG, MPI_COMM_WORLD, &status);
+    int32_t length_message[2];
+    MPI_Recv(length_message, 2, MPI_INT, source, GENOME_LENGTH_TAG, MPI_COMM_WORLD, &status);
 
     int32_t length = length_message[0];
+    search = length_message[1];
 
-    Log::debug("receiving genome of length: %d from: %d\n", length, source);
+    Log::debug("receiving genome of length: %d for search: %d from: %d\n", length, search, source);
 
     char* genome_str = new char[length + 1];
 
@@ -83,17 +116,18 @@ RNN_Genome* receive_genome_from(int32_t source) {
     return genome;
 }
 
-void send_genome_to(int32_t target, RNN_Genome* genome) {
+void send_genome_to(int32_t target, int32_t search, RNN_Genome* genome) {
     char* byte_array;
     int32_t length;
 
     genome->write_to_array(&byte_array, length);
 
-    Log::debug("sending genome of length: %d to: %d\n", length, target);
+    Log::debug("sending genome of length: %d for search: %d to: %d\n", length, search, target);
 
-    int32_t length_message[1];
+    int32_t length_message[2];
     length_message[0] = length;
-    MPI_Send(length_message, 1, MPI_INT, target, GENOME_LENGTH_TAG, MPI_COMM_WORLD);
+    length_message[1] = search;
+    MPI_Send(length_message, 2, MPI_INT, target, GENOME_LENGTH_TAG, MPI_COMM_WORLD);
 
     Log::debug("sending genome to: %d\n", target);
     MPI_Send(byte_array, length, MPI_CHAR, target, GENOME_TAG, MPI_COMM_WORLD);
@@ -113,7 +147,208 @@ void receive_terminate_message(int32_t source) {
     MPI_Recv(terminate_message, 1, MPI_INT, source, TERMINATE_TAG, MPI_COMM_WORLD, &status);
 }
 
-void master(int32_t max_rank) {
+struct SweepSearch {
+    int32_t search;
+    int32_t slice;
+    int32_t repeat;
+    EXAMM* examm;
+    string log_id;
+
+    // genomes sent to workers which have not been inserted yet
+    int32_t genomes_in_flight;
+    // set when examm stops generating genomes, the search finishes when its last genome comes back
+    bool generation_finished;
+
+    std::chrono::time_point<std::chrono::system_clock> start;
+};
+
+/**
+ * Runs every slice and repeat as its own EXAMM search over the same workers, instead of one after another with a
+ * barrier between them. Up to concurrent_searches searches generate genomes at the same time, and each work request
+ * is given a genome from the generating search with the fewest genomes in flight (the oldest on ties), so each gets
+ * an equal share of the workers. A search which has stopped generating no longer counts against the limit, so the
+ * next search starts while its last genomes are still being trained and workers don't sit idle waiting for them.
+ */
+class SweepScheduler {
+   private:
+    int32_t number_searches;
+    int32_t next_search;
+    int32_t concurrent_searches;
+    int32_t generating_searches;
+
+    map<int32_t, SweepSearch*> active_searches;
+
+    // runtimes of each slice's repeats, written out when all of a slice's repeats have finished
+    vector<vector<long> > slice_runtimes;
+    vector<int32_t> slice_repeats_finished;
+
+    void start_search() {
+        SweepSearch* current = new SweepSearch();
+        current->search = next_search++;
+        current->slice = get_search_slice(current->search);
+        current->repeat = get_search_repeat(current->search);
+        current->genomes_in_flight = 0;
+        current->generation_finished = false;
+
+        string slice_output_directory = output_directory + "/slice_" + to_string(current->slice);
+        string current_output_directory = slice_output_directory + "/repeat_" + to_string(current->repeat);
+        mkpath(current_output_directory.c_str(), 0777);
+
+        // each search writes its logs to its own directory
+        vector<string> search_arguments = arguments;
+        auto output_argument = find(search_arguments.begin(), search_arguments.end(), "--output_directory");
+        if (output_argument != search_arguments.end() && output_argument + 1 != search_arguments.end()) {
+            *(output_argument + 1) = current_output_directory;
+        } else {
+            search_arguments.push_back("--output_directory");
+            search_arguments.push_back(current_output_directory);
+        }
+
+        vector<int32_t> training_indexes;
+        vector<int32_t> test_indexes;
+        get_fold_indexes(current->slice, training_indexes, test_indexes);
+        time_series_sets->set_training_indexes(training_indexes);
+        time_series_sets->set_test_indexes(test_indexes);
+
+        current->log_id = "examm_slice_" + to_string(current->slice) + "_repeat_" + to_string(current->repeat);
+        Log::set_id(current->log_id);
+
+        // examm deletes its weight rules, and the seed genome is modified by the speciation strategy, so every
+        // search needs its own
+        WeightRules* weight_rules = new WeightRules();
+        weight_rules->initialize_from_args(arguments);
+        current->examm =
+            generate_examm_from_arguments(search_arguments, time_series_sets, weight_rules, seed_genome->copy());
+
+        Log::set_id("main_0");
+        Log::info(
+            "started search %d of %d (slice %d, repeat %d)\n", current->search, number_searches, current->slice,
+            current->repeat
+        );
+
+        current->start = std::chrono::system_clock::now();
+        active_searches[current->search] = current;
+        generating_searches++;
+    }
+
+    void finish_search(SweepSearch* current) {
+        std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
+        long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - current->start).count();
+
+        Log::set_id(current->log_id);
+        RNN_Genome* best_genome = current->examm->get_best_genome();
+
+        string slice_output_directory = output_directory + "/slice_" + to_string(current->slice);
+        string binary_file = slice_output_directory + "/repeat_best_" + to_string(current->repeat) + ".bin";
+        string graphviz_file = slice_output_directory + "/repeat_best_" + to_string(current->repeat) + ".gv";
+
+        Log::debug("writing best genome to '%s' and '%s'\n", binary_file.c_str(), graphviz_file.c_str());
+        best_genome->write_to_file(binary_file);
+        best_genome->write_graphviz(graphviz_file);
+
+        delete current->examm;
+        Log::release_id(current->log_id);
+        Log::set_id("main_0");
+
+        int32_t slice_number = current->slice / fold_size;
+        slice_runtimes[slice_number][current->repeat] = milliseconds;
+        slice_repeats_finished[slice_number]++;
+
+        if (slice_repeats_finished[slice_number] == repeats) {
+            ofstream slice_times_file(output_directory + "/slice_" + to_string(current->slice) + "_runtimes.csv");
+            for (int32_t k = 0; k < repeats; k++) {
+                slice_times_file << slice_runtimes[slice_number][k] << endl;
+            }
+            slice_times_file.close();
+        }
+
+        Log::info(
+            "finished search %d (slice %d, repeat %d) in %ld ms\n", current->search, current->slice, current->repeat,
+            milliseconds
+        );
+
+        active_searches.erase(current->search);
+        delete current;
+    }
+
+    void stop_generating(SweepSearch* current) {
+        current->generation_finished = true;
+        generating_searches--;
+
+        if (current->genomes_in_flight == 0) {
+            finish_search(current);
+        }
+    }
+
+   public:
+    SweepScheduler(int32_t _number_slices, int32_t _concurrent_searches)
+        : number_searches(_number_slices * repeats),
+          next_search(0),
+          concurrent_searches(_concurrent_searches),
+          generating_searches(0),
+          slice_runtimes(_number_slices, vector<long>(repeats, 0)),
+          slice_repeats_finished(_number_slices, 0) {
+    }
+
+    /**
+     * Returns the next genome to train (and which search it is for), or NULL if every search has stopped generating
+     * genomes, in which case there will be no more work.
+     */
+    RNN_Genome* generate_genome(int32_t& search) {
+        while (true) {
+            while (generating_searches < concurrent_searches && next_search < number_searches) {
+                start_search();
+            }
+
+            SweepSearch* current = NULL;
+            for (auto it = active_searches.begin(); it != active_searches.end(); it++) {
+                SweepSearch* candidate = it->second;
+                if (!candidate->generation_finished
+                    && (current == NULL || candidate->genomes_in_flight < current->genomes_in_flight)) {
+                    current = candidate;
+                }
+            }
+
+            if (current == NULL) {
+                return NULL;
+            }
+
+            Log::set_id(current->log_id);
+            RNN_Genome* genome = current->examm->generate_genome();
+            Log::set_id("main_0");
+
+            if (genome == NULL) {
+                // this search is done, so try the others (or start the next one)
+                stop_generating(current);
+            } else {
+                current->genomes_in_flight++;
+                search = current->search;
+                return genome;
+            }
+        }
+    }
+
+    void insert_genome(int32_t search, RNN_Genome* genome) {
+        if (active_searches.count(search) == 0) {
+            Log::fatal("ERROR: received a genome for search %d which is not running\n", search);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        SweepSearch* current = active_searches[search];
+
+        Log::set_id(current->log_id);
+        current->examm->insert_genome(genome);
+        Log::set_id("main_0");
+
+        current->genomes_in_flight--;
+        if (current->generation_finished && current->genomes_in_flight == 0) {
+            finish_search(current);
+        }
+    }
+};
+
+void master(int32_t max_rank, int32_t number_slices, int32_t concurrent_searches) {
+    SweepScheduler scheduler(number_slices, concurrent_searches);
     int32_t terminates_sent = 0;
 
     while (true) {
@@ -130,11 +365,10 @@ void master(int32_t max_rank) {
         if (tag == WORK_REQUEST_TAG) {
             receive_work_request(source);
 
-            examm_mutex.lock();
-            RNN_Genome* genome = examm->generate_genome();
-            examm_mutex.unlock();
+            int32_t search;
+            RNN_Genome* genome = scheduler.generate_genome(search);
 
-            if (genome == NULL) {  // search was completed if it returns NULL for an individual
+            if (genome == NULL) {  // every search was completed if it returns NULL for an individual
                 // send terminate message
                 Log::debug("terminating worker: %d\n", source);
                 send_terminate_message(source);
@@ -146,23 +380,19 @@ void master(int32_t max_rank) {
                 }
 
             } else {
-                // genome->write_to_file( examm->get_output_directory() + "/before_send_gen_" +
-                // to_string(genome->get_generation_id()) );
-
                 // send genome
-                Log::debug("sending genome to: %d\n", source);
-                send_genome_to(source, genome);
+                Log::debug("sending genome for search %d to: %d\n", search, source);
+                send_genome_to(source, search, genome);
 
                 // delete this genome as it will not be used again
                 delete genome;
             }
         } else if (tag == GENOME_LENGTH_TAG) {
             Log::debug("received genome from: %d\n", source);
-            RNN_Genome* genome = receive_genome_from(source);
+            int32_t search;
+            RNN_Genome* genome = receive_genome_from(source, search);
 
-            examm_mutex.lock();
-            examm->insert_genome(genome);
-            examm_mutex.unlock();
+            scheduler.insert_genome(search, genome);
 
             delete genome;
             // this genome will be deleted if/when removed from population
@@ -173,9 +403,36 @@ void master(int32_t max_rank) {
     }
 }
 
+struct SliceData {
+    vector<vector<vector<double> > > training_inputs;
+    vector<vector<vector<double> > > training_outputs;
+    vector<vector<vector<double> > > validation_inputs;
+    vector<vector<vector<double> > > validation_outputs;
+};
+
+// the training and validation data of each slice a worker has trained a genome for
+map<int32_t, SliceData> slice_data;
+
+SliceData& get_slice_data(int32_t slice) {
+    if (slice_data.count(slice) == 0) {
+        vector<int32_t> training_indexes;
+        vector<int32_t> test_indexes;
+        get_fold_indexes(slice, training_indexes, test_indexes);
+
+        time_series_sets->set_training_indexes(training_indexes);
+        time_series_sets->set_test_indexes(test_indexes);
+
+        SliceData& data = slice_data[slice];
+        get_train_validation_data(
+            arguments, time_series_sets, data.training_inputs, data.training_outputs, data.validation_inputs,
+            data.validation_outputs
+        );
+    }
+    return slice_data[slice];
+}
+
 void worker(int32_t rank) {
-    string worker_id =
-        "worker_slice_" + to_string(global_slice) + "_repeat_" + to_string(global_repeat) + "_" + to_string(rank);
+    string worker_id = "worker_" + to_string(rank);
     Log::set_id(worker_id);
 
     while (true) {
@@ -196,20 +453,27 @@ void worker(int32_t rank) {
 
         } else if (tag == GENOME_LENGTH_TAG) {
             Log::debug("received genome!\n");
-            RNN_Genome* genome = receive_genome_from(0);
+            int32_t search;
+            RNN_Genome* genome = receive_genome_from(0, search);
+
+            int32_t slice = get_search_slice(search);
+            SliceData& data = get_slice_data(slice);
+
+            string log_id = "slice_" + to_string(slice) + "_repeat_" + to_string(get_search_repeat(search))
+                            + "_genome_" + to_string(genome->get_generation_id()) + "_worker_" + to_string(rank);
+            genome_property->set_training_settings(genome);
 
-            string log_id = "slice_" + to_string(global_slice) + "_repeat_" + to_string(global_repeat) + "_genome_"
-                            + to_string(genome->get_generation_id()) + "_worker_" + to_string(rank);
             Log::set_id(log_id);
             genome->backpropagate_stochastic(
-                training_inputs, training_outputs, validation_inputs, validation_outputs, weight_update_method
+                data.training_inputs, data.training_outputs, data.validation_inputs, data.validation_outputs,
+                weight_update_method
             );
             Log::release_id(log_id);
 
             // go back to the worker's log for MPI communication
             Log::set_id(worker_id);
 
-            send_genome_to(0, genome);
+            send_genome_to(0, search, genome);
 
             delete genome;
         } else {
@@ -236,104 +500,44 @@ int main(int argc, char** argv) {
     Log::set_id("main_" + to_string(rank));
     Log::restrict_to_rank(0);
 
-    int32_t fold_size = 2;
     get_argument(arguments, "--fold_size", true, fold_size);
-
-    string output_directory = "";
     get_argument(arguments, "--output_directory", false, output_directory);
-
-    int32_t repeats;
     get_argument(arguments, "--repeats", true, repeats);
 
-    TimeSeriesSets* time_series_sets = NULL;
+    // how many slice/repeat searches generate genomes at the same time
+    int32_t concurrent_searches = 1;
+    get_argument(arguments, "--concurrent_searches", false, concurrent_searches);
+
     time_series_sets = TimeSeriesSets::generate_from_arguments(arguments);
-    get_train_validation_data(
-        arguments, time_series_sets, training_inputs, training_outputs, validation_inputs, validation_outputs
-    );
 
     weight_update_method = new WeightUpdate();
     weight_update_method->generate_from_arguments(arguments);
 
     WeightRules* weight_rules = new WeightRules();
     weight_rules->initialize_from_args(arguments);
+    get_argument(arguments, "--dnas_pruning_threshold", false, dnas_pruning_threshold);
 
-    RNN_Genome* seed_genome = get_seed_genome(arguments, time_series_sets, weight_rules);
+    genome_property = new GenomeProperty();
+    genome_property->generate_genome_property_from_arguments(arguments);
 
-    Log::clear_rank_restriction();
+    seed_genome = get_seed_genome(arguments, time_series_sets, weight_rules);
 
-    for (int32_t i = 0; i < time_series_sets->get_number_series(); i += fold_size) {
-        vector<int32_t> training_indexes;
-        vector<int32_t> test_indexes;
-
-        for (int32_t j = 0; j < time_series_sets->get_number_series(); j += fold_size) {
-            if (j == i) {
-                for (int32_t k = 0; k < fold_size; k++) {
-                    test_indexes.push_back(j + k);
-                }
-            } else {
-                for (int32_t k = 0; k < fold_size; k++) {
-                    training_indexes.push_back(j + k);
-                }
-            }
-        }
-
-        time_series_sets->set_training_indexes(training_indexes);
-        time_series_sets->set_test_indexes(test_indexes);
-
-        // time_series_sets->export_training_series(time_offset, training_inputs, training_outputs);
-        // time_series_sets->export_test_series(time_offset, validation_inputs, validation_outputs);
-
-        string slice_output_directory = output_directory + "/slice_" + to_string(i);
-        mkpath(slice_output_directory.c_str(), 0777);
-        ofstream slice_times_file(output_directory + "/slice_" + to_string(i) + "_runtimes.csv");
-
-        for (int32_t k = 0; k < repeats; k++) {
-            string current_output_directory = slice_output_directory + "/repeat_" + to_string(k);
-            mkpath(current_output_directory.c_str(), 0777);
-
-            // set to the master/workers can specify the right log id
-            global_slice = i;
-            global_repeat = k;
-
-            if (rank == 0) {
-                string examm_log_id = "examm_slice_" + to_string(global_slice) + "_repeat_" + to_string(global_repeat);
-                Log::set_id(examm_log_id);
-
-                examm = generate_examm_from_arguments(arguments, time_series_sets, weight_rules, seed_genome);
-
-                std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
-                master(max_rank);
-                std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
-                long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-
-                // examm->write_memory_log(current_output_directory + "/memory_fitness_log.csv");
-
-                slice_times_file << milliseconds << endl;
-
-                RNN_Genome* best_genome = examm->get_best_genome();
-
-                string binary_file = slice_output_directory + "/repeat_best_" + to_string(k) + ".bin";
-                string graphviz_file = slice_output_directory + "/repeat_best_" + to_string(k) + ".gv";
-
-                Log::debug("writing best genome to '%s' and '%s'\n", binary_file.c_str(), graphviz_file.c_str());
-                best_genome->write_to_file(binary_file);
-                best_genome->write_graphviz(graphviz_file);
+    Log::clear_rank_restriction();
 
-                delete examm;
-                Log::release_id(examm_log_id);
-            } else {
-                worker(rank);
-            }
-            Log::set_id("main_" + to_string(rank));
+    int32_t number_slices = (time_series_sets->get_number_series() + fold_size - 1) / fold_size;
 
-            MPI_Barrier(MPI_COMM_WORLD);
-            Log::debug(
-                "rank %d completed slice %d of %d repeat %d of %d\n", rank, i, time_series_sets->get_number_series(), k,
-                repeats
-            );
-        }
+    if (rank == 0) {
+        std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+        master(max_rank, number_slices, concurrent_searches);
+        std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
+        long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
-        slice_times_file.close();
+        Log::info(
+            "completed %d slices with %d repeats (%d concurrent searches) in %ld ms\n", number_slices, repeats,
+            concurrent_searches, milliseconds
+        );
+    } else {
+        worker(rank);
     }
 
     MPI_Finalize();
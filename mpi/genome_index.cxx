@@ -0,0 +1,195 @@
+#include <atomic>
+using std::atomic;
+
+#include <fstream>
+using std::getline;
+using std::ifstream;
+using std::ofstream;
+
+#include <iomanip>
+using std::setprecision;
+
+#include <iostream>
+using std::cerr;
+using std::cout;
+using std::endl;
+
+#include <mutex>
+using std::mutex;
+
+#include <sstream>
+using std::stringstream;
+
+#include <stdexcept>
+using std::invalid_argument;
+using std::logic_error;
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "genome_index.hxx"
+#include "rnn/rnn_genome.hxx"
+
+#define GENOME_INDEX_HEADER                                                                                        \
+    "# genome index v1: file_size,file_time,best_mse,best_mae,n_edges,n_rec_edges,n_nodes,n_ff,n_lstm,n_ugrnn,n_" \
+    "delta,n_mgu,n_gru,output_name,run_type,filename"
+
+bool GenomeIndex::read(string index_filename) {
+    summaries.clear();
+
+    ifstream infile(index_filename);
+    if (!infile.is_open()) {
+        return false;
+    }
+
+    string line;
+    if (!getline(infile, line) || line.compare(GENOME_INDEX_HEADER) != 0) {
+        cerr << "genome index '" << index_filename << "' is from a different version, all genomes will be reloaded"
+             << endl;
+        return false;
+    }
+
+    while (getline(infile, line)) {
+        stringstream ss(line);
+        string s;
+        GenomeSummary summary;
+
+        // a malformed line (e.g., from a run that was killed while writing the index) is skipped, so its genome
+        // is not in the index and gets reloaded by update
+        try {
+            getline(ss, s, ',');
+            summary.file_size = stoll(s);
+            getline(ss, s, ',');
+            summary.file_time = stoll(s);
+            getline(ss, s, ',');
+            summary.best_mse = stod(s);
+            getline(ss, s, ',');
+            summary.best_mae = stod(s);
+
+            int32_t* counts[] = {&summary.edges, &summary.rec_edges, &summary.nodes, &summary.ff,  &summary.lstm,
+                                 &summary.ugrnn, &summary.delta,     &summary.mgu,   &summary.gru};
+            for (int32_t i = 0; i < 9; i++) {
+                if (!getline(ss, s, ',')) {
+                    throw invalid_argument("missing node or edge count");
+                }
+                *counts[i] = stoi(s);
+            }
+        } catch (const logic_error& e) {
+            cerr << "skipping malformed genome index line '" << line << "': " << e.what() << endl;
+            continue;
+        }
+
+        getline(ss, summary.output_name, ',');
+        getline(ss, summary.run_type, ',');
+        // the filename is the rest of the line, in case it has a comma in it
+        getline(ss, summary.filename);
+
+        if (summary.filename.empty()) {
+            cerr << "skipping genome index line without a filename: '" << line << "'" << endl;
+            continue;
+        }
+
+        summaries[summary.filename] = summary;
+    }
+    infile.close();
+
+    return true;
+}
+
+void GenomeIndex::write(string index_filename) const {
+    ofstream outfile(index_filename);
+    if (!outfile.is_open()) {
+        cerr << "ERROR: could not open genome index '" << index_filename << "' for writing" << endl;
+        return;
+    }
+
+    outfile << GENOME_INDEX_HEADER << endl;
+    outfile << setprecision(17);
+
+    for (auto i = summaries.begin(); i != summaries.end(); i++) {
+        const GenomeSummary& summary = i->second;
+
+        outfile << summary.file_size << "," << summary.file_time << "," << summary.best_mse << "," << summary.best_mae
+                << "," << summary.edges << "," << summary.rec_edges << "," << summary.nodes << "," << summary.ff << ","
+                << summary.lstm << "," << summary.ugrnn << "," << summary.delta << "," << summary.mgu << ","
+                << summary.gru << "," << summary.output_name << "," << summary.run_type << "," << summary.filename
+                << endl;
+    }
+    outfile.close();
+}
+
+int32_t GenomeIndex::update(const vector<GenomeSummary>& files, int32_t number_threads) {
+    map<string, GenomeSummary> updated_summaries;
+    vector<GenomeSummary> to_load;
+
+    for (int32_t i = 0; i < (int32_t) files.size(); i++) {
+        auto found = summaries.find(files[i].filename);
+        if (found != summaries.end() && found->second.file_size == files[i].file_size
+            && found->second.file_time == files[i].file_time) {
+            updated_summaries[files[i].filename] = found->second;
+            // the file may have been found under a different output name or run type
+            updated_summaries[files[i].filename].output_name = files[i].output_name;
+            updated_summaries[files[i].filename].run_type = files[i].run_type;
+        } else {
+            to_load.push_back(files[i]);
+        }
+    }
+
+    cout << "genome index has " << updated_summaries.size() << " unchanged genomes, loading " << to_load.size()
+         << " new or changed genomes with " << number_threads << " threads" << endl;
+
+    mutex output_mutex;
+    atomic<int32_t> next_genome(0);
+
+    auto load_genomes = [&]() {
+        for (int32_t i = next_genome++; i < (int32_t) to_load.size(); i = next_genome++) {
+            GenomeSummary& summary = to_load[i];
+
+            RNN_Genome* genome = new RNN_Genome(summary.filename);
+
+            summary.best_mse = genome->get_best_validation_mse();
+            summary.best_mae = genome->get_best_validation_mae();
+            summary.edges = genome->get_enabled_edge_count();
+            summary.rec_edges = genome->get_enabled_recurrent_edge_count();
+            summary.nodes = genome->get_enabled_node_count();
+            summary.ff = genome->get_enabled_node_count(SIMPLE_NODE);
+            summary.lstm = genome->get_enabled_node_count(LSTM_NODE);
+            summary.ugrnn = genome->get_enabled_node_count(UGRNN_NODE);
+            summary.delta = genome->get_enabled_node_count(DELTA_NODE);
+            summary.mgu = genome->get_enabled_node_count(MGU_NODE);
+            summary.gru = genome->get_enabled_node_count(GRU_NODE);
+
+            output_mutex.lock();
+            cout << "\tprocessed genome binary '" << summary.filename << "' for '" << summary.output_name << "'"
+                 << " and " << summary.run_type << ", fitness: " << genome->get_fitness() << endl;
+            output_mutex.unlock();
+
+            delete genome;
+        }
+    };
+
+    vector<thread> threads;
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads.push_back(thread(load_genomes));
+    }
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads[i].join();
+    }
+
+    for (int32_t i = 0; i < (int32_t) to_load.size(); i++) {
+        updated_summaries[to_load[i].filename] = to_load[i];
+    }
+    summaries = updated_summaries;
+
+    return to_load.size();
+}
+
+const GenomeSummary& GenomeIndex::get_summary(string filename) const {
+    return summaries.at(filename);
+}
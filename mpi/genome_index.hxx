@@ -0,0 +1,66 @@
+#ifndef EXAMM_GENOME_INDEX_HXX
+#define EXAMM_GENOME_INDEX_HXX
+
+#include <map>
+using std::map;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "stdint.h"
+
+/**
+ * Everything process_sweep_results uses from a genome binary, along with the size and modification time of the file
+ * it was read from so it is only read again if the file changes.
+ */
+struct GenomeSummary {
+    string filename;
+    string output_name;
+    string run_type;
+
+    int64_t file_size;
+    int64_t file_time;
+
+    double best_mse;
+    double best_mae;
+
+    int32_t edges;
+    int32_t rec_edges;
+    int32_t nodes;
+    int32_t ff;
+    int32_t lstm;
+    int32_t ugrnn;
+    int32_t delta;
+    int32_t mgu;
+    int32_t gru;
+};
+
+/**
+ * A cache of genome summaries stored as a CSV file (one genome per line), so re-running process_sweep_results on a
+ * sweep directory only loads the genomes which were added or changed since the last run.
+ */
+class GenomeIndex {
+   private:
+    map<string, GenomeSummary> summaries;
+
+   public:
+    /**
+     * Returns false if the index file doesn't exist (or is from another version), leaving the index empty.
+     */
+    bool read(string index_filename);
+    void write(string index_filename) const;
+
+    /**
+     * Updates the index to the given genome files (which need their filename, output name, run type, size and
+     * modification time set), loading those which are new or have changed in parallel. Files which are no longer
+     * present are removed. Returns how many genomes were loaded.
+     */
+    int32_t update(const vector<GenomeSummary>& files, int32_t number_threads);
+
+    const GenomeSummary& get_summary(string filename) const;
+};
+
+#endif
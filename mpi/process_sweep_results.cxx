@@ -3,6 +3,10 @@ using std::sort;
 
 #include <chrono>
 #include <cstring>
+
+#include <fstream>
+using std::ofstream;
+
 #include <iomanip>
 using std::setw;
 
@@ -11,9 +15,6 @@ using std::cerr;
 using std::cout;
 using std::endl;
 
-#include <mutex>
-using std::mutex;
-
 #include <string>
 using std::string;
 
@@ -26,22 +27,28 @@ using std::map;
 #include <vector>
 using std::vector;
 
+#include <sys/stat.h>
+
 #include "common/arguments.hxx"
 #include "dirent.h"
+#include "genome_index.hxx"
 #include "rnn/rnn_genome.hxx"
 #include "run_statistics.hxx"
 #include "tracker.hxx"
 
-map<string, map<string, vector<RNN_Genome*>>> genome_map;
+// the genome binary filenames for each output and run type, and every genome file found (with its size and
+// modification time) so the genome index can tell which need to be loaded
+map<string, map<string, vector<string>>> genome_map;
+vector<GenomeSummary> genome_files;
 
 vector<RunStatistics*> run_statistics;
 
 bool extension_is(string name, string extension) {
-    if (name.size() < 4) {
+    if (name.size() < extension.size()) {
         return false;
     }
 
-    string ext = name.substr(name.length() - 4, 4);
+    string ext = name.substr(name.length() - extension.size());
 
     // cout << "comparing '" << ext << "' to '" << extension << "'" << endl;
 
@@ -63,6 +70,10 @@ void process_dir(string dir_name, int32_t depth) {
             if (strcmp(ent->d_name, "logs") == 0 && depth == 0) {
                 continue;
             }
+            // skip the genome index and statistics files written by a previous run
+            if (depth == 0 && (extension_is(ent->d_name, ".csv") || extension_is(ent->d_name, ".json"))) {
+                continue;
+            }
 
             if (depth == 0) {
                 current_output = ent->d_name;
@@ -82,12 +93,21 @@ void process_dir(string dir_name, int32_t depth) {
             // cout << sub_dir_name << ", depth: " << depth << endl;
 
             if (depth == 3 && extension_is(sub_dir_name, ".bin")) {
-                cout << "\tprocessing genome binary '" << sub_dir_name << "' for '" << current_output << "'"
-                     << " and " << current_run_type;
-                RNN_Genome* genome = new RNN_Genome(sub_dir_name);
-                cout << ", fitness: " << genome->get_fitness() << endl;
+                struct stat file_stat;
+                if (stat(sub_dir_name.c_str(), &file_stat) != 0) {
+                    cerr << "ERROR: could not stat genome binary '" << sub_dir_name << "'" << endl;
+                    continue;
+                }
 
-                genome_map[current_output][current_run_type].push_back(genome);
+                GenomeSummary file;
+                file.filename = sub_dir_name;
+                file.output_name = current_output;
+                file.run_type = current_run_type;
+                file.file_size = file_stat.st_size;
+                file.file_time = file_stat.st_mtime;
+                genome_files.push_back(file);
+
+                genome_map[current_output][current_run_type].push_back(sub_dir_name);
             } else if (depth < 3) {
                 process_dir(sub_dir_name, depth + 1);
             }
@@ -104,8 +124,30 @@ int main(int argc, char** argv) {
     vector<string> arguments = vector<string>(argv, argv + argc);
 
     string path = arguments[1];
+
+    // genome summaries are cached in the index, so only new or changed genomes are loaded
+    string index_filename = path + "/genome_index.csv";
+    get_argument(arguments, "--index_file", false, index_filename);
+
+    int32_t number_threads = thread::hardware_concurrency();
+    get_argument(arguments, "--number_threads", false, number_threads);
+    if (number_threads < 1) {
+        number_threads = 1;
+    }
+
+    string statistics_csv_filename = path + "/run_statistics.csv";
+    get_argument(arguments, "--statistics_csv", false, statistics_csv_filename);
+
+    string statistics_json_filename = path + "/run_statistics.json";
+    get_argument(arguments, "--statistics_json", false, statistics_json_filename);
+
     process_dir(path, 0);
 
+    GenomeIndex genome_index;
+    genome_index.read(index_filename);
+    genome_index.update(genome_files, number_threads);
+    genome_index.write(index_filename);
+
     vector<string> output_types;
     output_types.push_back("flame");
     output_types.push_back("oil");
@@ -128,28 +170,14 @@ int main(int argc, char** argv) {
 
             // iterate over the vector of genomes
             for (auto k = j->second.begin(); k != j->second.end(); k++) {
-                RNN_Genome* genome = *k;
-
-                cout << i->first << "," << j->first << "," << genome->get_best_validation_mse() << ","
-                     << genome->get_best_validation_mae() << "," << genome->get_enabled_edge_count() << ","
-                     << genome->get_enabled_recurrent_edge_count() << "," << genome->get_enabled_node_count() << ","
-                     << genome->get_enabled_node_count(SIMPLE_NODE) << "," << genome->get_enabled_node_count(LSTM_NODE)
-                     << "," << genome->get_enabled_node_count(UGRNN_NODE) << ","
-                     << genome->get_enabled_node_count(DELTA_NODE) << "," << genome->get_enabled_node_count(MGU_NODE)
-                     << "," << genome->get_enabled_node_count(GRU_NODE) << endl;
-
-                rs->mse.track(genome->get_best_validation_mse());
-                rs->mae.track(genome->get_best_validation_mae());
-                rs->edge.track(genome->get_enabled_edge_count());
-                rs->rec_edge.track(genome->get_enabled_recurrent_edge_count());
-
-                rs->node.track(genome->get_enabled_node_count());
-                rs->ff.track(genome->get_enabled_node_count(SIMPLE_NODE));
-                rs->lstm.track(genome->get_enabled_node_count(LSTM_NODE));
-                rs->ugrnn.track(genome->get_enabled_node_count(UGRNN_NODE));
-                rs->delta.track(genome->get_enabled_node_count(DELTA_NODE));
-                rs->mgu.track(genome->get_enabled_node_count(MGU_NODE));
-                rs->gru.track(genome->get_enabled_node_count(GRU_NODE));
+                const GenomeSummary& genome = genome_index.get_summary(*k);
+
+                cout << i->first << "," << j->first << "," << genome.best_mse << "," << genome.best_mae << ","
+                     << genome.edges << "," << genome.rec_edges << "," << genome.nodes << "," << genome.ff << ","
+                     << genome.lstm << "," << genome.ugrnn << "," << genome.delta << "," << genome.mgu << ","
+                     << genome.gru << endl;
+
+                rs->track(genome);
             }
             cout << endl;
 
@@ -189,6 +217,27 @@ int main(int argc, char** argv) {
         }
     }
 
+    ofstream statistics_csv(statistics_csv_filename);
+    ofstream statistics_json(statistics_json_filename);
+
+    statistics_csv << RunStatistics::csv_header() << endl;
+    statistics_json << "[" << endl;
+    for (int32_t i = 0; i < (int32_t) run_statistics.size(); i++) {
+        statistics_csv << run_statistics[i]->to_csv_string();
+        statistics_json << "    " << run_statistics[i]->to_json_string();
+        if (i < (int32_t) run_statistics.size() - 1) {
+            statistics_json << ",";
+        }
+        statistics_json << endl;
+    }
+    statistics_json << "]" << endl;
+
+    statistics_csv.close();
+    statistics_json.close();
+
+    cout << "wrote run statistics to '" << statistics_csv_filename << "' and '" << statistics_json_filename << "'"
+         << endl;
+
     // process the kfold sweep directories, these should start with "sweep"
     DIR *dir, *subdir;
     struct dirent* ent;
@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include <iostream>
 using std::endl;
 
@@ -58,6 +60,21 @@ string ConsolidatedStatistics::to_string_max() {
 RunStatistics::RunStatistics(string _output_name, string _run_type) : output_name(_output_name), run_type(_run_type) {
 }
 
+void RunStatistics::track(const GenomeSummary& summary) {
+    mse.track(summary.best_mse);
+    mae.track(summary.best_mae);
+    edge.track(summary.edges);
+    rec_edge.track(summary.rec_edges);
+
+    node.track(summary.nodes);
+    ff.track(summary.ff);
+    lstm.track(summary.lstm);
+    ugrnn.track(summary.ugrnn);
+    delta.track(summary.delta);
+    mgu.track(summary.mgu);
+    gru.track(summary.gru);
+}
+
 void RunStatistics::set_deviation_from_mean_min(double _dfm_min) {
     dfm_min = _dfm_min;
 }
@@ -268,3 +285,86 @@ string RunStatistics::to_overview_ff_string() {
 
     return oss.str();
 }
+
+#define NUMBER_STATISTICS 6
+static const char* statistic_names[NUMBER_STATISTICS] = {"min", "avg", "max", "stddev", "mse_correlation",
+                                                         "mae_correlation"};
+
+#define NUMBER_TRACKED 11
+static const char* tracked_names[NUMBER_TRACKED] = {"mse", "mae", "edges", "rec_edges", "nodes", "ff",
+                                                    "lstm", "ugrnn", "delta", "mgu", "gru"};
+
+static double get_statistic(Tracker& tracker, int32_t statistic, Tracker& mse, Tracker& mae) {
+    switch (statistic) {
+        case 0:
+            return tracker.min();
+        case 1:
+            return tracker.avg();
+        case 2:
+            return tracker.max();
+        case 3:
+            return tracker.stddev();
+        case 4:
+            return tracker.correlate(mse);
+        default:
+            return tracker.correlate(mae);
+    }
+}
+
+string RunStatistics::csv_header() {
+    ostringstream oss;
+
+    oss << "output_name,run_type,statistic";
+    for (int32_t i = 0; i < NUMBER_TRACKED; i++) {
+        oss << "," << tracked_names[i];
+    }
+
+    return oss.str();
+}
+
+string RunStatistics::to_csv_string() {
+    Tracker* tracked[NUMBER_TRACKED] = {&mse, &mae, &edge, &rec_edge, &node, &ff, &lstm, &ugrnn, &delta, &mgu, &gru};
+
+    ostringstream oss;
+    oss << setprecision(10);
+
+    for (int32_t i = 0; i < NUMBER_STATISTICS; i++) {
+        oss << output_name << "," << run_type << "," << statistic_names[i];
+        for (int32_t j = 0; j < NUMBER_TRACKED; j++) {
+            oss << "," << get_statistic(*tracked[j], i, mse, mae);
+        }
+        oss << endl;
+    }
+
+    return oss.str();
+}
+
+string RunStatistics::to_json_string() {
+    Tracker* tracked[NUMBER_TRACKED] = {&mse, &mae, &edge, &rec_edge, &node, &ff, &lstm, &ugrnn, &delta, &mgu, &gru};
+
+    ostringstream oss;
+    oss << setprecision(10);
+
+    oss << "{\"output_name\": \"" << output_name << "\", \"run_type\": \"" << run_type << "\"";
+    for (int32_t i = 0; i < NUMBER_TRACKED; i++) {
+        oss << ", \"" << tracked_names[i] << "\": {";
+        for (int32_t j = 0; j < NUMBER_STATISTICS; j++) {
+            double value = get_statistic(*tracked[i], j, mse, mae);
+
+            if (j > 0) {
+                oss << ", ";
+            }
+            oss << "\"" << statistic_names[j] << "\": ";
+            // the stddev and correlations are undefined with fewer than two genomes (or no variation)
+            if (std::isfinite(value)) {
+                oss << value;
+            } else {
+                oss << "null";
+            }
+        }
+        oss << "}";
+    }
+    oss << "}";
+
+    return oss.str();
+}
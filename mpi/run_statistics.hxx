@@ -4,6 +4,7 @@
 #include <string>
 using std::string;
 
+#include "genome_index.hxx"
 #include "tracker.hxx"
 
 string fix_run_type(string run_type);
@@ -64,6 +65,8 @@ class RunStatistics {
 
     RunStatistics(string _output_name, string _run_type);
 
+    void track(const GenomeSummary& summary);
+
     void set_deviation_from_mean_min(double _dfm_min);
     void set_deviation_from_mean_avg(double _dfm_avg);
     void set_deviation_from_mean_max(double _dfm_max);
@@ -83,6 +86,14 @@ class RunStatistics {
     string overview_ff_header();
     string overview_ff_footer(string type);
     string to_overview_ff_string();
+
+    /**
+     * Machine readable versions of the statistics: a CSV line for each statistic (min, avg, max, stddev and the
+     * correlations with mse and mae) and a JSON object with the same values (null where they are undefined).
+     */
+    static string csv_header();
+    string to_csv_string();
+    string to_json_string();
 };
 
 struct less_than_min {
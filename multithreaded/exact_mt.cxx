@@ -2,6 +2,9 @@
 #include <condition_variable>
 using std::condition_variable;
 
+#include <functional>
+using std::cref;
+
 #include <iomanip>
 using std::setw;
 
@@ -22,7 +25,9 @@ using std::thread;
 #include <vector>
 using std::vector;
 
+#include "cnn/convolution_backend.hxx"
 #include "cnn/exact.hxx"
+#include "cnn/genome_store.hxx"
 #include "common/arguments.hxx"
 #include "image_tools/image_set.hxx"
 
@@ -32,6 +37,8 @@ vector<string> arguments;
 
 EXACT* exact;
 
+GenomeStore* genome_store = NULL;
+
 bool finished = false;
 
 int32_t images_resize;
@@ -56,7 +63,10 @@ void exact_thread(
         exact_mutex.lock();
         exact->insert_genome(genome);
 #ifdef _MYSQL_
-        exact->export_to_database();
+        // the genome store already persists the inserted genomes without exporting the whole search every time
+        if (genome_store == NULL) {
+            exact->export_to_database();
+        }
 #endif
         exact_mutex.unlock();
     }
@@ -65,6 +75,8 @@ void exact_thread(
 int main(int argc, char** argv) {
     arguments = vector<string>(argv, argv + argc);
 
+    ConvolutionAutotuner::initialize(arguments);
+
     int32_t number_threads;
     get_argument(arguments, "--number_threads", true, number_threads);
 
@@ -127,9 +139,27 @@ int main(int argc, char** argv) {
     }
 #endif
 
+    if (argument_exists(arguments, "--genome_store")) {
+        string genome_store_filename;
+        get_argument(arguments, "--genome_store", true, genome_store_filename);
+
+        int32_t genome_store_batch = 16;
+        get_argument(arguments, "--genome_store_batch", false, genome_store_batch);
+        if (genome_store_batch < 1) {
+            cerr << "ERROR: --genome_store_batch must be at least 1, was " << genome_store_batch << endl;
+            exit(1);
+        }
+
+        genome_store = new GenomeStore(genome_store_filename, genome_store_batch);
+        exact->set_genome_store(genome_store);
+    }
+
     vector<thread> threads;
     for (int32_t i = 0; i < number_threads; i++) {
-        threads.push_back(thread(exact_thread, training_images, validation_images, testing_images, i));
+        // the image sets are shared by every thread instead of copied into each one
+        threads.push_back(
+            thread(exact_thread, cref(training_images), cref(validation_images), cref(testing_images), i)
+        );
     }
 
     for (int32_t i = 0; i < number_threads; i++) {
@@ -138,6 +168,13 @@ int main(int argc, char** argv) {
 
     finished = true;
 
+    ConvolutionAutotuner::print_choices(cout);
+
+    if (genome_store != NULL) {
+        genome_store->flush();
+        delete genome_store;
+    }
+
     cout << "completed!" << endl;
 
     return 0;
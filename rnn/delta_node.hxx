@@ -32,11 +32,11 @@ class Delta_Node : public RNN_Node_Interface {
     vector<double> d_z_hat_bias;
     vector<double> d_z_prev;
 
-    vector<double> r;
-    vector<double> ld_r;
-    vector<double> z_cap;
-    vector<double> ld_z_cap;
-    vector<double> ld_z;
+    vector<rnn_value_t> r;
+    vector<rnn_value_t> ld_r;
+    vector<rnn_value_t> z_cap;
+    vector<rnn_value_t> ld_z_cap;
+    vector<rnn_value_t> ld_z;
 
    public:
     Delta_Node(int32_t _innovation_number, int32_t _type, double _depth);
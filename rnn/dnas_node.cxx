@@ -1,9 +1,6 @@
 #include <algorithm>
 using std::sort;
 
-#include <utility>
-using std::pair;
-
 #include <cassert>
 #include <cmath>
 using std::max;
@@ -13,6 +10,8 @@ using std::max;
 #include "common/log.hxx"
 #include "dnas_node.hxx"
 
+double dnas_pruning_threshold = 0.0;
+
 DNASNode::DNASNode(
     vector<RNN_Node_Interface*>&& _nodes, int32_t _innovation_number, int32_t _type, double _depth, int32_t counter
 )
@@ -23,6 +22,7 @@ DNASNode::DNASNode(
       x(vector<double>(nodes.size())),
       g(vector<double>(nodes.size())),
       d_pi(vector<double>(nodes.size())),
+      d_pi_scale(vector<double>(nodes.size())),
       noise(vector<double>(nodes.size())),
       counter(counter) {
     node_type = DNAS_NODE;
@@ -45,6 +45,9 @@ DNASNode::DNASNode(const DNASNode& src) : RNN_Node_Interface(src.innovation_numb
 
     pi = src.pi;
     d_pi = src.d_pi;
+    d_pi_scale = src.d_pi_scale;
+    active_nodes = src.active_nodes;
+    selected_nodes = src.selected_nodes;
     z = src.z;
     g = src.g;
     x = src.x;
@@ -77,8 +80,12 @@ DNASNode::~DNASNode() {
 
 template <typename Rng>
 void DNASNode::gumbel_noise(Rng& rng, vector<double>& output) {
+    // the uniform samples have to be drawn in order, but the transform of all of them can be vectorized
+    for (int32_t i = 0; i < (int32_t) output.size(); i++) {
+        output[i] = uniform_real_distribution<double>(0.0, 1.0)(rng);
+    }
     for (int32_t i = 0; i < (int32_t) output.size(); i++) {
-        output[i] = -log(-log(uniform_real_distribution<double>(0.0, 1.0)(rng)));
+        output[i] = -log(-log(output[i]));
     }
 }
 
@@ -95,59 +102,82 @@ void DNASNode::sample_gumbel_softmax(Rng& rng) {
 void DNASNode::calculate_z() {
     tao = max(1.0 / 3.0, 1.0 / (1.0 + (double) counter * 0.05));
 
+    int32_t n = pi.size();
+
+    active_nodes.clear();
+    int32_t max_pi = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (dnas_pruning_threshold <= 0.0 || pi[i] >= dnas_pruning_threshold) {
+            active_nodes.push_back(i);
+        }
+        if (pi[i] > pi[max_pi]) {
+            max_pi = i;
+        }
+    }
+    if (active_nodes.size() == 0) {
+        active_nodes.push_back(max_pi);
+    }
+
+    // pruned candidates are left out of the softmax entirely
+    for (int32_t i = 0; i < n; i++) {
+        x[i] = 0.0;
+        z[i] = 0.0;
+        d_pi_scale[i] = 0.0;
+    }
+
     xtotal = 0.0;
     double emax = -10000000;
-    for (int32_t i = 0; i < (int32_t) z.size(); i++) {
-        x[i] = g[i] + log(pi[i]);
-        x[i] /= tao;
+    for (int32_t i : active_nodes) {
+        x[i] = (g[i] + log(pi[i])) / tao;
         emax = max(emax, x[i]);
     }
-    for (int32_t i = 0; i < (int32_t) z.size(); i++) {
+    for (int32_t i : active_nodes) {
         x[i] = exp(emax - x[i]);
         xtotal += x[i];
     }
-    for (int32_t i = 0; i < (int32_t) z.size(); i++) {
-        z[i] = x[i] / xtotal;
-    }
 
-    if (k > 0) {
-        pair<int32_t, double> ps_with_indices[z.size()];
-        for (int32_t i = 0; i < (int32_t) z.size(); i++) {
-            ps_with_indices[i] = pair(i, z[i]);
-        }
+    double inverse_xtotal = 1.0 / xtotal;
+    for (int32_t i : active_nodes) {
+        z[i] = x[i] * inverse_xtotal;
+        d_pi_scale[i] = (x[i] / pi[i]) * inverse_xtotal * (1 - z[i]) / tao;
+    }
 
-        std::sort(
-            ps_with_indices, ps_with_indices + z.size(),
-            [](const pair<int32_t, double>& a, const pair<int32_t, double>& b) {
-                // Descending order
-                return a.second > b.second;
-            }
-        );
+    if (k > 0 && k < (int32_t) active_nodes.size()) {
+        order = active_nodes;
+        std::partial_sort(order.begin(), order.begin() + k, order.end(), [this](int32_t a, int32_t b) {
+            // Descending order
+            return z[a] > z[b];
+        });
 
         double total = 0.0;
         for (int32_t i = 0; i < k; i++) {
-            total += ps_with_indices[i].second;
+            total += z[order[i]];
         }
 
-        for (int32_t i = 0; i < (int32_t) z.size(); i++) {
-            z[i] = 0.0;
+        for (int32_t i = 0; i < k; i++) {
+            z[order[i]] /= total;
         }
+        for (int32_t i = k; i < (int32_t) order.size(); i++) {
+            z[order[i]] = 0.0;
+        }
+    }
 
-        for (int32_t i = 0; i < k; i++) {
-            z[ps_with_indices[i].first] = ps_with_indices[i].second / total;
+    selected_nodes.clear();
+    for (int32_t i : active_nodes) {
+        if (z[i] != 0.0) {
+            selected_nodes.push_back(i);
         }
     }
 }
 
 void DNASNode::reset(int32_t series_length) {
     d_pi = vector<double>(pi.size(), 0.0);
-    d_input = vector<double>(series_length, 0.0);
-    node_outputs = vector<vector<double>>(series_length, vector<double>(pi.size(), 0.0));
-    output_values = vector<double>(series_length, 0.0);
-    error_values = vector<double>(series_length, 0.0);
+    d_input = vector<rnn_value_t>(series_length, 0.0);
+    output_values = vector<rnn_value_t>(series_length, 0.0);
+    error_values = vector<rnn_value_t>(series_length, 0.0);
     inputs_fired = vector<int>(series_length, 0);
     outputs_fired = vector<int>(series_length, 0);
-    input_values = vector<double>(series_length, 0.0);
+    input_values = vector<rnn_value_t>(series_length, 0.0);
 
     if (counter >= CRYSTALLIZATION_THRESHOLD) {
         nodes[maxi]->reset(series_length);
@@ -156,8 +186,9 @@ void DNASNode::reset(int32_t series_length) {
             sample_gumbel_softmax(generator);
         }
 
-        for (auto node : nodes) {
-            node->reset(series_length);
+        // pruned candidates are never evaluated so they don't need to be reset
+        for (int32_t i : active_nodes) {
+            nodes[i]->reset(series_length);
         }
     }
 }
@@ -181,15 +212,16 @@ void DNASNode::input_fired(int32_t time, double incoming_output) {
         assert(maxi >= 0);
 
         nodes[maxi]->input_fired(time, input_values[time]);
-        node_outputs[time][maxi] = nodes[maxi]->output_values[time];
         output_values[time] = nodes[maxi]->output_values[time];
     } else {
-        for (auto i = 0; i < (int32_t) nodes.size(); i++) {
-            auto node = nodes[i];
-            node->input_fired(time, input_values[time]);
-            node_outputs[time][i] = node->output_values[time];
-            output_values[time] += z[i] * node->output_values[time];
+        // every active candidate is evaluated (even those with a z of 0) as their outputs are needed for the
+        // gradient of pi, each candidate keeps its outputs in its own output_values
+        double output = 0.0;
+        for (int32_t i : active_nodes) {
+            nodes[i]->input_fired(time, input_values[time]);
+            output += z[i] * nodes[i]->output_values[time];
         }
+        output_values[time] += output;
     }
 }
 
@@ -223,17 +255,16 @@ void DNASNode::try_update_deltas(int32_t time) {
         d_input[time] += nodes[maxi]->d_input[time];
 
     } else {
-        for (int32_t i = 0; i < (int32_t) z.size(); i++) {
-            nodes[i]->output_fired(time, delta * z[i]);
-            double p = (x[i] / pi[i]);
-            p *= ((delta * node_outputs[time][i]) / xtotal);
-            p *= (1 - (x[i] / xtotal));
-            p *= 1 / tao;
-            d_pi[i] += p;
+        for (int32_t i : active_nodes) {
+            d_pi[i] += d_pi_scale[i] * delta * nodes[i]->output_values[time];
         }
+
+        // candidates with a z of 0 would only get a delta of 0, leaving their gradients and d_input at the 0 they
+        // were reset to
         d_input[time] = 0.0;
-        for (auto node : nodes) {
-            d_input[time] += node->d_input[time];
+        for (int32_t i : selected_nodes) {
+            nodes[i]->output_fired(time, delta * z[i]);
+            d_input[time] += nodes[i]->d_input[time];
         }
     }
 }
@@ -364,10 +395,18 @@ void DNASNode::get_gradients(vector<double>& gradients) {
             gradients[offset++] = d_pi[i] * 0.1;
         }
 
-        for (auto node : nodes) {
-            node->get_gradients(temp);
-            for (int32_t i = 0; i < (int32_t) temp.size(); i++) {
-                gradients[offset++] = temp[i];
+        int32_t next_active = 0;
+        for (int32_t i = 0; i < (int32_t) nodes.size(); i++) {
+            // pruned candidates were not evaluated, so their gradients stay 0
+            if (next_active >= (int32_t) active_nodes.size() || active_nodes[next_active] != i) {
+                offset += nodes[i]->get_number_weights();
+                continue;
+            }
+            next_active++;
+
+            nodes[i]->get_gradients(temp);
+            for (int32_t j = 0; j < (int32_t) temp.size(); j++) {
+                gradients[offset++] = temp[j];
             }
         }
     }
@@ -24,6 +24,10 @@ using std::unique_ptr;
 
 #define CRYSTALLIZATION_THRESHOLD 1000
 
+// candidate nodes whose pi falls below this are pruned: they are no longer evaluated or trained, and get no weight
+// in the Gumbel-Softmax sample. The candidate with the largest pi is never pruned. 0 (the default) disables pruning.
+extern double dnas_pruning_threshold;
+
 class DNASNode : public RNN_Node_Interface {
    private:
     template <typename R>
@@ -55,6 +59,20 @@ class DNASNode : public RNN_Node_Interface {
 
     vector<double> d_pi;
 
+    // The derivative of z_i with respect to pi_i for the current sample, calculated with z so backprop only has to
+    // multiply it by the error and candidate output for each time step
+    vector<double> d_pi_scale;
+
+    // The candidates which have not been pruned, these are the only ones evaluated in the forward pass
+    vector<int32_t> active_nodes;
+
+    // The active candidates with a non-zero weight in z (with a K-hot sample, only K of them), only these need to have
+    // errors passed back to them since the others would only receive zeros
+    vector<int32_t> selected_nodes;
+
+    // Indices of the active candidates, sorted to find the K largest values of z
+    vector<int32_t> order;
+
     // A vector to put gumbel noise into; just to avoid re-allocation
     vector<double> noise;
 
@@ -70,8 +88,6 @@ class DNASNode : public RNN_Node_Interface {
     // Can be set externally using DNASNode::set_stochastic
     bool stochastic = true;
 
-    vector<vector<double>> node_outputs;
-
    public:
     DNASNode(
         vector<RNN_Node_Interface*>&& nodes, int32_t _innovation_number, int32_t _type, double _depth,
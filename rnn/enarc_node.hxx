@@ -44,8 +44,8 @@ class ENARC_Node : public RNN_Node_Interface {
 
     vector<double> d_h_prev;
 
-    vector<double> z;
-    vector<double> l_d_z;
+    vector<rnn_value_t> z;
+    vector<rnn_value_t> l_d_z;
 
     vector<double> w1_z;
     vector<double> l_w1_z;
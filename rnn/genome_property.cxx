@@ -5,6 +5,10 @@
 
 GenomeProperty::GenomeProperty() {
     bp_iterations = 10;
+    validation_frequency = 1;
+    evaluation_threads = 1;
+    batch_size = 1;
+    training_threads = 1;
     dropout_probability = 0.0;
     min_recurrent_depth = 1;
     max_recurrent_depth = 10;
@@ -13,11 +17,19 @@ GenomeProperty::GenomeProperty() {
 void GenomeProperty::generate_genome_property_from_arguments(const vector<string>& arguments) {
     get_argument(arguments, "--bp_iterations", true, bp_iterations);
     use_dropout = get_argument(arguments, "--dropout_probability", false, dropout_probability);
+    get_argument(arguments, "--validation_frequency", false, validation_frequency);
+    get_argument(arguments, "--evaluation_threads", false, evaluation_threads);
+    get_argument(arguments, "--batch_size", false, batch_size);
+    get_argument(arguments, "--training_threads", false, training_threads);
 
     get_argument(arguments, "--min_recurrent_depth", false, min_recurrent_depth);
     get_argument(arguments, "--max_recurrent_depth", false, max_recurrent_depth);
 
     Log::info("Each generated genome is trained for %d epochs\n", bp_iterations);
+    Log::info(
+        "Validation set is evaluated every %d epochs using %d threads\n", validation_frequency, evaluation_threads
+    );
+    Log::info("Backprop batch size is %d, using %d training threads\n", batch_size, training_threads);
     Log::info(
         "Use dropout is set to %s, dropout probability is %f\n", use_dropout ? "True" : "False", dropout_probability
     );
@@ -26,6 +38,7 @@ void GenomeProperty::generate_genome_property_from_arguments(const vector<string
 
 void GenomeProperty::set_genome_properties(RNN_Genome* genome) {
     genome->set_bp_iterations(bp_iterations);
+    set_training_settings(genome);
     if (use_dropout) {
         genome->enable_dropout(dropout_probability);
     }
@@ -34,6 +47,13 @@ void GenomeProperty::set_genome_properties(RNN_Genome* genome) {
     genome->set_normalize_bounds(normalize_type, normalize_mins, normalize_maxs, normalize_avgs, normalize_std_devs);
 }
 
+void GenomeProperty::set_training_settings(RNN_Genome* genome) {
+    genome->set_validation_frequency(validation_frequency);
+    genome->set_evaluation_threads(evaluation_threads);
+    genome->set_batch_size(batch_size);
+    genome->set_training_threads(training_threads);
+}
+
 void GenomeProperty::get_time_series_parameters(TimeSeriesSets* time_series_sets) {
     input_parameter_names = time_series_sets->get_input_parameter_names();
     output_parameter_names = time_series_sets->get_output_parameter_names();
@@ -13,6 +13,10 @@ using std::string;
 class GenomeProperty {
    private:
     int32_t bp_iterations;
+    int32_t validation_frequency;
+    int32_t evaluation_threads;
+    int32_t batch_size;
+    int32_t training_threads;
     bool use_dropout;
     double dropout_probability;
     int32_t min_recurrent_depth;
@@ -34,6 +38,13 @@ class GenomeProperty {
     GenomeProperty();
     void generate_genome_property_from_arguments(const vector<string>& arguments);
     void set_genome_properties(RNN_Genome* genome);
+
+    /**
+     * Sets only the training settings which are not written with a genome (see RNN_Genome::read_from_stream), for
+     * the MPI workers which receive their genomes from the master.
+     */
+    void set_training_settings(RNN_Genome* genome);
+
     void get_time_series_parameters(TimeSeriesSets* time_series_sets);
     uniform_int_distribution<int32_t> get_recurrent_depth_dist();
 };
@@ -40,12 +40,12 @@ class GRU_Node : public RNN_Node_Interface {
 
     vector<double> d_h_prev;
 
-    vector<double> z;
-    vector<double> ld_z;
-    vector<double> r;
-    vector<double> ld_r;
-    vector<double> h_tanh;
-    vector<double> ld_h_tanh;
+    vector<rnn_value_t> z;
+    vector<rnn_value_t> ld_z;
+    vector<rnn_value_t> r;
+    vector<rnn_value_t> ld_r;
+    vector<rnn_value_t> h_tanh;
+    vector<rnn_value_t> ld_h_tanh;
 
    public:
     GRU_Node(int32_t _innovation_number, int32_t _type, double _depth);
@@ -31,19 +31,19 @@ class LSTM_Node : public RNN_Node_Interface {
     double cell_weight;
     double cell_bias;
 
-    vector<double> output_gate_values;
-    vector<double> input_gate_values;
-    vector<double> forget_gate_values;
-    vector<double> cell_values;
-
-    vector<double> ld_output_gate;
-    vector<double> ld_input_gate;
-    vector<double> ld_forget_gate;
-
-    vector<double> cell_in_tanh;
-    vector<double> cell_out_tanh;
-    vector<double> ld_cell_in;
-    vector<double> ld_cell_out;
+    vector<rnn_value_t> output_gate_values;
+    vector<rnn_value_t> input_gate_values;
+    vector<rnn_value_t> forget_gate_values;
+    vector<rnn_value_t> cell_values;
+
+    vector<rnn_value_t> ld_output_gate;
+    vector<rnn_value_t> ld_input_gate;
+    vector<rnn_value_t> ld_forget_gate;
+
+    vector<rnn_value_t> cell_in_tanh;
+    vector<rnn_value_t> cell_out_tanh;
+    vector<rnn_value_t> ld_cell_in;
+    vector<rnn_value_t> ld_cell_out;
 
     vector<double> d_prev_cell;
 
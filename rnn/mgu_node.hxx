@@ -33,10 +33,10 @@ class MGU_Node : public RNN_Node_Interface {
 
     vector<double> d_h_prev;
 
-    vector<double> f;
-    vector<double> ld_f;
-    vector<double> h_tanh;
-    vector<double> ld_h_tanh;
+    vector<rnn_value_t> f;
+    vector<rnn_value_t> ld_f;
+    vector<rnn_value_t> h_tanh;
+    vector<rnn_value_t> ld_h_tanh;
 
    public:
     MGU_Node(int32_t _innovation_number, int32_t _layer_type, double _depth);
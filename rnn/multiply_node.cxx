@@ -102,7 +102,7 @@ void MULTIPLY_Node::try_update_deltas(int32_t time) {
     }
 
     d_bias += d_input[time];
-    for (double& num : ordered_d_input[time]) {
+    for (rnn_value_t& num : ordered_d_input[time]) {
         num *= d_input[time];
 
         // most likely gradient got huge, so clip it
@@ -136,7 +136,7 @@ void MULTIPLY_Node::output_fired(int32_t time, double delta) {
 void MULTIPLY_Node::reset(int32_t _series_length) {
     series_length = _series_length;
 
-    ordered_d_input.assign(series_length, vector<double>());
+    ordered_d_input.assign(series_length, vector<rnn_value_t>());
     ordered_input.assign(series_length, vector<double>());
     d_input.assign(series_length, 0.0);
     input_values.assign(series_length, 0.0);
@@ -0,0 +1,167 @@
+#include <charconv>
+using std::to_chars;
+
+#include <fstream>
+using std::ios;
+using std::ofstream;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "common/log.hxx"
+#include "prediction_writer.hxx"
+
+// the version 1 files (written by the first evaluate_rnns_batch) stored the values row by row
+#define PREDICTIONS_VERSION 2
+
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// the longest a value written with 6 significant digits can be, e.g., -1.23457e-308
+#define MAX_VALUE_LENGTH 16
+
+PredictionWriter::PredictionWriter(
+    const vector<string>& _input_parameter_names, const vector<string>& _output_parameter_names,
+    TimeSeriesSets* time_series_sets
+)
+    : input_parameter_names(_input_parameter_names), output_parameter_names(_output_parameter_names) {
+    for (int32_t i = 0; i < (int32_t) input_parameter_names.size(); i++) {
+        double offset = time_series_sets->denormalize(input_parameter_names[i], 0.0);
+        input_offsets.push_back(offset);
+        input_scales.push_back(time_series_sets->denormalize(input_parameter_names[i], 1.0) - offset);
+    }
+
+    for (int32_t i = 0; i < (int32_t) output_parameter_names.size(); i++) {
+        double offset = time_series_sets->denormalize(output_parameter_names[i], 0.0);
+        output_offsets.push_back(offset);
+        output_scales.push_back(time_series_sets->denormalize(output_parameter_names[i], 1.0) - offset);
+    }
+}
+
+void PredictionWriter::write_csv(
+    string output_filename, const vector<vector<double> >& series_data,
+    const vector<vector<double> >& expected_outputs, const vector<vector<double> >& predicted_outputs
+) const {
+    ofstream outfile(output_filename);
+    if (!outfile.is_open()) {
+        Log::fatal("ERROR: could not open predictions file '%s' for writing.\n", output_filename.c_str());
+        exit(1);
+    }
+
+    int32_t number_inputs = input_parameter_names.size();
+    int32_t number_outputs = output_parameter_names.size();
+    int32_t number_rows = expected_outputs[0].size();
+
+    string header = "#";
+    for (int32_t i = 0; i < number_inputs; i++) {
+        if (i > 0) {
+            header += ",";
+        }
+        header += input_parameter_names[i];
+    }
+    for (int32_t i = 0; i < number_outputs; i++) {
+        header += ",expected_" + output_parameter_names[i];
+    }
+    for (int32_t i = 0; i < number_outputs; i++) {
+        header += ",predicted_" + output_parameter_names[i];
+    }
+    header += "\n";
+    outfile.write(header.c_str(), header.size());
+
+    int32_t max_row_length = (number_inputs + 2 * number_outputs) * (MAX_VALUE_LENGTH + 1) + 1;
+    vector<char> buffer(WRITE_BUFFER_SIZE + max_row_length);
+    char* buffer_end = buffer.data() + buffer.size();
+    char* current = buffer.data();
+
+    // the values are written with 6 significant digits in the shortest of fixed or scientific notation, the same
+    // as ofstream with its default precision
+    auto write_value = [&](double value) {
+        current = to_chars(current, buffer_end, value, std::chars_format::general, 6).ptr;
+    };
+
+    for (int32_t j = 0; j < number_rows; j++) {
+        for (int32_t i = 0; i < number_inputs; i++) {
+            if (i > 0) {
+                *current++ = ',';
+            }
+            write_value(series_data[i][j] * input_scales[i] + input_offsets[i]);
+        }
+
+        for (int32_t i = 0; i < number_outputs; i++) {
+            *current++ = ',';
+            write_value(expected_outputs[i][j] * output_scales[i] + output_offsets[i]);
+        }
+
+        for (int32_t i = 0; i < number_outputs; i++) {
+            *current++ = ',';
+            write_value(predicted_outputs[i][j] * output_scales[i] + output_offsets[i]);
+        }
+        *current++ = '\n';
+
+        if (current - buffer.data() >= WRITE_BUFFER_SIZE) {
+            outfile.write(buffer.data(), current - buffer.data());
+            current = buffer.data();
+        }
+    }
+
+    outfile.write(buffer.data(), current - buffer.data());
+    outfile.close();
+}
+
+void PredictionWriter::write_binary(
+    string output_filename, const vector<vector<double> >& series_data,
+    const vector<vector<double> >& expected_outputs, const vector<vector<double> >& predicted_outputs
+) const {
+    ofstream outfile(output_filename, ios::out | ios::binary);
+    if (!outfile.is_open()) {
+        Log::fatal("ERROR: could not open predictions file '%s' for writing.\n", output_filename.c_str());
+        exit(1);
+    }
+
+    int32_t version = PREDICTIONS_VERSION;
+    int32_t number_inputs = input_parameter_names.size();
+    int32_t number_outputs = output_parameter_names.size();
+    int64_t number_rows = expected_outputs[0].size();
+
+    outfile.write("EXAMMPRD", 8);
+    outfile.write((char*) &version, sizeof(int32_t));
+    outfile.write((char*) &number_inputs, sizeof(int32_t));
+    outfile.write((char*) &number_outputs, sizeof(int32_t));
+    outfile.write((char*) &number_rows, sizeof(int64_t));
+
+    auto write_name = [&](const string& name) {
+        int32_t length = name.size();
+        outfile.write((char*) &length, sizeof(int32_t));
+        outfile.write(name.c_str(), length);
+    };
+
+    for (int32_t i = 0; i < number_inputs; i++) {
+        write_name(input_parameter_names[i]);
+    }
+    for (int32_t i = 0; i < number_outputs; i++) {
+        write_name(output_parameter_names[i]);
+    }
+
+    vector<float> column(number_rows);
+
+    auto write_column = [&](const vector<double>& values, double scale, double offset) {
+        for (int64_t j = 0; j < number_rows; j++) {
+            column[j] = values[j] * scale + offset;
+        }
+        outfile.write((char*) column.data(), number_rows * sizeof(float));
+    };
+
+    for (int32_t i = 0; i < number_inputs; i++) {
+        write_column(series_data[i], input_scales[i], input_offsets[i]);
+    }
+    for (int32_t i = 0; i < number_outputs; i++) {
+        write_column(expected_outputs[i], output_scales[i], output_offsets[i]);
+    }
+    for (int32_t i = 0; i < number_outputs; i++) {
+        write_column(predicted_outputs[i], output_scales[i], output_offsets[i]);
+    }
+
+    outfile.close();
+}
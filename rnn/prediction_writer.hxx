@@ -0,0 +1,57 @@
+#ifndef EXAMM_PREDICTION_WRITER_HXX
+#define EXAMM_PREDICTION_WRITER_HXX
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "stdint.h"
+#include "time_series/time_series.hxx"
+
+/**
+ * Writes the denormalized inputs, expected outputs and predicted outputs of an RNN on a time series, either as CSV
+ * (the same text RNN::write_predictions has always written) or as binary columns.
+ *
+ * The denormalization for each parameter is linear, so it is precomputed from the TimeSeriesSets as a scale and
+ * offset per column, and after construction the writer is read only and can be shared between threads writing
+ * different files. Values are formatted with to_chars into a large buffer which is written out in blocks.
+ *
+ * The binary format is:
+ *
+ *      "EXAMMPRD", int32 version (2), int32 number inputs, int32 number outputs, int64 number rows, the input then
+ *      output parameter names (each an int32 length followed by its characters), then each input column, each
+ *      expected output column and each predicted output column as number rows floats
+ */
+class PredictionWriter {
+   private:
+    vector<string> input_parameter_names;
+    vector<string> output_parameter_names;
+
+    vector<double> input_scales;
+    vector<double> input_offsets;
+    vector<double> output_scales;
+    vector<double> output_offsets;
+
+   public:
+    PredictionWriter(
+        const vector<string>& _input_parameter_names, const vector<string>& _output_parameter_names,
+        TimeSeriesSets* time_series_sets
+    );
+
+    /**
+     * The series_data, expected_outputs and predicted_outputs are indexed by [parameter][row] and are normalized.
+     */
+    void write_csv(
+        string output_filename, const vector<vector<double> >& series_data,
+        const vector<vector<double> >& expected_outputs, const vector<vector<double> >& predicted_outputs
+    ) const;
+
+    void write_binary(
+        string output_filename, const vector<vector<double> >& series_data,
+        const vector<vector<double> >& expected_outputs, const vector<vector<double> >& predicted_outputs
+    ) const;
+};
+
+#endif
@@ -17,8 +17,12 @@ using std::endl;
 #include <fstream>
 using std::ofstream;
 
+#include <map>
+using std::map;
+
 #include <random>
 using std::minstd_rand0;
+using std::uniform_int_distribution;
 using std::uniform_real_distribution;
 
 #include <vector>
@@ -196,6 +200,9 @@ RNN::RNN(
 
     fix_parameter_orders(input_parameter_names, output_parameter_names);
     validate_parameters(input_parameter_names, output_parameter_names);
+
+    sparse_initialized = false;
+    sparse_forward = false;
 }
 
 RNN::RNN(
@@ -225,6 +232,9 @@ RNN::RNN(
     Log::debug("validating parameters, input_node.size: %d\n", input_nodes.size());
     validate_parameters(input_parameter_names, output_parameter_names);
 
+    sparse_initialized = false;
+    sparse_forward = false;
+
     Log::trace(
         "got RNN with %d nodes, %d edges, %d recurrent edges\n", nodes.size(), edges.size(), recurrent_edges.size()
     );
@@ -368,6 +378,7 @@ void RNN::forward_pass(
     }
 
     // TODO: want to check that all vectors in series_data are of same length
+    sparse_forward = false;
 
     for (int32_t i = 0; i < (int32_t) nodes.size(); i++) {
         nodes[i]->reset(series_length);
@@ -420,6 +431,161 @@ void RNN::forward_pass(
     }
 }
 
+void RNN::initialize_sparse_inputs() {
+    map<RNN_Node_Interface*, int32_t> input_positions;
+    for (int32_t i = 0; i < (int32_t) input_nodes.size(); i++) {
+        input_positions[input_nodes[i]] = i;
+
+        if (input_nodes[i]->is_reachable() && input_nodes[i]->total_inputs != 1) {
+            Log::fatal(
+                "ERROR: input node %d has %d inputs, the sparse forward pass needs input nodes with no incoming "
+                "edges\n",
+                input_nodes[i]->get_innovation_number(), input_nodes[i]->total_inputs - 1
+            );
+            exit(1);
+        }
+    }
+
+    map<RNN_Node_Interface*, int32_t> target_positions;
+    sparse_dense_edges.clear();
+    token_edges.assign(input_nodes.size(), vector<RNN_Edge*>());
+    token_edge_targets.assign(input_nodes.size(), vector<int32_t>());
+    sparse_targets.clear();
+    sparse_target_inputs.clear();
+
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        RNN_Edge* edge = edges[i];
+        if (!edge->is_reachable()) {
+            continue;
+        }
+
+        auto input_position = input_positions.find(edge->input_node);
+        // multiply nodes need each input fired separately, so those edges are fired like any other edge
+        if (input_position == input_positions.end() || edge->output_node->node_type == MULTIPLY_NODE) {
+            sparse_dense_edges.push_back(edge);
+            continue;
+        }
+
+        auto target_position = target_positions.find(edge->output_node);
+        if (target_position == target_positions.end()) {
+            target_position = target_positions.insert({edge->output_node, (int32_t) sparse_targets.size()}).first;
+            sparse_targets.push_back(edge->output_node);
+            sparse_target_inputs.push_back(0);
+        }
+
+        token_edges[input_position->second].push_back(edge);
+        token_edge_targets[input_position->second].push_back(target_position->second);
+        sparse_target_inputs[target_position->second]++;
+    }
+
+    Log::debug(
+        "sparse inputs: %d token edges into %d nodes, %d other edges\n", edges.size() - sparse_dense_edges.size(),
+        sparse_targets.size(), sparse_dense_edges.size()
+    );
+    sparse_initialized = true;
+}
+
+void RNN::forward_pass(
+    const vector<int32_t>& series_tokens, bool using_dropout, bool training, double dropout_probability
+) {
+    if (!sparse_initialized) {
+        initialize_sparse_inputs();
+    }
+
+    series_length = series_tokens.size();
+    sparse_forward = true;
+    input_tokens = series_tokens;
+
+    for (int32_t i = 0; i < (int32_t) nodes.size(); i++) {
+        nodes[i]->reset(series_length);
+    }
+
+    for (int32_t i = 0; i < (int32_t) sparse_dense_edges.size(); i++) {
+        sparse_dense_edges[i]->reset(series_length);
+    }
+
+    // the token edges only keep per time step values for dropout, so they take no memory for each time step
+    for (int32_t i = 0; i < (int32_t) token_edges.size(); i++) {
+        for (int32_t j = 0; j < (int32_t) token_edges[i].size(); j++) {
+            token_edges[i][j]->d_weight = 0.0;
+            if (using_dropout && training) {
+                token_edges[i][j]->dropped_out.resize(series_length);
+            }
+        }
+    }
+
+    for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
+        recurrent_edges[i]->reset(series_length);
+    }
+
+    for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
+        if (recurrent_edges[i]->is_reachable()) {
+            recurrent_edges[i]->first_propagate_forward();
+        }
+    }
+
+    sparse_target_sums.resize(sparse_targets.size());
+
+    for (int32_t time = 0; time < series_length; time++) {
+        int32_t token = series_tokens[time];
+        if (token < 0 || token >= (int32_t) input_nodes.size()) {
+            Log::fatal(
+                "ERROR: token %d at time %d is not the index of one of the %d input nodes\n", token, time,
+                input_nodes.size()
+            );
+            exit(1);
+        }
+
+        // the input nodes are already 0 from the reset, so only the active one needs an output
+        for (int32_t i = 0; i < (int32_t) input_nodes.size(); i++) {
+            input_nodes[i]->inputs_fired[time] = input_nodes[i]->total_inputs;
+        }
+        input_nodes[token]->output_values[time] = 1.0;
+
+        sparse_target_sums.assign(sparse_targets.size(), 0.0);
+        const vector<RNN_Edge*>& active_edges = token_edges[token];
+        const vector<int32_t>& active_targets = token_edge_targets[token];
+        for (int32_t i = 0; i < (int32_t) active_edges.size(); i++) {
+            double output = active_edges[i]->weight;
+
+            if (using_dropout) {
+                if (training) {
+                    active_edges[i]->dropped_out[time] = drand48() < dropout_probability;
+                    if (active_edges[i]->dropped_out[time]) {
+                        output = 0.0;
+                    }
+                } else {
+                    output *= (1.0 - dropout_probability);
+                }
+            }
+
+            sparse_target_sums[active_targets[i]] += output;
+        }
+
+        // every token edge into a node is counted as fired with a single input of their sum
+        for (int32_t i = 0; i < (int32_t) sparse_targets.size(); i++) {
+            sparse_targets[i]->inputs_fired[time] += sparse_target_inputs[i] - 1;
+            sparse_targets[i]->input_fired(time, sparse_target_sums[i]);
+        }
+
+        if (using_dropout) {
+            for (int32_t i = 0; i < (int32_t) sparse_dense_edges.size(); i++) {
+                sparse_dense_edges[i]->propagate_forward(time, training, dropout_probability);
+            }
+        } else {
+            for (int32_t i = 0; i < (int32_t) sparse_dense_edges.size(); i++) {
+                sparse_dense_edges[i]->propagate_forward(time);
+            }
+        }
+
+        for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
+            if (recurrent_edges[i]->is_reachable()) {
+                recurrent_edges[i]->propagate_forward(time);
+            }
+        }
+    }
+}
+
 void RNN::backward_pass(double error, bool using_dropout, bool training, double dropout_probability) {
     // do a propagate forward for time == (series_length - 1) so that the
     //  output fired count on each node will be correct for the first pass
@@ -430,21 +596,24 @@ void RNN::backward_pass(double error, bool using_dropout, bool training, double
         }
     }
 
+    // after a sparse forward pass the token edges are not in the edge list, the other edges are reachable
+    const vector<RNN_Edge*>& backward_edges = sparse_forward ? sparse_dense_edges : edges;
+
     for (int32_t time = series_length - 1; time >= 0; time--) {
         for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
             output_nodes[i]->error_fired(time, error);
         }
 
         if (using_dropout) {
-            for (int32_t i = (int32_t) edges.size() - 1; i >= 0; i--) {
-                if (edges[i]->is_reachable()) {
-                    edges[i]->propagate_backward(time, training, dropout_probability);
+            for (int32_t i = (int32_t) backward_edges.size() - 1; i >= 0; i--) {
+                if (backward_edges[i]->is_reachable()) {
+                    backward_edges[i]->propagate_backward(time, training, dropout_probability);
                 }
             }
         } else {
-            for (int32_t i = (int32_t) edges.size() - 1; i >= 0; i--) {
-                if (edges[i]->is_reachable()) {
-                    edges[i]->propagate_backward(time);
+            for (int32_t i = (int32_t) backward_edges.size() - 1; i >= 0; i--) {
+                if (backward_edges[i]->is_reachable()) {
+                    backward_edges[i]->propagate_backward(time);
                 }
             }
         }
@@ -454,41 +623,166 @@ void RNN::backward_pass(double error, bool using_dropout, bool training, double
                 recurrent_edges[i]->propagate_backward(time);
             }
         }
+
+        if (sparse_forward) {
+            // only the active token's edges had a non-zero input, and the input nodes have no weights to update
+            // (their biases are not used), so the other token edges and the input nodes are skipped
+            const vector<RNN_Edge*>& active_edges = token_edges[input_tokens[time]];
+            for (int32_t i = 0; i < (int32_t) active_edges.size(); i++) {
+                if (using_dropout && training && active_edges[i]->dropped_out[time]) {
+                    continue;
+                }
+                active_edges[i]->d_weight += active_edges[i]->output_node->d_input[time];
+            }
+        }
+    }
+}
+
+void RNN::get_softmax_normalizers(int32_t length, vector<double>& max_outputs, vector<double>& sums, bool keep_exps) {
+    // each loop goes through one output node's values in time order, so the memory accesses are contiguous and the
+    // inner loops can be vectorized, the max is subtracted so exp can't overflow
+    max_outputs.assign(output_nodes[0]->output_values.begin(), output_nodes[0]->output_values.begin() + length);
+    for (int32_t i = 1; i < (int32_t) output_nodes.size(); i++) {
+        const rnn_value_t* output_values = output_nodes[i]->output_values.data();
+        for (int32_t j = 0; j < length; j++) {
+            max_outputs[j] = fmax(max_outputs[j], output_values[j]);
+        }
+    }
+
+    sums.assign(length, 0.0);
+    for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
+        const rnn_value_t* output_values = output_nodes[i]->output_values.data();
+
+        if (keep_exps) {
+            output_nodes[i]->error_values.resize(length);
+            rnn_value_t* exps = output_nodes[i]->error_values.data();
+            for (int32_t j = 0; j < length; j++) {
+                exps[j] = exp(output_values[j] - max_outputs[j]);
+                sums[j] += exps[j];
+            }
+        } else {
+            for (int32_t j = 0; j < length; j++) {
+                sums[j] += exp(output_values[j] - max_outputs[j]);
+            }
+        }
     }
 }
 
 double RNN::calculate_error_softmax(const vector<vector<double> >& expected_outputs) {
-    double cross_entropy_sum = 0.0;
-    double error;
-    double softmax = 0.0;
+    int32_t length = expected_outputs[0].size();
+
+    // the exps are kept in the error values so exp is only called once for each output
+    vector<double> max_outputs, sums;
+    get_softmax_normalizers(length, max_outputs, sums, true);
+
+    vector<double> inverse_sums(length);
+    vector<double> log_sums(length);
+    for (int32_t j = 0; j < length; j++) {
+        inverse_sums[j] = 1.0 / sums[j];
+        log_sums[j] = log(sums[j]);
+    }
 
+    double cross_entropy_sum = 0.0;
     for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
-        output_nodes[i]->error_values.resize(expected_outputs[i].size());
+        const rnn_value_t* output_values = output_nodes[i]->output_values.data();
+        rnn_value_t* error_values = output_nodes[i]->error_values.data();
+        const double* expected = expected_outputs[i].data();
+
+        for (int32_t j = 0; j < length; j++) {
+            error_values[j] = error_values[j] * inverse_sums[j] - expected[j];
+
+            // log(softmax) without the exp, so it can't be log(0)
+            if (expected[j] != 0.0) {
+                cross_entropy_sum -= expected[j] * (output_values[j] - max_outputs[j] - log_sums[j]);
+            }
+        }
     }
 
-    // for each time step j
-    for (int32_t j = 0; j < (int32_t) expected_outputs[0].size(); j++) {
-        double softmax_sum = 0.0;
-        double cross_entropy = 0.0;
-        // get sum of all the outputs of the timestep j from all output node i
-        for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
-            softmax_sum += exp(output_nodes[i]->output_values[j]);
+    return cross_entropy_sum;
+}
+
+double RNN::calculate_error_softmax(const vector<int32_t>& expected_tokens) {
+    int32_t length = expected_tokens.size();
+
+    vector<double> max_outputs, sums;
+    get_softmax_normalizers(length, max_outputs, sums, true);
+
+    vector<double> inverse_sums(length);
+    for (int32_t j = 0; j < length; j++) {
+        inverse_sums[j] = 1.0 / sums[j];
+    }
+
+    for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
+        rnn_value_t* error_values = output_nodes[i]->error_values.data();
+        for (int32_t j = 0; j < length; j++) {
+            error_values[j] *= inverse_sums[j];
         }
+    }
 
-        // for each
+    // the expected output is 1 for the expected token and 0 for every other output
+    double cross_entropy_sum = 0.0;
+    for (int32_t j = 0; j < length; j++) {
+        RNN_Node_Interface* expected = output_nodes[expected_tokens[j]];
+        expected->error_values[j] -= 1.0;
+        cross_entropy_sum -= expected->output_values[j] - max_outputs[j] - log(sums[j]);
+    }
 
-        for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
-            softmax = exp(output_nodes[i]->output_values[j]) / softmax_sum;
-            error = softmax - expected_outputs[i][j];
-            output_nodes[i]->error_values[j] = error;
+    return cross_entropy_sum;
+}
 
-            // std::cout<<"softmax ::::: "<<error<<" "<<output_nodes[i]->output_values[j]<<"
-            // "<<expected_outputs[i][j]<<"\n"<<std::endl;
-            cross_entropy = -expected_outputs[i][j] * log(softmax);
-            // if(cross_entropy)std::cout<<"cross_entropy ::::: "<<cross_entropy<<"\n"<<std::endl;
+double RNN::calculate_error_sampled_softmax(
+    const vector<int32_t>& expected_tokens, int32_t number_samples, minstd_rand0& generator
+) {
+    int32_t length = expected_tokens.size();
+    int32_t number_outputs = output_nodes.size();
+
+    if (number_samples + 1 >= number_outputs) {
+        return calculate_error_softmax(expected_tokens);
+    }
+
+    for (int32_t i = 0; i < number_outputs; i++) {
+        output_nodes[i]->error_values.assign(length, 0.0);
+    }
+
+    // the samples are drawn uniformly, so the log of the sampling probability is the same for every output and
+    // cancels out of the softmax
+    uniform_int_distribution<int32_t> rng(0, number_outputs - 1);
+    vector<bool> sampled(number_outputs, false);
+    vector<int32_t> candidates;
+    vector<double> exps;
+
+    double cross_entropy_sum = 0.0;
+    for (int32_t j = 0; j < length; j++) {
+        candidates.clear();
+        candidates.push_back(expected_tokens[j]);
+        sampled[expected_tokens[j]] = true;
+        while ((int32_t) candidates.size() <= number_samples) {
+            int32_t sample = rng(generator);
+            if (!sampled[sample]) {
+                sampled[sample] = true;
+                candidates.push_back(sample);
+            }
+        }
+
+        double max_output = output_nodes[candidates[0]]->output_values[j];
+        for (int32_t k = 1; k < (int32_t) candidates.size(); k++) {
+            max_output = fmax(max_output, output_nodes[candidates[k]]->output_values[j]);
+        }
 
-            cross_entropy_sum += cross_entropy;
+        exps.resize(candidates.size());
+        double sum = 0.0;
+        for (int32_t k = 0; k < (int32_t) candidates.size(); k++) {
+            exps[k] = exp(output_nodes[candidates[k]]->output_values[j] - max_output);
+            sum += exps[k];
         }
+
+        for (int32_t k = 0; k < (int32_t) candidates.size(); k++) {
+            output_nodes[candidates[k]]->error_values[j] = exps[k] / sum;
+            sampled[candidates[k]] = false;
+        }
+        output_nodes[candidates[0]]->error_values[j] -= 1.0;
+
+        cross_entropy_sum -= output_nodes[candidates[0]]->output_values[j] - max_output - log(sum);
     }
 
     return cross_entropy_sum;
@@ -545,6 +839,49 @@ double RNN::calculate_error_mae(const vector<vector<double> >& expected_outputs)
     return mae_sum;
 }
 
+void RNN::calculate_errors(
+    const vector<vector<double> >& expected_outputs, bool use_softmax, double& mse, double& mae, double& softmax
+) {
+    mse = 0.0;
+    mae = 0.0;
+    softmax = 0.0;
+
+    for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
+        const vector<rnn_value_t>& output_values = output_nodes[i]->output_values;
+        const vector<double>& expected = expected_outputs[i];
+        int32_t length = (int32_t) expected.size();
+
+        double squared_sum = 0.0;
+        double absolute_sum = 0.0;
+        for (int32_t j = 0; j < length; j++) {
+            double error = output_values[j] - expected[j];
+            squared_sum += error * error;
+            absolute_sum += fabs(error);
+        }
+        mse += squared_sum / length;
+        mae += absolute_sum / length;
+    }
+
+    if (use_softmax) {
+        int32_t length = expected_outputs[0].size();
+
+        vector<double> max_outputs, sums;
+        get_softmax_normalizers(length, max_outputs, sums, false);
+        for (int32_t j = 0; j < length; j++) {
+            sums[j] = log(sums[j]);
+        }
+
+        for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
+            const vector<rnn_value_t>& output_values = output_nodes[i]->output_values;
+            for (int32_t j = 0; j < length; j++) {
+                if (expected_outputs[i][j] != 0.0) {
+                    softmax -= expected_outputs[i][j] * (output_values[j] - max_outputs[j] - sums[j]);
+                }
+            }
+        }
+    }
+}
+
 double RNN::prediction_softmax(
     const vector<vector<double> >& series_data, const vector<vector<double> >& expected_outputs, bool using_dropout,
     bool training, double dropout_probability
@@ -569,6 +906,14 @@ double RNN::prediction_mae(
     return calculate_error_mae(expected_outputs);
 }
 
+void RNN::prediction_errors(
+    const vector<vector<double> >& series_data, const vector<vector<double> >& expected_outputs, bool using_dropout,
+    double dropout_probability, bool use_softmax, double& mse, double& mae, double& softmax
+) {
+    forward_pass(series_data, using_dropout, false, dropout_probability);
+    calculate_errors(expected_outputs, use_softmax, mse, mae, softmax);
+}
+
 vector<double> RNN::get_predictions(
     const vector<vector<double> >& series_data, const vector<vector<double> >& expected_outputs, bool using_dropout,
     double dropout_probability
@@ -594,74 +939,89 @@ void RNN::write_predictions(
     const vector<vector<double> >& series_data, const vector<vector<double> >& expected_outputs,
     TimeSeriesSets* time_series_sets, bool using_dropout, double dropout_probability
 ) {
-    forward_pass(series_data, using_dropout, false, dropout_probability);
-
-    ofstream outfile(output_filename);
-
-    outfile << "#";
-
-    for (int32_t i = 0; i < (int32_t) input_nodes.size(); i++) {
-        if (i > 0) {
-            outfile << ",";
-        }
-        outfile << input_parameter_names[i];
+    PredictionWriter writer(input_parameter_names, output_parameter_names, time_series_sets);
+    write_predictions(
+        output_filename, series_data, expected_outputs, writer, false, using_dropout, dropout_probability
+    );
+}
 
-        Log::debug("input_parameter_names[%d]: '%s'\n", i, input_parameter_names[i].c_str());
-    }
+void RNN::write_predictions(
+    string output_filename, const vector<vector<double> >& series_data,
+    const vector<vector<double> >& expected_outputs, const PredictionWriter& writer, bool binary,
+    bool using_dropout, double dropout_probability
+) {
+    forward_pass(series_data, using_dropout, false, dropout_probability);
 
+    vector<vector<double> > predicted_outputs(output_nodes.size());
     for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
-        outfile << ",";
-        outfile << "expected_" << output_parameter_names[i];
-
-        Log::debug("output_parameter_names[%d]: '%s'\n", i, output_parameter_names[i].c_str());
+        predicted_outputs[i].assign(
+            output_nodes[i]->output_values.begin(), output_nodes[i]->output_values.begin() + series_length
+        );
     }
 
-    for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
-        outfile << ",";
-        outfile << "predicted_" << output_parameter_names[i];
-
-        Log::debug("output_parameter_names[%d]: '%s'\n", i, output_parameter_names[i].c_str());
+    if (binary) {
+        writer.write_binary(output_filename, series_data, expected_outputs, predicted_outputs);
+    } else {
+        writer.write_csv(output_filename, series_data, expected_outputs, predicted_outputs);
     }
-    outfile << endl;
+}
 
-    for (int32_t j = 0; j < series_length; j++) {
-        for (int32_t i = 0; i < (int32_t) input_nodes.size(); i++) {
-            if (i > 0) {
-                outfile << ",";
-            }
-            // outfile << series_data[i][j];
-            outfile << time_series_sets->denormalize(input_parameter_names[i], series_data[i][j]);
-        }
+void RNN::get_analytic_gradient(
+    const vector<double>& test_parameters, const vector<vector<double> >& inputs,
+    const vector<vector<double> >& outputs, double& mse, vector<double>& analytic_gradient, bool using_dropout,
+    bool training, double dropout_probability
+) {
+    analytic_gradient.assign(test_parameters.size(), 0.0);
 
-        for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
-            outfile << ",";
-            // outfile << expected_outputs[i][j];
-            outfile << time_series_sets->denormalize(output_parameter_names[i], expected_outputs[i][j]);
-        }
+    set_weights(test_parameters);
+    forward_pass(inputs, using_dropout, training, dropout_probability);
 
-        for (int32_t i = 0; i < (int32_t) output_nodes.size(); i++) {
-            outfile << ",";
-            // outfile << output_nodes[i]->output_values[j];
-            outfile << time_series_sets->denormalize(output_parameter_names[i], output_nodes[i]->output_values[j]);
-        }
-        outfile << endl;
-    }
-    outfile.close();
+    mse = calculate_error_mse(outputs);
+    backward_pass(mse * (1.0 / outputs[0].size()) * 2.0, using_dropout, training, dropout_probability);
+
+    get_gradients(analytic_gradient);
 }
 
 void RNN::get_analytic_gradient(
-    const vector<double>& test_parameters, const vector<vector<double> >& inputs,
+    const vector<double>& test_parameters, const vector<int32_t>& series_tokens,
     const vector<vector<double> >& outputs, double& mse, vector<double>& analytic_gradient, bool using_dropout,
     bool training, double dropout_probability
 ) {
     analytic_gradient.assign(test_parameters.size(), 0.0);
 
     set_weights(test_parameters);
-    forward_pass(inputs, using_dropout, training, dropout_probability);
+    forward_pass(series_tokens, using_dropout, training, dropout_probability);
 
     mse = calculate_error_mse(outputs);
     backward_pass(mse * (1.0 / outputs[0].size()) * 2.0, using_dropout, training, dropout_probability);
 
+    get_gradients(analytic_gradient);
+}
+
+double RNN::get_softmax_gradient(
+    const vector<double>& parameters, const vector<int32_t>& series_tokens, const vector<int32_t>& expected_tokens,
+    int32_t softmax_samples, minstd_rand0& generator, vector<double>& gradient, bool using_dropout, bool training,
+    double dropout_probability
+) {
+    gradient.assign(parameters.size(), 0.0);
+
+    set_weights(parameters);
+    forward_pass(series_tokens, using_dropout, training, dropout_probability);
+
+    double cross_entropy;
+    if (softmax_samples > 0) {
+        cross_entropy = calculate_error_sampled_softmax(expected_tokens, softmax_samples, generator);
+    } else {
+        cross_entropy = calculate_error_softmax(expected_tokens);
+    }
+    backward_pass(1.0 / expected_tokens.size(), using_dropout, training, dropout_probability);
+
+    get_gradients(gradient);
+
+    return cross_entropy / expected_tokens.size();
+}
+
+void RNN::get_gradients(vector<double>& gradient) {
     vector<double> current_gradients;
 
     int32_t current = 0;
@@ -670,7 +1030,7 @@ void RNN::get_analytic_gradient(
             nodes[i]->get_gradients(current_gradients);
 
             for (int32_t j = 0; j < (int32_t) current_gradients.size(); j++) {
-                analytic_gradient[current] = current_gradients[j];
+                gradient[current] = current_gradients[j];
                 current++;
             }
         }
@@ -678,14 +1038,14 @@ void RNN::get_analytic_gradient(
 
     for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
         if (edges[i]->is_reachable()) {
-            analytic_gradient[current] = edges[i]->get_gradient();
+            gradient[current] = edges[i]->get_gradient();
             current++;
         }
     }
 
     for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
         if (recurrent_edges[i]->is_reachable()) {
-            analytic_gradient[current] = recurrent_edges[i]->get_gradient();
+            gradient[current] = recurrent_edges[i]->get_gradient();
             current++;
         }
     }
@@ -731,6 +1091,46 @@ void RNN::get_empirical_gradient(
     mse = original_mse;
 }
 
+void RNN::get_empirical_gradient(
+    const vector<double>& test_parameters, const vector<int32_t>& series_tokens,
+    const vector<vector<double> >& outputs, double& mse, vector<double>& empirical_gradient, bool using_dropout,
+    bool training, double dropout_probability
+) {
+    empirical_gradient.assign(test_parameters.size(), 0.0);
+
+    vector<vector<double> > deltas;
+
+    set_weights(test_parameters);
+    forward_pass(series_tokens, using_dropout, training, dropout_probability);
+    double original_mse = calculate_error_mse(outputs);
+
+    double save;
+    double diff = 0.00001;
+    double mse1, mse2;
+
+    vector<double> parameters = test_parameters;
+    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
+        save = parameters[i];
+
+        parameters[i] = save - diff;
+        set_weights(parameters);
+        forward_pass(series_tokens, using_dropout, training, dropout_probability);
+        get_mse(this, outputs, mse1, deltas);
+
+        parameters[i] = save + diff;
+        set_weights(parameters);
+        forward_pass(series_tokens, using_dropout, training, dropout_probability);
+        get_mse(this, outputs, mse2, deltas);
+
+        empirical_gradient[i] = (mse2 - mse1) / (2.0 * diff);
+        empirical_gradient[i] *= original_mse;
+
+        parameters[i] = save;
+    }
+
+    mse = original_mse;
+}
+
 void RNN::initialize_randomly() {
     int32_t number_of_weights = get_number_weights();
     vector<double> parameters(number_of_weights, 0.0);
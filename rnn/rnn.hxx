@@ -1,12 +1,16 @@
 #ifndef EXAMM_RNN_GENOME_HXX
 #define EXAMM_RNN_GENOME_HXX
 
+#include <random>
+using std::minstd_rand0;
+
 #include <string>
 using std::string;
 
 #include <vector>
 using std::vector;
 
+#include "prediction_writer.hxx"
 #include "rnn_edge.hxx"
 #include "rnn_node_interface.hxx"
 #include "rnn_recurrent_edge.hxx"
@@ -24,6 +28,22 @@ class RNN {
     vector<RNN_Edge*> edges;
     vector<RNN_Recurrent_Edge*> recurrent_edges;
 
+    // state for the sparse (token index) forward pass: the edges out of input nodes which sum into a node are fired
+    // per token and grouped by the node they go into, every other edge is in sparse_dense_edges
+    bool sparse_initialized;
+    bool sparse_forward;
+    vector<int32_t> input_tokens;
+    vector<RNN_Edge*> sparse_dense_edges;
+    vector<vector<RNN_Edge*> > token_edges;
+    vector<vector<int32_t> > token_edge_targets;
+    vector<RNN_Node_Interface*> sparse_targets;
+    vector<int32_t> sparse_target_inputs;
+    vector<double> sparse_target_sums;
+
+    void initialize_sparse_inputs();
+    void get_gradients(vector<double>& gradient);
+    void get_softmax_normalizers(int32_t length, vector<double>& max_outputs, vector<double>& sums, bool keep_exps);
+
    public:
     RNN(vector<RNN_Node_Interface*>& _nodes, vector<RNN_Edge*>& _edges, const vector<string>& input_parameter_names,
         const vector<string>& output_parameter_names);
@@ -45,12 +65,43 @@ class RNN {
     void forward_pass(
         const vector<vector<double> >& series_data, bool using_dropout, bool training, double dropout_probability
     );
+
+    /**
+     * A forward pass where each time step is the index of the input node which is active (e.g., a word's index in the
+     * vocabulary), instead of a dense one-hot value for every input node. The active input node outputs 1 and every
+     * other input node outputs 0 (input node biases are not used), so only the active token's edges are fired, like
+     * an embedding lookup. backward_pass after this only updates the gradients of the active tokens' edges.
+     */
+    void forward_pass(
+        const vector<int32_t>& series_tokens, bool using_dropout, bool training, double dropout_probability
+    );
     void backward_pass(double error, bool using_dropout, bool training, double dropout_probability);
 
     double calculate_error_softmax(const vector<vector<double> >& expected_outputs);
+
+    /**
+     * The softmax cross entropy where each time step's expected output is the index of the output node which should
+     * be 1 (e.g., the next word), so the expected outputs don't need a dense one-hot vector.
+     */
+    double calculate_error_softmax(const vector<int32_t>& expected_tokens);
+
+    /**
+     * A sampled softmax for training with a large number of outputs: each time step's softmax only uses the expected
+     * output and number_samples other outputs drawn uniformly at random, and every other output gets an error of 0.
+     * The returned cross entropy is an estimate, calculate_error_softmax gives the exact value.
+     */
+    double calculate_error_sampled_softmax(
+        const vector<int32_t>& expected_tokens, int32_t number_samples, minstd_rand0& generator
+    );
     double calculate_error_mse(const vector<vector<double> >& expected_outputs);
     double calculate_error_mae(const vector<vector<double> >& expected_outputs);
 
+    // Evaluation only: computes the MSE, MAE and (if use_softmax is set) the softmax cross entropy of the
+    // last forward pass in a single sweep over the outputs, without writing error values for a backward pass.
+    void calculate_errors(
+        const vector<vector<double> >& expected_outputs, bool use_softmax, double& mse, double& mae, double& softmax
+    );
+
     double prediction_softmax(
         const vector<vector<double> >& series_data, const vector<vector<double> >& expected_outputs, bool using_dropout,
         bool training, double dropout_probability
@@ -64,6 +115,11 @@ class RNN {
         bool training, double dropout_probability
     );
 
+    void prediction_errors(
+        const vector<vector<double> >& series_data, const vector<vector<double> >& expected_outputs, bool using_dropout,
+        double dropout_probability, bool use_softmax, double& mse, double& mae, double& softmax
+    );
+
     vector<double> get_predictions(
         const vector<vector<double> >& series_data, const vector<vector<double> >& expected_outputs, bool usng_dropout,
         double dropout_probability
@@ -76,6 +132,15 @@ class RNN {
         double dropout_probability
     );
 
+    /**
+     * Runs the RNN on the series and writes its predictions with the writer, as CSV or binary columns.
+     */
+    void write_predictions(
+        string output_filename, const vector<vector<double> >& series_data,
+        const vector<vector<double> >& expected_outputs, const PredictionWriter& writer, bool binary,
+        bool using_dropout, double dropout_probability
+    );
+
     void initialize_randomly();
     void get_weights(vector<double>& parameters);
     void set_weights(const vector<double>& parameters);
@@ -93,6 +158,27 @@ class RNN {
         bool training, double dropout_probability
     );
 
+    void get_analytic_gradient(
+        const vector<double>& test_parameters, const vector<int32_t>& series_tokens,
+        const vector<vector<double> >& outputs, double& mse, vector<double>& analytic_gradient, bool using_dropout,
+        bool training, double dropout_probability
+    );
+    void get_empirical_gradient(
+        const vector<double>& test_parameters, const vector<int32_t>& series_tokens,
+        const vector<vector<double> >& outputs, double& mse, vector<double>& empirical_gradient, bool using_dropout,
+        bool training, double dropout_probability
+    );
+
+    /**
+     * Does a forward pass with the token indexes, and a backward pass for the softmax cross entropy of the expected
+     * tokens (sampled with softmax_samples > 0). Returns the cross entropy per time step.
+     */
+    double get_softmax_gradient(
+        const vector<double>& parameters, const vector<int32_t>& series_tokens, const vector<int32_t>& expected_tokens,
+        int32_t softmax_samples, minstd_rand0& generator, vector<double>& gradient, bool using_dropout, bool training,
+        double dropout_probability
+    );
+
     // RNN* copy();
 
     friend void get_mse(
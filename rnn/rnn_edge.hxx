@@ -7,8 +7,8 @@ class RNN_Edge {
    private:
     int32_t innovation_number;
 
-    vector<double> outputs;
-    vector<double> deltas;
+    vector<rnn_value_t> outputs;
+    vector<rnn_value_t> deltas;
     vector<bool> dropped_out;
 
     double weight;
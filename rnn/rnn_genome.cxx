@@ -1,4 +1,8 @@
+#include <atomic>
+using std::atomic;
+
 #include <algorithm>
+using std::remove_if;
 using std::sort;
 using std::upper_bound;
 
@@ -25,6 +29,8 @@ using std::endl;
 using std::minstd_rand0;
 using std::uniform_real_distribution;
 
+#include <functional>
+
 #include <thread>
 using std::thread;
 
@@ -47,6 +53,9 @@ using std::vector;
 #include <unordered_map>
 using std::unordered_map;
 
+#include <unordered_set>
+using std::unordered_set;
+
 #include <map>
 using std::map;
 
@@ -113,6 +122,10 @@ RNN_Genome::RNN_Genome(
 
     // set default values
     bp_iterations = 20000;
+    validation_frequency = 1;
+    evaluation_threads = 1;
+    batch_size = 1;
+    training_threads = 1;
     // learning_rate = 0.001;
     // adapt_learning_rate = false;
     // use_nesterov_momentum = false;
@@ -175,6 +188,10 @@ RNN_Genome* RNN_Genome::copy() {
 
     other->group_id = group_id;
     other->bp_iterations = bp_iterations;
+    other->validation_frequency = validation_frequency;
+    other->evaluation_threads = evaluation_threads;
+    other->batch_size = batch_size;
+    other->training_threads = training_threads;
     other->generation_id = generation_id;
     // other->learning_rate = learning_rate;
     // other->adapt_learning_rate = adapt_learning_rate;
@@ -469,6 +486,54 @@ int32_t RNN_Genome::get_bp_iterations() {
     return bp_iterations;
 }
 
+void RNN_Genome::set_validation_frequency(int32_t _validation_frequency) {
+    if (_validation_frequency < 1) {
+        Log::fatal("ERROR: validation frequency must be >= 1, was %d\n", _validation_frequency);
+        exit(1);
+    }
+    validation_frequency = _validation_frequency;
+}
+
+int32_t RNN_Genome::get_validation_frequency() {
+    return validation_frequency;
+}
+
+void RNN_Genome::set_evaluation_threads(int32_t _evaluation_threads) {
+    if (_evaluation_threads < 1) {
+        Log::fatal("ERROR: number of evaluation threads must be >= 1, was %d\n", _evaluation_threads);
+        exit(1);
+    }
+    evaluation_threads = _evaluation_threads;
+}
+
+int32_t RNN_Genome::get_evaluation_threads() {
+    return evaluation_threads;
+}
+
+void RNN_Genome::set_batch_size(int32_t _batch_size) {
+    if (_batch_size < 1) {
+        Log::fatal("ERROR: batch size must be >= 1, was %d\n", _batch_size);
+        exit(1);
+    }
+    batch_size = _batch_size;
+}
+
+int32_t RNN_Genome::get_batch_size() {
+    return batch_size;
+}
+
+void RNN_Genome::set_training_threads(int32_t _training_threads) {
+    if (_training_threads < 1) {
+        Log::fatal("ERROR: number of training threads must be >= 1, was %d\n", _training_threads);
+        exit(1);
+    }
+    training_threads = _training_threads;
+}
+
+int32_t RNN_Genome::get_training_threads() {
+    return training_threads;
+}
+
 // void RNN_Genome::set_learning_rate(double _learning_rate) {
 //     learning_rate = _learning_rate;
 // }
@@ -979,38 +1044,42 @@ void RNN_Genome::backpropagate(
     vector<double> velocity(n_parameters, 0.0);
     vector<double> prev_velocity(n_parameters, 0.0);
     vector<double> analytic_gradient;
-    vector<double> prev_gradient(n_parameters, 0.0);
 
     double mse;
     double norm = 0.0;
 
-    // initialize the initial previous values
     get_analytic_gradient(rnns, parameters, inputs, outputs, mse, analytic_gradient, true);
-    double validation_mse = get_mse(parameters, validation_inputs, validation_outputs);
+    double validation_mse, validation_mae, validation_softmax;
+    get_errors(
+        rnns, parameters, validation_inputs, validation_outputs, false, validation_mse, validation_mae,
+        validation_softmax
+    );
     best_validation_mse = validation_mse;
-    best_validation_mae = get_mae(parameters, validation_inputs, validation_outputs);
+    best_validation_mae = validation_mae;
     best_parameters = parameters;
 
-    norm = weight_update_method->get_norm(analytic_gradient);
-
     ofstream* output_log = create_log_file();
 
     for (int32_t iteration = 0; iteration < bp_iterations; iteration++) {
-        prev_gradient = analytic_gradient;
         get_analytic_gradient(rnns, parameters, inputs, outputs, mse, analytic_gradient, true);
         this->set_weights(parameters);
-        validation_mse = get_mse(parameters, validation_inputs, validation_outputs);
-        if (validation_mse < best_validation_mse) {
-            best_validation_mse = validation_mse;
-            best_validation_mae = get_mae(parameters, validation_inputs, validation_outputs);
-            best_parameters = parameters;
+        if ((iteration + 1) % validation_frequency == 0 || iteration == bp_iterations - 1) {
+            get_errors(
+                rnns, parameters, validation_inputs, validation_outputs, false, validation_mse, validation_mae,
+                validation_softmax
+            );
+            if (validation_mse < best_validation_mse) {
+                best_validation_mse = validation_mse;
+                best_validation_mae = validation_mae;
+                best_parameters = parameters;
+            }
         }
-        norm = weight_update_method->get_norm(analytic_gradient);
+        norm = weight_update_method->norm_and_update_weights(
+            parameters, velocity, prev_velocity, analytic_gradient, iteration
+        );
         if (output_log != NULL) {
             (*output_log) << iteration << " " << mse << " " << validation_mse << " " << best_validation_mse << endl;
         }
-        weight_update_method->norm_gradients(analytic_gradient, norm);
-        weight_update_method->update_weights(parameters, velocity, prev_velocity, analytic_gradient, iteration);
         Log::info(
             "iteration %10d, mse: %10lf, v_mse: %10lf, bv_mse: %10lf, norm: %lf", iteration, mse, validation_mse,
             best_validation_mse, norm
@@ -1032,41 +1101,41 @@ void RNN_Genome::backpropagate_stochastic(
     const vector<vector<vector<double> > >& validation_inputs,
     const vector<vector<vector<double> > >& validation_outputs, WeightUpdate* weight_update_method
 ) {
+    if (batch_size > 1) {
+        backpropagate_minibatch(inputs, outputs, validation_inputs, validation_outputs, weight_update_method);
+        return;
+    }
+
     int32_t n_parameters = this->get_number_weights();
     int32_t n_series = (int32_t) inputs.size();
 
     vector<double> parameters = initial_parameters;
     vector<double> velocity(n_parameters, 0.0);
     vector<double> prev_velocity(n_parameters, 0.0);
-    vector<double> analytic_gradient;
-    vector<double> prev_gradient(n_parameters, 0.0);
+    vector<double> analytic_gradient(n_parameters, 0.0);
 
     double mse;
     double norm = 0.0;
     RNN* rnn = get_rnn();
     rnn->set_weights(parameters);
 
-    std::chrono::time_point<std::chrono::system_clock> startClock = std::chrono::system_clock::now();
-
-    // initialize the initial previous values
-    for (int32_t i = 0; i < n_series; i++) {
-        Log::trace(
-            "getting analytic gradient for input/output: %d, n_series: %d, parameters.size: %d, inputs.size(): %d, "
-            "outputs.size(): %d, log filename: '%s'\n",
-            i, n_series, parameters.size(), inputs.size(), outputs.size(), log_filename.c_str()
-        );
-        rnn->get_analytic_gradient(
-            parameters, inputs[i], outputs[i], mse, analytic_gradient, use_dropout, true, dropout_probability
-        );
-        Log::trace("got analytic gradient.\n");
-        norm = weight_update_method->get_norm(analytic_gradient);
+    // the training RNN is reused for evaluation, any additional evaluation threads get their own copy
+    vector<RNN*> evaluation_rnns;
+    evaluation_rnns.push_back(rnn);
+    for (int32_t i = 1; i < evaluation_threads; i++) {
+        evaluation_rnns.push_back(get_rnn());
     }
-    Log::trace("initialized previous values.\n");
 
-    // TODO: need to get validation mse on the RNN not the genome
-    double validation_mse = get_mse(parameters, validation_inputs, validation_outputs);
+    std::chrono::time_point<std::chrono::system_clock> startClock = std::chrono::system_clock::now();
+
+    double training_mse, training_mae, training_softmax;
+    double validation_mse, validation_mae, validation_softmax;
+    get_errors(
+        evaluation_rnns, parameters, validation_inputs, validation_outputs, false, validation_mse, validation_mae,
+        validation_softmax
+    );
     best_validation_mse = validation_mse;
-    best_validation_mae = get_mae(parameters, validation_inputs, validation_outputs);
+    best_validation_mae = validation_mae;
     best_parameters = parameters;
 
     Log::trace("got initial mses.\n");
@@ -1078,29 +1147,34 @@ void RNN_Genome::backpropagate_stochastic(
 
     ofstream* output_log = create_log_file();
 
+    vector<int32_t> shuffle_order;
+    for (int32_t i = 0; i < n_series; i++) {
+        shuffle_order.push_back(i);
+    }
+
     for (int32_t iteration = 0; iteration < bp_iterations; iteration++) {
-        vector<int32_t> shuffle_order;
-        for (int32_t i = 0; i < n_series; i++) {
-            shuffle_order.push_back(i);
-        }
         fisher_yates_shuffle(generator, shuffle_order);
         double avg_norm = 0.0;
         for (int32_t k = 0; k < (int32_t) shuffle_order.size(); k++) {
             int32_t random_selection = shuffle_order[k];
-            prev_gradient = analytic_gradient;
             rnn->get_analytic_gradient(
                 parameters, inputs[random_selection], outputs[random_selection], mse, analytic_gradient, use_dropout,
                 true, dropout_probability
             );
 
-            norm = weight_update_method->get_norm(analytic_gradient);
+            // calculates the norm, scales by the norm thresholds and updates the weights in one call
+            norm = weight_update_method->norm_and_update_weights(
+                parameters, velocity, prev_velocity, analytic_gradient, iteration
+            );
 
             if (isnan(norm) || isinf(norm)) {
                 // This genome is getting NANs for gradients so it is a
                 // genetic dead end, delete it.
                 // TODO: figure out why and maybe use clipping or another
                 // method to handle it.
-                delete rnn;
+                for (int32_t i = 0; i < (int32_t) evaluation_rnns.size(); i++) {
+                    delete evaluation_rnns[i];
+                }
                 best_parameters = parameters;
                 this->best_validation_mse = NAN;
                 this->best_validation_mae = NAN;
@@ -1108,16 +1182,23 @@ void RNN_Genome::backpropagate_stochastic(
             }
 
             avg_norm += norm;
-            weight_update_method->norm_gradients(analytic_gradient, norm);
-            weight_update_method->update_weights(parameters, velocity, prev_velocity, analytic_gradient, iteration);
         }
         this->set_weights(parameters);
-        double training_mse = get_mse(parameters, inputs, outputs);
-        validation_mse = get_mse(parameters, validation_inputs, validation_outputs);
+
+        // only evaluate every validation_frequency epochs, but always evaluate the final weights
+        if ((iteration + 1) % validation_frequency != 0 && iteration != bp_iterations - 1) {
+            continue;
+        }
+
+        get_errors(evaluation_rnns, parameters, inputs, outputs, false, training_mse, training_mae, training_softmax);
+        get_errors(
+            evaluation_rnns, parameters, validation_inputs, validation_outputs, false, validation_mse, validation_mae,
+            validation_softmax
+        );
 
         if (validation_mse < best_validation_mse) {
             best_validation_mse = validation_mse;
-            best_validation_mae = get_mae(parameters, validation_inputs, validation_outputs);
+            best_validation_mae = validation_mae;
             best_parameters = parameters;
         }
         if (output_log != NULL) {
@@ -1131,13 +1212,333 @@ void RNN_Genome::backpropagate_stochastic(
             training_mse, validation_mse, best_validation_mse, avg_norm
         );
     }
+    for (int32_t i = 0; i < (int32_t) evaluation_rnns.size(); i++) {
+        delete evaluation_rnns[i];
+    }
+    this->set_weights(best_parameters);
+    Log::info("backpropagation completed, getting mu/sigma\n");
+    double _mu, _sigma;
+    get_mu_sigma(best_parameters, _mu, _sigma);
+}
+
+double get_perplexity(
+    RNN* rnn, const vector<double>& parameters, const vector<vector<int32_t> >& inputs,
+    const vector<vector<int32_t> >& outputs, bool use_dropout, double dropout_probability
+) {
+    rnn->set_weights(parameters);
+
+    double cross_entropy_sum = 0.0;
+    int64_t number_tokens = 0;
+    for (int32_t i = 0; i < (int32_t) inputs.size(); i++) {
+        rnn->forward_pass(inputs[i], use_dropout, false, dropout_probability);
+        cross_entropy_sum += rnn->calculate_error_softmax(outputs[i]);
+        number_tokens += outputs[i].size();
+    }
+
+    return exp(cross_entropy_sum / number_tokens);
+}
+
+double RNN_Genome::get_perplexity(
+    const vector<double>& parameters, const vector<vector<int32_t> >& inputs, const vector<vector<int32_t> >& outputs
+) {
+    RNN* rnn = get_rnn();
+    double perplexity = ::get_perplexity(rnn, parameters, inputs, outputs, use_dropout, dropout_probability);
+    delete rnn;
+
+    return perplexity;
+}
+
+void RNN_Genome::backpropagate_stochastic(
+    const vector<vector<int32_t> >& inputs, const vector<vector<int32_t> >& outputs,
+    const vector<vector<int32_t> >& validation_inputs, const vector<vector<int32_t> >& validation_outputs,
+    WeightUpdate* weight_update_method, int32_t softmax_samples
+) {
+    int32_t n_parameters = this->get_number_weights();
+    int32_t n_series = (int32_t) inputs.size();
+
+    vector<double> parameters = initial_parameters;
+    vector<double> velocity(n_parameters, 0.0);
+    vector<double> prev_velocity(n_parameters, 0.0);
+    vector<double> analytic_gradient(n_parameters, 0.0);
+
+    double norm = 0.0;
+    RNN* rnn = get_rnn();
+
+    std::chrono::time_point<std::chrono::system_clock> startClock = std::chrono::system_clock::now();
+
+    double validation_perplexity =
+        ::get_perplexity(rnn, parameters, validation_inputs, validation_outputs, use_dropout, dropout_probability);
+    best_validation_mse = validation_perplexity;
+    best_validation_mae = log(validation_perplexity);
+    best_parameters = parameters;
+
+    Log::info("initial validation perplexity: %lf\n", validation_perplexity);
+
+    ofstream* output_log = create_log_file();
+
+    vector<int32_t> shuffle_order;
+    for (int32_t i = 0; i < n_series; i++) {
+        shuffle_order.push_back(i);
+    }
+
+    for (int32_t iteration = 0; iteration < bp_iterations; iteration++) {
+        fisher_yates_shuffle(generator, shuffle_order);
+        double avg_norm = 0.0;
+        double training_cross_entropy = 0.0;
+        for (int32_t k = 0; k < (int32_t) shuffle_order.size(); k++) {
+            int32_t random_selection = shuffle_order[k];
+            training_cross_entropy += rnn->get_softmax_gradient(
+                parameters, inputs[random_selection], outputs[random_selection], softmax_samples, generator,
+                analytic_gradient, use_dropout, true, dropout_probability
+            );
+
+            norm = weight_update_method->norm_and_update_weights(
+                parameters, velocity, prev_velocity, analytic_gradient, iteration
+            );
+
+            if (isnan(norm) || isinf(norm)) {
+                delete rnn;
+                best_parameters = parameters;
+                this->best_validation_mse = NAN;
+                this->best_validation_mae = NAN;
+                return;
+            }
+
+            avg_norm += norm;
+        }
+        this->set_weights(parameters);
+
+        if ((iteration + 1) % validation_frequency != 0 && iteration != bp_iterations - 1) {
+            continue;
+        }
+
+        // the training perplexity is only an estimate when the softmax is sampled
+        double training_perplexity = exp(training_cross_entropy / n_series);
+        validation_perplexity =
+            ::get_perplexity(rnn, parameters, validation_inputs, validation_outputs, use_dropout, dropout_probability);
+
+        if (validation_perplexity < best_validation_mse) {
+            best_validation_mse = validation_perplexity;
+            best_validation_mae = log(validation_perplexity);
+            best_parameters = parameters;
+        }
+        if (output_log != NULL) {
+            std::chrono::time_point<std::chrono::system_clock> currentClock = std::chrono::system_clock::now();
+            long milliseconds =
+                std::chrono::duration_cast<std::chrono::milliseconds>(currentClock - startClock).count();
+            update_log_file(output_log, iteration, milliseconds, training_perplexity, validation_perplexity, avg_norm);
+        }
+        Log::info(
+            "iteration %4d, perplexity: %5.10lf, v_perplexity: %5.10lf, bv_perplexity: %5.10lf, avg_norm: %5.10lf\n",
+            iteration, training_perplexity, validation_perplexity, best_validation_mse, avg_norm
+        );
+    }
     delete rnn;
+
     this->set_weights(best_parameters);
     Log::info("backpropagation completed, getting mu/sigma\n");
     double _mu, _sigma;
     get_mu_sigma(best_parameters, _mu, _sigma);
 }
 
+void batch_gradient_thread(
+    RNN* rnn, const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
+    const vector<vector<vector<double> > >& outputs, const vector<int32_t>& batch, int32_t first, int32_t step,
+    bool use_dropout, double dropout_probability, vector<double>& gradient_sum, double& mse_sum
+) {
+    vector<double> gradient;
+    double mse;
+
+    gradient_sum.assign(parameters.size(), 0.0);
+    mse_sum = 0.0;
+    for (int32_t k = first; k < (int32_t) batch.size(); k += step) {
+        int32_t series = batch[k];
+        rnn->get_analytic_gradient(
+            parameters, inputs[series], outputs[series], mse, gradient, use_dropout, true, dropout_probability
+        );
+
+        for (int32_t i = 0; i < (int32_t) gradient.size(); i++) {
+            gradient_sum[i] += gradient[i];
+        }
+        mse_sum += mse;
+    }
+}
+
+void RNN_Genome::get_batch_gradient(
+    vector<RNN*>& rnns, const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
+    const vector<vector<vector<double> > >& outputs, const vector<int32_t>& batch, double& mse,
+    vector<double>& batch_gradient
+) {
+    int32_t n_threads = std::min((int32_t) rnns.size(), (int32_t) batch.size());
+
+    vector<vector<double> > thread_gradients(n_threads);
+    vector<double> thread_mses(n_threads, 0.0);
+
+    if (n_threads <= 1) {
+        batch_gradient_thread(
+            rnns[0], parameters, inputs, outputs, batch, 0, 1, use_dropout, dropout_probability, thread_gradients[0],
+            thread_mses[0]
+        );
+    } else {
+        // the nodes log at the trace level, so each thread gets an id derived from the calling thread's
+        string log_id = Log::get_id();
+        vector<thread> threads;
+        for (int32_t i = 0; i < n_threads; i++) {
+            threads.push_back(thread([&, i]() {
+                string thread_log_id = log_id + "_batch_" + to_string(i);
+                Log::set_id(thread_log_id);
+                batch_gradient_thread(
+                    rnns[i], parameters, inputs, outputs, batch, i, n_threads, use_dropout, dropout_probability,
+                    thread_gradients[i], thread_mses[i]
+                );
+                Log::release_id(thread_log_id);
+            }));
+        }
+
+        for (int32_t i = 0; i < n_threads; i++) {
+            threads[i].join();
+        }
+    }
+
+    batch_gradient.swap(thread_gradients[0]);
+    mse = thread_mses[0];
+    for (int32_t t = 1; t < n_threads; t++) {
+        for (int32_t i = 0; i < (int32_t) batch_gradient.size(); i++) {
+            batch_gradient[i] += thread_gradients[t][i];
+        }
+        mse += thread_mses[t];
+    }
+}
+
+void RNN_Genome::backpropagate_minibatch(
+    const vector<vector<vector<double> > >& inputs, const vector<vector<vector<double> > >& outputs,
+    const vector<vector<vector<double> > >& validation_inputs,
+    const vector<vector<vector<double> > >& validation_outputs, WeightUpdate* weight_update_method
+) {
+    int32_t n_parameters = this->get_number_weights();
+    int32_t n_series = (int32_t) inputs.size();
+
+    vector<double> parameters = initial_parameters;
+    vector<double> velocity(n_parameters, 0.0);
+    vector<double> prev_velocity(n_parameters, 0.0);
+    vector<double> batch_gradient(n_parameters, 0.0);
+
+    double mse;
+    double norm = 0.0;
+
+    // the same RNNs are used for the batch gradients and for evaluation
+    vector<RNN*> rnns;
+    for (int32_t i = 0; i < std::max(training_threads, evaluation_threads); i++) {
+        rnns.push_back(get_rnn());
+    }
+    vector<RNN*> training_rnns(rnns.begin(), rnns.begin() + training_threads);
+    vector<RNN*> evaluation_rnns(rnns.begin(), rnns.begin() + evaluation_threads);
+
+    std::chrono::time_point<std::chrono::system_clock> startClock = std::chrono::system_clock::now();
+
+    double training_mse, training_mae, training_softmax;
+    double validation_mse, validation_mae, validation_softmax;
+    get_errors(
+        evaluation_rnns, parameters, validation_inputs, validation_outputs, false, validation_mse, validation_mae,
+        validation_softmax
+    );
+    best_validation_mse = validation_mse;
+    best_validation_mae = validation_mae;
+    best_parameters = parameters;
+
+    Log::info(
+        "initial validation_mse: %lf, batch size: %d, training threads: %d\n", validation_mse, batch_size,
+        training_threads
+    );
+
+    ofstream* output_log = create_log_file();
+
+    vector<int32_t> shuffle_order;
+    for (int32_t i = 0; i < n_series; i++) {
+        shuffle_order.push_back(i);
+    }
+    vector<int32_t> batch;
+
+    bool gradients_failed = false;
+    for (int32_t iteration = 0; iteration < bp_iterations && !gradients_failed; iteration++) {
+        fisher_yates_shuffle(generator, shuffle_order);
+        double avg_norm = 0.0;
+
+        for (int32_t start = 0; start < n_series; start += batch_size) {
+            int32_t end = std::min(start + batch_size, n_series);
+            batch.assign(shuffle_order.begin() + start, shuffle_order.begin() + end);
+
+            get_batch_gradient(training_rnns, parameters, inputs, outputs, batch, mse, batch_gradient);
+
+            double batch_multiplier = 1.0 / batch.size();
+            for (int32_t i = 0; i < n_parameters; i++) {
+                batch_gradient[i] *= batch_multiplier;
+            }
+
+            norm = weight_update_method->norm_and_update_weights(
+                parameters, velocity, prev_velocity, batch_gradient, iteration
+            );
+
+            if (isnan(norm) || isinf(norm)) {
+                // same as stochastic backprop, a genome with NaN gradients is a genetic dead end
+                gradients_failed = true;
+                break;
+            }
+            avg_norm += norm;
+        }
+
+        if (gradients_failed) {
+            break;
+        }
+
+        this->set_weights(parameters);
+
+        // only evaluate every validation_frequency epochs, but always evaluate the final weights
+        if ((iteration + 1) % validation_frequency != 0 && iteration != bp_iterations - 1) {
+            continue;
+        }
+
+        get_errors(evaluation_rnns, parameters, inputs, outputs, false, training_mse, training_mae, training_softmax);
+        get_errors(
+            evaluation_rnns, parameters, validation_inputs, validation_outputs, false, validation_mse, validation_mae,
+            validation_softmax
+        );
+
+        if (validation_mse < best_validation_mse) {
+            best_validation_mse = validation_mse;
+            best_validation_mae = validation_mae;
+            best_parameters = parameters;
+        }
+        if (output_log != NULL) {
+            std::chrono::time_point<std::chrono::system_clock> currentClock = std::chrono::system_clock::now();
+            long milliseconds =
+                std::chrono::duration_cast<std::chrono::milliseconds>(currentClock - startClock).count();
+            update_log_file(output_log, iteration, milliseconds, training_mse, validation_mse, avg_norm);
+        }
+        Log::info(
+            "iteration %4d, mse: %5.10lf, v_mse: %5.10lf, bv_mse: %5.10lf, avg_norm: %5.10lf, lr: %lf\n", iteration,
+            training_mse, validation_mse, best_validation_mse, avg_norm,
+            weight_update_method->get_learning_rate(iteration)
+        );
+    }
+
+    for (int32_t i = 0; i < (int32_t) rnns.size(); i++) {
+        delete rnns[i];
+    }
+
+    if (gradients_failed) {
+        best_parameters = parameters;
+        this->best_validation_mse = NAN;
+        this->best_validation_mae = NAN;
+        return;
+    }
+
+    this->set_weights(best_parameters);
+    Log::info("mini-batch backpropagation completed, getting mu/sigma\n");
+    double _mu, _sigma;
+    get_mu_sigma(best_parameters, _mu, _sigma);
+}
+
 ofstream* RNN_Genome::create_log_file() {
     ofstream* output_log = NULL;
     if (log_filename != "") {
@@ -1176,6 +1577,74 @@ void RNN_Genome::update_log_file(
                   << best_validation_mse << "," << best_validation_mae << "," << avg_norm << endl;
 }
 
+void evaluate_series_thread(
+    RNN* rnn, const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
+    const vector<vector<vector<double> > >& outputs, int32_t first_series, int32_t series_step, bool use_softmax,
+    bool use_dropout, double dropout_probability, double* mses, double* maes, double* softmaxes
+) {
+    rnn->set_weights(parameters);
+    for (int32_t i = first_series; i < (int32_t) inputs.size(); i += series_step) {
+        rnn->prediction_errors(
+            inputs[i], outputs[i], use_dropout, dropout_probability, use_softmax, mses[i], maes[i], softmaxes[i]
+        );
+    }
+}
+
+void RNN_Genome::get_errors(
+    vector<RNN*>& rnns, const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
+    const vector<vector<vector<double> > >& outputs, bool use_softmax, double& mse, double& mae, double& softmax
+) {
+    int32_t n_series = (int32_t) inputs.size();
+    int32_t n_threads = std::min((int32_t) rnns.size(), n_series);
+
+    vector<double> mses(n_series, 0.0);
+    vector<double> maes(n_series, 0.0);
+    vector<double> softmaxes(n_series, 0.0);
+
+    if (n_threads <= 1) {
+        evaluate_series_thread(
+            rnns[0], parameters, inputs, outputs, 0, 1, use_softmax, use_dropout, dropout_probability, mses.data(),
+            maes.data(), softmaxes.data()
+        );
+    } else {
+        // the nodes log at the trace level, so each thread gets an id derived from the calling thread's
+        string log_id = Log::get_id();
+        vector<thread> threads;
+        for (int32_t i = 0; i < n_threads; i++) {
+            threads.push_back(thread([&, i]() {
+                string thread_log_id = log_id + "_evaluation_" + to_string(i);
+                Log::set_id(thread_log_id);
+                evaluate_series_thread(
+                    rnns[i], parameters, inputs, outputs, i, n_threads, use_softmax, use_dropout, dropout_probability,
+                    mses.data(), maes.data(), softmaxes.data()
+                );
+                Log::release_id(thread_log_id);
+            }));
+        }
+
+        for (int32_t i = 0; i < n_threads; i++) {
+            threads[i].join();
+        }
+    }
+
+    // sum in series order so the result does not depend on the number of threads, and log the per series errors
+    // in that order as well
+    mse = 0.0;
+    mae = 0.0;
+    softmax = 0.0;
+    for (int32_t i = 0; i < n_series; i++) {
+        Log::trace("series[%5d]: MSE: %5.10lf, MAE: %5.10lf\n", i, mses[i], maes[i]);
+        mse += mses[i];
+        mae += maes[i];
+        softmax += softmaxes[i];
+    }
+    mse /= n_series;
+    mae /= n_series;
+    softmax /= n_series;
+
+    Log::trace("average MSE: %5.10lf, average MAE: %5.10lf\n", mse, mae);
+}
+
 double RNN_Genome::get_softmax(
     const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
     const vector<vector<vector<double> > >& outputs
@@ -1275,29 +1744,71 @@ void RNN_Genome::write_predictions(
     const vector<vector<vector<double> > >& inputs, const vector<vector<vector<double> > >& outputs,
     TimeSeriesSets* time_series_sets
 ) {
-    RNN* rnn = get_rnn();
-    rnn->set_weights(parameters);
+    write_predictions(output_directory, input_filenames, parameters, inputs, outputs, time_series_sets, false, 1);
+}
 
-    for (int32_t i = 0; i < (int32_t) inputs.size(); i++) {
-        string filename = input_filenames[i];
-        Log::info("input filename[%5d]: '%s'\n", i, filename.c_str());
+void RNN_Genome::write_predictions(
+    string output_directory, const vector<string>& input_filenames, const vector<double>& parameters,
+    const vector<vector<vector<double> > >& inputs, const vector<vector<vector<double> > >& outputs,
+    TimeSeriesSets* time_series_sets, bool binary, int32_t number_threads
+) {
+    PredictionWriter writer(input_parameter_names, output_parameter_names, time_series_sets);
 
-        int32_t last_dot_pos = filename.find_last_of(".");
-        string extension = filename.substr(last_dot_pos);
-        string prefix = filename.substr(0, last_dot_pos);
+    if (number_threads > (int32_t) inputs.size()) {
+        number_threads = inputs.size();
+    }
+    if (number_threads < 1) {
+        number_threads = 1;
+    }
 
-        string output_filename = prefix + "_predictions" + extension;
-        output_filename = output_directory + "/" + output_filename.substr(output_filename.find_last_of("/") + 1);
+    atomic<int32_t> next_file(0);
 
-        Log::info("output filename: '%s'\n", output_filename.c_str());
+    // each thread needs its own copy of the RNN as the forward pass stores its values in the nodes
+    auto write_files = [&]() {
+        RNN* rnn = get_rnn();
+        rnn->set_weights(parameters);
 
-        rnn->write_predictions(
-            output_filename, input_parameter_names, output_parameter_names, inputs[i], outputs[i], time_series_sets,
-            use_dropout, dropout_probability
-        );
+        for (int32_t i = next_file++; i < (int32_t) inputs.size(); i = next_file++) {
+            string filename = input_filenames[i];
+
+            int32_t last_dot_pos = filename.find_last_of(".");
+            string extension = binary ? ".bin" : filename.substr(last_dot_pos);
+            string prefix = filename.substr(0, last_dot_pos);
+
+            string output_filename = prefix + "_predictions" + extension;
+            output_filename = output_directory + "/" + output_filename.substr(output_filename.find_last_of("/") + 1);
+
+            rnn->write_predictions(
+                output_filename, inputs[i], outputs[i], writer, binary, use_dropout, dropout_probability
+            );
+        }
+
+        delete rnn;
+    };
+
+    for (int32_t i = 0; i < (int32_t) inputs.size(); i++) {
+        Log::info("input filename[%5d]: '%s'\n", i, input_filenames[i].c_str());
     }
 
-    delete rnn;
+    if (number_threads == 1) {
+        write_files();
+        return;
+    }
+
+    // the worker threads need their own log ids, as the RNN constructor and the writers log
+    auto write_files_thread = [&](int32_t thread_number) {
+        Log::set_id("prediction_writer_" + to_string(thread_number));
+        write_files();
+        Log::release_id("prediction_writer_" + to_string(thread_number));
+    };
+
+    vector<thread> threads;
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads.push_back(thread(write_files_thread, i));
+    }
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads[i].join();
+    }
 }
 
 // void RNN_Genome::write_predictions(string output_directory, const vector<string> &input_filenames, const
@@ -1405,6 +1916,26 @@ void RNN_Genome::assign_reachability() {
         recurrent_edges[i]->backward_reachable = false;
     }
 
+    // index the enabled edges by the nodes they go out of and into (in the same order as the edge vectors, so the
+    // nodes are visited in the same order as scanning the vectors), instead of scanning every edge for every node
+    unordered_map<int32_t, vector<RNN_Edge*> > outgoing_edges;
+    unordered_map<int32_t, vector<RNN_Edge*> > incoming_edges;
+    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+        if (edges[i]->enabled) {
+            outgoing_edges[edges[i]->input_innovation_number].push_back(edges[i]);
+            incoming_edges[edges[i]->output_innovation_number].push_back(edges[i]);
+        }
+    }
+
+    unordered_map<int32_t, vector<RNN_Recurrent_Edge*> > outgoing_recurrent_edges;
+    unordered_map<int32_t, vector<RNN_Recurrent_Edge*> > incoming_recurrent_edges;
+    for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
+        if (recurrent_edges[i]->enabled) {
+            outgoing_recurrent_edges[recurrent_edges[i]->input_innovation_number].push_back(recurrent_edges[i]);
+            incoming_recurrent_edges[recurrent_edges[i]->output_innovation_number].push_back(recurrent_edges[i]);
+        }
+    }
+
     // do forward reachability
     vector<RNN_Node_Interface*> nodes_to_visit;
     for (int32_t i = 0; i < (int32_t) nodes.size(); i++) {
@@ -1422,42 +1953,43 @@ void RNN_Genome::assign_reachability() {
             continue;
         }
 
-        for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
-            if (edges[i]->input_innovation_number == current->innovation_number && edges[i]->enabled) {
+        auto found = outgoing_edges.find(current->innovation_number);
+        if (found != outgoing_edges.end()) {
+            for (RNN_Edge* edge : found->second) {
                 // this is an edge coming out of this node
 
-                if (edges[i]->output_node->enabled) {
-                    edges[i]->forward_reachable = true;
+                if (edge->output_node->enabled) {
+                    edge->forward_reachable = true;
 
-                    if (edges[i]->output_node->forward_reachable == false) {
-                        if (edges[i]->output_node->innovation_number == edges[i]->input_node->innovation_number) {
+                    if (edge->output_node->forward_reachable == false) {
+                        if (edge->output_node->innovation_number == edge->input_node->innovation_number) {
                             Log::fatal("ERROR, forward edge was circular -- this should never happen");
                             exit(1);
                         }
-                        edges[i]->output_node->forward_reachable = true;
-                        nodes_to_visit.push_back(edges[i]->output_node);
+                        edge->output_node->forward_reachable = true;
+                        nodes_to_visit.push_back(edge->output_node);
                     }
                 }
             }
         }
 
-        for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
-            if (recurrent_edges[i]->forward_reachable) {
-                continue;
-            }
+        auto found_recurrent = outgoing_recurrent_edges.find(current->innovation_number);
+        if (found_recurrent != outgoing_recurrent_edges.end()) {
+            for (RNN_Recurrent_Edge* recurrent_edge : found_recurrent->second) {
+                if (recurrent_edge->forward_reachable) {
+                    continue;
+                }
 
-            if (recurrent_edges[i]->input_innovation_number == current->innovation_number
-                && recurrent_edges[i]->enabled) {
                 // this is an recurrent_edge coming out of this node
 
-                if (recurrent_edges[i]->output_node->enabled) {
-                    recurrent_edges[i]->forward_reachable = true;
+                if (recurrent_edge->output_node->enabled) {
+                    recurrent_edge->forward_reachable = true;
 
-                    if (recurrent_edges[i]->output_node->forward_reachable == false) {
-                        recurrent_edges[i]->output_node->forward_reachable = true;
+                    if (recurrent_edge->output_node->forward_reachable == false) {
+                        recurrent_edge->output_node->forward_reachable = true;
 
                         // handle the edge case when a recurrent edge loops back on itself
-                        nodes_to_visit.push_back(recurrent_edges[i]->output_node);
+                        nodes_to_visit.push_back(recurrent_edge->output_node);
                     }
                 }
             }
@@ -1481,30 +2013,31 @@ void RNN_Genome::assign_reachability() {
             continue;
         }
 
-        for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
-            if (edges[i]->output_innovation_number == current->innovation_number && edges[i]->enabled) {
-                // this is an edge coming out of this node
+        auto found = incoming_edges.find(current->innovation_number);
+        if (found != incoming_edges.end()) {
+            for (RNN_Edge* edge : found->second) {
+                // this is an edge coming into this node
 
-                if (edges[i]->input_node->enabled) {
-                    edges[i]->backward_reachable = true;
-                    if (edges[i]->input_node->backward_reachable == false) {
-                        edges[i]->input_node->backward_reachable = true;
-                        nodes_to_visit.push_back(edges[i]->input_node);
+                if (edge->input_node->enabled) {
+                    edge->backward_reachable = true;
+                    if (edge->input_node->backward_reachable == false) {
+                        edge->input_node->backward_reachable = true;
+                        nodes_to_visit.push_back(edge->input_node);
                     }
                 }
             }
         }
 
-        for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
-            if (recurrent_edges[i]->output_innovation_number == current->innovation_number
-                && recurrent_edges[i]->enabled) {
-                // this is an recurrent_edge coming out of this node
+        auto found_recurrent = incoming_recurrent_edges.find(current->innovation_number);
+        if (found_recurrent != incoming_recurrent_edges.end()) {
+            for (RNN_Recurrent_Edge* recurrent_edge : found_recurrent->second) {
+                // this is an recurrent_edge coming into this node
 
-                if (recurrent_edges[i]->input_node->enabled) {
-                    recurrent_edges[i]->backward_reachable = true;
-                    if (recurrent_edges[i]->input_node->backward_reachable == false) {
-                        recurrent_edges[i]->input_node->backward_reachable = true;
-                        nodes_to_visit.push_back(recurrent_edges[i]->input_node);
+                if (recurrent_edge->input_node->enabled) {
+                    recurrent_edge->backward_reachable = true;
+                    if (recurrent_edge->input_node->backward_reachable == false) {
+                        recurrent_edge->input_node->backward_reachable = true;
+                        nodes_to_visit.push_back(recurrent_edge->input_node);
                     }
                 }
             }
@@ -1761,6 +2294,7 @@ bool RNN_Genome::attempt_edge_insert(
         e->output_innovation_number, e->weight
     );
     edges.insert(upper_bound(edges.begin(), edges.end(), e, sort_RNN_Edges_by_depth()), e);
+    innovation_list.clear();
 
     return true;
 }
@@ -2374,6 +2908,7 @@ bool RNN_Genome::connect_node_to_hid_nodes(
                 e->output_innovation_number, e->weight
             );
             edges.insert(upper_bound(edges.begin(), edges.end(), e, sort_RNN_Edges_by_depth()), e);
+            innovation_list.clear();
 
             initial_parameters.push_back(e->weight);
             best_parameters.push_back(e->weight);
@@ -3277,6 +3812,12 @@ void RNN_Genome::read_from_stream(istream& bin_istream) {
     bin_istream.read((char*) &group_id, sizeof(int32_t));
     bin_istream.read((char*) &bp_iterations, sizeof(int32_t));
 
+    // these are runtime settings and are not part of the binary format
+    validation_frequency = 1;
+    evaluation_threads = 1;
+    batch_size = 1;
+    training_threads = 1;
+
     bin_istream.read((char*) &use_dropout, sizeof(bool));
     bin_istream.read((char*) &dropout_probability, sizeof(double));
 
@@ -3377,6 +3918,7 @@ void RNN_Genome::read_from_stream(istream& bin_istream) {
     Log::debug("reading %d edges.\n", n_edges);
 
     edges.clear();
+    innovation_list.clear();
     for (int32_t i = 0; i < n_edges; i++) {
         int32_t innovation_number;
         int32_t input_innovation_number;
@@ -3641,14 +4183,17 @@ void RNN_Genome::update_innovation_counts(int32_t& node_innovation_count, int32_
     edge_innovation_count = max_edge_innovation_count + 1;
 }
 // return sorted innovation list
-vector<int32_t> RNN_Genome::get_innovation_list() {
-    vector<int32_t> innovations;
-    for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
-        int32_t innovation = edges[i]->get_innovation_number();
-        auto it = std::upper_bound(innovations.begin(), innovations.end(), innovation);
-        innovations.insert(it, innovation);
+const vector<int32_t>& RNN_Genome::get_innovation_list() {
+    // the list is cleared whenever edges are added or removed, the size check catches any edge
+    // modification that does not go through those methods
+    if (innovation_list.size() != edges.size()) {
+        innovation_list.resize(edges.size());
+        for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+            innovation_list[i] = edges[i]->get_innovation_number();
+        }
+        sort(innovation_list.begin(), innovation_list.end());
     }
-    return innovations;
+    return innovation_list;
 }
 
 string RNN_Genome::get_structural_hash() const {
@@ -3700,29 +4245,26 @@ void RNN_Genome::transfer_to(
     int32_t node_innovation_count = get_max_node_innovation_count() + 1;
     int32_t edge_innovation_count = get_max_edge_innovation_count() + 1;
 
+    // take the input and output nodes out of the node vector for the time being (in reverse order, so if a parameter
+    // name is duplicated the last of its nodes is the one kept)
     vector<RNN_Node_Interface*> input_nodes;
     vector<RNN_Node_Interface*> output_nodes;
-
-    // work backwards so we don't skip removing anything
     for (int32_t i = (int32_t) nodes.size() - 1; i >= 0; i--) {
-        Log::info("checking node: %d\n", i);
-
-        // add all the input and output nodes to the input_nodes and output_nodes vectors,
-        // and remove them from the node vector for the time being
-        RNN_Node_Interface* node = nodes[i];
-        if (node->layer_type == INPUT_LAYER) {
-            input_nodes.push_back(node);
-            Log::info("erasing node: %d of %d\n", i, nodes.size());
-            nodes.erase(nodes.begin() + i);
-            Log::info("input node with parameter name: '%s'\n", node->parameter_name.c_str());
-
-        } else if (node->layer_type == OUTPUT_LAYER) {
-            output_nodes.push_back(node);
-            Log::info("erasing node: %d of %d\n", i, nodes.size());
-            nodes.erase(nodes.begin() + i);
-            Log::info("output node with parameter name: '%s'\n", node->parameter_name.c_str());
+        if (nodes[i]->layer_type == INPUT_LAYER) {
+            input_nodes.push_back(nodes[i]);
+        } else if (nodes[i]->layer_type == OUTPUT_LAYER) {
+            output_nodes.push_back(nodes[i]);
         }
     }
+    nodes.erase(
+        remove_if(
+            nodes.begin(), nodes.end(),
+            [](RNN_Node_Interface* node) {
+                return node->layer_type == INPUT_LAYER || node->layer_type == OUTPUT_LAYER;
+            }
+        ),
+        nodes.end()
+    );
 
     Log::info("original input parameter names:\n");
     for (int32_t i = 0; i < (int32_t) input_parameter_names.size(); i++) {
@@ -3736,89 +4278,6 @@ void RNN_Genome::transfer_to(
     }
     Log::info_no_header("\n");
 
-    // first figure out which input nodes we're keeping, and add new input
-    // nodes as needed
-    vector<RNN_Node_Interface*> new_input_nodes;
-    vector<bool> new_inputs;  // this will track if new input node was new (true) or added from the genome (false)
-
-    for (int32_t i = 0; i < (int32_t) new_input_parameter_names.size(); i++) {
-        int32_t parameter_position = -1;
-        // iterate through the input parameter names to find the input
-        // node related to this new input paramter name, if it is
-        // not found we need to make a new node for it
-        for (int32_t j = 0; j < (int32_t) input_nodes.size(); j++) {
-            if (input_nodes[j]->parameter_name.compare(new_input_parameter_names[i]) == 0) {
-                parameter_position = j;
-                break;
-            }
-        }
-
-        if (parameter_position >= 0) {
-            Log::info("keeping input node for parameter '%s'\n", new_input_parameter_names[i].c_str());
-            // this input node already existed in the genome
-            new_input_nodes.push_back(input_nodes[parameter_position]);
-            new_inputs.push_back(false);
-
-            // erase this parameter from the input nodes and input parameter names so we don't
-            // re-use it
-            input_nodes.erase(input_nodes.begin() + parameter_position);
-        } else {
-            Log::info("creating new input node for parameter '%s'\n", new_input_parameter_names[i].c_str());
-            // create a new input node for this parameter
-            new_inputs.push_back(true);
-            RNN_Node* node = new RNN_Node(
-                ++node_innovation_count, INPUT_LAYER, 0.0 /*input nodes should be depth 0*/, SIMPLE_NODE,
-                new_input_parameter_names[i]
-            );
-            new_input_nodes.push_back(node);
-        }
-    }
-
-    Log::info("new input node parameter names (should be the same as new input parameter names):\n");
-    for (int32_t i = 0; i < (int32_t) new_input_nodes.size(); i++) {
-        Log::info("\t%s (new: %s)\n", new_input_nodes[i]->parameter_name.c_str(), new_inputs[i] ? "true" : "false");
-    }
-
-    // delete all the input nodes that were not kept in the transfer process
-    for (int32_t i = (int32_t) input_nodes.size() - 1; i >= 0; i--) {
-        Log::info(
-            "deleting outgoing edges for input node[%d] with parameter name: '%s' and innovation number %d\n", i,
-            input_nodes[i]->parameter_name.c_str(), input_nodes[i]->innovation_number
-        );
-
-        // first delete any outgoing edges from the input node to be deleted
-        for (int32_t j = (int32_t) edges.size() - 1; j >= 0; j--) {
-            if (edges[j]->input_innovation_number == input_nodes[i]->innovation_number) {
-                Log::info(
-                    "deleting edges[%d] with innovation number: %d and input_innovation_number %d\n", j,
-                    edges[j]->innovation_number, edges[j]->input_innovation_number
-                );
-                delete edges[j];
-                edges.erase(edges.begin() + j);
-            }
-        }
-
-        Log::info("deleting recurrent edges\n");
-
-        // do the same for any outgoing recurrent edges
-        for (int32_t j = (int32_t) recurrent_edges.size() - 1; j >= 0; j--) {
-            // recurrent edges shouldn't go into input nodes, but check to see if it has a connection either way to the
-            // node being deleted
-            if (recurrent_edges[j]->input_innovation_number == input_nodes[i]->innovation_number
-                || recurrent_edges[j]->output_innovation_number == input_nodes[i]->innovation_number) {
-                Log::info(
-                    "deleting recurrent_edges[%d] with innovation number: %d and input_innovation_number %d\n", j,
-                    recurrent_edges[j]->innovation_number, recurrent_edges[j]->input_innovation_number
-                );
-                delete recurrent_edges[j];
-                recurrent_edges.erase(recurrent_edges.begin() + j);
-            }
-        }
-
-        delete input_nodes[i];
-        input_nodes.erase(input_nodes.begin() + i);
-    }
-
     Log::info("original output parameter names:\n");
     for (int32_t i = 0; i < (int32_t) output_parameter_names.size(); i++) {
         Log::info_no_header(" %s", output_parameter_names[i].c_str());
@@ -3831,95 +4290,102 @@ void RNN_Genome::transfer_to(
     }
     Log::info_no_header("\n");
 
-    // first figure out which output nodes we're keeping, and add new output
-    // nodes as needed
-    vector<RNN_Node_Interface*> new_output_nodes;
-    vector<bool> new_outputs;  // this will track if new output node was new (true) or added from the genome (false)
-
-    for (int32_t i = 0; i < (int32_t) new_output_parameter_names.size(); i++) {
-        Log::info("finding output node with parameter name: '%s\n", new_output_parameter_names[i].c_str());
+    vector<RNN_Node_Interface*> removed_nodes;
+    unordered_set<int32_t> removed_innovation_numbers;
 
-        int32_t parameter_position = -1;
-        // iterate through the output parameter names to find the output
-        // node related to this new output paramter name, if it is
-        // not found we need to make a new node for it
-        for (int32_t j = 0; j < (int32_t) output_nodes.size(); j++) {
-            Log::info(
-                "\tchecking output_nodes[%d]->parameter_name: '%s'\n", j, output_nodes[j]->parameter_name.c_str()
-            );
-            if (output_nodes[j]->parameter_name.compare(new_output_parameter_names[i]) == 0) {
-                Log::info("\t\tMATCH!\n");
-                parameter_position = j;
-                break;
-            }
+    // keeps the existing node for each new parameter name which the genome already has and creates a node for each
+    // one it does not, any of the existing nodes which are not kept are added to the removed nodes
+    auto match_nodes = [&](vector<RNN_Node_Interface*>& existing_nodes, const vector<string>& new_parameter_names,
+                           int32_t layer_type, double depth, vector<RNN_Node_Interface*>& new_nodes,
+                           vector<bool>& created) {
+        // the nodes for each name are stored last to first, so the back is the first one in existing_nodes
+        unordered_map<string, vector<RNN_Node_Interface*> > nodes_by_name;
+        for (int32_t i = (int32_t) existing_nodes.size() - 1; i >= 0; i--) {
+            nodes_by_name[existing_nodes[i]->parameter_name].push_back(existing_nodes[i]);
         }
 
-        if (parameter_position >= 0) {
-            Log::info("keeping output node for parameter '%s'\n", new_output_parameter_names[i].c_str());
-            // this output node already existed in the genome
-            new_output_nodes.push_back(output_nodes[parameter_position]);
-            new_outputs.push_back(false);
+        for (int32_t i = 0; i < (int32_t) new_parameter_names.size(); i++) {
+            auto found = nodes_by_name.find(new_parameter_names[i]);
 
-            // erase this parameter from the output nodes and output parameter names so we don't
-            // re-use it
-            output_nodes.erase(output_nodes.begin() + parameter_position);
-        } else {
-            Log::info("creating new output node for parameter '%s'\n", new_output_parameter_names[i].c_str());
-            // create a new output node for this parameter
-            new_outputs.push_back(true);
-            RNN_Node* node = new RNN_Node(
-                ++node_innovation_count, OUTPUT_LAYER, 1.0 /*output nodes should be depth 1*/, SIMPLE_NODE,
-                new_output_parameter_names[i]
-            );
-            new_output_nodes.push_back(node);
+            if (found != nodes_by_name.end() && found->second.size() > 0) {
+                Log::info("keeping node for parameter '%s'\n", new_parameter_names[i].c_str());
+                new_nodes.push_back(found->second.back());
+                created.push_back(false);
+                found->second.pop_back();
+            } else {
+                Log::info("creating new node for parameter '%s'\n", new_parameter_names[i].c_str());
+                new_nodes.push_back(
+                    new RNN_Node(++node_innovation_count, layer_type, depth, SIMPLE_NODE, new_parameter_names[i])
+                );
+                created.push_back(true);
+            }
         }
-    }
-
-    Log::info("new output node parameter names (should be the same as new output parameter names):\n");
-    for (int32_t i = 0; i < (int32_t) new_output_nodes.size(); i++) {
-        Log::info("\t%s (new: %s)\n", new_output_nodes[i]->parameter_name.c_str(), new_outputs[i] ? "true" : "false");
-    }
-
-    // delete all the output nodes that were not kept in the transfer process
-    for (int32_t i = (int32_t) output_nodes.size() - 1; i >= 0; i--) {
-        Log::info(
-            "deleting incoming edges for output node[%d] with parameter name: '%s' and innovation number %d\n", i,
-            output_nodes[i]->parameter_name.c_str(), output_nodes[i]->innovation_number
-        );
 
-        // first delete any incoming edges to the output node to be deleted
-        for (int32_t j = (int32_t) edges.size() - 1; j >= 0; j--) {
-            if (edges[j]->output_innovation_number == output_nodes[i]->innovation_number) {
+        for (auto i = nodes_by_name.begin(); i != nodes_by_name.end(); i++) {
+            for (RNN_Node_Interface* node : i->second) {
                 Log::info(
-                    "deleting edges[%d] with innovation number: %d and output_innovation_number %d\n", j,
-                    edges[j]->innovation_number, edges[j]->output_innovation_number
+                    "removing node with parameter name: '%s' and innovation number %d\n",
+                    node->parameter_name.c_str(), node->innovation_number
                 );
-                delete edges[j];
-                edges.erase(edges.begin() + j);
+                removed_nodes.push_back(node);
+                removed_innovation_numbers.insert(node->innovation_number);
             }
         }
+    };
 
-        Log::info("doing recurrent edges\n");
+    // new_inputs and new_outputs track if each node was new (true) or kept from the genome (false)
+    vector<RNN_Node_Interface*> new_input_nodes;
+    vector<bool> new_inputs;
+    match_nodes(
+        input_nodes, new_input_parameter_names, INPUT_LAYER, 0.0 /*input nodes should be depth 0*/, new_input_nodes,
+        new_inputs
+    );
 
-        // do the same for any outgoing recurrent edges
-        for (int32_t j = (int32_t) recurrent_edges.size() - 1; j >= 0; j--) {
-            // output nodes can be the input to a recurrent edge so we need to delete those recurrent edges too if the
-            // output node is being deleted
-            if (recurrent_edges[j]->output_innovation_number == output_nodes[i]->innovation_number
-                || recurrent_edges[j]->input_innovation_number == output_nodes[i]->innovation_number) {
-                Log::info(
-                    "deleting recurrent_edges[%d] with innovation number: %d and output_innovation_number %d\n", j,
-                    recurrent_edges[j]->innovation_number, recurrent_edges[j]->output_innovation_number
-                );
-                delete recurrent_edges[j];
-                recurrent_edges.erase(recurrent_edges.begin() + j);
+    vector<RNN_Node_Interface*> new_output_nodes;
+    vector<bool> new_outputs;
+    match_nodes(
+        output_nodes, new_output_parameter_names, OUTPUT_LAYER, 1.0 /*output nodes should be depth 1*/,
+        new_output_nodes, new_outputs
+    );
+
+    // delete every edge and recurrent edge connected to a removed node with a single pass over each vector, this keeps
+    // the order of the remaining edges. recurrent edges can go out of output nodes, so both ends are checked.
+    if (removed_innovation_numbers.size() > 0) {
+        auto is_removed = [&](int32_t innovation_number) {
+            return removed_innovation_numbers.count(innovation_number) > 0;
+        };
+
+        int32_t kept = 0;
+        for (int32_t i = 0; i < (int32_t) edges.size(); i++) {
+            if (is_removed(edges[i]->input_innovation_number) || is_removed(edges[i]->output_innovation_number)) {
+                Log::debug("deleting edge with innovation number: %d\n", edges[i]->innovation_number);
+                delete edges[i];
+            } else {
+                edges[kept++] = edges[i];
             }
         }
+        if (kept < (int32_t) edges.size()) {
+            edges.resize(kept);
+            innovation_list.clear();
+        }
 
-        Log::info("deleting output_nodes[%d]\n", i);
+        kept = 0;
+        for (int32_t i = 0; i < (int32_t) recurrent_edges.size(); i++) {
+            if (is_removed(recurrent_edges[i]->input_innovation_number)
+                || is_removed(recurrent_edges[i]->output_innovation_number)) {
+                Log::debug(
+                    "deleting recurrent edge with innovation number: %d\n", recurrent_edges[i]->innovation_number
+                );
+                delete recurrent_edges[i];
+            } else {
+                recurrent_edges[kept++] = recurrent_edges[i];
+            }
+        }
+        recurrent_edges.resize(kept);
 
-        delete output_nodes[i];
-        output_nodes.erase(output_nodes.begin() + i);
+        for (RNN_Node_Interface* node : removed_nodes) {
+            delete node;
+        }
     }
 
     /* TRANSFER LEARNING VERSIONS:
@@ -3946,6 +4412,7 @@ void RNN_Genome::transfer_to(
         exit(1);
     }
 
+    // attempt_edge_insert and attempt_recurrent_edge_insert keep the edges sorted, so they only need to be sorted once
     sort_edges_by_depth();
     sort_recurrent_edges_by_depth();
 
@@ -3978,9 +4445,6 @@ void RNN_Genome::transfer_to(
         }
     }
 
-    sort_edges_by_depth();
-    sort_recurrent_edges_by_depth();
-
     uniform_int_distribution<int32_t> rec_depth_dist(min_recurrent_depth, max_recurrent_depth);
     if (transfer_learning_version.compare("v2") == 0 || transfer_learning_version.compare("v1+v2") == 0) {
         Log::info("doing transfer v2\n");
@@ -4022,9 +4486,6 @@ void RNN_Genome::transfer_to(
     // need to recalculate the reachability of each node
     assign_reachability();
 
-    sort_edges_by_depth();
-    sort_recurrent_edges_by_depth();
-
     // need to make sure that each input and each output has at least one connection
     for (auto node : nodes) {
         Log::info(
@@ -4054,19 +4515,18 @@ void RNN_Genome::transfer_to(
 
     Log::info("new_parameters.size() before get weights: %d\n", initial_parameters.size());
 
-    // update the new and best parameter lengths because this will have added edges
-    vector<double> updated_genome_parameters;
-    get_weights(updated_genome_parameters);
+    // update the new and best parameter lengths because this will have added edges, the weights are gathered straight
+    // into the existing parameter vectors
+    get_weights(initial_parameters);
     if (!epigenetic_weights) {
         Log::info("resetting genome parameters to randomly betwen -0.5 and 0.5\n");
-        for (int32_t i = 0; i < (int32_t) updated_genome_parameters.size(); i++) {
-            updated_genome_parameters[i] = rng_0_1(generator) - 0.5;
+        for (int32_t i = 0; i < (int32_t) initial_parameters.size(); i++) {
+            initial_parameters[i] = rng_0_1(generator) - 0.5;
         }
     } else {
         Log::info("not resetting weights\n");
     }
-    set_initial_parameters(updated_genome_parameters);
-    set_best_parameters(updated_genome_parameters);
+    best_parameters.assign(initial_parameters.begin(), initial_parameters.end());
 
     best_validation_mse = EXAMM_MAX_DOUBLE;
     best_validation_mae = EXAMM_MAX_DOUBLE;
@@ -4075,7 +4535,7 @@ void RNN_Genome::transfer_to(
     Log::info("after transfer, mu: %lf, sigma: %lf\n", mu, sigma);
     // make sure we don't duplicate new node/edge innovation numbers
 
-    Log::info("new_parameters.size() after get weights: %d\n", updated_genome_parameters.size());
+    Log::info("new_parameters.size() after get weights: %d\n", initial_parameters.size());
 
     Log::info("FINISHING PREPARING INITIAL GENOME\n");
 }
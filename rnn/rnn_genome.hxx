@@ -43,6 +43,15 @@ class RNN_Genome {
 
     int32_t bp_iterations;
 
+    // how many epochs between validation set evaluations during backpropagation
+    int32_t validation_frequency;
+    // how many threads (and RNN copies) are used when evaluating a set of series
+    int32_t evaluation_threads;
+    // number of series per weight update, 1 is plain stochastic backpropagation
+    int32_t batch_size;
+    // how many threads (and RNN copies) calculate the gradients of a mini-batch
+    int32_t training_threads;
+
     bool use_dropout;
     double dropout_probability;
 
@@ -72,6 +81,9 @@ class RNN_Genome {
     vector<RNN_Edge*> edges;
     vector<RNN_Recurrent_Edge*> recurrent_edges;
 
+    // sorted edge innovation numbers, built by get_innovation_list and cleared whenever the edges change
+    vector<int32_t> innovation_list;
+
     vector<string> input_parameter_names;
     vector<string> output_parameter_names;
 
@@ -152,6 +164,15 @@ class RNN_Genome {
     void set_bp_iterations(int32_t _bp_iterations);
     int32_t get_bp_iterations();
 
+    void set_validation_frequency(int32_t _validation_frequency);
+    int32_t get_validation_frequency();
+    void set_evaluation_threads(int32_t _evaluation_threads);
+    int32_t get_evaluation_threads();
+    void set_batch_size(int32_t _batch_size);
+    int32_t get_batch_size();
+    void set_training_threads(int32_t _training_threads);
+    int32_t get_training_threads();
+
     // Turns on / off stochastic operations. If it is off, any stochastic values will be "frozen" in place.
     void set_stochastic(bool stochastic);
     void disable_dropout();
@@ -211,6 +232,57 @@ class RNN_Genome {
         const vector<vector<vector<double> > >& validation_outputs, WeightUpdate* weight_update_method
     );
 
+    /**
+     * Calculates the gradient summed over the given series of a mini-batch, splitting the series between
+     * the provided RNNs (one thread per RNN). The sum is reduced in RNN order so it is deterministic.
+     */
+    void get_batch_gradient(
+        vector<RNN*>& rnns, const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
+        const vector<vector<vector<double> > >& outputs, const vector<int32_t>& batch, double& mse,
+        vector<double>& batch_gradient
+    );
+
+    /**
+     * Mini-batch backpropagation: each epoch the series are shuffled and split into batches of batch_size
+     * series, and the weights are updated once per batch with the average gradient of the batch.
+     */
+    void backpropagate_minibatch(
+        const vector<vector<vector<double> > >& inputs, const vector<vector<vector<double> > >& outputs,
+        const vector<vector<vector<double> > >& validation_inputs,
+        const vector<vector<vector<double> > >& validation_outputs, WeightUpdate* weight_update_method
+    );
+
+    /**
+     * Trains a word level language model where the inputs and expected outputs are token indexes (see
+     * Corpus::export_training_token_series) to minimize the softmax cross entropy. With softmax_samples > 0 the
+     * gradients use a sampled softmax over the expected word and softmax_samples random other words, the validation
+     * perplexity is always exact. The validation perplexity is used as the validation mse (so it is the fitness), and
+     * the validation cross entropy per word as the validation mae.
+     */
+    void backpropagate_stochastic(
+        const vector<vector<int32_t> >& inputs, const vector<vector<int32_t> >& outputs,
+        const vector<vector<int32_t> >& validation_inputs, const vector<vector<int32_t> >& validation_outputs,
+        WeightUpdate* weight_update_method, int32_t softmax_samples
+    );
+
+    /**
+     * The exact perplexity, exp of the average softmax cross entropy per token, over all the token series.
+     */
+    double get_perplexity(
+        const vector<double>& parameters, const vector<vector<int32_t> >& inputs,
+        const vector<vector<int32_t> >& outputs
+    );
+
+    /**
+     * Calculates the average MSE, MAE and (optionally) softmax cross entropy over all the series with a
+     * single forward pass per series. The series are split between the provided RNNs, one thread per RNN,
+     * so the caller can reuse the same RNNs across calls instead of creating a new one each time.
+     */
+    void get_errors(
+        vector<RNN*>& rnns, const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
+        const vector<vector<vector<double> > >& outputs, bool use_softmax, double& mse, double& mae, double& softmax
+    );
+
     double get_softmax(
         const vector<double>& parameters, const vector<vector<vector<double> > >& inputs,
         const vector<vector<vector<double> > >& outputs
@@ -233,6 +305,16 @@ class RNN_Genome {
         const vector<vector<vector<double> > >& inputs, const vector<vector<vector<double> > >& outputs,
         TimeSeriesSets* time_series_sets
     );
+
+    /**
+     * Writes the predictions for each input file to <output_directory>/<input file>_predictions (with a .bin
+     * extension instead of the input file's if binary is true), with the files split between number_threads threads.
+     */
+    void write_predictions(
+        string output_directory, const vector<string>& input_filenames, const vector<double>& parameters,
+        const vector<vector<vector<double> > >& inputs, const vector<vector<vector<double> > >& outputs,
+        TimeSeriesSets* time_series_sets, bool binary, int32_t number_threads
+    );
     // void write_predictions(string output_directory, const vector<string> &input_filenames, const vector<double>
     // &parameters, const vector< vector< vector<double> > > &inputs, const vector< vector< vector<double> > > &outputs,
     // Corpus * word_series_sets);
@@ -332,7 +414,10 @@ class RNN_Genome {
 
     void update_innovation_counts(int32_t& node_innovation_count, int32_t& edge_innovation_count);
 
-    vector<int32_t> get_innovation_list();
+    /**
+     * \return the sorted innovation numbers of the edges, which are cached until the edges of the genome change.
+     */
+    const vector<int32_t>& get_innovation_list();
     /**
      * \return the structural hash (calculated when assign_reachaability is called)
      */
@@ -11,7 +11,7 @@ class RNN_Node : public RNN_Node_Interface {
     double bias;
     double d_bias;
 
-    vector<double> ld_output;
+    vector<rnn_value_t> ld_output;
 
    public:
     // constructor for hidden nodes
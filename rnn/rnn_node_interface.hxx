@@ -22,6 +22,16 @@ using std::vector;
 
 class RNN;
 
+// The type used to store the per time step values of the RNN (node inputs, outputs and errors, edge
+// outputs and deltas, and the gate values of the memory cells). Weights and gradients are always
+// accumulated as doubles. Configure with -DSINGLE_PRECISION=YES to store these as floats, which halves
+// the memory traffic of the forward and backward passes.
+#ifdef EXAMM_SINGLE_PRECISION
+typedef float rnn_value_t;
+#else
+typedef double rnn_value_t;
+#endif
+
 #define INPUT_LAYER  0
 #define HIDDEN_LAYER 1
 #define OUTPUT_LAYER 2
@@ -83,11 +93,11 @@ class RNN_Node_Interface {
 
     int32_t series_length;
 
-    vector<double> input_values;
-    vector<double> output_values;
-    vector<double> error_values;
-    vector<double> d_input;
-    vector<vector<double>> ordered_d_input;
+    vector<rnn_value_t> input_values;
+    vector<rnn_value_t> output_values;
+    vector<rnn_value_t> error_values;
+    vector<rnn_value_t> d_input;
+    vector<vector<rnn_value_t>> ordered_d_input;
 
     vector<int32_t> inputs_fired;
     vector<int32_t> outputs_fired;
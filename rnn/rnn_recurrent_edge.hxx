@@ -13,8 +13,8 @@ class RNN_Recurrent_Edge {
     // how far in the past to get the value
     int32_t recurrent_depth;
 
-    vector<double> outputs;
-    vector<double> deltas;
+    vector<rnn_value_t> outputs;
+    vector<rnn_value_t> deltas;
 
     double weight;
     double d_weight;
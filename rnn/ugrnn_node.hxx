@@ -33,10 +33,10 @@ class UGRNN_Node : public RNN_Node_Interface {
 
     vector<double> d_h_prev;
 
-    vector<double> c;
-    vector<double> ld_c;
-    vector<double> g;
-    vector<double> ld_g;
+    vector<rnn_value_t> c;
+    vector<rnn_value_t> ld_c;
+    vector<rnn_value_t> g;
+    vector<rnn_value_t> ld_g;
 
    public:
     UGRNN_Node(int32_t _innovation_number, int32_t _type, double _depth);
@@ -0,0 +1,143 @@
+#include <cmath>
+using std::fabs;
+
+#include <fstream>
+using std::getline;
+using std::ifstream;
+
+#include <sstream>
+using std::istringstream;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "common/log.hxx"
+
+/**
+ * Compares the prediction files written by evaluate_rnn (or train_rnn) from two different builds, e.g. a
+ * -DSINGLE_PRECISION=YES build against the default double precision build, and reports the maximum absolute and
+ * relative difference of every column.
+ */
+
+void read_csv(string filename, vector<string>& header, vector<vector<double> >& rows) {
+    ifstream infile(filename);
+    if (!infile.is_open()) {
+        Log::fatal("ERROR: could not open prediction file '%s'\n", filename.c_str());
+        exit(1);
+    }
+
+    string line;
+    getline(infile, line);
+    if (line.size() > 0 && line[0] == '#') {
+        line = line.substr(1);
+    }
+
+    header.clear();
+    istringstream header_stream(line);
+    string column;
+    while (getline(header_stream, column, ',')) {
+        header.push_back(column);
+    }
+
+    rows.clear();
+    while (getline(infile, line)) {
+        if (line.size() == 0) {
+            continue;
+        }
+
+        vector<double> row;
+        istringstream row_stream(line);
+        string value;
+        while (getline(row_stream, value, ',')) {
+            row.push_back(stod(value));
+        }
+
+        if (row.size() != header.size()) {
+            Log::fatal(
+                "ERROR: row %d of '%s' had %d values but the header had %d columns\n", (int32_t) rows.size(),
+                filename.c_str(), (int32_t) row.size(), (int32_t) header.size()
+            );
+            exit(1);
+        }
+        rows.push_back(row);
+    }
+}
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    Log::initialize(arguments);
+    Log::set_id("main");
+
+    vector<string> baseline_filenames;
+    get_argument_vector(arguments, "--baseline_filenames", true, baseline_filenames);
+
+    vector<string> comparison_filenames;
+    get_argument_vector(arguments, "--comparison_filenames", true, comparison_filenames);
+
+    double tolerance = 1e-3;
+    get_argument(arguments, "--tolerance", false, tolerance);
+
+    if (baseline_filenames.size() != comparison_filenames.size()) {
+        Log::fatal(
+            "ERROR: number of baseline files (%d) != number of comparison files (%d)\n",
+            (int32_t) baseline_filenames.size(), (int32_t) comparison_filenames.size()
+        );
+        exit(1);
+    }
+
+    bool passed = true;
+    for (int32_t i = 0; i < (int32_t) baseline_filenames.size(); i++) {
+        vector<string> baseline_header, comparison_header;
+        vector<vector<double> > baseline_rows, comparison_rows;
+        read_csv(baseline_filenames[i], baseline_header, baseline_rows);
+        read_csv(comparison_filenames[i], comparison_header, comparison_rows);
+
+        if (baseline_header != comparison_header || baseline_rows.size() != comparison_rows.size()) {
+            Log::fatal(
+                "ERROR: '%s' and '%s' do not have the same columns and number of rows\n",
+                baseline_filenames[i].c_str(), comparison_filenames[i].c_str()
+            );
+            exit(1);
+        }
+
+        Log::info("comparing '%s' to '%s'\n", baseline_filenames[i].c_str(), comparison_filenames[i].c_str());
+        for (int32_t j = 0; j < (int32_t) baseline_header.size(); j++) {
+            double max_absolute = 0.0;
+            double max_relative = 0.0;
+
+            for (int32_t k = 0; k < (int32_t) baseline_rows.size(); k++) {
+                double difference = fabs(baseline_rows[k][j] - comparison_rows[k][j]);
+                max_absolute = fmax(max_absolute, difference);
+
+                double magnitude = fabs(baseline_rows[k][j]);
+                if (magnitude > 0.0) {
+                    max_relative = fmax(max_relative, difference / magnitude);
+                }
+            }
+
+            Log::info(
+                "\t%30s max absolute difference: %.10lf, max relative difference: %.10lf\n",
+                baseline_header[j].c_str(), max_absolute, max_relative
+            );
+
+            if (max_relative > tolerance) {
+                passed = false;
+            }
+        }
+    }
+
+    if (passed) {
+        Log::info("ALL COLUMNS WITHIN TOLERANCE %lf\n", tolerance);
+    } else {
+        Log::info("SOME COLUMNS EXCEEDED TOLERANCE %lf\n", tolerance);
+    }
+
+    Log::release_id("main");
+
+    return passed ? 0 : 1;
+}
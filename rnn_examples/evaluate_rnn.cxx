@@ -65,11 +65,23 @@ int main(int argc, char** argv) {
 
     time_series_sets->export_test_series(time_offset, testing_inputs, testing_outputs);
 
+    string output_format = "csv";
+    get_argument(arguments, "--output_format", false, output_format);
+    if (output_format.compare("csv") != 0 && output_format.compare("binary") != 0) {
+        Log::fatal("ERROR: unknown output format '%s', options are 'csv' or 'binary'\n", output_format.c_str());
+        exit(1);
+    }
+
+    // the testing files are only written in parallel if asked for
+    int32_t number_threads = 1;
+    get_argument(arguments, "--number_threads", false, number_threads);
+
     vector<double> best_parameters = genome->get_best_parameters();
     Log::info("MSE: %lf\n", genome->get_mse(best_parameters, testing_inputs, testing_outputs));
     Log::info("MAE: %lf\n", genome->get_mae(best_parameters, testing_inputs, testing_outputs));
     genome->write_predictions(
-        output_directory, testing_filenames, best_parameters, testing_inputs, testing_outputs, time_series_sets
+        output_directory, testing_filenames, best_parameters, testing_inputs, testing_outputs, time_series_sets,
+        output_format.compare("binary") == 0, number_threads
     );
 
     if (Log::at_level(Log::DEBUG)) {
@@ -90,7 +102,8 @@ int main(int argc, char** argv) {
             "duplicate MAE: %lf\n", duplicate_genome->get_mae(best_parameters_2, testing_inputs, testing_outputs)
         );
         duplicate_genome->write_predictions(
-            output_directory, testing_filenames, best_parameters_2, testing_inputs, testing_outputs, time_series_sets
+            output_directory, testing_filenames, best_parameters_2, testing_inputs, testing_outputs, time_series_sets,
+            output_format.compare("binary") == 0, number_threads
         );
     }
 
@@ -0,0 +1,340 @@
+/**
+ * Evaluates many genomes (for example all the best genomes of a sweep) on the same testing files at once.
+ *
+ * Example usage:
+ *
+ * ./rnn_examples/evaluate_rnns_batch --genome_filenames sweep/best_genome_*.bin --time_offsets 1
+ * --testing_filenames datasets/2019_ngafid_transfer/c172_file_1.csv --output_directory evaluation
+ * --output_format binary --number_threads 8 --std_message_level INFO --file_message_level NONE
+ *
+ * --time_offsets either has one offset per genome or a single offset used for every genome.
+ *
+ * The testing files are read and normalized once for each distinct set of input/output parameters and normalization
+ * values among the genomes (not once per genome), and the test series for each time offset are exported once and
+ * shared read-only between the threads. Each genome is then evaluated with a single forward pass over every testing
+ * file, the MSE and MAE are computed from its predictions, and the denormalized predictions are written with a
+ * PredictionWriter to one file per genome and testing file (named
+ * genome_<number>_<genome file>_offset_<offset>_<testing file>_predictions), either as CSV (the same columns as
+ * evaluate_rnn) or as binary columns (see rnn/prediction_writer.hxx).
+ *
+ * The MSE and MAE of every genome on every testing file (and averaged over the files, as in evaluate_rnn) are written
+ * to <output_directory>/evaluation_summary.csv in the order the genomes were given.
+ */
+
+#include <atomic>
+using std::atomic;
+
+#include <cmath>
+
+#include <fstream>
+using std::ofstream;
+
+#include <iomanip>
+using std::setprecision;
+
+#include <map>
+using std::map;
+
+#include <sstream>
+using std::ostringstream;
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "common/files.hxx"
+#include "common/log.hxx"
+#include "rnn/prediction_writer.hxx"
+#include "rnn/rnn_genome.hxx"
+#include "time_series/time_series.hxx"
+
+vector<string> arguments;
+
+/**
+ * The testing data shared by all the genomes with the same parameters and normalization.
+ */
+struct TestData {
+    int32_t number_outputs;
+    PredictionWriter* writer;
+
+    map<int32_t, vector<vector<vector<double> > > > inputs;
+    map<int32_t, vector<vector<vector<double> > > > outputs;
+};
+
+struct EvaluationJob {
+    int32_t genome_number;
+    int32_t time_offset;
+    TestData* test_data;
+
+    vector<double> mses;
+    vector<double> maes;
+};
+
+string get_test_data_key(RNN_Genome* genome) {
+    ostringstream key;
+    key << setprecision(17);
+
+    auto add_names = [&](const vector<string>& names) {
+        for (int32_t i = 0; i < (int32_t) names.size(); i++) {
+            key << names[i] << ",";
+        }
+        key << ";";
+    };
+
+    auto add_values = [&](const map<string, double>& values) {
+        for (auto i = values.begin(); i != values.end(); i++) {
+            key << i->first << "=" << i->second << ",";
+        }
+        key << ";";
+    };
+
+    add_names(genome->get_input_parameter_names());
+    add_names(genome->get_output_parameter_names());
+
+    string normalize_type = genome->get_normalize_type();
+    key << normalize_type << ";";
+    if (normalize_type.compare("min_max") == 0 || normalize_type.compare("avg_std_dev") == 0) {
+        add_values(genome->get_normalize_mins());
+        add_values(genome->get_normalize_maxs());
+    }
+    if (normalize_type.compare("avg_std_dev") == 0) {
+        add_values(genome->get_normalize_avgs());
+        add_values(genome->get_normalize_std_devs());
+    }
+
+    return key.str();
+}
+
+string get_basename(string filename) {
+    filename = filename.substr(filename.find_last_of("/") + 1);
+    return filename.substr(0, filename.find_last_of("."));
+}
+
+int main(int argc, char** argv) {
+    arguments = vector<string>(argv, argv + argc);
+
+    Log::initialize(arguments);
+    Log::set_id("main");
+
+    vector<string> genome_filenames;
+    get_argument_vector(arguments, "--genome_filenames", true, genome_filenames);
+
+    vector<int32_t> time_offsets;
+    get_argument_vector(arguments, "--time_offsets", true, time_offsets);
+
+    if (time_offsets.size() == 1) {
+        time_offsets.assign(genome_filenames.size(), time_offsets[0]);
+    } else if (time_offsets.size() != genome_filenames.size()) {
+        Log::fatal(
+            "ERROR: number of time_offsets (%d) != number of genome_files: (%d), either give one time offset per "
+            "genome or a single time offset for all of them\n",
+            time_offsets.size(), genome_filenames.size()
+        );
+        exit(1);
+    }
+
+    vector<string> testing_filenames;
+    get_argument_vector(arguments, "--testing_filenames", true, testing_filenames);
+
+    string output_directory;
+    get_argument(arguments, "--output_directory", true, output_directory);
+    mkpath(output_directory.c_str(), 0777);
+
+    string output_format = "csv";
+    get_argument(arguments, "--output_format", false, output_format);
+    if (output_format.compare("csv") != 0 && output_format.compare("binary") != 0) {
+        Log::fatal("ERROR: unknown output format '%s', options are 'csv' or 'binary'\n", output_format.c_str());
+        exit(1);
+    }
+    bool binary = output_format.compare("binary") == 0;
+
+    int32_t number_threads = thread::hardware_concurrency();
+    get_argument(arguments, "--number_threads", false, number_threads);
+    if (number_threads < 1) {
+        number_threads = 1;
+    }
+
+    vector<RNN_Genome*> genomes(genome_filenames.size(), NULL);
+    atomic<int32_t> next_genome(0);
+
+    auto read_genomes = [&](int32_t thread_number) {
+        Log::set_id("reader_" + std::to_string(thread_number));
+        for (int32_t i = next_genome++; i < (int32_t) genome_filenames.size(); i = next_genome++) {
+            Log::info("reading genome filename: %s\n", genome_filenames[i].c_str());
+            genomes[i] = new RNN_Genome(genome_filenames[i]);
+        }
+        Log::release_id("reader_" + std::to_string(thread_number));
+    };
+
+    vector<thread> threads;
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads.push_back(thread(read_genomes, i));
+    }
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads[i].join();
+    }
+    threads.clear();
+
+    // load and normalize the testing files once for each set of parameters and normalization values, and export
+    // the series for each time offset used with them
+    map<string, TestData*> all_test_data;
+    vector<EvaluationJob> jobs(genomes.size());
+
+    for (int32_t i = 0; i < (int32_t) genomes.size(); i++) {
+        RNN_Genome* genome = genomes[i];
+        string key = get_test_data_key(genome);
+
+        TestData*& test_data = all_test_data[key];
+        TimeSeriesSets* time_series_sets = NULL;
+
+        if (test_data == NULL || test_data->inputs.count(time_offsets[i]) == 0) {
+            time_series_sets = TimeSeriesSets::generate_test(
+                testing_filenames, genome->get_input_parameter_names(), genome->get_output_parameter_names()
+            );
+
+            string normalize_type = genome->get_normalize_type();
+            if (normalize_type.compare("min_max") == 0) {
+                time_series_sets->normalize_min_max(genome->get_normalize_mins(), genome->get_normalize_maxs());
+            } else if (normalize_type.compare("avg_std_dev") == 0) {
+                time_series_sets->normalize_avg_std_dev(
+                    genome->get_normalize_avgs(), genome->get_normalize_std_devs(), genome->get_normalize_mins(),
+                    genome->get_normalize_maxs()
+                );
+            }
+        }
+
+        if (test_data == NULL) {
+            Log::info("loaded testing data for parameters and normalization of genome %d\n", i);
+            test_data = new TestData();
+            test_data->number_outputs = genome->get_output_parameter_names().size();
+            test_data->writer = new PredictionWriter(
+                genome->get_input_parameter_names(), genome->get_output_parameter_names(), time_series_sets
+            );
+        }
+
+        if (time_series_sets != NULL) {
+            time_series_sets->export_test_series(
+                time_offsets[i], test_data->inputs[time_offsets[i]], test_data->outputs[time_offsets[i]]
+            );
+            delete time_series_sets;
+        }
+
+        jobs[i].genome_number = i;
+        jobs[i].time_offset = time_offsets[i];
+        jobs[i].test_data = test_data;
+    }
+
+    Log::info(
+        "evaluating %d genomes with %d sets of testing data on %d threads\n", genomes.size(), all_test_data.size(),
+        number_threads
+    );
+
+    atomic<int32_t> next_job(0);
+
+    auto evaluate_genomes = [&](int32_t thread_number) {
+        Log::set_id("evaluator_" + std::to_string(thread_number));
+
+        for (int32_t i = next_job++; i < (int32_t) jobs.size(); i = next_job++) {
+            EvaluationJob& job = jobs[i];
+            RNN_Genome* genome = genomes[job.genome_number];
+
+            const vector<vector<vector<double> > >& inputs = job.test_data->inputs.at(job.time_offset);
+            const vector<vector<vector<double> > >& outputs = job.test_data->outputs.at(job.time_offset);
+            int32_t number_outputs = job.test_data->number_outputs;
+
+            // one forward pass per testing file, the errors are calculated from the predictions the same way as
+            // RNN::calculate_error_mse and RNN::calculate_error_mae
+            vector<vector<double> > predictions =
+                genome->get_predictions(genome->get_best_parameters(), inputs, outputs);
+
+            for (int32_t j = 0; j < (int32_t) predictions.size(); j++) {
+                int32_t length = outputs[j][0].size();
+                vector<vector<double> > predicted_outputs(number_outputs, vector<double>(length));
+
+                double mse = 0.0, mae = 0.0;
+                for (int32_t k = 0; k < number_outputs; k++) {
+                    double output_mse = 0.0, output_mae = 0.0;
+                    for (int32_t row = 0; row < length; row++) {
+                        predicted_outputs[k][row] = predictions[j][row * number_outputs + k];
+
+                        double error = predicted_outputs[k][row] - outputs[j][k][row];
+                        output_mse += error * error;
+                        output_mae += fabs(error);
+                    }
+                    mse += output_mse / length;
+                    mae += output_mae / length;
+                }
+                job.mses.push_back(mse);
+                job.maes.push_back(mae);
+
+                // genomes from different runs often have the same filename, so the genome number keeps these unique
+                string output_filename = output_directory + "/genome_" + std::to_string(job.genome_number) + "_"
+                                         + get_basename(genome_filenames[job.genome_number]) + "_offset_"
+                                         + std::to_string(job.time_offset) + "_" + get_basename(testing_filenames[j])
+                                         + "_predictions" + (binary ? ".bin" : ".csv");
+
+                if (binary) {
+                    job.test_data->writer->write_binary(output_filename, inputs[j], outputs[j], predicted_outputs);
+                } else {
+                    job.test_data->writer->write_csv(output_filename, inputs[j], outputs[j], predicted_outputs);
+                }
+            }
+
+            Log::info(
+                "evaluated genome %d ('%s'), time offset %d\n", job.genome_number,
+                genome_filenames[job.genome_number].c_str(), job.time_offset
+            );
+        }
+
+        Log::release_id("evaluator_" + std::to_string(thread_number));
+    };
+
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads.push_back(thread(evaluate_genomes, i));
+    }
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads[i].join();
+    }
+
+    string summary_filename = output_directory + "/evaluation_summary.csv";
+    ofstream summary(summary_filename);
+    summary << "#genome,time_offset,testing_file,mse,mae" << endl;
+    summary << setprecision(17);
+
+    for (int32_t i = 0; i < (int32_t) jobs.size(); i++) {
+        const EvaluationJob& job = jobs[i];
+        double average_mse = 0.0, average_mae = 0.0;
+
+        for (int32_t j = 0; j < (int32_t) job.mses.size(); j++) {
+            summary << genome_filenames[i] << "," << job.time_offset << "," << testing_filenames[j] << ","
+                    << job.mses[j] << "," << job.maes[j] << endl;
+            average_mse += job.mses[j];
+            average_mae += job.maes[j];
+        }
+        average_mse /= job.mses.size();
+        average_mae /= job.maes.size();
+
+        summary << genome_filenames[i] << "," << job.time_offset << ",all," << average_mse << "," << average_mae
+                << endl;
+        Log::info("genome %d, time offset %d, MSE: %lf, MAE: %lf\n", i, job.time_offset, average_mse, average_mae);
+    }
+    summary.close();
+
+    for (auto i = all_test_data.begin(); i != all_test_data.end(); i++) {
+        delete i->second->writer;
+        delete i->second;
+    }
+    for (int32_t i = 0; i < (int32_t) genomes.size(); i++) {
+        delete genomes[i];
+    }
+
+    Log::release_id("main");
+
+    return 0;
+}
@@ -158,6 +158,7 @@ int main(int argc, char** argv) {
             weight_rules
         );
     } else if (rnn_type == "dnas") {
+        get_argument(arguments, "--dnas_pruning_threshold", false, dnas_pruning_threshold);
         vector<int> node_types = {SIMPLE_NODE, LSTM_NODE, GRU_NODE, MGU_NODE, DELTA_NODE};
         genome = create_dnas_nn(
             input_parameter_names, num_hidden_layers, 1, output_parameter_names, max_recurrent_depth, node_types,
@@ -177,6 +178,22 @@ int main(int argc, char** argv) {
     get_argument(arguments, "--bp_iterations", true, bp_iterations);
     genome->set_bp_iterations(bp_iterations);
 
+    int32_t validation_frequency = 1;
+    get_argument(arguments, "--validation_frequency", false, validation_frequency);
+    genome->set_validation_frequency(validation_frequency);
+
+    int32_t evaluation_threads = 1;
+    get_argument(arguments, "--evaluation_threads", false, evaluation_threads);
+    genome->set_evaluation_threads(evaluation_threads);
+
+    int32_t batch_size = 1;
+    get_argument(arguments, "--batch_size", false, batch_size);
+    genome->set_batch_size(batch_size);
+
+    int32_t training_threads = 1;
+    get_argument(arguments, "--training_threads", false, training_threads);
+    genome->set_training_threads(training_threads);
+
     get_argument(arguments, "--output_directory", true, output_directory);
     if (output_directory != "") {
         mkpath(output_directory.c_str(), 0777);
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+using std::fstream;
+using std::ios;
+using std::ofstream;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "common/log.hxx"
+#include "word_series/corpus_tokenizer.hxx"
+
+string directory;
+bool passed = true;
+
+void write_file(string filename, string contents) {
+    ofstream outfile(filename);
+    outfile << contents;
+    outfile.close();
+}
+
+// converts the tokens back to words, so the expected results are readable
+string get_words(const CorpusTokenizer& tokenizer, int32_t file) {
+    const vector<string>& word_index = tokenizer.get_word_index();
+    const vector<int32_t>& tokens = tokenizer.get_tokens(file);
+
+    string words;
+    for (int32_t i = 0; i < (int32_t) tokens.size(); i++) {
+        if (i > 0) {
+            words += " ";
+        }
+        words += word_index[tokens[i]];
+    }
+    return words;
+}
+
+string get_vocabulary(const CorpusTokenizer& tokenizer) {
+    const vector<string>& word_index = tokenizer.get_word_index();
+
+    string vocabulary;
+    for (int32_t i = 0; i < (int32_t) word_index.size(); i++) {
+        if (i > 0) {
+            vocabulary += " ";
+        }
+        vocabulary += word_index[i] + ":" + std::to_string(tokenizer.get_word_count(i));
+    }
+    return vocabulary;
+}
+
+void check(string name, string result, string expected) {
+    if (result.compare(expected) != 0) {
+        Log::info("\tFAILED %s, expected '%s' but was '%s'\n", name.c_str(), expected.c_str(), result.c_str());
+        passed = false;
+    } else {
+        Log::debug("\tPASSED %s\n", name.c_str());
+    }
+}
+
+void check(string name, bool result) {
+    if (!result) {
+        Log::info("\tFAILED %s\n", name.c_str());
+        passed = false;
+    } else {
+        Log::debug("\tPASSED %s\n", name.c_str());
+    }
+}
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    Log::initialize(arguments);
+    Log::set_id("main");
+
+    Log::info("TESTING CORPUS TOKENIZER\n");
+
+    char directory_template[] = "/tmp/test_corpus_tokenizer_XXXXXX";
+    directory = mkdtemp(directory_template);
+
+    // words are split on spaces, tabs and carriage returns, and every line ends with <eos>
+    vector<string> filenames{directory + "/train.txt", directory + "/test.txt"};
+    write_file(filenames[0], "the cat sat\n  the\tdog  sat\r\nthe bird\n");
+    write_file(filenames[1], "the fish sat\n");
+    vector<int32_t> training_indexes{0};
+
+    for (int32_t number_threads = 1; number_threads <= 4; number_threads *= 2) {
+        CorpusTokenizer tokenizer(filenames, number_threads);
+        tokenizer.tokenize(training_indexes, 1, 0);
+
+        // most frequent first, ties in alphabetical order, and words only in the test file become <unk>
+        string threads = " (" + std::to_string(number_threads) + " threads)";
+        check("vocabulary" + threads, get_vocabulary(tokenizer), "<eos>:3 the:3 sat:2 bird:1 cat:1 dog:1 <unk>:0");
+        check(
+            "training tokens" + threads, get_words(tokenizer, 0),
+            "the cat sat <eos> the dog sat <eos> the bird <eos>"
+        );
+        check("testing tokens" + threads, get_words(tokenizer, 1), "the <unk> sat <eos>");
+    }
+
+    CorpusTokenizer min_count_tokenizer(filenames, 2);
+    min_count_tokenizer.tokenize(training_indexes, 2, 0);
+    check("min_count vocabulary", get_vocabulary(min_count_tokenizer), "<eos>:3 the:3 sat:2 <unk>:3");
+    check(
+        "min_count tokens", get_words(min_count_tokenizer, 0), "the <unk> sat <eos> the <unk> sat <eos> the <unk> <eos>"
+    );
+
+    // <unk> takes the last place in the vocabulary when it is full
+    CorpusTokenizer max_size_tokenizer(filenames, 2);
+    max_size_tokenizer.tokenize(training_indexes, 1, 3);
+    check("max_size vocabulary", get_vocabulary(max_size_tokenizer), "<eos>:3 the:3 <unk>:5");
+    check("max_size tokens", get_words(max_size_tokenizer, 1), "the <unk> <unk> <eos>");
+
+    // an existing vocabulary maps the words it does not have to <unk>
+    CorpusTokenizer existing_tokenizer(filenames, 2);
+    existing_tokenizer.tokenize(vector<string>{"<unk>", "<eos>", "the", "sat"});
+    check("existing vocabulary tokens", get_words(existing_tokenizer, 1), "the <unk> sat <eos>");
+    check("existing vocabulary counts", get_vocabulary(existing_tokenizer), "<unk>:4 <eos>:4 the:4 sat:3");
+
+    // cache round trip
+    string cache_filename = directory + "/tokens.cache";
+    CorpusTokenizer cached_tokenizer(filenames, 2);
+    cached_tokenizer.tokenize(training_indexes, 1, 0);
+    cached_tokenizer.write_cache(cache_filename, training_indexes, 1, 0);
+
+    CorpusTokenizer read_tokenizer(filenames, 2);
+    check("read cache", read_tokenizer.read_cache(cache_filename, training_indexes, 1, 0));
+    check("cached vocabulary", get_vocabulary(read_tokenizer), get_vocabulary(cached_tokenizer));
+    check("cached training tokens", get_words(read_tokenizer, 0), get_words(cached_tokenizer, 0));
+    check("cached testing tokens", get_words(read_tokenizer, 1), get_words(cached_tokenizer, 1));
+
+    CorpusTokenizer stale_tokenizer(filenames, 2);
+    check("stale cache (min_count)", !stale_tokenizer.read_cache(cache_filename, training_indexes, 2, 0));
+    check("stale cache (training files)", !stale_tokenizer.read_cache(cache_filename, vector<int32_t>{1}, 1, 0));
+
+    // the last token of the last file is at the end of the cache, replace it with one outside the vocabulary
+    fstream cache_file(cache_filename, ios::in | ios::out | ios::binary);
+    int32_t bad_token = 1000;
+    cache_file.seekp(-(int32_t) sizeof(int32_t), ios::end);
+    cache_file.write((const char*) &bad_token, sizeof(int32_t));
+    cache_file.close();
+
+    CorpusTokenizer corrupt_tokenizer(filenames, 2);
+    check("corrupt cache", !corrupt_tokenizer.read_cache(cache_filename, training_indexes, 1, 0));
+
+    remove(cache_filename.c_str());
+    remove(filenames[0].c_str());
+    remove(filenames[1].c_str());
+    remove(directory.c_str());
+
+    if (passed) {
+        Log::info("ALL PASSED!\n");
+    } else {
+        Log::info("SOME FAILED!\n");
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include <cmath>
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "common/log.hxx"
+#include "gradient_test.hxx"
+#include "rnn/generate_nn.hxx"
+#include "rnn/lstm_node.hxx"
+#include "rnn/rnn.hxx"
+#include "rnn/rnn_genome.hxx"
+#include "weights/weight_rules.hxx"
+
+bool check_errors(string name, RNN_Genome* genome, int32_t number_series, int32_t series_length) {
+    int32_t number_inputs = genome->get_number_inputs();
+    int32_t number_outputs = genome->get_number_outputs();
+
+    vector<vector<vector<double> > > inputs(number_series);
+    vector<vector<vector<double> > > outputs(number_series);
+    for (int32_t i = 0; i < number_series; i++) {
+        inputs[i].resize(number_inputs);
+        for (int32_t j = 0; j < number_inputs; j++) {
+            generate_random_vector(series_length, inputs[i][j]);
+        }
+
+        outputs[i].resize(number_outputs);
+        for (int32_t j = 0; j < number_outputs; j++) {
+            generate_random_vector(series_length, outputs[i][j]);
+        }
+    }
+
+    genome->initialize_randomly();
+    vector<double> parameters;
+    genome->get_weights(parameters);
+
+    double expected_mse = genome->get_mse(parameters, inputs, outputs);
+    double expected_mae = genome->get_mae(parameters, inputs, outputs);
+    double expected_softmax = genome->get_softmax(parameters, inputs, outputs);
+
+    // single precision builds store the node values as floats, so the fused and separate error sums can differ
+    // in the low order digits
+    double tolerance = sizeof(rnn_value_t) == sizeof(float) ? 10e-6 : 10e-10;
+
+    bool failed = false;
+    for (int32_t number_threads = 1; number_threads <= 4; number_threads++) {
+        vector<RNN*> rnns;
+        for (int32_t i = 0; i < number_threads; i++) {
+            rnns.push_back(genome->get_rnn());
+        }
+
+        double mse, mae, softmax;
+        genome->get_errors(rnns, parameters, inputs, outputs, true, mse, mae, softmax);
+
+        if (fabs(mse - expected_mse) > tolerance || fabs(mae - expected_mae) > tolerance
+            || fabs(softmax - expected_softmax) > tolerance) {
+            Log::info(
+                "\tFAILED '%s' with %d threads, mse: %lf vs %lf, mae: %lf vs %lf, softmax: %lf vs %lf\n",
+                name.c_str(), number_threads, mse, expected_mse, mae, expected_mae, softmax, expected_softmax
+            );
+            failed = true;
+        } else {
+            Log::debug("\tPASSED '%s' with %d threads\n", name.c_str(), number_threads);
+        }
+
+        for (int32_t i = 0; i < number_threads; i++) {
+            delete rnns[i];
+        }
+    }
+
+    return !failed;
+}
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    Log::initialize(arguments);
+    Log::set_id("main");
+
+    initialize_generator();
+
+    Log::info("TESTING FUSED ERROR EVALUATION\n");
+
+    WeightRules* weight_rules = new WeightRules();
+    weight_rules->initialize_from_args(arguments);
+
+    vector<string> inputs{"input 1", "input 2", "input 3"};
+    vector<string> outputs{"output 1", "output 2"};
+
+    bool passed = true;
+    RNN_Genome* genome;
+
+    genome = create_ff(inputs, 1, 2, outputs, 3, weight_rules);
+    passed &= check_errors("FF: 3 Input, 1x2 Hidden, 2 Output", genome, 7, 10);
+    delete genome;
+
+    genome = create_lstm(inputs, 2, 3, outputs, 3, weight_rules);
+    passed &= check_errors("LSTM: 3 Input, 2x3 Hidden, 2 Output", genome, 5, 20);
+    delete genome;
+
+    delete weight_rules;
+
+    if (passed) {
+        Log::info("ALL PASSED!\n");
+    } else {
+        Log::info("SOME FAILED!\n");
+    }
+
+    return passed ? 0 : 1;
+}
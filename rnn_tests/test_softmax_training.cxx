@@ -0,0 +1,132 @@
+#include <cmath>
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "common/log.hxx"
+#include "rnn/generate_nn.hxx"
+#include "rnn/rnn_genome.hxx"
+#include "weights/weight_rules.hxx"
+#include "weights/weight_update.hxx"
+
+bool passed = true;
+
+void check(string name, bool result) {
+    if (!result) {
+        Log::info("\tFAILED %s\n", name.c_str());
+        passed = false;
+    } else {
+        Log::debug("\tPASSED %s\n", name.c_str());
+    }
+}
+
+/**
+ * A corpus where each word is always followed by the same word, so the perplexity of a trained model should drop
+ * well below the vocabulary size. Each series starts at a different word of the cycle, and the expected outputs are
+ * the inputs shifted by one word.
+ */
+void generate_cycle_series(
+    int32_t vocab_size, int32_t number_series, int32_t first_offset, int32_t length, vector<vector<int32_t> >& inputs,
+    vector<vector<int32_t> >& outputs
+) {
+    inputs.assign(number_series, vector<int32_t>(length));
+    outputs.assign(number_series, vector<int32_t>(length));
+
+    for (int32_t i = 0; i < number_series; i++) {
+        for (int32_t j = 0; j < length; j++) {
+            inputs[i][j] = (first_offset + i + j) % vocab_size;
+            outputs[i][j] = (first_offset + i + j + 1) % vocab_size;
+        }
+    }
+}
+
+void softmax_training_test(
+    string name, RNN_Genome* genome, WeightUpdate* weight_update_method, int32_t softmax_samples,
+    const vector<vector<int32_t> >& inputs, const vector<vector<int32_t> >& outputs,
+    const vector<vector<int32_t> >& validation_inputs, const vector<vector<int32_t> >& validation_outputs
+) {
+    Log::info("\ttesting softmax training on '%s' with %d softmax samples...\n", name.c_str(), softmax_samples);
+
+    genome->initialize_randomly();
+    double initial_perplexity =
+        genome->get_perplexity(genome->get_initial_parameters(), validation_inputs, validation_outputs);
+
+    genome->backpropagate_stochastic(
+        inputs, outputs, validation_inputs, validation_outputs, weight_update_method, softmax_samples
+    );
+
+    // the fitness is the best validation perplexity, which the best parameters should reproduce
+    double best_perplexity = genome->get_best_validation_mse();
+    double final_perplexity =
+        genome->get_perplexity(genome->get_best_parameters(), validation_inputs, validation_outputs);
+
+    Log::info(
+        "\t\tinitial perplexity: %lf, best perplexity: %lf, final perplexity: %lf\n", initial_perplexity,
+        best_perplexity, final_perplexity
+    );
+
+    check(name + " perplexity is finite", std::isfinite(best_perplexity));
+    check(name + " perplexity decreased", best_perplexity < 0.5 * initial_perplexity);
+    check(name + " best parameters perplexity", fabs(final_perplexity - best_perplexity) < 1e-10);
+}
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    Log::initialize(arguments);
+    Log::set_id("main");
+
+    Log::info("TESTING SOFTMAX TRAINING\n");
+
+    int32_t bp_iterations = 50;
+    get_argument(arguments, "--bp_iterations", false, bp_iterations);
+
+    WeightRules* weight_rules = new WeightRules();
+    weight_rules->initialize_from_args(arguments);
+
+    // the default learning rate is too small to train these models in a few iterations
+    WeightUpdate* weight_update_method = new WeightUpdate(arguments);
+    if (!argument_exists(arguments, "--learning_rate")) {
+        weight_update_method->set_learning_rate(0.01);
+    }
+
+    vector<string> vocab{"word 1", "word 2", "word 3", "word 4", "word 5", "word 6", "word 7", "word 8"};
+
+    vector<vector<int32_t> > inputs, outputs, validation_inputs, validation_outputs;
+    generate_cycle_series(vocab.size(), 8, 0, 20, inputs, outputs);
+    generate_cycle_series(vocab.size(), 4, 3, 20, validation_inputs, validation_outputs);
+
+    // the exact softmax, and a sampled softmax over the expected word and 3 of the other 7
+    for (int32_t softmax_samples = 0; softmax_samples <= 3; softmax_samples += 3) {
+        RNN_Genome* genome = create_ff(vocab, 1, 8, vocab, 1, weight_rules);
+        genome->set_bp_iterations(bp_iterations);
+        softmax_training_test(
+            "FF: 8 Tokens, 1x8 Hidden, 8 Softmax", genome, weight_update_method, softmax_samples, inputs, outputs,
+            validation_inputs, validation_outputs
+        );
+        delete genome;
+
+        genome = create_lstm(vocab, 1, 8, vocab, 1, weight_rules);
+        genome->set_bp_iterations(bp_iterations);
+        softmax_training_test(
+            "LSTM: 8 Tokens, 1x8 Hidden, 8 Softmax", genome, weight_update_method, softmax_samples, inputs, outputs,
+            validation_inputs, validation_outputs
+        );
+        delete genome;
+    }
+
+    delete weight_update_method;
+    delete weight_rules;
+
+    if (passed) {
+        Log::info("ALL PASSED!\n");
+    } else {
+        Log::info("SOME FAILED!\n");
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#include <chrono>
+#include <cmath>
+
+#include <random>
+using std::minstd_rand0;
+using std::uniform_int_distribution;
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "common/arguments.hxx"
+#include "common/log.hxx"
+#include "gradient_test.hxx"
+#include "rnn/generate_nn.hxx"
+#include "rnn/lstm_node.hxx"
+#include "rnn/rnn_genome.hxx"
+#include "weights/weight_rules.hxx"
+
+extern int test_iterations;
+
+void generate_random_tokens(int number_tokens, int vocab_size, vector<int32_t>& tokens) {
+    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+    minstd_rand0 generator(seed);
+    uniform_int_distribution<int32_t> rng(0, vocab_size - 1);
+
+    tokens.resize(number_tokens);
+    for (int32_t i = 0; i < number_tokens; i++) {
+        tokens[i] = rng(generator);
+    }
+}
+
+void sparse_gradient_test(
+    string name, RNN_Genome* genome, const vector<int32_t>& tokens, const vector<vector<double> >& outputs
+) {
+    genome->set_stochastic(false);
+    double analytic_mse, empirical_mse;
+    vector<double> parameters;
+    vector<double> analytic_gradient, empirical_gradient;
+
+    Log::info("\ttesting sparse input gradient on '%s'...\n", name.c_str());
+    bool failed = false;
+
+    genome->initialize_randomly();
+    RNN* rnn = genome->get_rnn();
+
+    for (int32_t i = 0; i < test_iterations; i++) {
+        generate_random_vector(rnn->get_number_weights(), parameters);
+
+        rnn->get_analytic_gradient(parameters, tokens, outputs, analytic_mse, analytic_gradient, false, true, 0.0);
+        rnn->get_empirical_gradient(parameters, tokens, outputs, empirical_mse, empirical_gradient, false, true, 0.0);
+
+        bool iteration_failed = false;
+
+        for (uint32_t j = 0; j < analytic_gradient.size(); j++) {
+            double difference = analytic_gradient[j] - empirical_gradient[j];
+
+            if (fabs(difference) > 10e-10) {
+                failed = true;
+                iteration_failed = true;
+                Log::info(
+                    "\t\tFAILED analytic gradient[%d]: %lf, empirical gradient[%d]: %lf, difference: %lf\n", j,
+                    analytic_gradient[j], j, empirical_gradient[j], difference
+                );
+            } else {
+                Log::debug(
+                    "\t\tPASSED analytic gradient[%d]: %lf, empirical gradient[%d]: %lf, difference: %lf\n", j,
+                    analytic_gradient[j], j, empirical_gradient[j], difference
+                );
+            }
+        }
+
+        if (iteration_failed) {
+            Log::info("\tITERATION %d FAILED!\n\n", i);
+        } else {
+            Log::debug("\tITERATION %d PASSED!\n\n", i);
+        }
+    }
+
+    delete rnn;
+
+    if (!failed) {
+        Log::info("ALL PASSED!\n");
+    } else {
+        Log::info("SOME FAILED!\n");
+    }
+}
+
+void softmax_gradient_test(
+    string name, RNN_Genome* genome, const vector<int32_t>& tokens, const vector<int32_t>& expected_tokens
+) {
+    genome->set_stochastic(false);
+    vector<double> parameters;
+    vector<double> analytic_gradient;
+    minstd_rand0 generator(1337);
+
+    Log::info("\ttesting softmax gradient on '%s'...\n", name.c_str());
+    bool failed = false;
+
+    genome->initialize_randomly();
+    RNN* rnn = genome->get_rnn();
+
+    double diff = 0.00001;
+    for (int32_t i = 0; i < test_iterations; i++) {
+        generate_random_vector(rnn->get_number_weights(), parameters);
+
+        rnn->get_softmax_gradient(
+            parameters, tokens, expected_tokens, 0, generator, analytic_gradient, false, true, 0.0
+        );
+
+        for (uint32_t j = 0; j < parameters.size(); j++) {
+            double save = parameters[j];
+
+            parameters[j] = save - diff;
+            rnn->set_weights(parameters);
+            rnn->forward_pass(tokens, false, true, 0.0);
+            double cross_entropy1 = rnn->calculate_error_softmax(expected_tokens) / expected_tokens.size();
+
+            parameters[j] = save + diff;
+            rnn->set_weights(parameters);
+            rnn->forward_pass(tokens, false, true, 0.0);
+            double cross_entropy2 = rnn->calculate_error_softmax(expected_tokens) / expected_tokens.size();
+
+            parameters[j] = save;
+
+            double empirical_gradient = (cross_entropy2 - cross_entropy1) / (2.0 * diff);
+            double difference = analytic_gradient[j] - empirical_gradient;
+            if (fabs(difference) > 10e-10) {
+                failed = true;
+                Log::info(
+                    "\t\tFAILED analytic gradient[%d]: %lf, empirical gradient[%d]: %lf, difference: %lf\n", j,
+                    analytic_gradient[j], j, empirical_gradient, difference
+                );
+            }
+        }
+    }
+
+    delete rnn;
+
+    if (!failed) {
+        Log::info("ALL PASSED!\n");
+    } else {
+        Log::info("SOME FAILED!\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    vector<string> arguments = vector<string>(argv, argv + argc);
+
+    Log::initialize(arguments);
+    Log::set_id("main");
+
+    initialize_generator();
+
+    RNN_Genome* genome;
+
+    Log::info("TESTING SPARSE INPUTS\n");
+
+    int input_length = 10;
+    get_argument(arguments, "--input_length", true, input_length);
+
+    WeightRules* weight_rules = new WeightRules();
+    weight_rules->initialize_from_args(arguments);
+
+    vector<string> vocab{"word 1", "word 2", "word 3", "word 4", "word 5"};
+    vector<string> outputs3{"output 1", "output 2", "output 3"};
+
+    vector<int32_t> tokens;
+    vector<vector<double> > outputs(outputs3.size());
+
+    for (int32_t max_recurrent_depth = 1; max_recurrent_depth <= 3; max_recurrent_depth++) {
+        Log::info("testing with max recurrent depth: %d\n", max_recurrent_depth);
+
+        generate_random_tokens(input_length, vocab.size(), tokens);
+        for (int32_t i = 0; i < (int32_t) outputs.size(); i++) {
+            generate_random_vector(input_length, outputs[i]);
+        }
+
+        genome = create_ff(vocab, 0, 0, outputs3, max_recurrent_depth, weight_rules);
+        sparse_gradient_test("FF: 5 Tokens, 3 Output", genome, tokens, outputs);
+        delete genome;
+
+        genome = create_ff(vocab, 2, 3, outputs3, max_recurrent_depth, weight_rules);
+        sparse_gradient_test("FF: 5 Tokens, 2x3 Hidden, 3 Output", genome, tokens, outputs);
+        delete genome;
+
+        genome = create_elman(vocab, 2, 3, outputs3, max_recurrent_depth, weight_rules);
+        sparse_gradient_test("ELMAN: 5 Tokens, 2x3 Hidden, 3 Output", genome, tokens, outputs);
+        delete genome;
+
+        genome = create_lstm(vocab, 2, 3, outputs3, max_recurrent_depth, weight_rules);
+        sparse_gradient_test("LSTM: 5 Tokens, 2x3 Hidden, 3 Output", genome, tokens, outputs);
+        delete genome;
+
+        vector<int32_t> expected_tokens;
+        generate_random_tokens(input_length, vocab.size(), expected_tokens);
+
+        genome = create_ff(vocab, 2, 3, vocab, max_recurrent_depth, weight_rules);
+        softmax_gradient_test("FF: 5 Tokens, 2x3 Hidden, 5 Softmax", genome, tokens, expected_tokens);
+        delete genome;
+
+        genome = create_lstm(vocab, 2, 3, vocab, max_recurrent_depth, weight_rules);
+        softmax_gradient_test("LSTM: 5 Tokens, 2x3 Hidden, 5 Softmax", genome, tokens, expected_tokens);
+        delete genome;
+    }
+}
@@ -1,17 +1,27 @@
 #include <fstream>
 using std::ofstream;
 
+#include <atomic>
+using std::atomic;
+
 #include <iomanip>
 using std::setw;
 
+#include <mutex>
+using std::mutex;
+
 #include <string>
 using std::string;
 
+#include <thread>
+using std::thread;
+
 #include <vector>
 using std::vector;
 
 #include "common/arguments.hxx"
 #include "common/log.hxx"
+#include "time_series/lagged_correlation.hxx"
 #include "time_series/time_series.hxx"
 
 vector<string> arguments;
@@ -39,49 +49,113 @@ int main(int argc, char** argv) {
 
     vector<string> parameter_names = time_series_sets->get_input_parameter_names();
 
-    for (int32_t i = 0; i < time_series_sets->get_number_series(); i++) {
-        TimeSeriesSet* tss = time_series_sets->get_set(i);
+    // the target does not have to be an input parameter (e.g., it can be the output parameter), so it is added to
+    // the fields being correlated after the input parameters if it is not one of them
+    vector<string> fields = parameter_names;
+    int32_t target_index = -1;
+    for (int32_t j = 0; j < (int32_t) fields.size(); j++) {
+        if (fields[j].compare(target_parameter_name) == 0) {
+            target_index = j;
+        }
+    }
+
+    if (target_index < 0) {
+        target_index = fields.size();
+        fields.push_back(target_parameter_name);
+    }
+
+    // also write the correlations of every pair of parameters, not just with the target
+    bool all_pairs = argument_exists(arguments, "--all_pairs");
+
+    // the series are processed in parallel, and if there are fewer series than threads the pairs of each series are
+    // split between the remaining threads
+    int32_t number_threads = thread::hardware_concurrency();
+    get_argument(arguments, "--number_threads", false, number_threads);
 
-        string input_filename = tss->get_filename();
-        cout << "processing: '" << input_filename << "'" << endl;
+    int32_t number_series = time_series_sets->get_number_series();
+    int32_t series_threads = number_threads < number_series ? number_threads : number_series;
+    int32_t correlation_threads = series_threads > 0 ? number_threads / series_threads : 1;
+    if (series_threads < 1) {
+        series_threads = 1;
+    }
+
+    mutex output_mutex;
+    atomic<int32_t> next_series(0);
 
-        int32_t last_slash = input_filename.find_last_of('/') + 1;
-        int32_t last_dot = input_filename.find_last_of('.');
-        string prefix = input_filename.substr(last_slash, last_dot - last_slash);
-        string suffix = input_filename.substr(last_dot, input_filename.length());
+    auto process_series = [&]() {
+        for (int32_t i = next_series++; i < number_series; i = next_series++) {
+            TimeSeriesSet* tss = time_series_sets->get_set(i);
 
-        cout << "prefix: '" << prefix << "'" << endl;
-        cout << "suffix: '" << suffix << "'" << endl;
+            string input_filename = tss->get_filename();
 
-        string correlations_csv_filename = output_directory + "/" + prefix + "_correlations.csv";
-        string headers_txt_filename = output_directory + "/" + prefix + "_headers.txt";
+            int32_t last_slash = input_filename.find_last_of('/') + 1;
+            int32_t last_dot = input_filename.find_last_of('.');
+            string prefix = input_filename.substr(last_slash, last_dot - last_slash);
 
-        cout << "correlations_csv_filename: '" << correlations_csv_filename << "'" << endl;
-        cout << "headers_txt_filename: '" << headers_txt_filename << "'" << endl;
+            string correlations_csv_filename = output_directory + "/" + prefix + "_correlations.csv";
+            string headers_txt_filename = output_directory + "/" + prefix + "_headers.txt";
 
-        ofstream correlations_csv(correlations_csv_filename);
-        ofstream headers_txt(headers_txt_filename);
+            output_mutex.lock();
+            cout << "processing: '" << input_filename << "'" << endl;
+            cout << "correlations_csv_filename: '" << correlations_csv_filename << "'" << endl;
+            cout << "headers_txt_filename: '" << headers_txt_filename << "'" << endl;
+            output_mutex.unlock();
 
-        for (int32_t j = 0; j < (int32_t) parameter_names.size(); j++) {
-            if (parameter_names[j].compare(target_parameter_name) == 0) {
-                continue;
+            LaggedCorrelation lagged_correlation(tss, fields, max_lag);
+            if (all_pairs) {
+                lagged_correlation.compute_all(correlation_threads);
+            } else {
+                lagged_correlation.compute(vector<int32_t>(1, target_index), correlation_threads);
             }
 
-            for (int32_t k = 1; k < max_lag; k++) {
-                double correlation = tss->get_correlation(target_parameter_name, parameter_names[j], k);
+            ofstream correlations_csv(correlations_csv_filename);
+            ofstream headers_txt(headers_txt_filename);
 
-                if (k > 1) {
-                    correlations_csv << ",";
+            for (int32_t j = 0; j < (int32_t) parameter_names.size(); j++) {
+                if (j == target_index) {
+                    continue;
                 }
-                correlations_csv << correlation;
+
+                for (int32_t k = 1; k < max_lag; k++) {
+                    if (k > 1) {
+                        correlations_csv << ",";
+                    }
+                    correlations_csv << lagged_correlation.get_correlation(target_index, j, k);
+                }
+                correlations_csv << endl;
+
+                headers_txt << parameter_names[j] << endl;
             }
-            correlations_csv << endl;
 
-            headers_txt << parameter_names[j] << endl;
+            correlations_csv.close();
+            headers_txt.close();
+
+            if (all_pairs) {
+                // one line for each pair of parameters: the first, the second, and the correlations of the first
+                // lagged 1 to max_lag - 1 rows ahead of the second
+                ofstream all_pairs_csv(output_directory + "/" + prefix + "_all_correlations.csv");
+
+                for (int32_t j = 0; j < (int32_t) fields.size(); j++) {
+                    for (int32_t l = 0; l < (int32_t) fields.size(); l++) {
+                        all_pairs_csv << fields[j] << "," << fields[l];
+                        for (int32_t k = 1; k < max_lag; k++) {
+                            all_pairs_csv << "," << lagged_correlation.get_correlation(j, l, k);
+                        }
+                        all_pairs_csv << endl;
+                    }
+                }
+
+                all_pairs_csv.close();
+            }
         }
+    };
 
-        correlations_csv.close();
-        headers_txt.close();
+    vector<thread> threads;
+    for (int32_t i = 0; i < series_threads; i++) {
+        threads.push_back(thread(process_series));
+    }
+    for (int32_t i = 0; i < series_threads; i++) {
+        threads[i].join();
     }
 
     Log::release_id("main");
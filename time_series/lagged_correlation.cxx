@@ -0,0 +1,126 @@
+#include <atomic>
+using std::atomic;
+
+#include <cmath>
+
+#include <string>
+using std::string;
+
+#include <thread>
+using std::thread;
+
+#include <vector>
+using std::vector;
+
+#include "lagged_correlation.hxx"
+
+LaggedCorrelation::LaggedCorrelation(TimeSeriesSet* time_series_set, const vector<string>& fields, int32_t _max_lag) {
+    number_fields = fields.size();
+    length = time_series_set->get_number_rows();
+    max_lag = _max_lag;
+
+    normalized.assign((int64_t) number_fields * length, 0.0);
+    correlations.assign((int64_t) number_fields * number_fields * max_lag, 0.0);
+
+    vector<double> series;
+    for (int32_t i = 0; i < number_fields; i++) {
+        double average = time_series_set->get_average(fields[i]);
+        double variance = time_series_set->get_variance(fields[i]);
+
+        // like TimeSeries::get_correlation, the correlation with a constant field is 0
+        if (variance < 1e-12) {
+            continue;
+        }
+
+        double scale = 1.0 / sqrt(variance);
+        time_series_set->get_series(fields[i], series);
+
+        double* current = &normalized[(int64_t) i * length];
+        for (int32_t j = 0; j < length; j++) {
+            current[j] = (series[j] - average) * scale;
+        }
+    }
+}
+
+void LaggedCorrelation::correlate(int32_t first, int32_t second, vector<double>& sums) {
+    const double* first_values = &normalized[(int64_t) first * length];
+    const double* second_values = &normalized[(int64_t) second * length];
+
+    sums.assign(max_lag, 0.0);
+    double* lag_sums = sums.data();
+
+    // for every row before full_rows, all the lags are within the first field
+    int32_t full_rows = length - max_lag + 1;
+    if (full_rows < 0) {
+        full_rows = 0;
+    }
+
+    for (int32_t i = 0; i < full_rows; i++) {
+        const double* shifted = first_values + i;
+        double value = second_values[i];
+
+        for (int32_t lag = 0; lag < max_lag; lag++) {
+            lag_sums[lag] += shifted[lag] * value;
+        }
+    }
+
+    for (int32_t i = full_rows; i < length; i++) {
+        const double* shifted = first_values + i;
+        double value = second_values[i];
+
+        for (int32_t lag = 0; lag < length - i; lag++) {
+            lag_sums[lag] += shifted[lag] * value;
+        }
+    }
+
+    double* result = &correlations[((int64_t) first * number_fields + second) * max_lag];
+    for (int32_t lag = 0; lag < max_lag; lag++) {
+        if (lag < length) {
+            result[lag] = lag_sums[lag] / (length - lag);
+        } else {
+            result[lag] = 0.0;
+        }
+    }
+}
+
+void LaggedCorrelation::compute(const vector<int32_t>& first_fields, int32_t number_threads) {
+    int64_t number_pairs = (int64_t) first_fields.size() * number_fields;
+    atomic<int64_t> next_pair(0);
+
+    auto correlate_pairs = [&]() {
+        vector<double> sums;
+        for (int64_t pair = next_pair++; pair < number_pairs; pair = next_pair++) {
+            correlate(first_fields[pair / number_fields], pair % number_fields, sums);
+        }
+    };
+
+    if (number_threads <= 1) {
+        correlate_pairs();
+        return;
+    }
+
+    vector<thread> threads;
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads.push_back(thread(correlate_pairs));
+    }
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads[i].join();
+    }
+}
+
+void LaggedCorrelation::compute_all(int32_t number_threads) {
+    vector<int32_t> first_fields(number_fields);
+    for (int32_t i = 0; i < number_fields; i++) {
+        first_fields[i] = i;
+    }
+
+    compute(first_fields, number_threads);
+}
+
+double LaggedCorrelation::get_correlation(int32_t first, int32_t second, int32_t lag) const {
+    return correlations[((int64_t) first * number_fields + second) * max_lag + lag];
+}
+
+const vector<double>& LaggedCorrelation::get_correlations() const {
+    return correlations;
+}
@@ -0,0 +1,60 @@
+#ifndef EXAMM_LAGGED_CORRELATION_HXX
+#define EXAMM_LAGGED_CORRELATION_HXX
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include "stdint.h"
+#include "time_series.hxx"
+
+/**
+ * Computes the lagged correlations between pairs of fields of a time series set, for every lag from 0 to
+ * max_lag - 1 at once, into a dense [first field][second field][lag] matrix. The values are the same as
+ * TimeSeries::get_correlation, i.e., the correlation of the first field lag rows ahead of the second:
+ *
+ *      sum_{i < n - lag} (first[i + lag] - first_avg) * (second[i] - second_avg)
+ *      / (sqrt(first_variance * second_variance) * (n - lag))
+ *
+ * Each field is centered and scaled once, and the inner loop accumulates all the lags for each row of the second
+ * field so it is vectorized over the lags. Pairs are split between threads.
+ */
+class LaggedCorrelation {
+   private:
+    int32_t number_fields;
+    int32_t length;
+    int32_t max_lag;
+
+    // each field minus its average and divided by its standard deviation (all zeros for constant fields), stored
+    // one field after another
+    vector<double> normalized;
+
+    vector<double> correlations;
+
+    void correlate(int32_t first, int32_t second, vector<double>& sums);
+
+   public:
+    LaggedCorrelation(TimeSeriesSet* time_series_set, const vector<string>& fields, int32_t _max_lag);
+
+    /**
+     * Computes the correlations of the given first fields with every field.
+     */
+    void compute(const vector<int32_t>& first_fields, int32_t number_threads);
+
+    /**
+     * Computes the correlations of every pair of fields.
+     */
+    void compute_all(int32_t number_threads);
+
+    double get_correlation(int32_t first, int32_t second, int32_t lag) const;
+
+    /**
+     * The dense matrix of correlations, the correlation of first and second at lag is at
+     * (first * number_fields + second) * max_lag + lag.
+     */
+    const vector<double>& get_correlations() const;
+};
+
+#endif
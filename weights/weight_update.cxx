@@ -15,6 +15,11 @@ WeightUpdate::WeightUpdate() {
     beta2 = 0.99;
 
     learning_rate = 0.001;
+    learning_rate_schedule = CONSTANT_LR;
+    learning_rate_decay = 0.5;
+    learning_rate_decay_epochs = 10;
+    min_learning_rate = 0.0;
+    warmup_epochs = 0;
     high_threshold = 1.0;
     low_threshold = 0.05;
     use_high_norm = true;
@@ -69,28 +74,77 @@ void WeightUpdate::generate_from_arguments(const vector<string>& arguments) {
     get_argument(arguments, "--high_threshold", false, high_threshold);
     get_argument(arguments, "--low_threshold", false, low_threshold);
     Log::info("Backprop learning rate: %f\n", learning_rate);
+
+    if (argument_exists(arguments, "--learning_rate_schedule")) {
+        string schedule_string;
+        get_argument(arguments, "--learning_rate_schedule", true, schedule_string);
+        learning_rate_schedule = get_enum_schedule_from_string(schedule_string);
+    }
+    get_argument(arguments, "--learning_rate_decay", false, learning_rate_decay);
+    get_argument(arguments, "--learning_rate_decay_epochs", false, learning_rate_decay_epochs);
+    get_argument(arguments, "--min_learning_rate", false, min_learning_rate);
+    get_argument(arguments, "--warmup_epochs", false, warmup_epochs);
+    if (learning_rate_decay_epochs < 1) {
+        Log::fatal("ERROR: --learning_rate_decay_epochs must be >= 1, was %d\n", learning_rate_decay_epochs);
+        exit(1);
+    }
+    Log::info(
+        "Learning rate schedule: %s, decay: %f, decay epochs: %d, min learning rate: %f, warmup epochs: %d\n",
+        LEARNING_RATE_SCHEDULE_STRING[learning_rate_schedule].c_str(), learning_rate_decay,
+        learning_rate_decay_epochs, min_learning_rate, warmup_epochs
+    );
     Log::info("Use high norm is set to %s, high norm is %f\n", use_high_norm ? "True" : "False", high_threshold);
     Log::info("Use low norm is set to %s, low norm is %f\n", use_low_norm ? "True" : "False", low_threshold);
 }
 
+// keeps the weights in [-10, 10], written as a conditional so the update loops vectorize
+template <typename T>
+static inline T clip_weight(T weight) {
+    weight = weight < (T) -10.0 ? (T) -10.0 : weight;
+    return weight > (T) 10.0 ? (T) 10.0 : weight;
+}
+
+template <typename T>
 void WeightUpdate::update_weights(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
+    vector<T>& parameters, vector<T>& velocity, vector<T>& prev_velocity, const vector<T>& gradient,
+    double gradient_scale, int32_t epoch
 ) {
+    Log::trace("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
+
+    int32_t n_parameters = (int32_t) parameters.size();
+    T scale = (T) gradient_scale;
+    // the learning rate is kept local, one WeightUpdate is shared by all the threads training genomes
+    T epoch_learning_rate = (T) get_learning_rate(epoch);
+
     if (weight_update_method == VANILLA) {
-        vanilla_weight_update(parameters, velocity, prev_velocity, gradient, epoch);
+        vanilla_weight_update(parameters.data(), gradient.data(), n_parameters, epoch_learning_rate, scale);
     } else if (weight_update_method == MOMENTUM) {
-        momentum_weight_update(parameters, velocity, prev_velocity, gradient, epoch);
+        momentum_weight_update(
+            parameters.data(), velocity.data(), gradient.data(), n_parameters, epoch_learning_rate, scale
+        );
     } else if (weight_update_method == NESTEROV) {
-        nesterov_weight_update(parameters, velocity, prev_velocity, gradient, epoch);
+        nesterov_weight_update(
+            parameters.data(), velocity.data(), prev_velocity.data(), gradient.data(), n_parameters,
+            epoch_learning_rate, scale
+        );
     } else if (weight_update_method == ADAGRAD) {
-        adagrad_weight_update(parameters, velocity, prev_velocity, gradient, epoch);
+        adagrad_weight_update(
+            parameters.data(), velocity.data(), gradient.data(), n_parameters, epoch_learning_rate, scale
+        );
     } else if (weight_update_method == RMSPROP) {
-        rmsprop_weight_update(parameters, velocity, prev_velocity, gradient, epoch);
+        rmsprop_weight_update(
+            parameters.data(), velocity.data(), gradient.data(), n_parameters, epoch_learning_rate, scale
+        );
     } else if (weight_update_method == ADAM) {
-        adam_weight_update(parameters, velocity, prev_velocity, gradient, epoch);
+        adam_weight_update(
+            parameters.data(), velocity.data(), prev_velocity.data(), gradient.data(), n_parameters,
+            epoch_learning_rate, scale, epoch, false
+        );
     } else if (weight_update_method == ADAM_BIAS) {
-        adam_bias_weight_update(parameters, velocity, prev_velocity, gradient, epoch);
+        adam_weight_update(
+            parameters.data(), velocity.data(), prev_velocity.data(), gradient.data(), n_parameters,
+            epoch_learning_rate, scale, epoch, true
+        );
     } else {
         Log::fatal(
             "Unrecognized weight update method's enom number: %d, this should never happen!\n", weight_update_method
@@ -99,103 +153,127 @@ void WeightUpdate::update_weights(
     }
 }
 
+template <typename T>
+void WeightUpdate::update_weights(
+    vector<T>& parameters, vector<T>& velocity, vector<T>& prev_velocity, const vector<T>& gradient, int32_t epoch
+) {
+    update_weights(parameters, velocity, prev_velocity, gradient, 1.0, epoch);
+}
+
+template <typename T>
+double WeightUpdate::norm_and_update_weights(
+    vector<T>& parameters, vector<T>& velocity, vector<T>& prev_velocity, const vector<T>& gradient, int32_t epoch
+) {
+    double norm = get_norm(gradient);
+    if (std::isnan(norm) || std::isinf(norm)) {
+        return norm;
+    }
+
+    update_weights(parameters, velocity, prev_velocity, gradient, get_gradient_scale(norm), epoch);
+    return norm;
+}
+
+template <typename T>
 void WeightUpdate::vanilla_weight_update(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
+    T* __restrict__ parameters, const T* __restrict__ gradient, int32_t n_parameters, T epoch_learning_rate,
+    T gradient_scale
 ) {
-    Log::trace("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
-    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
-        parameters[i] -= learning_rate * gradient[i];
-        gradient_clip(parameters[i]);
+    const T step = epoch_learning_rate * gradient_scale;
+    for (int32_t i = 0; i < n_parameters; i++) {
+        parameters[i] = clip_weight(parameters[i] - step * gradient[i]);
     }
 }
 
+template <typename T>
 void WeightUpdate::momentum_weight_update(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
+    T* __restrict__ parameters, T* __restrict__ velocity, const T* __restrict__ gradient, int32_t n_parameters,
+    T epoch_learning_rate, T gradient_scale
 ) {
-    Log::trace("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
-    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
-        velocity[i] = momentum * velocity[i] - learning_rate * gradient[i];
-        parameters[i] += velocity[i];
-        gradient_clip(parameters[i]);
+    const T mu = (T) momentum;
+    const T step = epoch_learning_rate * gradient_scale;
+    for (int32_t i = 0; i < n_parameters; i++) {
+        velocity[i] = mu * velocity[i] - step * gradient[i];
+        parameters[i] = clip_weight(parameters[i] + velocity[i]);
     }
 }
 
+template <typename T>
 void WeightUpdate::nesterov_weight_update(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
+    T* __restrict__ parameters, T* __restrict__ velocity, T* __restrict__ prev_velocity,
+    const T* __restrict__ gradient, int32_t n_parameters, T epoch_learning_rate, T gradient_scale
 ) {
-    Log::info("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
-    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
+    const T mu = (T) momentum;
+    const T one_plus_mu = (T) (1.0 + momentum);
+    const T step = epoch_learning_rate * gradient_scale;
+    for (int32_t i = 0; i < n_parameters; i++) {
         prev_velocity[i] = velocity[i];
-        velocity[i] = momentum * velocity[i] - learning_rate * gradient[i];
-        parameters[i] += -momentum * prev_velocity[i] + (1 + momentum) * velocity[i];
-        gradient_clip(parameters[i]);
+        velocity[i] = mu * velocity[i] - step * gradient[i];
+        parameters[i] = clip_weight(parameters[i] - mu * prev_velocity[i] + one_plus_mu * velocity[i]);
     }
 }
 
+template <typename T>
 void WeightUpdate::adagrad_weight_update(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
+    T* __restrict__ parameters, T* __restrict__ velocity, const T* __restrict__ gradient, int32_t n_parameters,
+    T epoch_learning_rate, T gradient_scale
 ) {
-    Log::trace("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
-    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
+    const T lr = epoch_learning_rate;
+    const T eps = (T) epsilon;
+    for (int32_t i = 0; i < n_parameters; i++) {
         // here the velocity is the "cache" in Adagrad
-        velocity[i] += gradient[i] * gradient[i];
-        parameters[i] += -learning_rate * gradient[i] / (sqrt(velocity[i]) + epsilon);
-        gradient_clip(parameters[i]);
+        T g = gradient_scale * gradient[i];
+        velocity[i] += g * g;
+        parameters[i] = clip_weight(parameters[i] - lr * g / (std::sqrt(velocity[i]) + eps));
     }
 }
 
+template <typename T>
 void WeightUpdate::rmsprop_weight_update(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
+    T* __restrict__ parameters, T* __restrict__ velocity, const T* __restrict__ gradient, int32_t n_parameters,
+    T epoch_learning_rate, T gradient_scale
 ) {
-    Log::trace("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
-    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
+    const T lr = epoch_learning_rate;
+    const T eps = (T) epsilon;
+    const T decay = (T) decay_rate;
+    const T one_minus_decay = (T) (1.0 - decay_rate);
+    for (int32_t i = 0; i < n_parameters; i++) {
         // here the velocity is the "cache" in RMSProp
-        velocity[i] = decay_rate * velocity[i] + (1 - decay_rate) * gradient[i] * gradient[i];
-        parameters[i] += -learning_rate * gradient[i] / (sqrt(velocity[i]) + epsilon);
-        gradient_clip(parameters[i]);
+        T g = gradient_scale * gradient[i];
+        velocity[i] = decay * velocity[i] + one_minus_decay * g * g;
+        parameters[i] = clip_weight(parameters[i] - lr * g / (std::sqrt(velocity[i]) + eps));
     }
 }
 
+template <typename T>
 void WeightUpdate::adam_weight_update(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
+    T* __restrict__ parameters, T* __restrict__ velocity, T* __restrict__ prev_velocity,
+    const T* __restrict__ gradient, int32_t n_parameters, T epoch_learning_rate, T gradient_scale, int32_t epoch,
+    bool bias_correction
 ) {
-    Log::trace("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
-    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
-        // here the velocity is the "v" in adam, the prev_velocity is "m" in adam
-        prev_velocity[i] = beta1 * prev_velocity[i] + (1 - beta1) * gradient[i];
-        velocity[i] = beta2 * velocity[i] + (1 - beta2) * (gradient[i] * gradient[i]);
-        parameters[i] += -learning_rate * prev_velocity[i] / (sqrt(velocity[i]) + epsilon);
-        gradient_clip(parameters[i]);
-    }
-}
+    const T b1 = (T) beta1;
+    const T one_minus_b1 = (T) (1.0 - beta1);
+    const T b2 = (T) beta2;
+    const T one_minus_b2 = (T) (1.0 - beta2);
+    const T eps = (T) epsilon;
 
-void WeightUpdate::adam_bias_weight_update(
-    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-    int32_t epoch
-) {
-    Log::trace("Doing weight update with method: %s \n", WEIGHT_UPDATE_METHOD_STRING[weight_update_method].c_str());
-    for (int32_t i = 0; i < (int32_t) parameters.size(); i++) {
-        // here the velocity is the "v" in adam, the prev_velocity is "m" in adam
-        prev_velocity[i] = beta1 * prev_velocity[i] + (1 - beta1) * gradient[i];
-        double mt = prev_velocity[i] / (1 - pow(beta1, epoch));
-        velocity[i] = beta2 * velocity[i] + (1 - beta2) * (gradient[i] * gradient[i]);
-        double vt = velocity[i] / (1 - pow(beta2, epoch));
-        parameters[i] += -learning_rate * mt / (sqrt(vt) + epsilon);
-        gradient_clip(parameters[i]);
+    // the bias corrections only depend on the epoch, so calculate them once per update instead of per
+    // parameter. epoch is 0 based and adam's timestep is 1 based, otherwise the first correction is a divide
+    // by 0.
+    T m_correction = 1.0;
+    T v_correction = 1.0;
+    if (bias_correction) {
+        m_correction = (T) (1.0 / (1.0 - pow(beta1, epoch + 1)));
+        v_correction = (T) (1.0 / (1.0 - pow(beta2, epoch + 1)));
     }
-}
+    const T lr = epoch_learning_rate * m_correction;
 
-void WeightUpdate::gradient_clip(double& parameter) {
-    if (parameter < -10.0) {
-        parameter = -10.0;
-    } else if (parameter > 10.0) {
-        parameter = 10.0;
+    for (int32_t i = 0; i < n_parameters; i++) {
+        // here the velocity is the "v" in adam, the prev_velocity is "m" in adam
+        T g = gradient_scale * gradient[i];
+        prev_velocity[i] = b1 * prev_velocity[i] + one_minus_b1 * g;
+        velocity[i] = b2 * velocity[i] + one_minus_b2 * (g * g);
+        T v_hat = velocity[i] * v_correction;
+        parameters[i] = clip_weight(parameters[i] - lr * prev_velocity[i] / (std::sqrt(v_hat) + eps));
     }
 }
 
@@ -203,6 +281,29 @@ double WeightUpdate::get_learning_rate() {
     return learning_rate;
 }
 
+double WeightUpdate::get_learning_rate(int32_t epoch) {
+    double rate = learning_rate;
+
+    if (learning_rate_schedule == STEP_LR) {
+        rate = learning_rate * pow(learning_rate_decay, epoch / learning_rate_decay_epochs);
+    } else if (learning_rate_schedule == EXPONENTIAL_LR) {
+        rate = learning_rate * pow(learning_rate_decay, epoch);
+    } else if (learning_rate_schedule == COSINE_LR) {
+        double progress = (double) (epoch % learning_rate_decay_epochs) / learning_rate_decay_epochs;
+        rate = min_learning_rate + 0.5 * (learning_rate - min_learning_rate) * (1.0 + cos(M_PI * progress));
+    }
+
+    if (rate < min_learning_rate) {
+        rate = min_learning_rate;
+    }
+
+    if (epoch < warmup_epochs) {
+        rate *= (double) (epoch + 1) / (warmup_epochs + 1);
+    }
+
+    return rate;
+}
+
 double WeightUpdate::get_low_threshold() {
     return low_threshold;
 }
@@ -233,31 +334,69 @@ void WeightUpdate::enable_low_threshold(double _low_threshold) {
     low_threshold = _low_threshold;
 }
 
-double WeightUpdate::get_norm(vector<double>& analytic_gradient) {
+template <typename T>
+double WeightUpdate::get_norm(const vector<T>& analytic_gradient) {
+    // always accumulate in double, even if the gradient is stored as float
+    const T* __restrict__ gradient = analytic_gradient.data();
     double norm = 0.0;
     for (int32_t i = 0; i < (int32_t) analytic_gradient.size(); i++) {
-        norm += analytic_gradient[i] * analytic_gradient[i];
+        norm += (double) gradient[i] * (double) gradient[i];
     }
     norm = sqrt(norm);
 
     return norm;
 }
 
-void WeightUpdate::norm_gradients(vector<double>& analytic_gradient, double norm) {
+double WeightUpdate::get_gradient_scale(double norm) {
     if (use_high_norm && norm > high_threshold) {
         double high_threshold_norm = high_threshold / norm;
         Log::debug_no_header(", OVER THRESHOLD, multiplier: %lf", high_threshold_norm);
-
-        for (int32_t i = 0; i < (int32_t) analytic_gradient.size(); i++) {
-            analytic_gradient[i] = high_threshold_norm * analytic_gradient[i];
-        }
+        return high_threshold_norm;
 
     } else if (use_low_norm && norm < low_threshold) {
         double low_threshold_norm = low_threshold / norm;
         Log::debug_no_header(", UNDER THRESHOLD, multiplier: %lf", low_threshold_norm);
+        return low_threshold_norm;
+    }
+    return 1.0;
+}
 
+template <typename T>
+void WeightUpdate::norm_gradients(vector<T>& analytic_gradient, double norm) {
+    T scale = (T) get_gradient_scale(norm);
+    if (scale != (T) 1.0) {
         for (int32_t i = 0; i < (int32_t) analytic_gradient.size(); i++) {
-            analytic_gradient[i] = low_threshold_norm * analytic_gradient[i];
+            analytic_gradient[i] = scale * analytic_gradient[i];
         }
     }
 }
+
+// parameters may be stored as either double or float
+template void WeightUpdate::update_weights<double>(
+    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity,
+    const vector<double>& gradient, double gradient_scale, int32_t epoch
+);
+template void WeightUpdate::update_weights<float>(
+    vector<float>& parameters, vector<float>& velocity, vector<float>& prev_velocity, const vector<float>& gradient,
+    double gradient_scale, int32_t epoch
+);
+template void WeightUpdate::update_weights<double>(
+    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity,
+    const vector<double>& gradient, int32_t epoch
+);
+template void WeightUpdate::update_weights<float>(
+    vector<float>& parameters, vector<float>& velocity, vector<float>& prev_velocity, const vector<float>& gradient,
+    int32_t epoch
+);
+template double WeightUpdate::norm_and_update_weights<double>(
+    vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity,
+    const vector<double>& gradient, int32_t epoch
+);
+template double WeightUpdate::norm_and_update_weights<float>(
+    vector<float>& parameters, vector<float>& velocity, vector<float>& prev_velocity, const vector<float>& gradient,
+    int32_t epoch
+);
+template double WeightUpdate::get_norm<double>(const vector<double>& analytic_gradient);
+template double WeightUpdate::get_norm<float>(const vector<float>& analytic_gradient);
+template void WeightUpdate::norm_gradients<double>(vector<double>& analytic_gradient, double norm);
+template void WeightUpdate::norm_gradients<float>(vector<float>& analytic_gradient, double norm);
@@ -15,6 +15,11 @@ static string WEIGHT_UPDATE_METHOD_STRING[] = {"vanilla", "momentum", "nesterov"
                                                "rmsprop", "adam",     "adam-bias"};
 static int32_t NUM_WEIGHT_UPDATE_TYPES = 7;
 
+enum LearningRateSchedule { CONSTANT_LR = 0, STEP_LR = 1, EXPONENTIAL_LR = 2, COSINE_LR = 3 };
+
+static string LEARNING_RATE_SCHEDULE_STRING[] = {"constant", "step", "exponential", "cosine"};
+static int32_t NUM_LEARNING_RATE_SCHEDULES = 4;
+
 inline WeightUpdateMethod get_enum_method_from_string(string input_string) {
     WeightUpdateMethod method = ADAM;
     for (int i = 0; i < NUM_WEIGHT_UPDATE_TYPES; i++) {
@@ -25,6 +30,16 @@ inline WeightUpdateMethod get_enum_method_from_string(string input_string) {
     return method;
 }
 
+inline LearningRateSchedule get_enum_schedule_from_string(string input_string) {
+    LearningRateSchedule schedule = CONSTANT_LR;
+    for (int i = 0; i < NUM_LEARNING_RATE_SCHEDULES; i++) {
+        if (input_string.compare(LEARNING_RATE_SCHEDULE_STRING[i]) == 0) {
+            schedule = static_cast<LearningRateSchedule>(i);
+        }
+    }
+    return schedule;
+}
+
 template <typename Weight_Update_Type>
 int32_t enum_method_to_integer(Weight_Update_Type method) {
     return static_cast<typename std::underlying_type<Weight_Update_Type>::type>(method);
@@ -40,51 +55,78 @@ class WeightUpdate {
     double beta2;
     double learning_rate;
 
+    LearningRateSchedule learning_rate_schedule;
+    // multiplier for the step and exponential schedules
+    double learning_rate_decay;
+    // epochs between decays for the step schedule, or the period of the cosine schedule
+    int32_t learning_rate_decay_epochs;
+    double min_learning_rate;
+    // the learning rate ramps up linearly to its scheduled value over this many epochs
+    int32_t warmup_epochs;
+
     bool use_high_norm;
     double high_threshold;
     bool use_low_norm;
     double low_threshold;
 
-   public:
-    WeightUpdate();
-    explicit WeightUpdate(const vector<string>& arguments);
-    void generate_from_arguments(const vector<string>& arguments);
-
-    void update_weights(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
-    );
-
+    template <typename T>
     void vanilla_weight_update(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
+        T* parameters, const T* gradient, int32_t n_parameters, T epoch_learning_rate, T gradient_scale
     );
+    template <typename T>
     void momentum_weight_update(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
+        T* parameters, T* velocity, const T* gradient, int32_t n_parameters, T epoch_learning_rate, T gradient_scale
     );
+    template <typename T>
     void nesterov_weight_update(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
+        T* parameters, T* velocity, T* prev_velocity, const T* gradient, int32_t n_parameters, T epoch_learning_rate,
+        T gradient_scale
     );
+    template <typename T>
     void adagrad_weight_update(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
+        T* parameters, T* velocity, const T* gradient, int32_t n_parameters, T epoch_learning_rate, T gradient_scale
     );
+    template <typename T>
     void rmsprop_weight_update(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
+        T* parameters, T* velocity, const T* gradient, int32_t n_parameters, T epoch_learning_rate, T gradient_scale
     );
+    template <typename T>
     void adam_weight_update(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
+        T* parameters, T* velocity, T* prev_velocity, const T* gradient, int32_t n_parameters, T epoch_learning_rate,
+        T gradient_scale, int32_t epoch, bool bias_correction
     );
-    void adam_bias_weight_update(
-        vector<double>& parameters, vector<double>& velocity, vector<double>& prev_velocity, vector<double>& gradient,
-        int32_t epoch
+
+   public:
+    WeightUpdate();
+    explicit WeightUpdate(const vector<string>& arguments);
+    void generate_from_arguments(const vector<string>& arguments);
+
+    /**
+     * Applies one step of the weight update method to the parameters. Each gradient is multiplied by
+     * gradient_scale as it is read, so clipping by norm does not need a separate pass over the gradient.
+     * The parameters, velocity and prev_velocity can be stored as either float or double.
+     */
+    template <typename T>
+    void update_weights(
+        vector<T>& parameters, vector<T>& velocity, vector<T>& prev_velocity, const vector<T>& gradient,
+        double gradient_scale, int32_t epoch
     );
 
-    void gradient_clip(double& parameter);
+    template <typename T>
+    void update_weights(
+        vector<T>& parameters, vector<T>& velocity, vector<T>& prev_velocity, const vector<T>& gradient, int32_t epoch
+    );
+
+    /**
+     * Calculates the norm of the gradient and then updates the weights with the high/low norm thresholds
+     * folded into the update. If the norm is NaN or infinite the parameters are not modified.
+     *
+     * \return the norm of the (unscaled) gradient
+     */
+    template <typename T>
+    double norm_and_update_weights(
+        vector<T>& parameters, vector<T>& velocity, vector<T>& prev_velocity, const vector<T>& gradient, int32_t epoch
+    );
 
     void set_learning_rate(double _learning_rate);
     void disable_high_threshold();
@@ -93,11 +135,26 @@ class WeightUpdate {
     void enable_low_threshold(double _low_threshold);
 
     double get_learning_rate();
+
+    /**
+     * \return the learning rate for the given (0 based) epoch after applying the warmup and
+     * learning rate schedule.
+     */
+    double get_learning_rate(int32_t epoch);
     double get_low_threshold();
     double get_high_threshold();
 
-    double get_norm(vector<double>& analytic_gradient);
-    void norm_gradients(vector<double>& analytic_gradient, double norm);
+    template <typename T>
+    double get_norm(const vector<T>& analytic_gradient);
+
+    /**
+     * \return the multiplier norm_gradients would apply to a gradient with the given norm (1.0 if the norm
+     * is within the thresholds).
+     */
+    double get_gradient_scale(double norm);
+
+    template <typename T>
+    void norm_gradients(vector<T>& analytic_gradient, double norm);
 };
 
 #endif
@@ -0,0 +1,565 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+using std::sort;
+
+#include <atomic>
+using std::atomic;
+
+#include <cstring>
+
+#include <fstream>
+using std::ifstream;
+using std::ios;
+using std::ofstream;
+
+#include <string>
+using std::string;
+
+#include <string_view>
+using std::string_view;
+
+#include <thread>
+using std::thread;
+
+#include <unordered_map>
+using std::unordered_map;
+
+#include <vector>
+using std::vector;
+
+#include "common/log.hxx"
+#include "corpus_tokenizer.hxx"
+
+// files are split into chunks of about this many bytes (at the next line break) to be tokenized in parallel
+#define TOKENIZER_CHUNK_SIZE (4 * 1024 * 1024)
+
+static const char TOKEN_CACHE_MAGIC[8] = {'E', 'X', 'A', 'M', 'M', 'T', 'O', 'K'};
+static const int32_t TOKEN_CACHE_VERSION = 1;
+
+struct TokenizedChunk {
+    int32_t file;
+    const char* begin;
+    const char* end;
+
+    // the chunk's words in the order they are first seen, how many times each occurs, and the index (in words) of
+    // every token in the chunk
+    vector<string_view> words;
+    vector<int64_t> counts;
+    vector<int32_t> tokens;
+};
+
+static inline bool is_separator(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static void tokenize_chunk(TokenizedChunk& chunk) {
+    unordered_map<string_view, int32_t> chunk_words;
+
+    auto add_token = [&](string_view word) {
+        auto found = chunk_words.find(word);
+        int32_t index;
+        if (found == chunk_words.end()) {
+            index = chunk.words.size();
+            chunk_words.emplace(word, index);
+            chunk.words.push_back(word);
+            chunk.counts.push_back(0);
+        } else {
+            index = found->second;
+        }
+        chunk.counts[index]++;
+        chunk.tokens.push_back(index);
+    };
+
+    const string_view end_of_sentence("<eos>");
+
+    const char* current = chunk.begin;
+    while (current < chunk.end) {
+        const char* line_end = (const char*) memchr(current, '\n', chunk.end - current);
+        if (line_end == NULL) {
+            line_end = chunk.end;
+        }
+
+        while (current < line_end) {
+            while (current < line_end && is_separator(*current)) {
+                current++;
+            }
+
+            const char* word_start = current;
+            while (current < line_end && !is_separator(*current)) {
+                current++;
+            }
+
+            if (current > word_start) {
+                add_token(string_view(word_start, current - word_start));
+            }
+        }
+        add_token(end_of_sentence);
+
+        current = line_end + 1;
+    }
+}
+
+template <typename T>
+static void write_value(ofstream& out, const T& value) {
+    out.write((const char*) &value, sizeof(T));
+}
+
+template <typename T>
+static bool read_value(ifstream& in, T& value) {
+    in.read((char*) &value, sizeof(T));
+    return (bool) in;
+}
+
+static void write_string(ofstream& out, const string& value) {
+    write_value(out, (int32_t) value.size());
+    out.write(value.c_str(), value.size());
+}
+
+static bool read_string(ifstream& in, string& value) {
+    int32_t length;
+    if (!read_value(in, length) || length < 0) {
+        return false;
+    }
+    value.resize(length);
+    in.read(&value[0], length);
+    return (bool) in;
+}
+
+CorpusTokenizer::CorpusTokenizer(const vector<string>& _filenames, int32_t _number_threads) {
+    filenames = _filenames;
+    number_threads = _number_threads > 0 ? _number_threads : 1;
+}
+
+void CorpusTokenizer::read_file_stats() {
+    file_sizes.resize(filenames.size());
+    file_times.resize(filenames.size());
+
+    for (int32_t i = 0; i < (int32_t) filenames.size(); i++) {
+        struct stat file_stat;
+        if (stat(filenames[i].c_str(), &file_stat) != 0) {
+            Log::fatal("ERROR: could not open corpus file '%s'\n", filenames[i].c_str());
+            exit(1);
+        }
+        file_sizes[i] = file_stat.st_size;
+        file_times[i] = file_stat.st_mtime;
+    }
+}
+
+void CorpusTokenizer::read_words(
+    const vector<int32_t>& training_indexes, vector<string>& words, vector<int64_t>& training_counts
+) {
+    vector<const char*> mapped_files(filenames.size(), NULL);
+    vector<TokenizedChunk> chunks;
+
+    for (int32_t i = 0; i < (int32_t) filenames.size(); i++) {
+        if (file_sizes[i] == 0) {
+            continue;
+        }
+
+        int file_descriptor = open(filenames[i].c_str(), O_RDONLY);
+        if (file_descriptor < 0) {
+            Log::fatal("ERROR: could not open corpus file '%s'\n", filenames[i].c_str());
+            exit(1);
+        }
+
+        // the mapping stays valid after the file is closed
+        void* mapped_file = mmap(NULL, file_sizes[i], PROT_READ, MAP_SHARED, file_descriptor, 0);
+        close(file_descriptor);
+
+        if (mapped_file == MAP_FAILED) {
+            Log::fatal("ERROR: could not memory map corpus file '%s'\n", filenames[i].c_str());
+            exit(1);
+        }
+        mapped_files[i] = (const char*) mapped_file;
+
+        // split the file after the first line break past every TOKENIZER_CHUNK_SIZE bytes, so no line is split
+        const char* file_end = mapped_files[i] + file_sizes[i];
+        const char* chunk_begin = mapped_files[i];
+        while (chunk_begin < file_end) {
+            const char* chunk_end = file_end;
+            if (file_end - chunk_begin > TOKENIZER_CHUNK_SIZE) {
+                const char* line_end = (const char*) memchr(
+                    chunk_begin + TOKENIZER_CHUNK_SIZE, '\n', file_end - (chunk_begin + TOKENIZER_CHUNK_SIZE)
+                );
+                if (line_end != NULL) {
+                    chunk_end = line_end + 1;
+                }
+            }
+
+            TokenizedChunk chunk;
+            chunk.file = i;
+            chunk.begin = chunk_begin;
+            chunk.end = chunk_end;
+            chunks.push_back(chunk);
+
+            chunk_begin = chunk_end;
+        }
+    }
+
+    atomic<int32_t> next_chunk(0);
+    auto tokenize_chunks = [&]() {
+        for (int32_t chunk = next_chunk++; chunk < (int32_t) chunks.size(); chunk = next_chunk++) {
+            tokenize_chunk(chunks[chunk]);
+        }
+    };
+
+    vector<thread> threads;
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads.push_back(thread(tokenize_chunks));
+    }
+    for (int32_t i = 0; i < number_threads; i++) {
+        threads[i].join();
+    }
+
+    vector<bool> is_training(filenames.size(), false);
+    for (int32_t i = 0; i < (int32_t) training_indexes.size(); i++) {
+        is_training[training_indexes[i]] = true;
+    }
+
+    // merge the chunks' words in order, so the word indexes don't depend on the number of threads
+    unordered_map<string_view, int32_t> all_words;
+    words.clear();
+    training_counts.clear();
+
+    file_tokens.assign(filenames.size(), vector<int32_t>());
+    for (int32_t i = 0; i < (int32_t) chunks.size(); i++) {
+        TokenizedChunk& chunk = chunks[i];
+
+        vector<int32_t> chunk_map(chunk.words.size());
+        for (int32_t j = 0; j < (int32_t) chunk.words.size(); j++) {
+            auto found = all_words.find(chunk.words[j]);
+            if (found == all_words.end()) {
+                found = all_words.emplace(chunk.words[j], (int32_t) words.size()).first;
+                words.push_back(string(chunk.words[j]));
+                training_counts.push_back(0);
+            }
+            chunk_map[j] = found->second;
+
+            if (is_training[chunk.file]) {
+                training_counts[found->second] += chunk.counts[j];
+            }
+        }
+
+        vector<int32_t>& tokens = file_tokens[chunk.file];
+        int64_t offset = tokens.size();
+        tokens.resize(offset + chunk.tokens.size());
+        for (int64_t j = 0; j < (int64_t) chunk.tokens.size(); j++) {
+            tokens[offset + j] = chunk_map[chunk.tokens[j]];
+        }
+
+        // free each chunk's tokens once they are merged
+        vector<int32_t>().swap(chunk.tokens);
+    }
+
+    // the word strings have been copied, so the files can be unmapped
+    all_words.clear();
+    for (int32_t i = 0; i < (int32_t) filenames.size(); i++) {
+        if (mapped_files[i] != NULL) {
+            munmap((void*) mapped_files[i], file_sizes[i]);
+        }
+    }
+}
+
+void CorpusTokenizer::remap_tokens(const vector<int32_t>& word_map) {
+    for (int32_t i = 0; i < (int32_t) file_tokens.size(); i++) {
+        vector<int32_t>& tokens = file_tokens[i];
+        for (int64_t j = 0; j < (int64_t) tokens.size(); j++) {
+            tokens[j] = word_map[tokens[j]];
+        }
+    }
+}
+
+void CorpusTokenizer::tokenize(const vector<int32_t>& training_indexes, int32_t min_count, int32_t max_size) {
+    read_file_stats();
+
+    vector<string> words;
+    vector<int64_t> training_counts;
+    read_words(training_indexes, words, training_counts);
+
+    vector<int32_t> kept;
+    for (int32_t i = 0; i < (int32_t) words.size(); i++) {
+        if (training_counts[i] > 0 && training_counts[i] >= min_count) {
+            kept.push_back(i);
+        }
+    }
+
+    sort(kept.begin(), kept.end(), [&](int32_t a, int32_t b) {
+        if (training_counts[a] != training_counts[b]) {
+            return training_counts[a] > training_counts[b];
+        }
+        return words[a] < words[b];
+    });
+
+    if (max_size > 0 && (int32_t) kept.size() > max_size) {
+        kept.resize(max_size);
+    }
+
+    // any word which is not kept (rare, past the max size, or not in the training files) becomes <unk>
+    int32_t unknown = -1;
+    for (int32_t i = 0; i < (int32_t) kept.size(); i++) {
+        if (words[kept[i]] == "<unk>") {
+            unknown = kept[i];
+        }
+    }
+
+    if (unknown < 0 && kept.size() < words.size()) {
+        if (max_size > 0 && (int32_t) kept.size() == max_size) {
+            kept.pop_back();
+        }
+
+        for (int32_t i = 0; i < (int32_t) words.size(); i++) {
+            if (words[i] == "<unk>") {
+                unknown = i;
+            }
+        }
+        if (unknown < 0) {
+            unknown = words.size();
+            words.push_back("<unk>");
+        }
+        kept.push_back(unknown);
+    }
+
+    word_index.clear();
+    vocab.clear();
+
+    vector<int32_t> word_map(words.size(), -1);
+    for (int32_t i = 0; i < (int32_t) kept.size(); i++) {
+        word_map[kept[i]] = i;
+        vocab[words[kept[i]]] = i;
+        word_index.push_back(words[kept[i]]);
+    }
+
+    for (int32_t i = 0; i < (int32_t) words.size(); i++) {
+        if (word_map[i] < 0) {
+            word_map[i] = word_map[unknown];
+        }
+    }
+
+    // the counts are of the training files, with every word replaced by <unk> counted as <unk>
+    word_counts.assign(word_index.size(), 0);
+    for (int32_t i = 0; i < (int32_t) words.size(); i++) {
+        if (i < (int32_t) training_counts.size()) {
+            word_counts[word_map[i]] += training_counts[i];
+        }
+    }
+
+    remap_tokens(word_map);
+
+    Log::info(
+        "tokenized %d files, %d distinct words, vocabulary size: %d (min count: %d, max size: %d)\n", filenames.size(),
+        words.size(), word_index.size(), min_count, max_size
+    );
+}
+
+void CorpusTokenizer::tokenize(const vector<string>& _word_index) {
+    read_file_stats();
+
+    vector<string> words;
+    vector<int64_t> training_counts;
+    read_words(vector<int32_t>(), words, training_counts);
+
+    word_index = _word_index;
+    vocab.clear();
+    for (int32_t i = 0; i < (int32_t) word_index.size(); i++) {
+        vocab[word_index[i]] = i;
+    }
+
+    // words which are not in the vocabulary become <unk>, or the first word if there is no <unk>
+    int32_t unknown = 0;
+    if (vocab.count("<unk>") > 0) {
+        unknown = vocab["<unk>"];
+    }
+
+    int32_t number_unknown = 0;
+    vector<int32_t> word_map(words.size());
+    for (int32_t i = 0; i < (int32_t) words.size(); i++) {
+        auto found = vocab.find(words[i]);
+        if (found == vocab.end()) {
+            word_map[i] = unknown;
+            number_unknown++;
+        } else {
+            word_map[i] = found->second;
+        }
+    }
+
+    if (number_unknown > 0) {
+        Log::warning(
+            "%d words were not in the vocabulary, they were replaced with '%s'\n", number_unknown,
+            word_index[unknown].c_str()
+        );
+    }
+
+    remap_tokens(word_map);
+
+    word_counts.assign(word_index.size(), 0);
+    for (int32_t i = 0; i < (int32_t) file_tokens.size(); i++) {
+        for (int64_t j = 0; j < (int64_t) file_tokens[i].size(); j++) {
+            word_counts[file_tokens[i][j]]++;
+        }
+    }
+}
+
+bool CorpusTokenizer::read_cache(
+    string cache_filename, const vector<int32_t>& training_indexes, int32_t min_count, int32_t max_size
+) {
+    ifstream infile(cache_filename.c_str(), ios::in | ios::binary);
+    if (!infile.is_open()) {
+        return false;
+    }
+
+    read_file_stats();
+
+    char magic[8];
+    infile.read(magic, sizeof(magic));
+    int32_t version;
+    if (!infile || memcmp(magic, TOKEN_CACHE_MAGIC, sizeof(magic)) != 0 || !read_value(infile, version)
+        || version != TOKEN_CACHE_VERSION) {
+        Log::warning("'%s' is not a token cache, the corpus will be tokenized\n", cache_filename.c_str());
+        return false;
+    }
+
+    bool matches = true;
+
+    int32_t number_files;
+    matches = matches && read_value(infile, number_files) && number_files == (int32_t) filenames.size();
+    for (int32_t i = 0; matches && i < number_files; i++) {
+        string filename;
+        int64_t file_size, file_time;
+        matches = read_string(infile, filename) && read_value(infile, file_size) && read_value(infile, file_time)
+                  && filename == filenames[i] && file_size == file_sizes[i] && file_time == file_times[i];
+    }
+
+    int32_t number_training;
+    matches = matches && read_value(infile, number_training) && number_training == (int32_t) training_indexes.size();
+    for (int32_t i = 0; matches && i < number_training; i++) {
+        int32_t training_index;
+        matches = read_value(infile, training_index) && training_index == training_indexes[i];
+    }
+
+    int32_t cache_min_count, cache_max_size;
+    matches = matches && read_value(infile, cache_min_count) && read_value(infile, cache_max_size)
+              && cache_min_count == min_count && cache_max_size == max_size;
+
+    if (!matches) {
+        Log::info("token cache '%s' is out of date, the corpus will be tokenized\n", cache_filename.c_str());
+        return false;
+    }
+
+    int32_t vocab_size;
+    vector<string> cache_word_index;
+    vector<int64_t> cache_word_counts;
+    bool read = read_value(infile, vocab_size) && vocab_size >= 0;
+    for (int32_t i = 0; read && i < vocab_size; i++) {
+        string word;
+        int64_t count;
+        read = read_string(infile, word) && read_value(infile, count);
+        cache_word_index.push_back(word);
+        cache_word_counts.push_back(count);
+    }
+
+    vector<vector<int32_t> > cache_tokens(filenames.size());
+    for (int32_t i = 0; read && i < (int32_t) filenames.size(); i++) {
+        int64_t number_tokens;
+        read = read_value(infile, number_tokens) && number_tokens >= 0;
+        if (read) {
+            cache_tokens[i].resize(number_tokens);
+            infile.read((char*) cache_tokens[i].data(), number_tokens * sizeof(int32_t));
+            read = (bool) infile;
+        }
+    }
+
+    if (!read) {
+        Log::warning("token cache '%s' is truncated, the corpus will be tokenized\n", cache_filename.c_str());
+        return false;
+    }
+
+    // a corrupt cache could otherwise put words outside the vocabulary into the word series
+    for (int32_t i = 0; i < (int32_t) cache_tokens.size(); i++) {
+        for (int64_t j = 0; j < (int64_t) cache_tokens[i].size(); j++) {
+            if (cache_tokens[i][j] < 0 || cache_tokens[i][j] >= vocab_size) {
+                Log::warning(
+                    "token cache '%s' has a token (%d) outside its vocabulary of %d words, the corpus will be "
+                    "tokenized\n",
+                    cache_filename.c_str(), cache_tokens[i][j], vocab_size
+                );
+                return false;
+            }
+        }
+    }
+
+    word_index = cache_word_index;
+    word_counts = cache_word_counts;
+    file_tokens = cache_tokens;
+    vocab.clear();
+    for (int32_t i = 0; i < (int32_t) word_index.size(); i++) {
+        vocab[word_index[i]] = i;
+    }
+
+    Log::info(
+        "read %d files with a vocabulary size of %d from token cache '%s'\n", filenames.size(), word_index.size(),
+        cache_filename.c_str()
+    );
+    return true;
+}
+
+void CorpusTokenizer::write_cache(
+    string cache_filename, const vector<int32_t>& training_indexes, int32_t min_count, int32_t max_size
+) const {
+    ofstream outfile(cache_filename.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!outfile.is_open()) {
+        Log::error("ERROR: could not open token cache '%s' for writing\n", cache_filename.c_str());
+        return;
+    }
+
+    outfile.write(TOKEN_CACHE_MAGIC, sizeof(TOKEN_CACHE_MAGIC));
+    write_value(outfile, TOKEN_CACHE_VERSION);
+
+    write_value(outfile, (int32_t) filenames.size());
+    for (int32_t i = 0; i < (int32_t) filenames.size(); i++) {
+        write_string(outfile, filenames[i]);
+        write_value(outfile, file_sizes[i]);
+        write_value(outfile, file_times[i]);
+    }
+
+    write_value(outfile, (int32_t) training_indexes.size());
+    for (int32_t i = 0; i < (int32_t) training_indexes.size(); i++) {
+        write_value(outfile, training_indexes[i]);
+    }
+    write_value(outfile, min_count);
+    write_value(outfile, max_size);
+
+    write_value(outfile, (int32_t) word_index.size());
+    for (int32_t i = 0; i < (int32_t) word_index.size(); i++) {
+        write_string(outfile, word_index[i]);
+        write_value(outfile, word_counts[i]);
+    }
+
+    for (int32_t i = 0; i < (int32_t) file_tokens.size(); i++) {
+        write_value(outfile, (int64_t) file_tokens[i].size());
+        outfile.write((const char*) file_tokens[i].data(), file_tokens[i].size() * sizeof(int32_t));
+    }
+
+    if (!outfile) {
+        Log::error("ERROR: could not write token cache '%s'\n", cache_filename.c_str());
+    }
+}
+
+const vector<string>& CorpusTokenizer::get_word_index() const {
+    return word_index;
+}
+
+int64_t CorpusTokenizer::get_word_count(int32_t word) const {
+    return word_counts[word];
+}
+
+int32_t CorpusTokenizer::get_number_files() const {
+    return file_tokens.size();
+}
+
+const vector<int32_t>& CorpusTokenizer::get_tokens(int32_t file) const {
+    return file_tokens[file];
+}
@@ -0,0 +1,90 @@
+#ifndef EXAMM_CORPUS_TOKENIZER_HXX
+#define EXAMM_CORPUS_TOKENIZER_HXX
+
+#include <string>
+using std::string;
+
+#include <unordered_map>
+using std::unordered_map;
+
+#include <vector>
+using std::vector;
+
+#include "stdint.h"
+
+/**
+ * Splits a set of corpus files into words (separated by spaces, tabs or carriage returns, with an "<eos>" at the end
+ * of every line) and converts them to vocabulary indexes in a single pass over each file. The files are memory mapped
+ * and split into chunks at line breaks, and the chunks are tokenized in parallel, each with its own hash table of
+ * words, which are then merged into the vocabulary.
+ *
+ * The vocabulary is built from the words of the training files, sorted by how often they occur (most frequent first,
+ * ties in alphabetical order). Words which occur fewer than min_count times, or are past the first max_size words
+ * (if max_size > 0), are replaced by "<unk>", as are the words of the other files which are not in the vocabulary.
+ *
+ * The vocabulary and every file's tokens can be written to a binary cache, which is only read back if the files
+ * (their names, sizes and modification times), the training files and the vocabulary limits are the same.
+ */
+class CorpusTokenizer {
+   private:
+    vector<string> filenames;
+    int32_t number_threads;
+
+    vector<string> word_index;
+    unordered_map<string, int32_t> vocab;
+    vector<int64_t> word_counts;
+
+    vector<vector<int32_t> > file_tokens;
+
+    // the size and modification time of each file when it was tokenized, to check if a cache is stale
+    vector<int64_t> file_sizes;
+    vector<int64_t> file_times;
+
+    void read_file_stats();
+
+    /**
+     * Tokenizes every file, giving each distinct word a temporary index in the order it is first seen (in
+     * words), and counting how many times each word occurs in the training files.
+     */
+    void read_words(
+        const vector<int32_t>& training_indexes, vector<string>& words, vector<int64_t>& training_counts
+    );
+
+    void remap_tokens(const vector<int32_t>& word_map);
+
+   public:
+    CorpusTokenizer(const vector<string>& _filenames, int32_t _number_threads);
+
+    /**
+     * Builds the vocabulary from the words of the training files and tokenizes every file.
+     */
+    void tokenize(const vector<int32_t>& training_indexes, int32_t min_count, int32_t max_size);
+
+    /**
+     * Tokenizes every file with an existing vocabulary (e.g., the input parameter names of a trained genome).
+     */
+    void tokenize(const vector<string>& _word_index);
+
+    /**
+     * Returns false (and leaves the tokenizer unchanged) if the cache file doesn't exist, was written for
+     * different files, training files or vocabulary limits, or is truncated or has tokens outside its vocabulary.
+     */
+    bool read_cache(
+        string cache_filename, const vector<int32_t>& training_indexes, int32_t min_count, int32_t max_size
+    );
+    void write_cache(
+        string cache_filename, const vector<int32_t>& training_indexes, int32_t min_count, int32_t max_size
+    ) const;
+
+    const vector<string>& get_word_index() const;
+
+    /**
+     * How many times the word occurs in the training files (or in every file, with an existing vocabulary).
+     */
+    int64_t get_word_count(int32_t word) const;
+
+    int32_t get_number_files() const;
+    const vector<int32_t>& get_tokens(int32_t file) const;
+};
+
+#endif
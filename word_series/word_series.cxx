@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <cmath>
+using std::binary_search;
 using std::find;
+using std::lower_bound;
 
 #include <fstream>
 using std::ifstream;
@@ -32,66 +34,85 @@ using std::vector;
 #include <set>
 using std::set;
 
-#include <regex>
-using std::regex_replace;
+#include <thread>
+using std::thread;
 
 #include "../common/arguments.hxx"
 #include "../common/log.hxx"
+#include "corpus_tokenizer.hxx"
 #include "word_series.hxx"
 
-WordSeries::WordSeries(string _name) {
+WordSeries::WordSeries(string _name, int32_t _number_values) {
     name = _name;
+    number_values = _number_values;
+    active_value = 1.0;
+    inactive_value = 0.0;
 }
 
-void WordSeries::add_value(double value) {
-    values.push_back(value);
+void WordSeries::add_position(int32_t row) {
+    positions.push_back(row);
 }
 
-double WordSeries::get_value(int i) {
-    return values[i];
+double WordSeries::get_value(int i) const {
+    if (binary_search(positions.begin(), positions.end(), i)) {
+        return active_value;
+    } else {
+        return inactive_value;
+    }
 }
 
 void WordSeries::calculate_statistics() {
-    min = numeric_limits<double>::max();
-    min_change = numeric_limits<double>::max();
-    average = 0.0;
-    max = -numeric_limits<double>::max();
-    max_change = -numeric_limits<double>::max();
+    int32_t occurrences = positions.size();
+    int32_t others = number_values - occurrences;
+
+    if (occurrences == 0) {
+        min = inactive_value;
+        max = inactive_value;
+    } else if (others == 0) {
+        min = active_value;
+        max = active_value;
+    } else {
+        min = fmin(active_value, inactive_value);
+        max = fmax(active_value, inactive_value);
+    }
 
-    std_dev = 0.0;
-    variance = 0.0;
+    average = (occurrences * active_value + others * inactive_value) / number_values;
 
-    for (uint32_t i = 0; i < values.size(); i++) {
-        average += values[i];
+    double active_diff = active_value - average;
+    double inactive_diff = inactive_value - average;
+    variance = (occurrences * active_diff * active_diff + others * inactive_diff * inactive_diff) / (number_values - 1);
+    std_dev = sqrt(variance);
 
-        if (min > values[i]) {
-            min = values[i];
+    // the value only changes going into or out of a run of the word's rows, every other change is 0
+    int32_t rises = 0;
+    int32_t falls = 0;
+    for (int32_t i = 0; i < occurrences; i++) {
+        if (positions[i] > 0 && (i == 0 || positions[i - 1] != positions[i] - 1)) {
+            rises++;
         }
-        if (max < values[i]) {
-            max = values[i];
-        }
-
-        if (i > 0) {
-            double diff = values[i] - values[i - 1];
-
-            if (diff < min_change) {
-                min_change = diff;
-            }
-            if (diff > max_change) {
-                max_change = diff;
-            }
+        if (positions[i] < number_values - 1 && (i == occurrences - 1 || positions[i + 1] != positions[i] + 1)) {
+            falls++;
         }
     }
 
-    average /= values.size();
+    min_change = numeric_limits<double>::max();
+    max_change = -numeric_limits<double>::max();
 
-    for (uint32_t i = 0; i < values.size(); i++) {
-        double diff = values[i] - average;
-        variance += diff * diff;
+    vector<double> changes;
+    if (rises > 0) {
+        changes.push_back(active_value - inactive_value);
+    }
+    if (falls > 0) {
+        changes.push_back(inactive_value - active_value);
+    }
+    if (rises + falls < number_values - 1) {
+        changes.push_back(0.0);
     }
-    variance /= values.size() - 1;
 
-    std_dev = sqrt(variance);
+    for (int32_t i = 0; i < (int32_t) changes.size(); i++) {
+        min_change = fmin(min_change, changes[i]);
+        max_change = fmax(max_change, changes[i]);
+    }
 }
 
 void WordSeries::print_statistics() {
@@ -102,7 +123,11 @@ void WordSeries::print_statistics() {
 }
 
 int WordSeries::get_number_values() const {
-    return values.size();
+    return number_values;
+}
+
+int WordSeries::get_number_occurrences() const {
+    return positions.size();
 }
 
 double WordSeries::get_min() const {
@@ -133,29 +158,35 @@ double WordSeries::get_max_change() const {
     return max_change;
 }
 
+double WordSeries::get_active_value() const {
+    return active_value;
+}
+
+double WordSeries::get_inactive_value() const {
+    return inactive_value;
+}
+
 void WordSeries::normalize_min_max(double min, double max) {
     Log::debug(
         "normalizing time series '%s' with min: %lf and max: %lf, series min: %lf, series max: %lf\n", name.c_str(),
         min, max, this->min, this->max
     );
 
-    for (int i = 0; i < values.size(); i++) {
-        if (values[i] < min) {
-            Log::warning(
-                "normalizing series %s, value[%d] %lf was less than min for normalization: %lf\n", name.c_str(), i,
-                values[i], min
-            );
-        }
-
-        if (values[i] > max) {
-            Log::warning(
-                "normalizing series %s, value[%d] %lf was greater than max for normalization: %lf\n", name.c_str(), i,
-                values[i], max
-            );
-        }
+    if (this->min < min) {
+        Log::warning(
+            "normalizing series %s, value %lf was less than min for normalization: %lf\n", name.c_str(), this->min, min
+        );
+    }
 
-        values[i] = (values[i] - min) / (max - min);
+    if (this->max > max) {
+        Log::warning(
+            "normalizing series %s, value %lf was greater than max for normalization: %lf\n", name.c_str(), this->max,
+            max
+        );
     }
+
+    active_value = (active_value - min) / (max - min);
+    inactive_value = (inactive_value - min) / (max - min);
 }
 
 // divide by the normalized max to make things between -1 and 1
@@ -166,15 +197,19 @@ void WordSeries::normalize_avg_std_dev(double avg, double std_dev, double norm_m
         name.c_str(), avg, std_dev, norm_max, this->average, this->std_dev
     );
 
-    for (int i = 0; i < values.size(); i++) {
-        values[i] = ((values[i] - avg) / std_dev) / norm_max;
-    }
+    active_value = ((active_value - avg) / std_dev) / norm_max;
+    inactive_value = ((inactive_value - avg) / std_dev) / norm_max;
 }
 
 void WordSeries::cut(int32_t start, int32_t stop) {
-    auto first = values.begin() + start;
-    auto last = values.begin() + stop;
-    values = vector<double>(first, last);
+    vector<int32_t> cut_positions;
+    for (int32_t i = 0; i < (int32_t) positions.size(); i++) {
+        if (positions[i] >= start && positions[i] < stop) {
+            cut_positions.push_back(positions[i] - start);
+        }
+    }
+    positions = cut_positions;
+    number_values = stop - start;
 
     // update the statistics after the cut
     calculate_statistics();
@@ -183,11 +218,26 @@ void WordSeries::cut(int32_t start, int32_t stop) {
 double WordSeries::get_correlation(const WordSeries* other, int32_t lag) const {
     double other_average = other->get_average();
 
-    int32_t length = fmin(values.size(), other->values.size()) - lag;
+    int32_t length = fmin(number_values, other->number_values) - lag;
 
+    // walk through both lists of rows instead of looking up every value
     double covariance_sum = 0.0;
+    int32_t current = lower_bound(positions.begin(), positions.end(), lag) - positions.begin();
+    int32_t other_current = 0;
     for (int32_t i = 0; i < length; i++) {
-        covariance_sum += (values[i + lag] - average) * (other->values[i] - other_average);
+        double value = inactive_value;
+        if (current < (int32_t) positions.size() && positions[current] == i + lag) {
+            value = active_value;
+            current++;
+        }
+
+        double other_value = other->inactive_value;
+        if (other_current < (int32_t) other->positions.size() && other->positions[other_current] == i) {
+            other_value = other->active_value;
+            other_current++;
+        }
+
+        covariance_sum += (value - average) * (other_value - other_average);
     }
 
     double other_variance = other->get_variance();
@@ -208,6 +258,11 @@ WordSeries* WordSeries::copy() {
     WordSeries* ws = new WordSeries();
 
     ws->name = name;
+    ws->number_values = number_values;
+    ws->positions = positions;
+    ws->active_value = active_value;
+    ws->inactive_value = inactive_value;
+
     ws->min = min;
     ws->average = average;
     ws->max = max;
@@ -216,28 +271,19 @@ WordSeries* WordSeries::copy() {
     ws->min_change = min_change;
     ws->max_change = max_change;
 
-    ws->values = values;
-
     return ws;
 }
 
 void WordSeries::copy_values(vector<double>& series) {
-    series = values;
-}
-
-void string_split_word(const string& s, char delim, vector<string>& result) {
-    stringstream ss;
-    ss.str(s);
-
-    string item;
-    while (getline(ss, item, delim)) {
-        result.push_back(item);
+    series.assign(number_values, inactive_value);
+    for (int32_t i = 0; i < (int32_t) positions.size(); i++) {
+        series[positions[i]] = active_value;
     }
 }
 
 void SentenceSeries::add_word_series(string name) {
     if (word_series.count(name) == 0) {
-        word_series[name] = new WordSeries(name);
+        word_series[name] = new WordSeries(name, number_rows);
     } else {
         Log::error(
             "ERROR! Trying to add a time series to a time series set with name '%s' which already exists in the set!\n",
@@ -247,39 +293,27 @@ void SentenceSeries::add_word_series(string name) {
 }
 
 SentenceSeries::SentenceSeries(
-    const string _filename, const vector<string>& _word_index, const map<string, int>& _vocab
+    const string _filename, const vector<string>& _word_index, const map<string, int>& _vocab,
+    const vector<int32_t>& _tokens
 ) {
     filename = _filename;
     word_index = _word_index;
     vocab = _vocab;
 
-    ifstream cs_file(filename.c_str());
-
-    vector<string> file_words;
-
-    for (string line; getline(cs_file, line);) {
-        line = regex_replace(line, std::regex("^ +| +$|( ) +"), "$1");
-        string_split_word(line, ' ', file_words);
-        file_words.push_back("<eos>");
-    }
+    // only the index of each row's word is stored
+    tokens = _tokens;
+    number_rows = tokens.size();
 
+    vector<WordSeries*> series_by_index(word_index.size());
     for (int i = 0; i < word_index.size(); i++) {
         add_word_series(word_index[i]);
+        series_by_index[i] = word_series[word_index[i]];
     }
 
-    for (int i = 0; i < file_words.size(); ++i) {
-        int current_word = vocab[file_words[i]];
-        for (int i = 0; i < word_index.size(); ++i) {
-            if (i != current_word) {
-                word_series[word_index[i]]->add_value(0);
-            } else {
-                word_series[word_index[i]]->add_value(1);
-            }
-        }
+    for (int i = 0; i < number_rows; ++i) {
+        series_by_index[tokens[i]]->add_position(i);
     }
 
-    number_rows = file_words.size();
-
     for (auto series = word_series.begin(); series != word_series.end(); series++) {
         series->second->calculate_statistics();
         if (series->second->get_min_change() == 0 && series->second->get_max_change() == 0) {
@@ -290,16 +324,6 @@ SentenceSeries::SentenceSeries(
         } else {
             series->second->print_statistics();
         }
-
-        int series_rows = series->second->get_number_values();
-
-        if (series_rows != number_rows) {
-            Log::error(
-                "ERROR! number of rows for field '%s' (%d) doesn't equal number of rows in first field '%s' (%d)\n",
-                series->first.c_str(), series->second->get_number_values(), word_series.begin()->first.c_str(),
-                word_series.begin()->second->get_number_values()
-            );
-        }
     }
 
     Log::info("read time series '%s' with number rows: %d\n", filename.c_str(), number_rows);
@@ -378,30 +402,23 @@ double SentenceSeries::get_correlation(string word1, string word2, int32_t lag)
 }
 
 void SentenceSeries::export_word_series(vector<vector<double> >& data, int word_offset) {
-    cout << "word_offset:: " << word_offset << endl;
     data.clear();
-    data.resize(word_index.size(), vector<double>(number_rows - fabs(word_offset), 0.0));
+    data.resize(word_index.size());
 
-    if (word_offset > 0) {
-        cout << "testing" << endl;
-        for (int i = 0; i < word_index.size(); ++i) {
-            for (int j = word_offset; j < number_rows; ++j) {
-                data[i][j - word_offset] = word_series[word_index[i]]->get_value(j);
-            }
-        }
-    } else if (word_offset < 0) {
-        cout << "training" << endl;
-        for (int i = 0; i < word_index.size(); ++i) {
-            for (int j = 0; j < number_rows + word_offset; ++j) {
-                data[i][j] = word_series[word_index[i]]->get_value(j);
-            }
-        }
-    } else {
-        for (int i = 0; i < word_index.size(); ++i) {
-            for (int j = 0; j < number_rows; ++j) {
-                data[i][j] = word_series[word_index[i]]->get_value(j);
-            }
-        }
+    // the inputs drop the last word_offset rows and the outputs drop the first word_offset rows
+    int first_row = word_offset > 0 ? word_offset : 0;
+    int length = number_rows - fabs(word_offset);
+
+    vector<double> active_values(word_index.size());
+    for (int i = 0; i < word_index.size(); ++i) {
+        WordSeries* series = word_series[word_index[i]];
+        data[i].assign(length, series->get_inactive_value());
+        active_values[i] = series->get_active_value();
+    }
+
+    for (int j = 0; j < length; ++j) {
+        int token = tokens[first_row + j];
+        data[token][j] = active_values[token];
     }
 }
 
@@ -409,6 +426,17 @@ void SentenceSeries::export_word_series(vector<vector<double> >& data) {
     export_word_series(data, 0);
 }
 
+void SentenceSeries::export_token_series(vector<int32_t>& data, int word_offset) {
+    int first_row = word_offset > 0 ? word_offset : 0;
+    int length = number_rows - fabs(word_offset);
+
+    data.assign(tokens.begin() + first_row, tokens.begin() + first_row + length);
+}
+
+const vector<int32_t>& SentenceSeries::get_tokens() const {
+    return tokens;
+}
+
 SentenceSeries::SentenceSeries() {
 }
 
@@ -418,6 +446,7 @@ SentenceSeries* SentenceSeries::copy() {
     ss->filename = filename;
     ss->word_index = word_index;
     ss->vocab = vocab;
+    ss->tokens = tokens;
 
     for (auto series = word_series.begin(); series != word_series.end(); series++) {
         ss->word_series[series->first] = series->second->copy();
@@ -444,7 +473,12 @@ void SentenceSeries::select_parameters(
     select_parameters(combined_parameters);
 }
 
-Corpus::Corpus() : normalize_type("none") {
+Corpus::Corpus()
+    : normalize_type("none"),
+      min_word_count(1),
+      max_vocab_size(0),
+      token_cache(""),
+      tokenizer_threads(thread::hardware_concurrency()) {
 }
 
 Corpus::~Corpus() {
@@ -475,34 +509,36 @@ void merge_parameter_names_word(
 }
 
 void Corpus::load_word_library() {
-    for (int i = 0; i < training_indexes.size(); ++i) {
-        vector<string> words;
-        string filename = filenames[training_indexes[i]];
-        ifstream cs_file(filename.c_str());
+    CorpusTokenizer tokenizer(filenames, tokenizer_threads);
 
-        for (string line; getline(cs_file, line);) {
-            line = regex_replace(line, std::regex("^ +| +$|( ) +"), "$1");
-
-            string_split_word(line, ' ', words);
-            words.push_back("<eos>");
+    if (training_indexes.size() == 0) {
+        // a test corpus uses the vocabulary of the genome it is evaluated with
+        tokenizer.tokenize(input_parameter_names);
+    } else if (token_cache == ""
+               || !tokenizer.read_cache(token_cache, training_indexes, min_word_count, max_vocab_size)) {
+        tokenizer.tokenize(training_indexes, min_word_count, max_vocab_size);
+
+        if (token_cache != "") {
+            tokenizer.write_cache(token_cache, training_indexes, min_word_count, max_vocab_size);
         }
+    }
 
-        set<string> word_index_set(words.begin(), words.end());
-
-        for (set<string>::iterator i = word_index_set.begin(); i != word_index_set.end(); ++i) {
-            word_index.push_back(*i);
-            vocab[*i] = vocab.size();
-        }
+    word_index = tokenizer.get_word_index();
+    vocab.clear();
+    for (int32_t i = 0; i < (int32_t) word_index.size(); i++) {
+        vocab[word_index[i]] = i;
     }
 
-    input_parameter_names = word_index;
-    output_parameter_names = word_index;
-    all_parameter_names = word_index;
+    if (training_indexes.size() > 0) {
+        input_parameter_names = word_index;
+        output_parameter_names = word_index;
+        all_parameter_names = word_index;
+    }
 
     for (uint32_t i = 0; i < filenames.size(); i++) {
         Log::debug("\t%s\n", filenames[i].c_str());
 
-        SentenceSeries* ss = new SentenceSeries(filenames[i], word_index, vocab);
+        SentenceSeries* ss = new SentenceSeries(filenames[i], word_index, vocab, tokenizer.get_tokens(i));
         sent_series.push_back(ss);
     }
 }
@@ -547,6 +583,11 @@ Corpus* Corpus::generate_from_arguments(const vector<string>& arguments) {
     cs->input_parameter_names.clear();
     cs->output_parameter_names.clear();
 
+    get_argument(arguments, "--min_word_count", false, cs->min_word_count);
+    get_argument(arguments, "--max_vocab_size", false, cs->max_vocab_size);
+    get_argument(arguments, "--token_cache", false, cs->token_cache);
+    get_argument(arguments, "--tokenizer_threads", false, cs->tokenizer_threads);
+
     cs->load_word_library();
 
     return cs;
@@ -914,6 +955,34 @@ void Corpus::export_sent_series(
     outputs = batchify(64, temp_outputs);
 }
 
+void Corpus::export_sent_token_series(
+    const vector<int>& series_indexes, int word_offset, vector<vector<int32_t> >& inputs,
+    vector<vector<int32_t> >& outputs
+) {
+    inputs.clear();
+    outputs.clear();
+
+    vector<int32_t> series_inputs;
+    vector<int32_t> series_outputs;
+
+    // split each series into batches of (up to) 64 rows the same way as batchify, the last batch of each series is
+    // left shorter instead of being padded
+    int batch_size = 64;
+    for (uint32_t i = 0; i < series_indexes.size(); i++) {
+        int series_index = series_indexes[i];
+
+        sent_series[series_index]->export_token_series(series_inputs, -word_offset);
+        sent_series[series_index]->export_token_series(series_outputs, word_offset);
+
+        for (int start = 0; start < (int) series_inputs.size(); start += batch_size) {
+            int stop = fmin(start + batch_size, series_inputs.size());
+
+            inputs.push_back(vector<int32_t>(series_inputs.begin() + start, series_inputs.begin() + stop));
+            outputs.push_back(vector<int32_t>(series_outputs.begin() + start, series_outputs.begin() + stop));
+        }
+    }
+}
+
 /**
  * This exports the time series marked as training series by the training_indexes vector.
  */
@@ -944,6 +1013,30 @@ void Corpus::export_test_series(
     export_sent_series(test_indexes, word_offset, inputs, outputs);
 }
 
+void Corpus::export_training_token_series(
+    int word_offset, vector<vector<int32_t> >& inputs, vector<vector<int32_t> >& outputs
+) {
+    if (training_indexes.size() == 0) {
+        Log::fatal(
+            "ERROR: attempting to export training time series, however the training_indexes were not specified.\n"
+        );
+        exit(1);
+    }
+
+    export_sent_token_series(training_indexes, word_offset, inputs, outputs);
+}
+
+void Corpus::export_test_token_series(
+    int word_offset, vector<vector<int32_t> >& inputs, vector<vector<int32_t> >& outputs
+) {
+    if (test_indexes.size() == 0) {
+        Log::fatal("ERROR: attempting to export test time series, however the test_indexes were not specified.\n");
+        exit(1);
+    }
+
+    export_sent_token_series(test_indexes, word_offset, inputs, outputs);
+}
+
 void Corpus::export_series_by_name(string field_name, vector<vector<double> >& exported_series) {
     exported_series.clear();
 
@@ -13,10 +13,18 @@ using std::map;
 #include <vector>
 using std::vector;
 
+/**
+ * The one-hot series of a single word, stored as the rows where the word occurs instead of a value for every row. The
+ * word's rows have active_value and every other row has inactive_value (1 and 0 until the series is normalized).
+ */
 class WordSeries {
    private:
     string name;
-    int vocab_size;
+    int32_t number_values;
+
+    vector<int32_t> positions;
+    double active_value;
+    double inactive_value;
 
     double min;
     double average;
@@ -26,19 +34,20 @@ class WordSeries {
     double min_change;
     double max_change;
 
-    vector<double> values;
     WordSeries();
 
    public:
-    WordSeries(string _name);
+    WordSeries(string _name, int32_t _number_values);
 
-    void add_value(double value);
-    double get_value(int i);
+    // the rows must be added in increasing order
+    void add_position(int32_t row);
+    double get_value(int i) const;
 
     void calculate_statistics();
     void print_statistics();
 
     int get_number_values() const;
+    int get_number_occurrences() const;
 
     double get_min() const;
     double get_average() const;
@@ -48,6 +57,9 @@ class WordSeries {
     double get_min_change() const;
     double get_max_change() const;
 
+    double get_active_value() const;
+    double get_inactive_value() const;
+
     void normalize_min_max(double min, double max);
     void normalize_avg_std_dev(double avg, double std_dev, double norm_max);
 
@@ -68,10 +80,16 @@ class SentenceSeries {
     vector<string> word_index;
     map<string, WordSeries*> word_series;
 
+    // the index (in word_index) of the word at each row
+    vector<int32_t> tokens;
+
     SentenceSeries();
 
    public:
-    SentenceSeries(const string _filename, const vector<string>& _word_index, const map<string, int>& _vocab);
+    SentenceSeries(
+        const string _filename, const vector<string>& _word_index, const map<string, int>& _vocab,
+        const vector<int32_t>& _tokens
+    );
     ~SentenceSeries();
     void add_word_series(string name);
 
@@ -100,6 +118,13 @@ class SentenceSeries {
     void export_word_series(vector<vector<double> >& data, int word_offset);
     void export_word_series(vector<vector<double> >& data);
 
+    /**
+     * Exports the index of the word at each row, with the same word_offset as export_word_series (negative for the
+     * inputs and positive for the expected outputs), for RNN::forward_pass with token indexes.
+     */
+    void export_token_series(vector<int32_t>& data, int word_offset);
+    const vector<int32_t>& get_tokens() const;
+
     SentenceSeries* copy();
 
     void select_parameters(const vector<string>& input_parameter_names, const vector<string>& output_parameter_names);
@@ -130,6 +155,13 @@ class Corpus {
     vector<string> word_index;
     map<string, int> vocab;
 
+    // vocabulary limits (words occurring fewer than min_word_count times in the training files or past the first
+    // max_vocab_size words become <unk>) and the optional token cache, see CorpusTokenizer
+    int32_t min_word_count;
+    int32_t max_vocab_size;
+    string token_cache;
+    int32_t tokenizer_threads;
+
     void load_word_library();
 
    public:
@@ -166,6 +198,19 @@ class Corpus {
         int word_offset, vector<vector<vector<double> > >& inputs, vector<vector<vector<double> > >& outputs
     );
 
+    /**
+     * The same batches of 64 rows as export_sent_series, with the index of each row's word instead of a one-hot value
+     * for every word in the vocabulary.
+     */
+    void export_sent_token_series(
+        const vector<int>& series_indexes, int word_offset, vector<vector<int32_t> >& inputs,
+        vector<vector<int32_t> >& outputs
+    );
+    void export_training_token_series(
+        int word_offset, vector<vector<int32_t> >& inputs, vector<vector<int32_t> >& outputs
+    );
+    void export_test_token_series(int word_offset, vector<vector<int32_t> >& inputs, vector<vector<int32_t> >& outputs);
+
     void export_series_by_name(string field_name, vector<vector<double> >& exported_series);
 
     double denormalize(string field_name, double value);